@@ -1807,18 +1807,33 @@ uint64_t *v3d_compile(const struct v3d_compiler *compiler,
                                            void *debug_output_data),
                       void *debug_output_data,
                       int program_id, int variant_id,
+                      uint32_t strategy_hint,
                       uint32_t *final_assembly_size)
 {
         struct v3d_compile *c = NULL;
 
+        /* The caller may know from previous compiles of the same shader
+         * which strategy it ended up needing. This is only a guess for this
+         * variant, which may have a lot less register pressure, so we still
+         * try the default strategy first, but if that fails we go straight
+         * to the hinted one instead of going through the ones in between.
+         */
+        strategy_hint = MIN2(strategy_hint, ARRAY_SIZE(strategies) - 1);
+
         uint32_t best_spill_fill_count = UINT32_MAX;
         struct v3d_compile *best_c = NULL;
+        bool jumped_to_hint = false;
         for (int32_t strat = 0; strat < ARRAY_SIZE(strategies); strat++) {
                 /* Fallback strategy */
                 if (strat > 0) {
                         assert(c);
-                        if (skip_compile_strategy(c, strat))
+
+                        /* The skip checks look at what the previous strategy
+                         * did, which isn't the one we jumped from.
+                         */
+                        if (!jumped_to_hint && skip_compile_strategy(c, strat))
                                 continue;
+                        jumped_to_hint = false;
 
                         char *debug_msg;
                         int ret = asprintf(&debug_msg,
@@ -1894,6 +1909,11 @@ uint64_t *v3d_compile(const struct v3d_compiler *compiler,
                 assert(c->compilation_result ==
                        V3D_COMPILATION_FAILED_REGISTER_ALLOCATION ||
                        c->spills > 0);
+
+                if (strat == 0 && strategy_hint > 1) {
+                        strat = strategy_hint - 1;
+                        jumped_to_hint = true;
+                }
         }
 
         /* If the best strategy was not the last, choose that */
@@ -21,6 +21,7 @@
  * IN THE SOFTWARE.
  */
 
+#include "vk_common_entrypoints.h"
 #include "vk_descriptors.h"
 #include "vk_util.h"
 
@@ -1385,6 +1386,84 @@ v3dv_GetDescriptorSetLayoutSupport(
    pSupport->supported = supported;
 }
 
+VKAPI_ATTR VkResult VKAPI_CALL
+v3dv_CreateDescriptorUpdateTemplate(
+   VkDevice _device,
+   const VkDescriptorUpdateTemplateCreateInfo *pCreateInfo,
+   const VkAllocationCallbacks *pAllocator,
+   VkDescriptorUpdateTemplate *pDescriptorUpdateTemplate)
+{
+   V3DV_FROM_HANDLE(v3dv_device, device, _device);
+   V3DV_FROM_HANDLE(v3dv_descriptor_set_layout, set_layout,
+                    pCreateInfo->descriptorSetLayout);
+
+   /* We don't support push descriptors */
+   assert(pCreateInfo->templateType ==
+          VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET);
+
+   VkResult result =
+      vk_common_CreateDescriptorUpdateTemplate(_device, pCreateInfo, pAllocator,
+                                               pDescriptorUpdateTemplate);
+   if (result != VK_SUCCESS)
+      return result;
+
+   V3DV_FROM_HANDLE(vk_descriptor_update_template, template,
+                    *pDescriptorUpdateTemplate);
+
+   struct vk_descriptor_template_binding *bindings =
+      vk_alloc2(&device->vk.alloc, pAllocator,
+                set_layout->binding_count * sizeof(*bindings), 8,
+                VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+   if (set_layout->binding_count > 0 && !bindings) {
+      result = vk_error(device, VK_ERROR_OUT_OF_HOST_MEMORY);
+      goto fail;
+   }
+
+   for (uint32_t i = 0; i < set_layout->binding_count; i++) {
+      const struct v3dv_descriptor_set_binding_layout *binding_layout =
+         &set_layout->binding[i];
+
+      /* Only buffer descriptors are written without their binding layout,
+       * the others have state in the descriptor BO at an offset that
+       * depends on the binding, so keep them from merging across bindings.
+       */
+      bool needs_binding;
+      switch (binding_layout->type) {
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+         needs_binding = false;
+         break;
+      default:
+         needs_binding = true;
+         break;
+      }
+
+      bindings[i] = (struct vk_descriptor_template_binding) {
+         .array_size = binding_layout->array_size,
+         .offset = binding_layout->descriptor_index,
+         .stride = 1,
+         .flags = needs_binding ? i + 1 : 0,
+      };
+   }
+
+   result = vk_descriptor_template_program_create(&device->vk, pAllocator,
+                                                  pCreateInfo, bindings,
+                                                  set_layout->binding_count,
+                                                  &template->program);
+   vk_free2(&device->vk.alloc, pAllocator, bindings);
+   if (result != VK_SUCCESS)
+      goto fail;
+
+   return VK_SUCCESS;
+
+fail:
+   vk_common_DestroyDescriptorUpdateTemplate(_device, *pDescriptorUpdateTemplate,
+                                             pAllocator);
+   return result;
+}
+
 void
 v3dv_UpdateDescriptorSetWithTemplate(
    VkDevice _device,
@@ -1396,28 +1475,25 @@ v3dv_UpdateDescriptorSetWithTemplate(
    V3DV_FROM_HANDLE(v3dv_descriptor_set, set, descriptorSet);
    V3DV_FROM_HANDLE(vk_descriptor_update_template, template,
                     descriptorUpdateTemplate);
+   const struct vk_descriptor_template_program *program = template->program;
 
-   for (int i = 0; i < template->entry_count; i++) {
-      const struct vk_descriptor_template_entry *entry =
-         &template->entries[i];
+   for (uint32_t i = 0; i < program->op_count; i++) {
+      const struct vk_descriptor_template_op *op = &program->ops[i];
 
       const struct v3dv_descriptor_set_binding_layout *binding_layout =
-         set->layout->binding + entry->binding;
+         set->layout->binding + op->binding;
 
-      struct v3dv_descriptor *descriptor =
-         set->descriptors +
-         binding_layout->descriptor_index;
+      struct v3dv_descriptor *descriptor = set->descriptors + op->dst_offset;
+      const void *src = pData + op->src_offset;
 
-      switch (entry->type) {
+      switch (op->type) {
       case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
       case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
       case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
       case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
-         for (uint32_t j = 0; j < entry->array_count; j++) {
-            const VkDescriptorBufferInfo *info =
-               pData + entry->offset + j * entry->stride;
-            write_buffer_descriptor(descriptor + entry->array_element + j,
-                                    entry->type, info);
+         for (uint32_t j = 0; j < op->count; j++) {
+            const VkDescriptorBufferInfo *info = src + j * op->src_stride;
+            write_buffer_descriptor(descriptor + j, op->type, info);
          }
          break;
 
@@ -1426,36 +1502,34 @@ v3dv_UpdateDescriptorSetWithTemplate(
       case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
       case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
       case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-         for (uint32_t j = 0; j < entry->array_count; j++) {
-            const VkDescriptorImageInfo *info =
-               pData + entry->offset + j * entry->stride;
+         for (uint32_t j = 0; j < op->count; j++) {
+            const VkDescriptorImageInfo *info = src + j * op->src_stride;
             V3DV_FROM_HANDLE(v3dv_image_view, iview, info->imageView);
             V3DV_FROM_HANDLE(v3dv_sampler, sampler, info->sampler);
-            write_image_descriptor(device, descriptor + entry->array_element + j,
-                                   entry->type, set, binding_layout, iview,
-                                   sampler, entry->array_element + j);
+            write_image_descriptor(device, descriptor + j, op->type,
+                                   set, binding_layout, iview, sampler,
+                                   op->array_element + j);
          }
          break;
 
       case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
       case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-         for (uint32_t j = 0; j < entry->array_count; j++) {
-            const VkBufferView *_bview =
-               pData + entry->offset + j * entry->stride;
+         for (uint32_t j = 0; j < op->count; j++) {
+            const VkBufferView *_bview = src + j * op->src_stride;
             V3DV_FROM_HANDLE(v3dv_buffer_view, bview, *_bview);
-            write_buffer_view_descriptor(device,
-                                         descriptor + entry->array_element + j,
-                                         entry->type, set, binding_layout, bview,
-                                         entry->array_element + j);
+            write_buffer_view_descriptor(device, descriptor + j, op->type,
+                                         set, binding_layout, bview,
+                                         op->array_element + j);
          }
          break;
 
       case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK: {
-         write_inline_uniform_descriptor(device, descriptor, set,
-                                         binding_layout,
-                                         pData + entry->offset,
-                                         entry->array_element, /* offset */
-                                         entry->array_count);  /* size */
+         write_inline_uniform_descriptor(device,
+                                         set->descriptors +
+                                         binding_layout->descriptor_index,
+                                         set, binding_layout, src,
+                                         op->array_element, /* offset */
+                                         op->count);        /* size */
          break;
       }
 
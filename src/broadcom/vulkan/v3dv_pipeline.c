@@ -1634,7 +1634,7 @@ pipeline_compile_shader_variant(struct v3dv_pipeline_stage *p_stage,
                            key, &prog_data,
                            p_stage->nir,
                            shader_debug_output, NULL,
-                           p_stage->program_id, 0,
+                           p_stage->program_id, 0, 0,
                            &qpu_insts_size);
 
    struct v3dv_shader_variant *variant = NULL;
@@ -29,6 +29,8 @@
 #include "clc_helpers.h"
 #include "nir_clc_helpers.h"
 #include "spirv/nir_spirv.h"
+#include "util/disk_cache.h"
+#include "util/mesa-cache-key.h"
 #include "util/u_debug.h"
 
 #include <stdlib.h>
@@ -221,14 +223,91 @@ clc_free_spirv(struct clc_binary *spirv)
    clc_free_spirv_binary(spirv);
 }
 
+#ifdef ENABLE_SHADER_CACHE
+static void
+hash_string(struct mesa_cache_key_ctx *ctx, const char *str)
+{
+   /* Including the terminator keeps consecutive strings apart */
+   _mesa_cache_key_update(ctx, str, strlen(str) + 1);
+}
+
+static bool
+clc_compile_args_cache_key(struct disk_cache *disk_cache,
+                           const struct clc_compile_args *args,
+                           cache_key key)
+{
+   unsigned char args_key[MESA_CACHE_KEY_SIZE];
+   struct mesa_cache_key_ctx ctx;
+
+   /* The key only covers what's in args, included files could change
+    * behind our back.
+    */
+   for (unsigned i = 0; i < args->num_args; i++) {
+      if (!strncmp(args->args[i], "-I", 2))
+         return false;
+   }
+
+   _mesa_cache_key_init(&ctx);
+   hash_string(&ctx, "clc_compile_c_to_spirv");
+   hash_string(&ctx, args->source.name);
+   hash_string(&ctx, args->source.value);
+   for (unsigned i = 0; i < args->num_headers; i++) {
+      hash_string(&ctx, args->headers[i].name);
+      hash_string(&ctx, args->headers[i].value);
+   }
+   _mesa_cache_key_update(&ctx, &args->num_args, sizeof(args->num_args));
+   for (unsigned i = 0; i < args->num_args; i++)
+      hash_string(&ctx, args->args[i]);
+   _mesa_cache_key_update(&ctx, &args->spirv_version, sizeof(args->spirv_version));
+   _mesa_cache_key_update(&ctx, &args->features, sizeof(args->features));
+   if (args->allowed_spirv_extensions) {
+      for (unsigned i = 0; args->allowed_spirv_extensions[i]; i++)
+         hash_string(&ctx, args->allowed_spirv_extensions[i]);
+   } else {
+      hash_string(&ctx, "all extensions");
+   }
+   _mesa_cache_key_update(&ctx, &args->address_bits, sizeof(args->address_bits));
+   _mesa_cache_key_final(&ctx, args_key);
+
+   disk_cache_compute_key(disk_cache, args_key, sizeof(args_key), key);
+   return true;
+}
+#endif
+
 bool
 clc_compile_c_to_spirv(const struct clc_compile_args *args,
                        const struct clc_logger *logger,
+                       struct disk_cache *disk_cache,
                        struct clc_binary *out_spirv)
 {
+#ifdef ENABLE_SHADER_CACHE
+   cache_key cache_key;
+   if (disk_cache && !clc_compile_args_cache_key(disk_cache, args, cache_key))
+      disk_cache = NULL;
+
+   if (disk_cache) {
+      size_t size;
+      void *data = disk_cache_get(disk_cache, cache_key, &size);
+      if (data && size % 4 == 0) {
+         out_spirv->data = data;
+         out_spirv->size = size;
+         goto out;
+      }
+      free(data);
+   }
+#endif
+
    if (clc_c_to_spirv(args, logger, out_spirv) < 0)
       return false;
 
+#ifdef ENABLE_SHADER_CACHE
+   if (disk_cache) {
+      disk_cache_put(disk_cache, cache_key, out_spirv->data, out_spirv->size,
+                     NULL);
+   }
+
+out:
+#endif
    if (debug_get_option_debug_clc() & CLC_DEBUG_DUMP_SPIRV)
       clc_dump_spirv(out_spirv, stdout);
 
@@ -34,6 +34,7 @@ extern "C" {
 
 typedef struct nir_shader nir_shader;
 struct nir_shader_compiler_options;
+struct disk_cache;
 
 struct clc_named_value {
    const char *name;
@@ -218,9 +219,13 @@ clc_compile_spir_to_spirv(const struct clc_binary *in_spir,
 void
 clc_free_spirv(struct clc_binary *spirv);
 
+/* disk_cache is optional, the SPIR-V is cached there when it is set and
+ * the source can't include files from the file system.
+ */
 bool
 clc_compile_c_to_spirv(const struct clc_compile_args *args,
                        const struct clc_logger *logger,
+                       struct disk_cache *disk_cache,
                        struct clc_binary *out_spirv);
 
 bool
@@ -26,6 +26,7 @@
 #include <filesystem>
 #include <sstream>
 #include <mutex>
+#include <unordered_map>
 
 #include <llvm/ADT/ArrayRef.h>
 #include <llvm/IR/DiagnosticPrinter.h>
@@ -33,6 +34,7 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Type.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm-c/Core.h>
@@ -43,9 +45,13 @@
 #include <clang/CodeGen/CodeGenAction.h>
 #include <clang/Lex/PreprocessorOptions.h>
 #include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
 #include <clang/Frontend/TextDiagnosticBuffer.h>
 #include <clang/Frontend/TextDiagnosticPrinter.h>
+#include <clang/Basic/DiagnosticFrontend.h>
 #include <clang/Basic/TargetInfo.h>
+#include <clang/Serialization/ASTWriter.h>
+#include <clang/Serialization/PCHContainerOperations.h>
 
 #include <spirv-tools/libspirv.hpp>
 #include <spirv-tools/linker.hpp>
@@ -751,26 +757,9 @@ clc_free_kernels_info(const struct clc_kernel_info *kernels,
    free((void *)kernels);
 }
 
-static std::unique_ptr<::llvm::Module>
-clc_compile_to_llvm_module(LLVMContext &llvm_ctx,
-                           const struct clc_compile_args *args,
-                           const struct clc_logger *logger)
+static std::vector<const char *>
+clc_clang_args(const struct clc_compile_args *args)
 {
-   static_assert(std::has_unique_object_representations<clc_optional_features>(),
-                 "no padding allowed inside clc_optional_features");
-
-   std::string diag_log_str;
-   raw_string_ostream diag_log_stream { diag_log_str };
-
-   std::unique_ptr<clang::CompilerInstance> c { new clang::CompilerInstance };
-
-   clang::DiagnosticsEngine diag {
-      new clang::DiagnosticIDs,
-      new clang::DiagnosticOptions,
-      new clang::TextDiagnosticPrinter(diag_log_stream,
-                                       &c->getDiagnosticOpts())
-   };
-
    const char *triple = args->address_bits == 32 ? "spir-unknown-unknown" : "spir64-unknown-unknown";
 
    std::vector<const char *> clang_opts = {
@@ -811,6 +800,28 @@ clc_compile_to_llvm_module(LLVMContext &llvm_ctx,
    // being provided by the caller here.
    clang_opts.insert(clang_opts.end(), args->args, args->args + args->num_args);
 
+   return clang_opts;
+}
+
+/* Sets up everything but the main file */
+static bool
+clc_init_compiler_instance(clang::CompilerInstance *c,
+                           const std::vector<const char *> &clang_opts,
+                           const struct clc_compile_args *args,
+                           raw_string_ostream &diag_log_stream,
+                           const std::string &diag_log_str,
+                           const struct clc_logger *logger)
+{
+   static_assert(std::has_unique_object_representations<clc_optional_features>(),
+                 "no padding allowed inside clc_optional_features");
+
+   clang::DiagnosticsEngine diag {
+      new clang::DiagnosticIDs,
+      new clang::DiagnosticOptions,
+      new clang::TextDiagnosticPrinter(diag_log_stream,
+                                       &c->getDiagnosticOpts())
+   };
+
    if (!clang::CompilerInvocation::CreateFromArgs(c->getInvocation(),
 #if LLVM_VERSION_MAJOR >= 10
                                                   clang_opts,
@@ -820,13 +831,13 @@ clc_compile_to_llvm_module(LLVMContext &llvm_ctx,
 #endif
                                                   diag)) {
       clc_error(logger, "Couldn't create Clang invocation.\n");
-      return {};
+      return false;
    }
 
    if (diag.hasErrorOccurred()) {
       clc_error(logger, "%sErrors occurred during Clang invocation.\n",
                 diag_log_str.c_str());
-      return {};
+      return false;
    }
 
    // This is a workaround for a Clang bug which causes the number
@@ -952,21 +963,301 @@ clc_compile_to_llvm_module(LLVMContext &llvm_ctx,
       }
    }
 
+   return true;
+}
+
+/* Precompiling the builtin headers is experimental, builds have to ask for
+ * it with -DCLC_BUILTINS_PCH.  PCHGenerator taking the module cache and
+ * createFileManager() taking a VFS are LLVM 10+.
+ */
+#if defined(CLC_BUILTINS_PCH) && LLVM_VERSION_MAJOR < 10
+#undef CLC_BUILTINS_PCH
+#endif
+
+#ifdef CLC_BUILTINS_PCH
+static std::string
+clc_builtins_pch_path(const char *ext)
+{
+   ::llvm::SmallString<128> path;
+   ::llvm::sys::path::system_temp_directory(true, path);
+   ::llvm::sys::path::append(path, "openclon12", ::llvm::Twine("clc-builtins") + ext);
+   return path.str().str();
+}
+
+/* Writes the AST of the builtin headers into a buffer, instead of a file
+ * like clang::GeneratePCHAction.
+ */
+class ClcBuiltinsPCHAction : public clang::ASTFrontendAction {
+public:
+   ClcBuiltinsPCHAction(std::shared_ptr<clang::PCHBuffer> buffer) :
+      buffer(buffer) { }
+
+protected:
+   std::unique_ptr<clang::ASTConsumer>
+   CreateASTConsumer(clang::CompilerInstance &c, ::llvm::StringRef in_file) override
+   {
+      return std::make_unique<clang::PCHGenerator>(
+         c.getPreprocessor(), c.getModuleCache(), clc_builtins_pch_path(".pch"),
+         "", buffer, c.getFrontendOpts().ModuleFileExtensions,
+         /* AllowASTWithErrors */ false, /* IncludeTimestamps */ false);
+   }
+
+   bool
+   BeginSourceFileAction(clang::CompilerInstance &c) override
+   {
+      c.getLangOpts().CompilingPCH = true;
+      return true;
+   }
+
+   clang::TranslationUnitKind
+   getTranslationUnitKind() override
+   {
+      return clang::TU_Prefix;
+   }
+
+   bool
+   hasASTFileSupport() const override
+   {
+      return false;
+   }
+
+private:
+   std::shared_ptr<clang::PCHBuffer> buffer;
+};
+
+/* A PCH only loads into a compile with the same language and target options,
+ * so it is keyed on all the clang arguments and features.  Only the implicit
+ * includes of the builtin headers go in, an app-provided -include could
+ * change between compiles.
+ */
+static bool
+clc_builtins_pch_key(const clang::CompilerInstance *c,
+                     const std::vector<const char *> &clang_opts,
+                     const struct clc_compile_args *args,
+                     std::string &key)
+{
+   const clang::PreprocessorOptions &pp_opts = c->getPreprocessorOpts();
+
+   if (pp_opts.Includes.empty() || !pp_opts.MacroIncludes.empty() ||
+       !pp_opts.ImplicitPCHInclude.empty())
+      return false;
+
+   for (const std::string &include : pp_opts.Includes) {
+      if (include != "opencl-c.h" && include != "opencl-c-base.h")
+         return false;
+   }
+
+   /* Skip the input file name */
+   for (size_t i = 1; i < clang_opts.size(); i++) {
+      key += clang_opts[i];
+      key += '\0';
+   }
+   key.append(reinterpret_cast<const char *>(&args->features),
+              sizeof(args->features));
+   key += args->num_headers ? '1' : '0';
+
+   return true;
+}
+
+static std::shared_ptr<const std::string>
+clc_build_builtins_pch(const std::vector<const char *> &clang_opts,
+                       const struct clc_compile_args *args)
+{
+   std::string diag_log_str;
+   raw_string_ostream diag_log_stream { diag_log_str };
+
+   std::unique_ptr<clang::CompilerInstance> c { new clang::CompilerInstance };
+
+   if (!clc_init_compiler_instance(c.get(), clang_opts, args, diag_log_stream,
+                                   diag_log_str, NULL))
+      return {};
+
+   // The main file is an empty header, the builtin headers come in through
+   // the implicit includes exactly like they would in a normal compile.
+   const std::string header_path = clc_builtins_pch_path(".h");
+   auto &inputs = c->getFrontendOpts().Inputs;
+   const clang::InputKind kind = inputs[0].getKind().getHeader();
+   inputs.clear();
+   inputs.emplace_back(header_path, kind);
+   c->getPreprocessorOpts().addRemappedFile(header_path,
+      ::llvm::MemoryBuffer::getMemBuffer("").release());
+   c->getFrontendOpts().ProgramAction = clang::frontend::GeneratePCH;
+
+   auto buffer = std::make_shared<clang::PCHBuffer>();
+   ClcBuiltinsPCHAction act(buffer);
+   if (!c->ExecuteAction(act) || !buffer->IsComplete)
+      return {};
+
+   return std::make_shared<const std::string>(buffer->Data.data(),
+                                              buffer->Data.size());
+}
+
+/* Precompiled builtin headers by configuration.  Apps tend to build all
+ * their programs with the same options, so a handful is plenty.
+ */
+#define CLC_BUILTINS_PCH_CACHE_SIZE 16
+
+struct clc_builtins_pch_entry {
+   std::once_flag built;
+   std::shared_ptr<const std::string> pch;
+};
+
+static std::mutex builtins_pch_mutex;
+static std::unordered_map<std::string, std::shared_ptr<clc_builtins_pch_entry>> builtins_pch_cache;
+
+static std::shared_ptr<const std::string>
+clc_get_builtins_pch(const clang::CompilerInstance *c,
+                     const std::vector<const char *> &clang_opts,
+                     const struct clc_compile_args *args)
+{
+   std::string key;
+   if (!clc_builtins_pch_key(c, clang_opts, args, key))
+      return {};
+
+   std::shared_ptr<clc_builtins_pch_entry> entry;
+   {
+      std::lock_guard<std::mutex> lock(builtins_pch_mutex);
+
+      auto it = builtins_pch_cache.find(key);
+      if (it != builtins_pch_cache.end()) {
+         entry = it->second;
+      } else {
+         if (builtins_pch_cache.size() >= CLC_BUILTINS_PCH_CACHE_SIZE)
+            builtins_pch_cache.clear();
+
+         entry = std::make_shared<clc_builtins_pch_entry>();
+         builtins_pch_cache.emplace(key, entry);
+      }
+   }
+
+   // The PCH is built outside of the cache lock, only compiles that need
+   // the same one wait for it.  Failures are remembered too, so they don't
+   // cost every compile.
+   std::call_once(entry->built, [&]() {
+      entry->pch = clc_build_builtins_pch(clang_opts, args);
+   });
+   return entry->pch;
+}
+
+/* Notes errors that come from loading the PCH rather than from the source,
+ * only those are worth compiling again without it.
+ */
+class ClcPCHDiagnosticConsumer : public clang::ForwardingDiagnosticConsumer {
+public:
+   ClcPCHDiagnosticConsumer(clang::DiagnosticConsumer &target) :
+      clang::ForwardingDiagnosticConsumer(target) { }
+
+   void
+   HandleDiagnostic(clang::DiagnosticsEngine::Level level,
+                    const clang::Diagnostic &info) override
+   {
+      const unsigned id = info.getID();
+
+      if (level >= clang::DiagnosticsEngine::Error &&
+          ((id >= clang::diag::DIAG_START_SERIALIZATION &&
+            id < clang::diag::DIAG_START_LEX) ||
+           id == clang::diag::err_fe_unable_to_load_pch))
+         pch_failed = true;
+
+      clang::ForwardingDiagnosticConsumer::HandleDiagnostic(level, info);
+   }
+
+   bool pch_failed = false;
+};
+#endif
+
+static std::unique_ptr<::llvm::Module>
+clc_compile_to_llvm_module(LLVMContext &llvm_ctx,
+                           const struct clc_compile_args *args,
+                           const struct clc_logger *logger,
+                           bool use_pch, bool *pch_failed)
+{
+   *pch_failed = false;
+
+   std::string diag_log_str;
+   raw_string_ostream diag_log_stream { diag_log_str };
+
+   std::unique_ptr<clang::CompilerInstance> c { new clang::CompilerInstance };
+
+   const std::vector<const char *> clang_opts = clc_clang_args(args);
+   if (!clc_init_compiler_instance(c.get(), clang_opts, args, diag_log_stream,
+                                   diag_log_str, logger))
+      return {};
+
+#ifdef CLC_BUILTINS_PCH
+   std::shared_ptr<const std::string> pch;
+   std::unique_ptr<clang::DiagnosticConsumer> diag_printer;
+   std::unique_ptr<ClcPCHDiagnosticConsumer> pch_diag;
+   if (use_pch)
+      pch = clc_get_builtins_pch(c.get(), clang_opts, args);
+
+   if (pch) {
+      // The PCH replaces the implicit includes.  It lives in memory, so give
+      // clang a file system that has it on top of the real one.
+      const std::string pch_path = clc_builtins_pch_path(".pch");
+      ::llvm::IntrusiveRefCntPtr<::llvm::vfs::InMemoryFileSystem> mem_fs {
+         new ::llvm::vfs::InMemoryFileSystem
+      };
+      mem_fs->addFile(pch_path, 0,
+                      ::llvm::MemoryBuffer::getMemBuffer(*pch, pch_path, false));
+      ::llvm::IntrusiveRefCntPtr<::llvm::vfs::OverlayFileSystem> fs {
+         new ::llvm::vfs::OverlayFileSystem(::llvm::vfs::getRealFileSystem())
+      };
+      fs->pushOverlay(mem_fs);
+      c->createFileManager(fs);
+
+      c->getPreprocessorOpts().Includes.clear();
+      c->getPreprocessorOpts().ImplicitPCHInclude = pch_path;
+
+      diag_printer = c->getDiagnostics().takeClient();
+      pch_diag.reset(new ClcPCHDiagnosticConsumer(*diag_printer));
+      c->getDiagnostics().setClient(pch_diag.get(), false);
+   }
+#endif
+
    c->getPreprocessorOpts().addRemappedFile(
            args->source.name,
            ::llvm::MemoryBuffer::getMemBufferCopy(std::string(args->source.value)).release());
 
    // Compile the code
    clang::EmitLLVMOnlyAction act(&llvm_ctx);
-   if (!c->ExecuteAction(act)) {
-      clc_error(logger, "%sError executing LLVM compilation action.\n",
-                diag_log_str.c_str());
+   bool ok = c->ExecuteAction(act);
+
+#ifdef CLC_BUILTINS_PCH
+   if (pch_diag) {
+      *pch_failed = !ok && pch_diag->pch_failed;
+      c->getDiagnostics().setClient(diag_printer.release(), true);
+   }
+#endif
+
+   if (!ok) {
+      // A PCH that doesn't load gets retried without it, which reports
+      // whatever else is wrong
+      if (!*pch_failed) {
+         clc_error(logger, "%sError executing LLVM compilation action.\n",
+                   diag_log_str.c_str());
+      }
       return {};
    }
 
    return act.takeModule();
 }
 
+static std::unique_ptr<::llvm::Module>
+clc_compile_to_llvm_module(LLVMContext &llvm_ctx,
+                           const struct clc_compile_args *args,
+                           const struct clc_logger *logger)
+{
+   bool pch_failed = false;
+   auto mod = clc_compile_to_llvm_module(llvm_ctx, args, logger, true, &pch_failed);
+
+   // Errors in the source itself are reported by the first compile
+   if (!mod && pch_failed)
+      mod = clc_compile_to_llvm_module(llvm_ctx, args, logger, false, &pch_failed);
+
+   return mod;
+}
+
 static SPIRV::VersionNumber
 spirv_version_to_llvm_spirv_translator_version(enum clc_spirv_version version)
 {
@@ -95,6 +95,7 @@ static const struct isa_bitset bitset_${bitset.get_c_name()}_gen_${bitset.gen_mi
 
 %for root_name, root in isa.roots.items():
 const struct isa_bitset *${root.get_c_name()}[];
+static const struct isa_bitset **${root.get_c_name()}_decode_tree(bitmask_t val);
 %endfor
 
 /*
@@ -138,6 +139,7 @@ static const struct isa_case ${case.get_c_name()}_gen_${bitset.gen_min} = {
             .type = ${field.get_c_typename()},
 %      if field.get_c_typename() == 'TYPE_BITSET':
             .bitsets = ${isa.roots[field.type].get_c_name()},
+            .decode_tree = ${isa.roots[field.type].get_c_name()}_decode_tree,
 %         if len(field.params) > 0:
             .params = &${case.get_c_name()}_gen_${bitset.gen_min}_${field.get_c_name()},
 %         endif
@@ -192,6 +194,28 @@ const struct isa_bitset *${root.get_c_name()}[] = {
 };
 %endfor
 
+/*
+ * decision trees, to narrow down the candidate bitsets for a given
+ * value before matching against them:
+ */
+
+%for root_name, tree in trees.items():
+%   for idx, table in enumerate(tree.tables):
+static const struct isa_bitset *${tree.name}_${idx}[] = {
+%      for leaf in table:
+             &bitset_${leaf.get_c_name()}_gen_${leaf.gen_min},
+%      endfor
+    (void *)0
+};
+%   endfor
+
+static const struct isa_bitset **
+${tree.name}(bitmask_t val)
+{
+${tree.render()}
+}
+%endfor
+
 #include "isaspec_decode_impl.c"
 
 """
@@ -272,6 +296,110 @@ uint64_t_to_bitmask(uint64_t val)
 
 """
 
+class DecodeTree(object):
+    """Decision tree for a bitset hierarchy root, which switches on ranges
+       of bits that all of the remaining candidate leaf bitsets have a fixed
+       value for, until only a handful of candidates remain.  The leaves of
+       the tree are NULL terminated candidate tables which are matched in
+       the same way as the full root table.
+    """
+
+    # Max # of candidates in a leaf table before we try to split it further:
+    MAX_LEAF = 4
+    # Max # of bits to switch on at each level of the tree:
+    MAX_WIDTH = 8
+
+    def __init__(self, isa, root):
+        self.isa = isa
+        self.name = root.get_c_name() + '_decode_tree'
+        self.tables = []
+
+        leafs = []
+        for leaf_name, bitsets in isa.leafs.items():
+            for leaf in bitsets:
+                if leaf.get_root() == root:
+                    leafs.append(leaf)
+
+        self.fixed = {}
+        self.match = {}
+        for leaf in leafs:
+            pat = leaf.get_pattern()
+            self.fixed[leaf] = pat.mask & ~pat.dontcare
+            self.match[leaf] = pat.match
+
+        self.node = self.build(leafs)
+
+    def partition(self, cands, low, width):
+        buckets = {}
+        for leaf in cands:
+            val = (self.match[leaf] >> low) & ((1 << width) - 1)
+            buckets.setdefault(val, []).append(leaf)
+        return buckets
+
+    def build(self, cands):
+        if len(cands) <= self.MAX_LEAF:
+            return self.add_table(cands)
+
+        common = (1 << self.isa.bitsize) - 1
+        for leaf in cands:
+            common &= self.fixed[leaf]
+
+        # Pick the bit range that best splits up the candidates, ie. the
+        # one which minimizes the size of the largest resulting bucket.
+        # Ranges do not cross BITSET_WORD boundaries, to keep extracting
+        # them cheap:
+        best = None
+        for low in range(self.isa.bitsize):
+            width = 0
+            while (width < self.MAX_WIDTH and
+                   ((low + width) % 32 != 0 or width == 0) and
+                   (common & (1 << (low + width)))):
+                width += 1
+            if width == 0:
+                continue
+            buckets = self.partition(cands, low, width)
+            score = (max(len(b) for b in buckets.values()), -len(buckets))
+            if best is None or score < best[0]:
+                best = (score, low, width, buckets)
+
+        if best is None or best[0][0] == len(cands):
+            return self.add_table(cands)
+
+        score, low, width, buckets = best
+        children = {}
+        for val, bucket in sorted(buckets.items()):
+            children[val] = self.build(bucket)
+
+        return (low, width, children)
+
+    def add_table(self, cands):
+        self.tables.append(cands)
+        return len(self.tables) - 1
+
+    def render_node(self, node, indent):
+        pad = '    ' * indent
+        if isinstance(node, int):
+            return [pad + 'return {}_{};'.format(self.name, node)]
+
+        low, width, children = node
+        lines = [pad + 'switch ((val.bitset[{}] >> {}) & 0x{:x}) {{'.format(
+                 low // 32, low % 32, (1 << width) - 1)]
+        for val, child in children.items():
+            lines.append(pad + 'case 0x{:x}:'.format(val))
+            lines += self.render_node(child, indent + 1)
+        lines.append(pad + 'default:')
+        lines.append(pad + '    return {}_empty;'.format(self.name))
+        lines.append(pad + '}')
+        return lines
+
+    def render(self):
+        lines = []
+        if not isinstance(self.node, int):
+            lines.append('    static const struct isa_bitset *{}_empty[] = {{ (void *)0 }};'.format(self.name))
+            lines.append('')
+        lines += self.render_node(self.node, 1)
+        return '\n'.join(lines)
+
 def guard(p):
     return os.path.basename(p).upper().replace("-", "_").replace(".", "_")
 
@@ -283,11 +411,14 @@ def main():
     args = parser.parse_args()
 
     isa = ISA(args.xml)
+    trees = {}
+    for root_name, root in isa.roots.items():
+        trees[root_name] = DecodeTree(isa, root)
 
     try:
         with open(args.out_c, 'w') as f:
             out_h_basename = os.path.basename(args.out_h)
-            f.write(Template(template).render(isa=isa, header=out_h_basename))
+            f.write(Template(template).render(isa=isa, trees=trees, header=out_h_basename))
 
         with open(args.out_h, 'w') as f:
             f.write(Template(header).render(isa=isa, guard=guard(args.out_h)))
@@ -51,6 +51,12 @@ struct isa_enum {
  */
 typedef uint64_t (*isa_expr_t)(struct decode_scope *scope);
 
+/**
+ * Generated decision tree for a bitset hierarchy root, returns the NULL
+ * terminated table of candidate bitsets which could match the given value
+ */
+typedef const struct isa_bitset **(*isa_decode_tree_t)(bitmask_t val);
+
 /**
  * Used by generated expr functions
  */
@@ -105,6 +111,12 @@ struct isa_field {
 		const char *display;                /* if type==BOOL */
 	};
 
+	/**
+	 * type==BITSET fields also have a decision tree to narrow down the
+	 * candidate bitsets, rather than matching against all of them
+	 */
+	isa_decode_tree_t decode_tree;
+
 	/**
 	 * type==BITSET fields can also optionally provide remapping for
 	 * field names
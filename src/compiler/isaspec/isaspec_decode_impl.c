@@ -51,6 +51,7 @@
  * can work with multiple different instruction sets.
  */
 extern const struct isa_bitset *__instruction[];
+static const struct isa_bitset **__instruction_decode_tree(bitmask_t val);
 
 struct decode_state;
 
@@ -304,14 +305,17 @@ evaluate_expr(struct decode_scope *scope, isa_expr_t expr)
 }
 
 /**
- * Find the bitset in NULL terminated bitset hiearchy root table which
- * matches against 'val'
+ * Match 'val' against each bitset in a NULL terminated bitset table, any
+ * additional match beyond the first is returned in 'conflict'
  */
 static const struct isa_bitset *
-find_bitset(struct decode_state *state, const struct isa_bitset **bitsets,
-		bitmask_t val)
+match_bitset(struct decode_state *state, const struct isa_bitset **bitsets,
+		bitmask_t val, const struct isa_bitset **conflict)
 {
 	const struct isa_bitset *match = NULL;
+
+	*conflict = NULL;
+
 	for (int n = 0; bitsets[n]; n++) {
 		if (state->options->gpu_id > bitsets[n]->gen.max)
 			continue;
@@ -339,14 +343,47 @@ find_bitset(struct decode_state *state, const struct isa_bitset **bitsets,
 		 * bit pattern will only have a single match?
 		 */
 		if (match) {
-			decode_error(state, "bitset conflict: %s vs %s", match->name,
-					bitsets[n]->name);
-			return NULL;
+			*conflict = bitsets[n];
+			return match;
 		}
 
 		match = bitsets[n];
 	}
 
+	return match;
+}
+
+/**
+ * Find the bitset in NULL terminated bitset hiearchy root table which
+ * matches against 'val'.  The generated decision tree is used to narrow
+ * down the candidates, in debug builds the result is validated against
+ * the full root table.
+ */
+static const struct isa_bitset *
+find_bitset(struct decode_state *state, const struct isa_bitset **bitsets,
+		isa_decode_tree_t decode_tree, bitmask_t val)
+{
+	const struct isa_bitset *conflict;
+	const struct isa_bitset *match =
+			match_bitset(state, decode_tree(val), val, &conflict);
+
+#ifndef NDEBUG
+	const struct isa_bitset *linear_conflict;
+	const struct isa_bitset *linear_match =
+			match_bitset(state, bitsets, val, &linear_conflict);
+
+	assert(match == linear_match);
+	assert(!conflict == !linear_conflict);
+#else
+	(void)bitsets;
+#endif
+
+	if (conflict) {
+		decode_error(state, "bitset conflict: %s vs %s", match->name,
+				conflict->name);
+		return NULL;
+	}
+
 	if (match) {
 		bitmask_t m = { 0 };
 		BITSET_AND(m.bitset, match->dontcare.bitset, val.bitset);
@@ -464,7 +501,8 @@ find_display(struct decode_scope *scope, const struct isa_bitset *bitset)
 static void
 display_bitset_field(struct decode_scope *scope, const struct isa_field *field, bitmask_t val)
 {
-	const struct isa_bitset *b = find_bitset(scope->state, field->bitsets, val);
+	const struct isa_bitset *b = find_bitset(scope->state, field->bitsets,
+			field->decode_tree, val);
 	if (!b) {
 		decode_error(scope->state, "no match: FIELD: '%s.%s': %"BITSET_FORMAT,
 				scope->bitset->name, field->name, BITSET_VALUE(val.bitset));
@@ -739,7 +777,8 @@ decode(struct decode_state *state, void *bin, int sz)
 			state->options->instr_cb(state->options->cbdata, state->n, instr.bitset);
 		}
 
-		const struct isa_bitset *b = find_bitset(state, __instruction, instr);
+		const struct isa_bitset *b = find_bitset(state, __instruction,
+				__instruction_decode_tree, instr);
 		if (!b) {
 			if (state->options->no_match_cb) {
 				state->options->no_match_cb(state->out, instr.bitset, BITMASK_WORDS);
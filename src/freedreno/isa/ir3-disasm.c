@@ -22,14 +22,17 @@
  */
 
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "util/os_file.h"
+#include "util/os_time.h"
 
 #include "isa.h"
 
@@ -41,12 +44,53 @@ disasm_instr_cb(void *d, unsigned n, void *instr)
 	printf("%3d[%08x_%08x] ", n, dwords[1], dwords[0]);
 }
 
+/* Decode the input repeatedly without output, to measure disassembly
+ * throughput:
+ */
+static void
+benchmark(void *raw, size_t sz, unsigned iterations)
+{
+	FILE *out = fopen("/dev/null", "w");
+	int64_t start = os_time_get_nano();
+
+	for (unsigned i = 0; i < iterations; i++) {
+		isa_decode(raw, sz, out, &(struct isa_decode_options) {
+			.show_errors = true,
+			.branch_labels = true,
+		});
+	}
+
+	int64_t elapsed = os_time_get_nano() - start;
+	uint64_t num_instrs = (uint64_t)(sz / 8) * iterations;
+
+	fclose(out);
+
+	fprintf(stderr, "decoded %"PRIu64" instructions in %.3f ms (%.0f instr/s)\n",
+			num_instrs, elapsed / 1000000.0,
+			num_instrs / (elapsed / 1000000000.0));
+}
+
 int
 main(int argc, char **argv)
 {
+	unsigned iterations = 0;
 	size_t sz;
+
+	if (argc > 3 && !strcmp(argv[1], "-b")) {
+		iterations = atoi(argv[2]);
+		argv += 2;
+	} else if (argc < 2) {
+		fprintf(stderr, "usage: %s [-b iterations] file\n", argv[0]);
+		return 1;
+	}
+
 	void *raw = os_read_file(argv[1], &sz);
 
+	if (iterations) {
+		benchmark(raw, sz, iterations);
+		return 0;
+	}
+
 	isa_decode(raw, sz, stdout, &(struct isa_decode_options) {
 		.show_errors = true,
 		.branch_labels = true,
@@ -127,6 +127,8 @@ lp_sampler_static_texture_state(struct lp_static_texture_state *state,
    state->pot_height = util_is_power_of_two_or_zero(texture->height0);
    state->pot_depth = util_is_power_of_two_or_zero(texture->depth0);
    state->level_zero_only = !view->u.tex.last_level;
+   state->tiled = !view->is_tex2d_from_buf &&
+                  (texture->flags & LP_RESOURCE_FLAG_TILED) != 0;
 
    /*
     * the layer / element / level parameters are all either dynamic
@@ -167,6 +169,7 @@ lp_sampler_static_texture_state_image(struct lp_static_texture_state *state,
    state->pot_height = util_is_power_of_two_or_zero(resource->height0);
    state->pot_depth = util_is_power_of_two_or_zero(resource->depth0);
    state->level_zero_only = 0;
+   state->tiled = (resource->flags & LP_RESOURCE_FLAG_TILED) != 0;
 
    /*
     * the layer / element / level parameters are all either dynamic
@@ -2141,6 +2144,72 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Byte offset of texel column x within a row of tiles of a texture with
+ * the LP_RESOURCE_FLAG_TILED layout.
+ *
+ * The tiled layout is separable, the offset of texel (x, y) being the sum
+ * of the x and y parts, so like for linear textures they can be computed
+ * (and wrapped) independently.
+ */
+LLVMValueRef
+lp_build_sample_tiled_offset_x(struct lp_build_context *bld,
+                               unsigned texel_size,
+                               LLVMValueRef x)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMValueRef tile, x1, x0, index;
+
+   /* Index in texels: tile * 16 + x1 * 4 + x0 */
+   tile = LLVMBuildAnd(builder, x,
+                       lp_build_const_int_vec(gallivm, bld->type, ~3), "");
+   tile = LLVMBuildShl(builder, tile,
+                       lp_build_const_int_vec(gallivm, bld->type, 2), "");
+   x1 = LLVMBuildAnd(builder, x,
+                     lp_build_const_int_vec(gallivm, bld->type, 2), "");
+   x1 = LLVMBuildShl(builder, x1, bld->one, "");
+   x0 = LLVMBuildAnd(builder, x, bld->one, "");
+   index = LLVMBuildOr(builder, LLVMBuildOr(builder, tile, x1, ""), x0, "");
+
+   return LLVMBuildShl(builder, index,
+                       lp_build_const_int_vec(gallivm, bld->type,
+                                              util_logbase2(texel_size)), "");
+}
+
+
+/**
+ * Byte offset of texel row y of a texture with the LP_RESOURCE_FLAG_TILED
+ * layout, see lp_build_sample_tiled_offset_x().
+ */
+LLVMValueRef
+lp_build_sample_tiled_offset_y(struct lp_build_context *bld,
+                               unsigned texel_size,
+                               LLVMValueRef y,
+                               LLVMValueRef tile_row_stride)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMValueRef two = lp_build_const_int_vec(gallivm, bld->type, 2);
+   LLVMValueRef row, y1, y0, index;
+
+   row = LLVMBuildLShr(builder, y, two, "");
+   row = lp_build_mul(bld, row, tile_row_stride);
+
+   /* Index in texels within the tile: y1 * 8 + y0 * 2 */
+   y1 = LLVMBuildAnd(builder, y, two, "");
+   y1 = LLVMBuildShl(builder, y1, two, "");
+   y0 = LLVMBuildAnd(builder, y, bld->one, "");
+   y0 = LLVMBuildShl(builder, y0, bld->one, "");
+   index = LLVMBuildOr(builder, y1, y0, "");
+   index = LLVMBuildShl(builder, index,
+                        lp_build_const_int_vec(gallivm, bld->type,
+                                               util_logbase2(texel_size)), "");
+
+   return lp_build_add(bld, row, index);
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
@@ -2151,6 +2220,7 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       bool tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2163,23 +2233,38 @@ lp_build_sample_offset(struct lp_build_context *bld,
    LLVMValueRef x_stride;
    LLVMValueRef offset;
 
-   x_stride = lp_build_const_vec(bld->gallivm, bld->type,
-                                 format_desc->block.bits/8);
+   if (tiled) {
+      const unsigned texel_size = format_desc->block.bits / 8;
 
-   lp_build_sample_partial_offset(bld,
-                                  format_desc->block.width,
-                                  x, x_stride,
-                                  &offset, out_i);
+      assert(format_desc->block.width == 1 && format_desc->block.height == 1);
 
-   if (y && y_stride) {
-      LLVMValueRef y_offset;
-      lp_build_sample_partial_offset(bld,
-                                     format_desc->block.height,
-                                     y, y_stride,
-                                     &y_offset, out_j);
-      offset = lp_build_add(bld, offset, y_offset);
-   } else {
+      offset = lp_build_sample_tiled_offset_x(bld, texel_size, x);
+      if (y && y_stride) {
+         offset = lp_build_add(bld, offset,
+                               lp_build_sample_tiled_offset_y(bld, texel_size,
+                                                              y, y_stride));
+      }
+      *out_i = bld->zero;
       *out_j = bld->zero;
+   } else {
+      x_stride = lp_build_const_vec(bld->gallivm, bld->type,
+                                    format_desc->block.bits/8);
+
+      lp_build_sample_partial_offset(bld,
+                                     format_desc->block.width,
+                                     x, x_stride,
+                                     &offset, out_i);
+
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         lp_build_sample_partial_offset(bld,
+                                        format_desc->block.height,
+                                        y, y_stride,
+                                        &y_offset, out_j);
+         offset = lp_build_add(bld, offset, y_offset);
+      } else {
+         *out_j = bld->zero;
+      }
    }
 
    if (z && z_stride) {
@@ -49,6 +49,14 @@ extern "C" {
 
 #define LP_MAX_TEXEL_BUFFER_ELEMENTS 134217728
 
+/**
+ * Set by llvmpipe on textures whose levels are stored as rows of 4x4 texel
+ * tiles, with the texels of a tile in Morton order (UTIL_TILING_MORTON in
+ * util/u_tiling.h).  The row stride of such textures is the distance
+ * between two rows of tiles.
+ */
+#define LP_RESOURCE_FLAG_TILED PIPE_RESOURCE_FLAG_DRV_PRIV
+
 struct util_format_description;
 struct lp_type;
 struct lp_build_context;
@@ -197,6 +205,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< LP_RESOURCE_FLAG_TILED layout */
 };
 
 
@@ -724,9 +733,23 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+LLVMValueRef
+lp_build_sample_tiled_offset_x(struct lp_build_context *bld,
+                               unsigned texel_size,
+                               LLVMValueRef x);
+
+
+LLVMValueRef
+lp_build_sample_tiled_offset_y(struct lp_build_context *bld,
+                               unsigned texel_size,
+                               LLVMValueRef y,
+                               LLVMValueRef tile_row_stride);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       bool tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -7,6 +7,7 @@ DRI_CONF_SECTION_PERFORMANCE
 DRI_CONF_SECTION_END
 
 DRI_CONF_SECTION_QUALITY
+   DRI_CONF_TEXCOMPRESS_QUALITY(0)
    DRI_CONF_PP_CELSHADE(0)
    DRI_CONF_PP_NORED(0)
    DRI_CONF_PP_NOGREEN(0)
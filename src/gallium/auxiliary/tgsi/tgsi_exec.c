@@ -63,10 +63,13 @@
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/rounding.h"
+#include "util/u_debug.h"
 
 
 #define DEBUG_EXECUTION 0
 
+DEBUG_GET_ONCE_BOOL_OPTION(tgsi_exec_no_predecode, "TGSI_EXEC_NO_PREDECODE", false)
+
 
 #define TILE_TOP_LEFT     0
 #define TILE_TOP_RIGHT    1
@@ -1015,6 +1018,10 @@ tgsi_exec_set_constant_buffers(struct tgsi_exec_machine *mach,
    }
 }
 
+static void
+decode_instructions(struct tgsi_exec_machine *mach);
+
+
 /**
  * Initialize machine state by expanding tokens to full instructions,
  * allocating temporary storage, setting up constants, etc.
@@ -1054,6 +1061,9 @@ tgsi_exec_machine_bind_shader(
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
+      FREE(mach->Decoded);
+      mach->Decoded = NULL;
+
       return;
    }
 
@@ -1204,6 +1214,8 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   decode_instructions(mach);
 }
 
 
@@ -1219,6 +1231,7 @@ tgsi_exec_machine_create(enum pipe_shader_type shader_type)
    memset(mach, 0, sizeof(*mach));
 
    mach->ShaderType = shader_type;
+   mach->DisablePredecode = debug_get_option_tgsi_exec_no_predecode();
 
    if (shader_type != PIPE_SHADER_COMPUTE) {
       mach->Inputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_INPUTS, 16);
@@ -1257,6 +1270,7 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
       FREE(mach->Instructions);
+      FREE(mach->Decoded);
       FREE(mach->Declarations);
       FREE(mach->Imms);
 
@@ -5945,6 +5959,668 @@ exec_instruction(
    return false;
 }
 
+/*
+ * Pre-decoded instructions.
+ *
+ * When a shader is bound, the plain register-to-register ALU instructions
+ * are translated into tgsi_exec_decoded_inst entries whose operands are
+ * resolved to channel pointers and whose opcode is resolved to a handler
+ * and micro op.  Running them then skips the opcode switch, as well as
+ * get_index_registers() and fetch_src_file_channel() for every channel.
+ *
+ * Anything using indirect or 2D addressing (other than a constant buffer
+ * index), the geometry shader output stream or an opcode without a handler
+ * below keeps pointing at its full instruction and goes through
+ * exec_instruction().
+ */
+
+struct tgsi_exec_decoded_src {
+   /* Swizzled source channels, NULL for the CONSTANT file as constant
+    * buffers are only bound after the shader.
+    */
+   const union tgsi_exec_channel *chan[TGSI_NUM_CHANNELS];
+   unsigned const_buf;
+   unsigned const_pos[TGSI_NUM_CHANNELS];
+   bool abs;
+   bool neg;
+   /* Broadcast immediate values, chan[] points here for IMMEDIATE. */
+   union tgsi_exec_channel imm[TGSI_NUM_CHANNELS];
+};
+
+typedef bool (* decoded_exec_func)(struct tgsi_exec_machine *mach,
+                                   const struct tgsi_exec_decoded_inst *d);
+
+struct tgsi_exec_decoded_inst {
+   decoded_exec_func exec;
+   const struct tgsi_full_instruction *inst;
+   union {
+      micro_unary_op unary;
+      micro_binary_op binary;
+      micro_trinary_op trinary;
+   } op;
+   enum tgsi_exec_datatype datatype;
+   unsigned writemask;
+   unsigned num_dp_chans;
+   bool saturate;
+   union tgsi_exec_channel *dst[TGSI_NUM_CHANNELS];
+   struct tgsi_exec_decoded_src src[3];
+};
+
+static inline const union tgsi_exec_channel *
+fetch_decoded(const struct tgsi_exec_machine *mach,
+              union tgsi_exec_channel *tmp,
+              const struct tgsi_exec_decoded_src *src,
+              unsigned chan_index,
+              enum tgsi_exec_datatype src_datatype)
+{
+   const union tgsi_exec_channel *chan = src->chan[chan_index];
+
+   if (!chan) {
+      const unsigned constbuf = src->const_buf;
+      const unsigned pos = src->const_pos[chan_index];
+      unsigned value = 0;
+
+      /* const buffer bounds check */
+      if (pos < mach->ConstsSize[constbuf] / 4)
+         value = ((const unsigned *)mach->Consts[constbuf])[pos];
+
+      tmp->u[0] = tmp->u[1] = tmp->u[2] = tmp->u[3] = value;
+      chan = tmp;
+   }
+
+   if (likely(!src->abs && !src->neg))
+      return chan;
+
+   if (chan != tmp)
+      *tmp = *chan;
+
+   if (src->abs)
+      micro_abs(tmp, tmp);
+
+   if (src->neg) {
+      if (src_datatype == TGSI_EXEC_DATA_FLOAT)
+         micro_neg(tmp, tmp);
+      else
+         micro_ineg(tmp, tmp);
+   }
+
+   return tmp;
+}
+
+static inline void
+store_decoded(struct tgsi_exec_machine *mach,
+              const struct tgsi_exec_decoded_inst *d,
+              const union tgsi_exec_channel *chan,
+              unsigned chan_index)
+{
+   union tgsi_exec_channel *dst = d->dst[chan_index];
+   const unsigned execmask = mach->ExecMask;
+   int i;
+
+   if (!d->saturate) {
+      if (execmask == 0xf) {
+         *dst = *chan;
+      } else {
+         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+            if (execmask & (1 << i))
+               dst->i[i] = chan->i[i];
+      }
+   }
+   else {
+      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         if (execmask & (1 << i))
+            dst->f[i] = fminf(fmaxf(chan->f[i], 0.0f), 1.0f);
+   }
+}
+
+static bool
+exec_decoded_fallback(struct tgsi_exec_machine *mach,
+                      const struct tgsi_exec_decoded_inst *d)
+{
+   return exec_instruction(mach, d->inst, &mach->pc);
+}
+
+static bool
+exec_decoded_scalar_unary(struct tgsi_exec_machine *mach,
+                          const struct tgsi_exec_decoded_inst *d)
+{
+   union tgsi_exec_channel tmp, dst;
+   unsigned chan;
+
+   d->op.unary(&dst, fetch_decoded(mach, &tmp, &d->src[0], TGSI_CHAN_X,
+                                   d->datatype));
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan))
+         store_decoded(mach, d, &dst, chan);
+   }
+   mach->pc++;
+   return false;
+}
+
+static bool
+exec_decoded_scalar_binary(struct tgsi_exec_machine *mach,
+                           const struct tgsi_exec_decoded_inst *d)
+{
+   union tgsi_exec_channel tmp[2], dst;
+   unsigned chan;
+
+   d->op.binary(&dst,
+                fetch_decoded(mach, &tmp[0], &d->src[0], TGSI_CHAN_X,
+                              d->datatype),
+                fetch_decoded(mach, &tmp[1], &d->src[1], TGSI_CHAN_X,
+                              d->datatype));
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan))
+         store_decoded(mach, d, &dst, chan);
+   }
+   mach->pc++;
+   return false;
+}
+
+static bool
+exec_decoded_vector_unary(struct tgsi_exec_machine *mach,
+                          const struct tgsi_exec_decoded_inst *d)
+{
+   struct tgsi_exec_vector dst;
+   unsigned chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan)) {
+         union tgsi_exec_channel tmp;
+
+         d->op.unary(&dst.xyzw[chan],
+                     fetch_decoded(mach, &tmp, &d->src[0], chan, d->datatype));
+      }
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan))
+         store_decoded(mach, d, &dst.xyzw[chan], chan);
+   }
+   mach->pc++;
+   return false;
+}
+
+static bool
+exec_decoded_vector_binary(struct tgsi_exec_machine *mach,
+                           const struct tgsi_exec_decoded_inst *d)
+{
+   struct tgsi_exec_vector dst;
+   unsigned chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan)) {
+         union tgsi_exec_channel tmp[2];
+
+         d->op.binary(&dst.xyzw[chan],
+                      fetch_decoded(mach, &tmp[0], &d->src[0], chan,
+                                    d->datatype),
+                      fetch_decoded(mach, &tmp[1], &d->src[1], chan,
+                                    d->datatype));
+      }
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan))
+         store_decoded(mach, d, &dst.xyzw[chan], chan);
+   }
+   mach->pc++;
+   return false;
+}
+
+static bool
+exec_decoded_vector_trinary(struct tgsi_exec_machine *mach,
+                            const struct tgsi_exec_decoded_inst *d)
+{
+   struct tgsi_exec_vector dst;
+   unsigned chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan)) {
+         union tgsi_exec_channel tmp[3];
+
+         d->op.trinary(&dst.xyzw[chan],
+                       fetch_decoded(mach, &tmp[0], &d->src[0], chan,
+                                     d->datatype),
+                       fetch_decoded(mach, &tmp[1], &d->src[1], chan,
+                                     d->datatype),
+                       fetch_decoded(mach, &tmp[2], &d->src[2], chan,
+                                     d->datatype));
+      }
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan))
+         store_decoded(mach, d, &dst.xyzw[chan], chan);
+   }
+   mach->pc++;
+   return false;
+}
+
+/* DP2, DP3 and DP4, with the same operation order as exec_dp2/3/4(). */
+static bool
+exec_decoded_dp(struct tgsi_exec_machine *mach,
+                const struct tgsi_exec_decoded_inst *d)
+{
+   union tgsi_exec_channel tmp[2], acc;
+   unsigned chan;
+
+   micro_mul(&acc,
+             fetch_decoded(mach, &tmp[0], &d->src[0], TGSI_CHAN_X,
+                           TGSI_EXEC_DATA_FLOAT),
+             fetch_decoded(mach, &tmp[1], &d->src[1], TGSI_CHAN_X,
+                           TGSI_EXEC_DATA_FLOAT));
+   for (chan = TGSI_CHAN_Y; chan < d->num_dp_chans; chan++) {
+      micro_mad(&acc,
+                fetch_decoded(mach, &tmp[0], &d->src[0], chan,
+                              TGSI_EXEC_DATA_FLOAT),
+                fetch_decoded(mach, &tmp[1], &d->src[1], chan,
+                              TGSI_EXEC_DATA_FLOAT),
+                &acc);
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (d->writemask & (1 << chan))
+         store_decoded(mach, d, &acc, chan);
+   }
+   mach->pc++;
+   return false;
+}
+
+static bool
+decode_src(const struct tgsi_exec_machine *mach,
+           const struct tgsi_full_src_register *reg,
+           enum tgsi_exec_datatype src_datatype,
+           struct tgsi_exec_decoded_src *src)
+{
+   const unsigned index = reg->Register.Index;
+   const struct tgsi_exec_vector *vec;
+   unsigned chan;
+
+   if (reg->Register.Indirect)
+      return false;
+   if (reg->Register.Dimension && reg->Register.File != TGSI_FILE_CONSTANT)
+      return false;
+   if (reg->Register.Absolute && src_datatype != TGSI_EXEC_DATA_FLOAT)
+      return false;
+
+   src->abs = reg->Register.Absolute;
+   src->neg = reg->Register.Negate;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_CONSTANT:
+      src->const_buf = 0;
+      if (reg->Register.Dimension) {
+         if (reg->Dimension.Indirect ||
+             reg->Dimension.Index >= PIPE_MAX_CONSTANT_BUFFERS)
+            return false;
+         src->const_buf = reg->Dimension.Index;
+      }
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         src->chan[chan] = NULL;
+         src->const_pos[chan] = index * 4 +
+            tgsi_util_get_full_src_register_swizzle(reg, chan);
+      }
+      return true;
+
+   case TGSI_FILE_IMMEDIATE:
+      if (index >= mach->ImmLimit)
+         return false;
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         const unsigned swizzle =
+            tgsi_util_get_full_src_register_swizzle(reg, chan);
+         int i;
+
+         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+            src->imm[chan].f[i] = mach->Imms[index][swizzle];
+         src->chan[chan] = &src->imm[chan];
+      }
+      return true;
+
+   case TGSI_FILE_INPUT:
+      if (!mach->Inputs || mach->ShaderType == PIPE_SHADER_GEOMETRY ||
+          index >= PIPE_MAX_SHADER_INPUTS)
+         return false;
+      vec = &mach->Inputs[index];
+      break;
+
+   case TGSI_FILE_OUTPUT:
+      if (!mach->Outputs || mach->ShaderType == PIPE_SHADER_GEOMETRY ||
+          index >= PIPE_MAX_SHADER_OUTPUTS)
+         return false;
+      vec = &mach->Outputs[index];
+      break;
+
+   case TGSI_FILE_TEMPORARY:
+      if (index >= TGSI_EXEC_NUM_TEMPS)
+         return false;
+      vec = &mach->Temps[index];
+      break;
+
+   case TGSI_FILE_SYSTEM_VALUE:
+      if (index >= TGSI_MAX_MISC_INPUTS)
+         return false;
+      vec = &mach->SystemValue[index];
+      break;
+
+   case TGSI_FILE_ADDRESS:
+      if (index >= ARRAY_SIZE(mach->Addrs))
+         return false;
+      vec = &mach->Addrs[index];
+      break;
+
+   default:
+      return false;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      src->chan[chan] =
+         &vec->xyzw[tgsi_util_get_full_src_register_swizzle(reg, chan)];
+   return true;
+}
+
+static bool
+decode_dst(struct tgsi_exec_machine *mach,
+           const struct tgsi_full_dst_register *reg,
+           struct tgsi_exec_decoded_inst *d)
+{
+   const unsigned index = reg->Register.Index;
+   struct tgsi_exec_vector *vec;
+   unsigned chan;
+
+   if (reg->Register.Indirect || reg->Register.Dimension)
+      return false;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_OUTPUT:
+      /* geometry shader outputs move with OutputVertexOffset */
+      if (!mach->Outputs || mach->ShaderType == PIPE_SHADER_GEOMETRY ||
+          index >= PIPE_MAX_SHADER_OUTPUTS)
+         return false;
+      vec = &mach->Outputs[index];
+      break;
+
+   case TGSI_FILE_TEMPORARY:
+      if (index >= TGSI_EXEC_NUM_TEMPS)
+         return false;
+      vec = &mach->Temps[index];
+      break;
+
+   case TGSI_FILE_ADDRESS:
+      if (index >= ARRAY_SIZE(mach->Addrs))
+         return false;
+      vec = &mach->Addrs[index];
+      break;
+
+   default:
+      return false;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      d->dst[chan] = &vec->xyzw[chan];
+   d->writemask = reg->Register.WriteMask;
+   return true;
+}
+
+static bool
+decode_instruction(struct tgsi_exec_machine *mach,
+                   const struct tgsi_full_instruction *inst,
+                   struct tgsi_exec_decoded_inst *d)
+{
+   decoded_exec_func exec;
+   enum tgsi_exec_datatype datatype = TGSI_EXEC_DATA_FLOAT;
+   unsigned num_src;
+   unsigned i;
+
+#define UNARY(handler, micro, type) \
+   exec = handler; d->op.unary = micro; datatype = type; num_src = 1
+#define BINARY(handler, micro, type) \
+   exec = handler; d->op.binary = micro; datatype = type; num_src = 2
+#define TRINARY(handler, micro, type) \
+   exec = handler; d->op.trinary = micro; datatype = type; num_src = 3
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_ARL:
+      UNARY(exec_decoded_vector_unary, micro_arl, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_MOV:
+      UNARY(exec_decoded_vector_unary, micro_mov, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_FRC:
+      UNARY(exec_decoded_vector_unary, micro_frc, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_FLR:
+      UNARY(exec_decoded_vector_unary, micro_flr, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_ROUND:
+      UNARY(exec_decoded_vector_unary, micro_rnd, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_CEIL:
+      UNARY(exec_decoded_vector_unary, micro_ceil, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_TRUNC:
+      UNARY(exec_decoded_vector_unary, micro_trunc, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SSG:
+      UNARY(exec_decoded_vector_unary, micro_sgn, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_F2I:
+      UNARY(exec_decoded_vector_unary, micro_f2i, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_F2U:
+      UNARY(exec_decoded_vector_unary, micro_f2u, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_I2F:
+      UNARY(exec_decoded_vector_unary, micro_i2f, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_U2F:
+      UNARY(exec_decoded_vector_unary, micro_u2f, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_NOT:
+      UNARY(exec_decoded_vector_unary, micro_not, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_INEG:
+      UNARY(exec_decoded_vector_unary, micro_ineg, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_UARL:
+      UNARY(exec_decoded_vector_unary, micro_uarl, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_RCP:
+      UNARY(exec_decoded_scalar_unary, micro_rcp, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_RSQ:
+      UNARY(exec_decoded_scalar_unary, micro_rsq, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SQRT:
+      UNARY(exec_decoded_scalar_unary, micro_sqrt, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_EX2:
+      UNARY(exec_decoded_scalar_unary, micro_exp2, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_LG2:
+      UNARY(exec_decoded_scalar_unary, micro_lg2, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_COS:
+      UNARY(exec_decoded_scalar_unary, micro_cos, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SIN:
+      UNARY(exec_decoded_scalar_unary, micro_sin, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_POW:
+      BINARY(exec_decoded_scalar_binary, micro_pow, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_ADD:
+      BINARY(exec_decoded_vector_binary, micro_add, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_MUL:
+      BINARY(exec_decoded_vector_binary, micro_mul, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_DIV:
+      BINARY(exec_decoded_vector_binary, micro_div, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_MIN:
+      BINARY(exec_decoded_vector_binary, micro_min, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_MAX:
+      BINARY(exec_decoded_vector_binary, micro_max, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SLT:
+      BINARY(exec_decoded_vector_binary, micro_slt, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SGE:
+      BINARY(exec_decoded_vector_binary, micro_sge, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SEQ:
+      BINARY(exec_decoded_vector_binary, micro_seq, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SGT:
+      BINARY(exec_decoded_vector_binary, micro_sgt, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SLE:
+      BINARY(exec_decoded_vector_binary, micro_sle, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_SNE:
+      BINARY(exec_decoded_vector_binary, micro_sne, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_FSEQ:
+      BINARY(exec_decoded_vector_binary, micro_fseq, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_FSGE:
+      BINARY(exec_decoded_vector_binary, micro_fsge, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_FSLT:
+      BINARY(exec_decoded_vector_binary, micro_fslt, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_FSNE:
+      BINARY(exec_decoded_vector_binary, micro_fsne, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_AND:
+      BINARY(exec_decoded_vector_binary, micro_and, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_OR:
+      BINARY(exec_decoded_vector_binary, micro_or, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_XOR:
+      BINARY(exec_decoded_vector_binary, micro_xor, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_SHL:
+      BINARY(exec_decoded_vector_binary, micro_shl, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_ISHR:
+      BINARY(exec_decoded_vector_binary, micro_ishr, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_USHR:
+      BINARY(exec_decoded_vector_binary, micro_ushr, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_UADD:
+      BINARY(exec_decoded_vector_binary, micro_uadd, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_UMUL:
+      BINARY(exec_decoded_vector_binary, micro_umul, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_IMAX:
+      BINARY(exec_decoded_vector_binary, micro_imax, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_IMIN:
+      BINARY(exec_decoded_vector_binary, micro_imin, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_UMAX:
+      BINARY(exec_decoded_vector_binary, micro_umax, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_UMIN:
+      BINARY(exec_decoded_vector_binary, micro_umin, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_ISGE:
+      BINARY(exec_decoded_vector_binary, micro_isge, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_ISLT:
+      BINARY(exec_decoded_vector_binary, micro_islt, TGSI_EXEC_DATA_INT);
+      break;
+   case TGSI_OPCODE_USEQ:
+      BINARY(exec_decoded_vector_binary, micro_useq, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_USGE:
+      BINARY(exec_decoded_vector_binary, micro_usge, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_USLT:
+      BINARY(exec_decoded_vector_binary, micro_uslt, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_USNE:
+      BINARY(exec_decoded_vector_binary, micro_usne, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_MAD:
+      TRINARY(exec_decoded_vector_trinary, micro_mad, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_LRP:
+      TRINARY(exec_decoded_vector_trinary, micro_lrp, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_CMP:
+      TRINARY(exec_decoded_vector_trinary, micro_cmp, TGSI_EXEC_DATA_FLOAT);
+      break;
+   case TGSI_OPCODE_UMAD:
+      TRINARY(exec_decoded_vector_trinary, micro_umad, TGSI_EXEC_DATA_UINT);
+      break;
+   case TGSI_OPCODE_DP2:
+   case TGSI_OPCODE_DP3:
+   case TGSI_OPCODE_DP4:
+      exec = exec_decoded_dp;
+      num_src = 2;
+      d->num_dp_chans = inst->Instruction.Opcode == TGSI_OPCODE_DP2 ? 2 :
+                        inst->Instruction.Opcode == TGSI_OPCODE_DP3 ? 3 : 4;
+      break;
+   default:
+      return false;
+   }
+
+#undef UNARY
+#undef BINARY
+#undef TRINARY
+
+   if (inst->Instruction.NumDstRegs != 1 ||
+       inst->Instruction.NumSrcRegs != num_src)
+      return false;
+
+   if (!decode_dst(mach, &inst->Dst[0], d))
+      return false;
+
+   for (i = 0; i < num_src; i++) {
+      if (!decode_src(mach, &inst->Src[i], datatype, &d->src[i]))
+         return false;
+   }
+
+   d->exec = exec;
+   d->datatype = datatype;
+   d->saturate = inst->Instruction.Saturate;
+   return true;
+}
+
+/**
+ * Build mach->Decoded from mach->Instructions.  Must be redone whenever
+ * Instructions, Imms or the Inputs/Outputs storage changes, which only
+ * happens in tgsi_exec_machine_bind_shader().
+ */
+static void
+decode_instructions(struct tgsi_exec_machine *mach)
+{
+   unsigned i;
+
+   FREE(mach->Decoded);
+   mach->Decoded = NULL;
+
+   if (mach->DisablePredecode || !mach->NumInstructions)
+      return;
+
+   mach->Decoded = CALLOC(mach->NumInstructions, sizeof(*mach->Decoded));
+   if (!mach->Decoded)
+      return;
+
+   for (i = 0; i < mach->NumInstructions; i++) {
+      struct tgsi_exec_decoded_inst *d = &mach->Decoded[i];
+
+      if (!decode_instruction(mach, &mach->Instructions[i], d)) {
+         memset(d, 0, sizeof(*d));
+         d->exec = exec_decoded_fallback;
+      }
+      d->inst = &mach->Instructions[i];
+   }
+}
+
 static void
 tgsi_exec_machine_setup_masks(struct tgsi_exec_machine *mach)
 {
@@ -6025,7 +6701,12 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 #endif
 
          assert(mach->pc < (int) mach->NumInstructions);
-         barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc, &mach->pc);
+         if (mach->Decoded) {
+            const struct tgsi_exec_decoded_inst *d = &mach->Decoded[mach->pc];
+            barrier_hit = d->exec(mach, d);
+         } else {
+            barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc, &mach->pc);
+         }
 
          /* for compute shaders if we hit a barrier return now for later rescheduling */
          if (barrier_hit && mach->ShaderType == PIPE_SHADER_COMPUTE)
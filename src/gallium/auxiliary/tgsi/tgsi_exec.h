@@ -280,6 +280,7 @@ enum tgsi_break_type {
 typedef float float4[4];
 
 struct tgsi_exec_machine;
+struct tgsi_exec_decoded_inst;
 
 typedef void (* apply_sample_offset_func)(
    const struct tgsi_exec_machine *mach,
@@ -396,6 +397,10 @@ struct tgsi_exec_machine
    struct tgsi_full_instruction *Instructions;
    unsigned NumInstructions;
 
+   /** Pre-decoded form of Instructions, NULL if DisablePredecode is set */
+   struct tgsi_exec_decoded_inst *Decoded;
+   bool DisablePredecode;
+
    struct tgsi_full_declaration *Declarations;
    unsigned NumDeclarations;
 
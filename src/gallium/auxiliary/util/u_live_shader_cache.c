@@ -32,18 +32,18 @@
 
 #include "util/blob.h"
 #include "util/hash_table.h"
-#include "util/mesa-sha1.h"
+#include "util/mesa-cache-key.h"
 
 static uint32_t key_hash(const void *key)
 {
-   /* Take the first dword of SHA1. */
+   /* Take the first dword of the key. */
    return *(uint32_t*)key;
 }
 
 static bool key_equals(const void *a, const void *b)
 {
-   /* Compare SHA1s. */
-   return memcmp(a, b, 20) == 0;
+   /* Compare the keys. */
+   return memcmp(a, b, MESA_CACHE_KEY_SIZE) == 0;
 }
 
 void
@@ -96,19 +96,19 @@ util_live_shader_cache_get(struct pipe_context *ctx,
       return NULL;
    }
 
-   /* Compute SHA1 of pipe_shader_state. */
-   struct mesa_sha1 sha1_ctx;
-   unsigned char sha1[20];
-   _mesa_sha1_init(&sha1_ctx);
-   _mesa_sha1_update(&sha1_ctx, ir_binary, ir_size);
+   /* Compute the key of pipe_shader_state. */
+   struct mesa_cache_key_ctx key_ctx;
+   unsigned char sha1[MESA_CACHE_KEY_SIZE];
+   _mesa_cache_key_init(&key_ctx);
+   _mesa_cache_key_update(&key_ctx, ir_binary, ir_size);
    if ((stage == PIPE_SHADER_VERTEX ||
         stage == PIPE_SHADER_TESS_EVAL ||
         stage == PIPE_SHADER_GEOMETRY) &&
        state->stream_output.num_outputs) {
-      _mesa_sha1_update(&sha1_ctx, &state->stream_output,
-                        sizeof(state->stream_output));
+      _mesa_cache_key_update(&key_ctx, &state->stream_output,
+                             sizeof(state->stream_output));
    }
-   _mesa_sha1_final(&sha1_ctx, sha1);
+   _mesa_cache_key_final(&key_ctx, sha1);
 
    if (ir_binary == blob.data)
       blob_finish(&blob);
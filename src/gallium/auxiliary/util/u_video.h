@@ -35,6 +35,7 @@
 #include "util/compiler.h"
 #include "util/u_debug.h"
 #include "util/u_math.h"
+#include "util/u_planar.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -99,22 +100,17 @@ u_copy_nv12_to_yv12(void *const *destination_data,
                     uint8_t const *src,
                     int width, int height)
 {
-   int x, y;
-   unsigned u_stride = destination_pitches[2] * num_fields;
-   unsigned v_stride = destination_pitches[1] * num_fields;
-   uint8_t *u_dst = (uint8_t *)destination_data[2] + destination_pitches[2] * src_field;
-   uint8_t *v_dst = (uint8_t *)destination_data[1] + destination_pitches[1] * src_field;
-
-   /* TODO: SIMD */
-   for (y = 0; y < height; y++) {
-      for (x = 0; x < width; x++) {
-         u_dst[x] = src[2*x];
-         v_dst[x] = src[2*x+1];
-      }
-      u_dst += u_stride;
-      v_dst += v_stride;
-      src += src_stride;
-   }
+   struct util_planar_copy copy = { UTIL_PLANAR_DEINTERLEAVE_8 };
+
+   copy.dst[0] = (uint8_t *)destination_data[2] + destination_pitches[2] * src_field;
+   copy.dst[1] = (uint8_t *)destination_data[1] + destination_pitches[1] * src_field;
+   copy.dst_stride[0] = destination_pitches[2] * num_fields;
+   copy.dst_stride[1] = destination_pitches[1] * num_fields;
+   copy.src[0] = src;
+   copy.src_stride[0] = src_stride;
+   copy.width = width;
+   copy.height = height;
+   util_planar_copy(&copy);
 }
 
 /**
@@ -141,22 +137,17 @@ u_copy_nv12_from_yv12(const void *const *source_data,
                       uint8_t *dst,
                       int width, int height)
 {
-   int x, y;
-   unsigned u_stride = source_pitches[2] * num_fields;
-   unsigned v_stride = source_pitches[1] * num_fields;
-   uint8_t *u_src = (uint8_t *)source_data[2] + source_pitches[2] * dst_field;
-   uint8_t *v_src = (uint8_t *)source_data[1] + source_pitches[1] * dst_field;
-
-   /* TODO: SIMD */
-   for (y = 0; y < height; y++) {
-      for (x = 0; x < width; x++) {
-         dst[2*x] = u_src[x];
-         dst[2*x+1] = v_src[x];
-      }
-      u_src += u_stride;
-      v_src += v_stride;
-      dst += dst_stride;
-   }
+   struct util_planar_copy copy = { UTIL_PLANAR_INTERLEAVE_8 };
+
+   copy.dst[0] = dst;
+   copy.dst_stride[0] = dst_stride;
+   copy.src[0] = (const uint8_t *)source_data[2] + source_pitches[2] * dst_field;
+   copy.src[1] = (const uint8_t *)source_data[1] + source_pitches[1] * dst_field;
+   copy.src_stride[0] = source_pitches[2] * num_fields;
+   copy.src_stride[1] = source_pitches[1] * num_fields;
+   copy.width = width;
+   copy.height = height;
+   util_planar_copy(&copy);
 }
 
 static inline void
@@ -167,19 +158,18 @@ u_copy_yv12_to_nv12(void *const *destination_data,
                     uint8_t const *src,
                     int width, int height)
 {
-   int x, y;
-   unsigned offset = 2 - src_plane;
-   unsigned stride = destination_pitches[1] * num_fields;
-   uint8_t *dst = (uint8_t *)destination_data[1] + destination_pitches[1] * src_field;
-
-   /* TODO: SIMD */
-   for (y = 0; y < height; y++) {
-      for (x = 0; x < 2 * width; x += 2) {
-         dst[x+offset] = src[x>>1];
-      }
-      dst += stride;
-      src += src_stride;
-   }
+   /* U (plane 2) goes to the even bytes, V (plane 1) to the odd ones */
+   struct util_planar_copy copy = {
+      src_plane == 2 ? UTIL_PLANAR_INSERT_8_EVEN : UTIL_PLANAR_INSERT_8_ODD
+   };
+
+   copy.dst[0] = (uint8_t *)destination_data[1] + destination_pitches[1] * src_field;
+   copy.dst_stride[0] = destination_pitches[1] * num_fields;
+   copy.src[0] = src;
+   copy.src_stride[0] = src_stride;
+   copy.width = width;
+   copy.height = height;
+   util_planar_copy(&copy);
 }
 
 static inline void
@@ -190,21 +180,71 @@ u_copy_swap422_packed(void *const *destination_data,
                        uint8_t const *src,
                        int width, int height)
 {
-   int x, y;
-   unsigned stride = destination_pitches[0] * num_fields;
-   uint8_t *dst = (uint8_t *)destination_data[0] + destination_pitches[0] * src_field;
-
-   /* TODO: SIMD */
-   for (y = 0; y < height; y++) {
-      for (x = 0; x < 4 * width; x += 4) {
-         dst[x+0] = src[x+1];
-         dst[x+1] = src[x+0];
-         dst[x+2] = src[x+3];
-         dst[x+3] = src[x+2];
-      }
-      dst += stride;
-      src += src_stride;
-   }
+   /* Each 4-byte macropixel is two 16-bit words to swap */
+   struct util_planar_copy copy = { UTIL_PLANAR_SWAP_16 };
+
+   copy.dst[0] = (uint8_t *)destination_data[0] + destination_pitches[0] * src_field;
+   copy.dst_stride[0] = destination_pitches[0] * num_fields;
+   copy.src[0] = src;
+   copy.src_stride[0] = src_stride;
+   copy.width = 2 * width;
+   copy.height = height;
+   util_planar_copy(&copy);
+}
+
+/**
+ * \brief  Copy a plane of P010/P016 data while converting it to NV12
+ *
+ * Only the 8 most significant bits of each sample are kept.
+ *
+ * \param src_plane[in]  The source plane, 0 for luma and 1 for chroma.
+ * \param width[in]  The source plane width, in UV pairs for the chroma.
+ */
+static inline void
+u_copy_p016_to_nv12(void *const *destination_data,
+                    uint32_t const *destination_pitches,
+                    int src_plane, int src_field,
+                    int src_stride, int num_fields,
+                    uint8_t const *src,
+                    int width, int height)
+{
+   struct util_planar_copy copy = { UTIL_PLANAR_NARROW_16 };
+
+   copy.dst[0] = (uint8_t *)destination_data[src_plane] +
+                 destination_pitches[src_plane] * src_field;
+   copy.dst_stride[0] = destination_pitches[src_plane] * num_fields;
+   copy.src[0] = src;
+   copy.src_stride[0] = src_stride;
+   copy.width = src_plane ? 2 * width : width;
+   copy.height = height;
+   util_planar_copy(&copy);
+}
+
+/**
+ * \brief  Copy P010/P016 chroma data while converting it to YV12
+ *
+ * Same as u_copy_nv12_to_yv12(), keeping the 8 most significant bits of
+ * each sample.
+ */
+static inline void
+u_copy_p016_to_yv12(void *const *destination_data,
+                    uint32_t const *destination_pitches,
+                    int src_plane, int src_field,
+                    int src_stride, int num_fields,
+                    uint8_t const *src,
+                    int width, int height)
+{
+   struct util_planar_copy copy = { UTIL_PLANAR_DEINTERLEAVE_NARROW_16 };
+
+   copy.dst[0] = (uint8_t *)destination_data[2] + destination_pitches[2] * src_field;
+   copy.dst[1] = (uint8_t *)destination_data[1] + destination_pitches[1] * src_field;
+   copy.dst_stride[0] = destination_pitches[2] * num_fields;
+   copy.dst_stride[1] = destination_pitches[1] * num_fields;
+   copy.src[0] = src;
+   copy.src_stride[0] = src_stride;
+   copy.width = width;
+   copy.height = height;
+   util_planar_copy(&copy);
 }
 
 static inline uint32_t
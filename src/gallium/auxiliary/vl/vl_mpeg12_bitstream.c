@@ -27,6 +27,8 @@
  **************************************************************************/
 
 #include "pipe/p_video_codec.h"
+#include "util/u_bands.h"
+#include "util/u_call_once.h"
 #include "util/u_memory.h"
 #include "util/vl_vlc.h"
 
@@ -36,7 +38,8 @@ enum {
    dct_End_of_Block = 0xFF,
    dct_Escape = 0xFE,
    dct_DC = 0xFD,
-   dct_AC = 0xFC
+   dct_AC = 0xFC,
+   dct_Subtable = 0xFB
 };
 
 struct dct_coeff
@@ -529,17 +532,43 @@ static struct vl_vlc_entry tbl_B10[1 << 11];
 static struct vl_vlc_entry tbl_B11[1 << 2];
 static struct vl_vlc_entry tbl_B12[1 << 10];
 static struct vl_vlc_entry tbl_B13[1 << 10];
-static struct dct_coeff tbl_B14_DC[1 << 17];
-static struct dct_coeff tbl_B14_AC[1 << 17];
-static struct dct_coeff tbl_B15[1 << 17];
+/*
+ * The DCT coefficient codes are up to 17 bits long with the sign, but the
+ * long ones are rare.  The tables are indexed by the first DCT_COEFF_BITS
+ * bits, and the entries of prefixes shared by longer codes point to
+ * subtables indexed by the remaining bits.  That keeps them a few KiB each
+ * instead of 512 KiB.
+ */
+#define DCT_COEFF_BITS 9
+#define DCT_COEFF_MAX_BITS 17
+#define DCT_COEFF_TABLE_SIZE 1024
+
+static struct dct_coeff tbl_B14_DC[DCT_COEFF_TABLE_SIZE];
+static struct dct_coeff tbl_B14_AC[DCT_COEFF_TABLE_SIZE];
+static struct dct_coeff tbl_B15[DCT_COEFF_TABLE_SIZE];
 
 static inline void
-init_dct_coeff_table(struct dct_coeff *dst, const struct dct_coeff_compressed *src,
-                     unsigned size, bool is_DC)
+fill_dct_coeff_range(struct dct_coeff *dst, unsigned first, unsigned count,
+                     unsigned start, unsigned end, struct dct_coeff coeff)
+{
+   unsigned i;
+
+   for (i = MAX2(start, first); i < MIN2(end, first + count); ++i)
+      dst[i - first] = coeff;
+}
+
+/**
+ * decompress the codes with the DCT_COEFF_MAX_BITS bit indices first to
+ * first + count - 1, so that the tables can be built a prefix at a time
+ */
+static inline void
+decompress_dct_coeff_table(struct dct_coeff *dst, unsigned first, unsigned count,
+                           const struct dct_coeff_compressed *src,
+                           unsigned size, bool is_DC)
 {
    unsigned i;
 
-   for (i=0;i<(1<<17);++i) {
+   for (i = 0; i < count; ++i) {
       dst[i].length = 0;
       dst[i].level = 0;
       dst[i].run = dct_End_of_Block;
@@ -583,17 +612,75 @@ init_dct_coeff_table(struct dct_coeff *dst, const struct dct_coeff_compressed *s
          break;
       }
 
-      for(i = 0; i < (1u << (17 - coeff.length)); ++i)
-         dst[src->bitcode << 1 | i] = coeff;
+      unsigned start = src->bitcode << 1;
+      unsigned positive = 1u << (17 - coeff.length);
+
+      fill_dct_coeff_range(dst, first, count, start, start + positive, coeff);
 
       if (has_sign) {
 	 coeff.level = -coeff.level;
-         for(; i < (1u << (18 - coeff.length)); ++i)
-            dst[src->bitcode << 1 | i] = coeff;
+         fill_dct_coeff_range(dst, first, count, start + positive,
+                              start + 2 * positive, coeff);
       }
    }
 }
 
+/**
+ * build the two level table from the decompressed one, the entries keep
+ * the full code length
+ */
+static void
+init_dct_coeff_table(struct dct_coeff *dst, const struct dct_coeff_compressed *src,
+                     unsigned size, bool is_DC)
+{
+   const unsigned sub_bits = DCT_COEFF_MAX_BITS - DCT_COEFF_BITS;
+   struct dct_coeff codes[1 << (DCT_COEFF_MAX_BITS - DCT_COEFF_BITS)];
+   unsigned prefix, i, used = 1 << DCT_COEFF_BITS;
+
+   for (prefix = 0; prefix < (1 << DCT_COEFF_BITS); ++prefix) {
+      unsigned max_length = 0;
+
+      decompress_dct_coeff_table(codes, prefix << sub_bits, 1 << sub_bits,
+                                 src, size, is_DC);
+
+      for (i = 0; i < (1 << sub_bits); ++i)
+         max_length = MAX2(max_length, codes[i].length);
+
+      /* all the codes with this prefix are the same one */
+      if (max_length <= DCT_COEFF_BITS) {
+         dst[prefix] = codes[0];
+         continue;
+      }
+
+      unsigned extra = max_length - DCT_COEFF_BITS;
+      dst[prefix].length = extra;
+      dst[prefix].run = dct_Subtable;
+      dst[prefix].level = used;
+
+      assert(used + (1 << extra) <= DCT_COEFF_TABLE_SIZE);
+      for (i = 0; i < (1 << extra); ++i)
+         dst[used + i] = codes[i << (sub_bits - extra)];
+      used += 1 << extra;
+   }
+}
+
+/**
+ * lookup the next DCT coefficient, needs at least DCT_COEFF_MAX_BITS valid
+ */
+static inline const struct dct_coeff *
+get_dct_coeff(struct vl_vlc *vlc, const struct dct_coeff *tbl)
+{
+   const struct dct_coeff *entry = tbl + vl_vlc_peekbits(vlc, DCT_COEFF_BITS);
+
+   if (unlikely(entry->run == dct_Subtable)) {
+      unsigned extra = entry->length;
+      unsigned index = vl_vlc_peekbits(vlc, DCT_COEFF_BITS + extra) & ((1 << extra) - 1);
+      entry = tbl + entry->level + index;
+   }
+
+   return entry;
+}
+
 static inline void
 init_tables()
 {
@@ -625,7 +712,7 @@ motion_vector(struct vl_mpg12_bs *bs, int r, int s, int dmv, short delta[2], sho
       int motion_code;
       int r_size = bs->desc->f_code[s][t];
 
-      vl_vlc_fillbits(&bs->vlc);
+      vl_vlc_refill(&bs->vlc);
       motion_code = vl_vlc_get_vlclbf(&bs->vlc, tbl_B10, 11);
 
       assert(r_size >= 0);
@@ -714,7 +801,7 @@ decode_dct(struct vl_mpg12_bs *bs, struct pipe_mpeg12_macroblock *mb, int scale)
    int i, cbp, blk = 0;
    short *dst = mb->blocks;
 
-   vl_vlc_fillbits(&bs->vlc);
+   vl_vlc_refill(&bs->vlc);
    mb->coded_block_pattern = cbp = intra ? 0x3F : vl_vlc_get_vlclbf(&bs->vlc, tbl_B9, 9);
 
    goto entry;
@@ -738,7 +825,7 @@ entry:
             blk++;
          }
 
-         vl_vlc_fillbits(&bs->vlc);
+         vl_vlc_refill(&bs->vlc);
 
          if (intra) {
             unsigned cc = blk2cc[blk];
@@ -758,7 +845,7 @@ entry:
             if (bs->desc->picture_coding_type == PIPE_MPEG12_PICTURE_CODING_TYPE_D)
                goto next_d;
          } else {
-            entry = tbl_B14_DC + vl_vlc_peekbits(&bs->vlc, 17);
+            entry = get_dct_coeff(&bs->vlc, tbl_B14_DC);
             i = -1;
             continue;
          }
@@ -791,14 +878,44 @@ entry:
          dst[i] = entry->level * scale;
       }
 
-      vl_vlc_fillbits(&bs->vlc);
-      entry = table + vl_vlc_peekbits(&bs->vlc, 17);
+      vl_vlc_refill(&bs->vlc);
+      entry = get_dct_coeff(&bs->vlc, table);
    }
 
    if (bs->desc->picture_coding_type == PIPE_MPEG12_PICTURE_CODING_TYPE_D)
       vl_vlc_eatbits(&bs->vlc, 1);
 }
 
+static void
+emit_macroblock(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target,
+                const struct pipe_mpeg12_macroblock *mb)
+{
+   if (bs->macroblocks) {
+      /* only the coded blocks are used, and they are packed */
+      unsigned num_blocks = util_bitcount(mb->coded_block_pattern & 0x3F);
+      unsigned offset = util_dynarray_num_elements(bs->blocks, short);
+      struct pipe_mpeg12_macroblock *copy =
+         util_dynarray_grow(bs->macroblocks, struct pipe_mpeg12_macroblock, 1);
+
+      if (!copy)
+         return;
+
+      *copy = *mb;
+      /* relocated once all the slices are parsed */
+      copy->blocks = (short *)(uintptr_t)offset;
+
+      if (num_blocks) {
+         short *blocks = util_dynarray_grow(bs->blocks, short, 64 * num_blocks);
+         if (blocks)
+            memcpy(blocks, mb->blocks, 64 * sizeof(short) * num_blocks);
+         else
+            copy->coded_block_pattern = 0;
+      }
+   } else {
+      bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb->base, 1);
+   }
+}
+
 static inline void
 decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
 {
@@ -813,14 +930,14 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
    mb.blocks = dct_blocks;
 
    reset_predictor(bs);
-   vl_vlc_fillbits(&bs->vlc);
+   vl_vlc_refill(&bs->vlc);
    dct_scale = quant_scale[bs->desc->q_scale_type][vl_vlc_get_uimsbf(&bs->vlc, 5)];
 
    if (vl_vlc_get_uimsbf(&bs->vlc, 1))
       while (vl_vlc_get_uimsbf(&bs->vlc, 9) & 1)
-         vl_vlc_fillbits(&bs->vlc);
+         vl_vlc_refill(&bs->vlc);
 
-   vl_vlc_fillbits(&bs->vlc);
+   vl_vlc_refill(&bs->vlc);
    assert(vl_vlc_peekbits(&bs->vlc, 23));
    do {
       int inc = 0;
@@ -829,12 +946,12 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
          /* MPEG-1 macroblock stuffing, can appear an arbitrary number of times. */
          while (vl_vlc_peekbits(&bs->vlc, 11) == 15) {
             vl_vlc_eatbits(&bs->vlc, 11);
-            vl_vlc_fillbits(&bs->vlc);
+            vl_vlc_refill(&bs->vlc);
          }
 
          if (vl_vlc_peekbits(&bs->vlc, 11) == 8) {
             vl_vlc_eatbits(&bs->vlc, 11);
-            vl_vlc_fillbits(&bs->vlc);
+            vl_vlc_refill(&bs->vlc);
             inc += 33;
          } else {
             inc += vl_vlc_get_vlclbf(&bs->vlc, tbl_B1, 11);
@@ -846,7 +963,7 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
          if (!inc)
             return;
          mb.num_skipped_macroblocks = inc - 1;
-         bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb.base, 1);
+         emit_macroblock(bs, target, &mb);
       }
       mb.x = x += inc;
       if (bs->decoder->profile == PIPE_VIDEO_PROFILE_MPEG1) {
@@ -952,28 +1069,178 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
       } else
          mb.coded_block_pattern = 0;
 
-      vl_vlc_fillbits(&bs->vlc);
+      vl_vlc_refill(&bs->vlc);
    } while (vl_vlc_bits_left(&bs->vlc) && vl_vlc_peekbits(&bs->vlc, 23));
 
    mb.num_skipped_macroblocks = 0;
-   bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb.base, 1);
+   emit_macroblock(bs, target, &mb);
+}
+
+/* Parallel parsing of the slices, which are independent from each other.
+ * Each job parses a range of consecutive slices into its own list of
+ * macroblocks, which are then handed to the decoder in bitstream order.
+ */
+#define VL_MPG12_MAX_JOBS UTIL_BANDS_MAX
+#define VL_MPG12_MIN_SLICES_PER_JOB 4
+
+struct vl_mpg12_slice_job
+{
+   struct vl_mpg12_bs bs;
+   struct pipe_video_buffer *target;
+   const struct vl_vlc *slices;
+   unsigned num_slices;
+
+   struct util_dynarray macroblocks;
+   struct util_dynarray blocks;
+};
+
+static util_once_flag init_once_flag = UTIL_ONCE_FLAG_INIT;
+
+static void
+decode_slices(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target,
+              const struct vl_vlc *slices, unsigned num_slices)
+{
+   unsigned i;
+
+   for (i = 0; i < num_slices; ++i) {
+      bs->vlc = slices[i];
+      vl_vlc_eatbits(&bs->vlc, 24);
+      decode_slice(bs, target);
+   }
+}
+
+static void
+slice_job_execute(void *data, unsigned index)
+{
+   struct vl_mpg12_slice_job *job = (struct vl_mpg12_slice_job *)data + index;
+
+   decode_slices(&job->bs, job->target, job->slices, job->num_slices);
+}
+
+/**
+ * find the start of all the slices without decoding them
+ */
+static unsigned
+find_slices(struct vl_mpg12_bs *bs)
+{
+   struct vl_vlc vlc = bs->vlc;
+
+   util_dynarray_clear(&bs->slices);
+
+   while (vl_vlc_search_byte(&vlc, ~0, 0x00) && vl_vlc_bits_left(&vlc) > 32) {
+      uint32_t code = vl_vlc_peekbits(&vlc, 32);
+
+      if (code >= 0x101 && code <= 0x1AF) {
+         struct vl_vlc *slice = util_dynarray_grow(&bs->slices, struct vl_vlc, 1);
+         if (!slice)
+            return 0;
+
+         *slice = vlc;
+         vl_vlc_eatbits(&vlc, 32);
+      } else {
+         vl_vlc_eatbits(&vlc, 8);
+      }
+
+      vl_vlc_fillbits(&vlc);
+   }
+
+   return util_dynarray_num_elements(&bs->slices, struct vl_vlc);
+}
+
+static bool
+decode_parallel(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
+{
+   unsigned num_slices = find_slices(bs);
+   unsigned num_jobs = MIN2(util_bands_max(),
+                            num_slices / VL_MPG12_MIN_SLICES_PER_JOB);
+   const struct vl_vlc *slices = bs->slices.data;
+   unsigned i, j;
+
+   if (num_jobs <= 1)
+      return false;
+
+   if (!bs->jobs) {
+      bs->jobs = CALLOC(VL_MPG12_MAX_JOBS, sizeof(*bs->jobs));
+      if (!bs->jobs)
+         return false;
+
+      for (i = 0; i < VL_MPG12_MAX_JOBS; ++i) {
+         util_dynarray_init(&bs->jobs[i].macroblocks, NULL);
+         util_dynarray_init(&bs->jobs[i].blocks, NULL);
+      }
+      bs->num_jobs = VL_MPG12_MAX_JOBS;
+   }
+
+   for (i = 0; i < num_jobs; ++i) {
+      struct vl_mpg12_slice_job *job = &bs->jobs[i];
+      unsigned first = num_slices * i / num_jobs;
+      unsigned last = num_slices * (i + 1) / num_jobs;
+
+      util_dynarray_clear(&job->macroblocks);
+      util_dynarray_clear(&job->blocks);
+
+      job->bs.decoder = bs->decoder;
+      job->bs.desc = bs->desc;
+      job->bs.intra_dct_tbl = bs->intra_dct_tbl;
+      job->bs.macroblocks = &job->macroblocks;
+      job->bs.blocks = &job->blocks;
+      job->target = target;
+      job->slices = slices + first;
+      job->num_slices = last - first;
+   }
+
+   util_run_bands(num_jobs, slice_job_execute, bs->jobs);
+
+   for (i = 0; i < num_jobs; ++i) {
+      struct vl_mpg12_slice_job *job = &bs->jobs[i];
+      struct pipe_mpeg12_macroblock *mbs;
+      unsigned num_mbs;
+
+      mbs = job->macroblocks.data;
+      num_mbs = util_dynarray_num_elements(&job->macroblocks,
+                                           struct pipe_mpeg12_macroblock);
+      if (!num_mbs)
+         continue;
+
+      for (j = 0; j < num_mbs; ++j)
+         mbs[j].blocks = (short *)job->blocks.data + (uintptr_t)mbs[j].blocks;
+
+      bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base,
+                                     &mbs[0].base, num_mbs);
+   }
+
+   return true;
 }
 
 void
 vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder)
 {
-   static bool tables_initialized = false;
-
    assert(bs);
 
    memset(bs, 0, sizeof(struct vl_mpg12_bs));
 
    bs->decoder = decoder;
+   util_dynarray_init(&bs->slices, NULL);
+
+   util_call_once(&init_once_flag, init_tables);
+}
 
-   if (!tables_initialized) {
-      init_tables();
-      tables_initialized = true;
+void
+vl_mpg12_bs_cleanup(struct vl_mpg12_bs *bs)
+{
+   unsigned i;
+
+   assert(bs);
+
+   for (i = 0; i < bs->num_jobs; ++i) {
+      util_dynarray_fini(&bs->jobs[i].macroblocks);
+      util_dynarray_fini(&bs->jobs[i].blocks);
    }
+   FREE(bs->jobs);
+   bs->jobs = NULL;
+   bs->num_jobs = 0;
+
+   util_dynarray_fini(&bs->slices);
 }
 
 void
@@ -990,6 +1257,9 @@ vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
    bs->intra_dct_tbl = picture->intra_vlc_format ? tbl_B15 : tbl_B14_AC;
 
    vl_vlc_init(&bs->vlc, num_buffers, buffers, sizes);
+   if (util_bands_max() > 1 && decode_parallel(bs, target))
+      return;
+
    while (vl_vlc_search_byte(&bs->vlc, ~0, 0x00) && vl_vlc_bits_left(&bs->vlc) > 32) {
       uint32_t code = vl_vlc_peekbits(&bs->vlc, 32);
 
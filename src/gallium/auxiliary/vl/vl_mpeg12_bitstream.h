@@ -29,8 +29,11 @@
 #define vl_mpeg12_bitstream_h
 
 #include "vl_defines.h"
+#include "util/u_dynarray.h"
 #include "util/vl_vlc.h"
 
+struct vl_mpg12_slice_job;
+
 struct vl_mpg12_bs
 {
    struct pipe_video_codec *decoder;
@@ -40,11 +43,23 @@ struct vl_mpg12_bs
 
    struct vl_vlc vlc;
    short pred_dc[3];
+
+   /* when set, the parsed macroblocks are stored here instead of decoded */
+   struct util_dynarray *macroblocks;
+   struct util_dynarray *blocks;
+
+   /* slices found in the current bitstream, parsed by these jobs */
+   struct util_dynarray slices;
+   struct vl_mpg12_slice_job *jobs;
+   unsigned num_jobs;
 };
 
 void
 vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder);
 
+void
+vl_mpg12_bs_cleanup(struct vl_mpg12_bs *bs);
+
 void
 vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
                    struct pipe_video_buffer *target,
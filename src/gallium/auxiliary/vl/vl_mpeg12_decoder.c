@@ -472,6 +472,7 @@ vl_mpeg12_destroy_buffer(struct vl_mpeg12_buffer *buf)
    cleanup_idct_buffer(buf);
    cleanup_mc_buffer(buf);
    vl_vb_cleanup(&buf->vertex_stream);
+   vl_mpg12_bs_cleanup(&buf->bs);
 
    FREE(buf);
 }
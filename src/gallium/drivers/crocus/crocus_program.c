@@ -39,6 +39,7 @@
 #include "util/u_upload_mgr.h"
 #include "util/u_debug.h"
 #include "util/u_prim.h"
+#include "util/mesa-cache-key.h"
 #include "compiler/nir/nir.h"
 #include "compiler/nir/nir_builder.h"
 #include "compiler/nir/nir_serialize.h"
@@ -2684,7 +2685,7 @@ crocus_create_uncompiled_shader(struct pipe_context *ctx,
       struct blob blob;
       blob_init(&blob);
       nir_serialize(&blob, nir, true);
-      _mesa_sha1_compute(blob.data, blob.size, ish->nir_sha1);
+      _mesa_cache_key_compute(blob.data, blob.size, ish->nir_sha1);
       blob_finish(&blob);
    }
 
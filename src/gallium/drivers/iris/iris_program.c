@@ -39,6 +39,7 @@
 #include "util/u_upload_mgr.h"
 #include "util/u_debug.h"
 #include "util/u_async_debug.h"
+#include "util/mesa-cache-key.h"
 #include "compiler/nir/nir.h"
 #include "compiler/nir/nir_builder.h"
 #include "compiler/nir/nir_serialize.h"
@@ -2421,7 +2422,7 @@ iris_create_uncompiled_shader(struct iris_screen *screen,
       struct blob blob;
       blob_init(&blob);
       nir_serialize(&blob, nir, true);
-      _mesa_sha1_compute(blob.data, blob.size, ish->nir_sha1);
+      _mesa_cache_key_compute(blob.data, blob.size, ish->nir_sha1);
       blob_finish(&blob);
    }
 
@@ -915,6 +915,10 @@ lp_linear_check_sampler(const struct lp_sampler_static_state *sampler,
        sampler->texture_state.format != PIPE_FORMAT_R8G8B8X8_UNORM)
       return false;
 
+   /* The linear path reads textures row by row */
+   if (sampler->texture_state.tiled)
+      return false;
+
    /* We don't support sampler view swizzling on the linear path */
    if (sampler->texture_state.swizzle_r != PIPE_SWIZZLE_X ||
        sampler->texture_state.swizzle_g != PIPE_SWIZZLE_Y ||
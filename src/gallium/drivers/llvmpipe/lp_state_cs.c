@@ -51,7 +51,7 @@
 #include "lp_cs_tpool.h"
 #include "frontend/sw_winsys.h"
 #include "nir/nir_to_tgsi_info.h"
-#include "util/mesa-sha1.h"
+#include "util/mesa-cache-key.h"
 #include "nir_serialize.h"
 
 #include "draw/draw_context.h"
@@ -1149,11 +1149,11 @@ lp_cs_get_ir_cache_key(struct lp_compute_shader_variant *variant,
    ir_binary = blob.data;
    ir_size = blob.size;
 
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
-   _mesa_sha1_update(&ctx, &variant->key, variant->shader->variant_key_size);
-   _mesa_sha1_update(&ctx, ir_binary, ir_size);
-   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
+   _mesa_cache_key_update(&ctx, &variant->key, variant->shader->variant_key_size);
+   _mesa_cache_key_update(&ctx, ir_binary, ir_size);
+   _mesa_cache_key_final(&ctx, ir_sha1_cache_key);
 
    blob_finish(&blob);
 }
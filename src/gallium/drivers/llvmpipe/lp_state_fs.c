@@ -109,7 +109,7 @@
 
 #include "lp_screen.h"
 #include "compiler/nir/nir_serialize.h"
-#include "util/mesa-sha1.h"
+#include "util/mesa-cache-key.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -3643,6 +3643,8 @@ dump_fs_variant_key(struct lp_fragment_shader_variant_key *key)
                    texture->pot_width,
                    texture->pot_height,
                    texture->pot_depth);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
    }
    struct lp_image_static_state *images = lp_fs_variant_key_images(key);
    for (unsigned i = 0; i < key->nr_images; ++i) {
@@ -3713,11 +3715,11 @@ lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
    ir_binary = blob.data;
    ir_size = blob.size;
 
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
-   _mesa_sha1_update(&ctx, &variant->key, variant->shader->variant_key_size);
-   _mesa_sha1_update(&ctx, ir_binary, ir_size);
-   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
+   _mesa_cache_key_update(&ctx, &variant->key, variant->shader->variant_key_size);
+   _mesa_cache_key_update(&ctx, ir_binary, ir_size);
+   _mesa_cache_key_final(&ctx, ir_sha1_cache_key);
 
    blob_finish(&blob);
 }
@@ -3839,6 +3841,7 @@ generate_variant(struct llvmpipe_context *lp,
       }
 
       if (target == PIPE_TEXTURE_2D &&
+          !samp0->texture_state.tiled &&
           min_img_filter == PIPE_TEX_FILTER_NEAREST &&
           mag_img_filter == PIPE_TEX_FILTER_NEAREST &&
           min_mip_filter == PIPE_TEX_MIPFILTER_NONE &&
@@ -659,7 +659,7 @@ llvmpipe_fs_variant_linear_fastpath(struct lp_fragment_shader_variant *variant)
 
    struct lp_sampler_static_state *samp0 =
       lp_fs_variant_key_sampler_idx(&variant->key, 0);
-   if (!samp0)
+   if (!samp0 || samp0->texture_state.tiled)
       return;
 
    enum pipe_format tex_format = samp0->texture_state.format;
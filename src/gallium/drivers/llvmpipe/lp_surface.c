@@ -35,6 +35,289 @@
 #include "lp_texture.h"
 #include "lp_query.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_cs_tpool.h"
+
+#if DETECT_ARCH_SSE
+#include <emmintrin.h>
+#endif
+
+
+/* Copies and fills of at least this many bytes are split into chunks and
+ * executed on the compute thread pool.  Below it the cost of waking the
+ * threads is larger than what we gain.  Such transfers are also far
+ * bigger than the caches, so the destination is written with streaming
+ * stores.
+ */
+#define LP_COPY_PARALLEL_MIN_SIZE (4 << 20)
+#define LP_COPY_CHUNK_SIZE (1 << 20)
+
+
+static void
+lp_memcpy(uint8_t *dst, const uint8_t *src, size_t size, bool stream)
+{
+#if DETECT_ARCH_SSE
+   if (stream && size >= 128) {
+      unsigned head = (16 - ((uintptr_t)dst & 15)) & 15;
+
+      memcpy(dst, src, head);
+      dst += head;
+      src += head;
+      size -= head;
+
+      while (size >= 64) {
+         __m128i a = _mm_loadu_si128((const __m128i *)src);
+         __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+         __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+         __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+         _mm_stream_si128((__m128i *)dst, a);
+         _mm_stream_si128((__m128i *)(dst + 16), b);
+         _mm_stream_si128((__m128i *)(dst + 32), c);
+         _mm_stream_si128((__m128i *)(dst + 48), d);
+         dst += 64;
+         src += 64;
+         size -= 64;
+      }
+      _mm_sfence();
+   }
+#endif
+   memcpy(dst, src, size);
+}
+
+
+/**
+ * Fill size bytes at dst with a repeated pattern, dst being at the start
+ * of a pattern.  A trailing partial pattern is written as well.
+ */
+static void
+lp_fill_pattern(uint8_t *dst, const uint8_t *pattern, unsigned pattern_size,
+                size_t size, bool stream)
+{
+   size_t i = 0;
+
+   if (pattern_size == 1 && !stream) {
+      memset(dst, pattern[0], size);
+      return;
+   }
+
+#if DETECT_ARCH_SSE
+   /* Patterns whose period together with the vector width fits in four
+    * registers: 1, 2, 4, 8, 12 and 16 bytes cover every clear_buffer user.
+    */
+   unsigned period = pattern_size;
+   while (period % 16)
+      period += pattern_size;
+
+   if (size >= 64 && period <= 64) {
+      uint8_t rep[64 + 16];
+      __m128i v[4];
+      unsigned num_v = period / 16;
+
+      /* Scalar head up to 16-byte alignment. */
+      unsigned head = (16 - ((uintptr_t)dst & 15)) & 15;
+      for (; i < head; i++)
+         dst[i] = pattern[i % pattern_size];
+
+      unsigned phase = head % pattern_size;
+      for (unsigned j = 0; j < period + 16; j++)
+         rep[j] = pattern[(phase + j) % pattern_size];
+      for (unsigned j = 0; j < num_v; j++)
+         v[j] = _mm_loadu_si128((const __m128i *)&rep[j * 16]);
+
+      unsigned k = 0;
+      if (stream) {
+         for (; i + 16 <= size; i += 16) {
+            _mm_stream_si128((__m128i *)&dst[i], v[k]);
+            k = k + 1 == num_v ? 0 : k + 1;
+         }
+         _mm_sfence();
+      } else {
+         for (; i + 16 <= size; i += 16) {
+            _mm_store_si128((__m128i *)&dst[i], v[k]);
+            k = k + 1 == num_v ? 0 : k + 1;
+         }
+      }
+   }
+#endif
+
+   if (pattern_size == 4 && i == 0 && ((uintptr_t)dst & 3) == 0) {
+      util_memset32(dst, *(const uint32_t *)pattern, size / 4);
+      i = size & ~(size_t)3;
+   }
+
+   for (; i < size; i++)
+      dst[i] = pattern[i % pattern_size];
+}
+
+
+struct lp_copy_job {
+   uint8_t *dst;
+   const uint8_t *src;
+   const uint8_t *pattern;
+   unsigned pattern_size;
+   size_t size;
+   size_t chunk_size;
+
+   /* Box copies, row by row */
+   unsigned row_size;
+   unsigned rows_per_layer;
+   unsigned rows_per_task;
+   unsigned num_rows;
+   unsigned dst_stride, dst_layer_stride;
+   unsigned src_stride, src_layer_stride;
+};
+
+
+static void
+lp_copy_linear_task(void *data, int iter_idx, struct lp_cs_local_mem *lmem)
+{
+   const struct lp_copy_job *job = data;
+   size_t offset = (size_t)iter_idx * job->chunk_size;
+   size_t size = MIN2(job->chunk_size, job->size - offset);
+
+   lp_memcpy(job->dst + offset, job->src + offset, size, true);
+}
+
+
+static void
+lp_fill_task(void *data, int iter_idx, struct lp_cs_local_mem *lmem)
+{
+   const struct lp_copy_job *job = data;
+   size_t offset = (size_t)iter_idx * job->chunk_size;
+   size_t size = MIN2(job->chunk_size, job->size - offset);
+
+   lp_fill_pattern(job->dst + offset, job->pattern, job->pattern_size,
+                   size, true);
+}
+
+
+static void
+lp_copy_rows_task(void *data, int iter_idx, struct lp_cs_local_mem *lmem)
+{
+   const struct lp_copy_job *job = data;
+   unsigned first = iter_idx * job->rows_per_task;
+   unsigned last = MIN2(first + job->rows_per_task, job->num_rows);
+
+   for (unsigned r = first; r < last; r++) {
+      unsigned z = r / job->rows_per_layer;
+      unsigned y = r % job->rows_per_layer;
+
+      lp_memcpy(job->dst + (size_t)z * job->dst_layer_stride +
+                (size_t)y * job->dst_stride,
+                job->src + (size_t)z * job->src_layer_stride +
+                (size_t)y * job->src_stride,
+                job->row_size, true);
+   }
+}
+
+
+static void
+lp_copy_job_run(struct llvmpipe_screen *screen, lp_cs_tpool_task_func func,
+                struct lp_copy_job *job, unsigned num_tasks)
+{
+   struct lp_cs_tpool_task *task;
+
+   mtx_lock(&screen->cs_mutex);
+   task = lp_cs_tpool_queue_task(screen->cs_tpool, func, job, num_tasks);
+   mtx_unlock(&screen->cs_mutex);
+
+   lp_cs_tpool_wait_for_task(screen->cs_tpool, &task);
+}
+
+
+/**
+ * Split a large single-sampled copy between resources of the same block
+ * layout across the thread pool.  Returns false if the copy is not worth
+ * it, in which case nothing was done.
+ */
+static bool
+lp_resource_copy_parallel(struct pipe_context *pipe,
+                          struct pipe_resource *dst, unsigned dst_level,
+                          unsigned dstx, unsigned dsty, unsigned dstz,
+                          struct pipe_resource *src, unsigned src_level,
+                          const struct pipe_box *src_box)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   const enum pipe_format format = src->format;
+   struct pipe_transfer *src_trans, *dst_trans;
+   struct lp_copy_job job;
+
+   if (screen->num_threads == 0 ||
+       src->nr_samples > 1 || dst->nr_samples > 1 ||
+       util_format_get_blocksize(format) !=
+       util_format_get_blocksize(dst->format) ||
+       util_format_get_blockwidth(format) !=
+       util_format_get_blockwidth(dst->format) ||
+       util_format_get_blockheight(format) !=
+       util_format_get_blockheight(dst->format))
+      return false;
+
+   const unsigned row_size = util_format_get_stride(format, src_box->width);
+   const unsigned rows_per_layer =
+      util_format_get_nblocksy(format, src_box->height);
+   const uint64_t total = (uint64_t)row_size * rows_per_layer * src_box->depth;
+
+   if (total < LP_COPY_PARALLEL_MIN_SIZE)
+      return false;
+
+   struct pipe_box dst_box = *src_box;
+   dst_box.x = dstx;
+   dst_box.y = dsty;
+   dst_box.z = dstz;
+
+   memset(&job, 0, sizeof(job));
+
+   if (src->target == PIPE_BUFFER) {
+      assert(dst->target == PIPE_BUFFER);
+      job.src = pipe->buffer_map(pipe, src, src_level, PIPE_MAP_READ,
+                                 src_box, &src_trans);
+      if (!job.src)
+         return true;
+      job.dst = pipe->buffer_map(pipe, dst, dst_level,
+                                 PIPE_MAP_WRITE | PIPE_MAP_DISCARD_RANGE,
+                                 &dst_box, &dst_trans);
+      if (!job.dst) {
+         pipe->buffer_unmap(pipe, src_trans);
+         return true;
+      }
+
+      job.size = src_box->width;
+      job.chunk_size = LP_COPY_CHUNK_SIZE;
+      lp_copy_job_run(screen, lp_copy_linear_task, &job,
+                      DIV_ROUND_UP(job.size, job.chunk_size));
+
+      pipe->buffer_unmap(pipe, dst_trans);
+      pipe->buffer_unmap(pipe, src_trans);
+      return true;
+   }
+
+   job.src = pipe->texture_map(pipe, src, src_level, PIPE_MAP_READ,
+                               src_box, &src_trans);
+   if (!job.src)
+      return true;
+   job.dst = pipe->texture_map(pipe, dst, dst_level,
+                               PIPE_MAP_WRITE | PIPE_MAP_DISCARD_RANGE,
+                               &dst_box, &dst_trans);
+   if (!job.dst) {
+      pipe->texture_unmap(pipe, src_trans);
+      return true;
+   }
+
+   job.row_size = row_size;
+   job.rows_per_layer = rows_per_layer;
+   job.num_rows = rows_per_layer * src_box->depth;
+   job.rows_per_task = MAX2(LP_COPY_CHUNK_SIZE / row_size, 1);
+   job.dst_stride = dst_trans->stride;
+   job.dst_layer_stride = dst_trans->layer_stride;
+   job.src_stride = src_trans->stride;
+   job.src_layer_stride = src_trans->layer_stride;
+   lp_copy_job_run(screen, lp_copy_rows_task, &job,
+                   DIV_ROUND_UP(job.num_rows, job.rows_per_task));
+
+   pipe->texture_unmap(pipe, dst_trans);
+   pipe->texture_unmap(pipe, src_trans);
+   return true;
+}
 
 
 static void
@@ -111,6 +394,11 @@ lp_resource_copy(struct pipe_context *pipe,
                           src, src_level, src_box);
       return;
    }
+
+   if (lp_resource_copy_parallel(pipe, dst, dst_level, dstx, dsty, dstz,
+                                 src, src_level, src_box))
+      return;
+
    util_resource_copy_region(pipe, dst, dst_level, dstx, dsty, dstz,
                              src, src_level, src_box);
 }
@@ -487,24 +775,31 @@ llvmpipe_clear_buffer(struct pipe_context *pipe,
                       const void *clear_value,
                       int clear_value_size)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
    struct pipe_transfer *dst_t;
    struct pipe_box box;
 
    u_box_1d(offset, size, &box);
 
-   char *dst = pipe->buffer_map(pipe, res, 0, PIPE_MAP_WRITE, &box, &dst_t);
+   uint8_t *dst = pipe->buffer_map(pipe, res, 0, PIPE_MAP_WRITE, &box, &dst_t);
+   if (!dst)
+      return;
 
-   switch (clear_value_size) {
-   case 1:
-      memset(dst, *(uint8_t *)clear_value, size);
-      break;
-   case 4:
-      util_memset32(dst, *(uint32_t *)clear_value, size / 4);
-      break;
-   default:
-      for (unsigned i = 0; i < size; i += clear_value_size)
-         memcpy(&dst[i], clear_value, clear_value_size);
-      break;
+   if (size >= LP_COPY_PARALLEL_MIN_SIZE && screen->num_threads) {
+      struct lp_copy_job job;
+
+      /* Chunks start on a pattern boundary. */
+      memset(&job, 0, sizeof(job));
+      job.dst = dst;
+      job.pattern = clear_value;
+      job.pattern_size = clear_value_size;
+      job.size = size;
+      job.chunk_size = LP_COPY_CHUNK_SIZE -
+                       LP_COPY_CHUNK_SIZE % clear_value_size;
+      lp_copy_job_run(screen, lp_fill_task, &job,
+                      DIV_ROUND_UP(job.size, job.chunk_size));
+   } else {
+      lp_fill_pattern(dst, clear_value, clear_value_size, size, false);
    }
    pipe->buffer_unmap(pipe, dst_t);
 }
@@ -0,0 +1,343 @@
+/**************************************************************************
+ *
+ * Copyright 2023 Mesa contributors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Correctness and bandwidth of resource_copy_region and clear_buffer,
+ * which are split across the thread pool for large sizes.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "util/os_time.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "frontend/sw_winsys.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+struct copy_test_case {
+   enum pipe_texture_target target;
+   unsigned width, height, depth;
+   /* Source box, destination at (dstx, dsty, dstz) */
+   unsigned x, y, z, w, h, d;
+   unsigned dstx, dsty, dstz;
+};
+
+static const struct copy_test_case copy_test_cases[] = {
+   { PIPE_BUFFER, 64 << 10, 1, 1, 16, 0, 0, 60 << 10, 1, 1, 3, 0, 0 },
+   { PIPE_BUFFER, 64 << 20, 1, 1, 0, 0, 0, 64 << 20, 1, 1, 0, 0, 0 },
+   { PIPE_BUFFER, 32 << 20, 1, 1, 7, 0, 0, (24 << 20) + 13, 1, 1, 5, 0, 0 },
+   { PIPE_TEXTURE_2D, 256, 256, 1, 0, 0, 0, 256, 256, 1, 0, 0, 0 },
+   { PIPE_TEXTURE_2D, 4096, 4096, 1, 0, 0, 0, 4096, 4096, 1, 0, 0, 0 },
+   { PIPE_TEXTURE_2D, 4096, 2048, 1, 3, 5, 0, 4000, 1900, 1, 7, 1, 0 },
+   { PIPE_TEXTURE_3D, 256, 256, 64, 1, 2, 3, 250, 251, 60, 2, 1, 0 },
+};
+
+struct fill_test_case {
+   unsigned size, offset, fill_size, pattern_size;
+};
+
+static const struct fill_test_case fill_test_cases[] = {
+   { 1 << 20, 4, 1000, 4 },
+   { 64 << 20, 0, 64 << 20, 1 },
+   { 64 << 20, 0, 64 << 20, 4 },
+   { 64 << 20, 12, (48 << 20) + 36, 12 },
+   { 64 << 20, 16, 48 << 20, 16 },
+   { 32 << 20, 8, (16 << 20) + 8, 8 },
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "GB/s\t"
+           "test\n");
+
+   fflush(fp);
+}
+
+
+static struct pipe_resource *
+create_resource(struct pipe_screen *screen, enum pipe_texture_target target,
+                unsigned width, unsigned height, unsigned depth)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = target;
+   templ.format = target == PIPE_BUFFER ? PIPE_FORMAT_R8_UNORM :
+                                          PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = depth;
+   templ.array_size = 1;
+   templ.bind = target == PIPE_BUFFER ? PIPE_BIND_SHADER_BUFFER :
+                                        PIPE_BIND_SAMPLER_VIEW;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+static uint8_t *
+map_resource(struct pipe_context *pipe, struct pipe_resource *res,
+             unsigned usage, struct pipe_transfer **transfer)
+{
+   struct pipe_box box;
+
+   u_box_3d(0, 0, 0, res->width0, res->height0, res->depth0, &box);
+   if (res->target == PIPE_BUFFER)
+      return pipe->buffer_map(pipe, res, 0, usage, &box, transfer);
+   return pipe->texture_map(pipe, res, 0, usage, &box, transfer);
+}
+
+
+static void
+unmap_resource(struct pipe_context *pipe, struct pipe_resource *res,
+               struct pipe_transfer *transfer)
+{
+   if (res->target == PIPE_BUFFER)
+      pipe->buffer_unmap(pipe, transfer);
+   else
+      pipe->texture_unmap(pipe, transfer);
+}
+
+
+static void
+randomize(uint8_t *data, size_t size)
+{
+   for (size_t i = 0; i < size; i++)
+      data[i] = rand();
+}
+
+
+static void
+report(FILE *fp, bool success, double gbps, const char *name)
+{
+   if (fp) {
+      fprintf(fp, "%s\t%f\t%s\n", success ? "pass" : "fail", gbps, name);
+      fflush(fp);
+   }
+}
+
+
+static bool
+test_copy(unsigned verbose, FILE *fp, struct pipe_context *pipe,
+          const struct copy_test_case *test)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *src, *dst;
+   struct pipe_transfer *src_trans, *dst_trans;
+   struct pipe_box box;
+   const unsigned bs = test->target == PIPE_BUFFER ? 1 : 4;
+   bool success = true;
+   char name[128];
+
+   snprintf(name, sizeof(name), "copy %s %ux%ux%u",
+            test->target == PIPE_BUFFER ? "buffer" : "texture",
+            test->w, test->h, test->d);
+
+   src = create_resource(screen, test->target, test->width, test->height,
+                         test->depth);
+   dst = create_resource(screen, test->target, test->width, test->height,
+                         test->depth);
+   if (!src || !dst) {
+      pipe_resource_reference(&src, NULL);
+      pipe_resource_reference(&dst, NULL);
+      return false;
+   }
+
+   uint8_t *map = map_resource(pipe, src, PIPE_MAP_WRITE, &src_trans);
+   size_t src_size = (size_t)src_trans->layer_stride * test->depth;
+   if (test->target == PIPE_BUFFER)
+      src_size = test->width;
+   randomize(map, src_size);
+   uint8_t *ref_src = MALLOC(src_size);
+   memcpy(ref_src, map, src_size);
+   unmap_resource(pipe, src, src_trans);
+
+   map = map_resource(pipe, dst, PIPE_MAP_WRITE, &dst_trans);
+   randomize(map, src_size);
+   uint8_t *ref_dst = MALLOC(src_size);
+   memcpy(ref_dst, map, src_size);
+   const unsigned stride = dst_trans->stride;
+   const unsigned layer_stride = dst_trans->layer_stride;
+   unmap_resource(pipe, dst, dst_trans);
+
+   for (unsigned z = 0; z < test->d; z++) {
+      for (unsigned y = 0; y < test->h; y++) {
+         memcpy(ref_dst + (size_t)(test->dstz + z) * layer_stride +
+                (size_t)(test->dsty + y) * stride + test->dstx * bs,
+                ref_src + (size_t)(test->z + z) * layer_stride +
+                (size_t)(test->y + y) * stride + test->x * bs,
+                (size_t)test->w * bs);
+      }
+   }
+
+   u_box_3d(test->x, test->y, test->z, test->w, test->h, test->d, &box);
+
+   /* One untimed run to fault the pages in. */
+   pipe->resource_copy_region(pipe, dst, 0, test->dstx, test->dsty,
+                              test->dstz, src, 0, &box);
+
+   const unsigned iterations = 8;
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++) {
+      pipe->resource_copy_region(pipe, dst, 0, test->dstx, test->dsty,
+                                 test->dstz, src, 0, &box);
+   }
+   int64_t ns = os_time_get_nano() - start;
+
+   map = map_resource(pipe, dst, PIPE_MAP_READ, &dst_trans);
+   if (memcmp(map, ref_dst, src_size) != 0)
+      success = false;
+   unmap_resource(pipe, dst, dst_trans);
+
+   /* Read and written once each */
+   double gbps = 2.0 * test->w * test->h * test->d * bs * iterations / ns;
+
+   if (verbose || !success)
+      printf("%s %-32s %8.2f GB/s\n", success ? "pass" : "FAIL", name, gbps);
+   report(fp, success, gbps, name);
+
+   FREE(ref_src);
+   FREE(ref_dst);
+   pipe_resource_reference(&src, NULL);
+   pipe_resource_reference(&dst, NULL);
+
+   return success;
+}
+
+
+static bool
+test_fill(unsigned verbose, FILE *fp, struct pipe_context *pipe,
+          const struct fill_test_case *test)
+{
+   struct pipe_resource *res;
+   struct pipe_transfer *trans;
+   uint8_t pattern[16];
+   bool success = true;
+   char name[128];
+
+   snprintf(name, sizeof(name), "fill %u bytes, %u byte pattern",
+            test->fill_size, test->pattern_size);
+
+   res = create_resource(pipe->screen, PIPE_BUFFER, test->size, 1, 1);
+   if (!res)
+      return false;
+
+   randomize(pattern, sizeof(pattern));
+
+   uint8_t *map = map_resource(pipe, res, PIPE_MAP_WRITE, &trans);
+   randomize(map, test->size);
+   uint8_t *ref = MALLOC(test->size);
+   memcpy(ref, map, test->size);
+   unmap_resource(pipe, res, trans);
+
+   for (unsigned i = 0; i < test->fill_size; i++)
+      ref[test->offset + i] = pattern[i % test->pattern_size];
+
+   pipe->clear_buffer(pipe, res, test->offset, test->fill_size, pattern,
+                      test->pattern_size);
+
+   const unsigned iterations = 8;
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++) {
+      pipe->clear_buffer(pipe, res, test->offset, test->fill_size, pattern,
+                         test->pattern_size);
+   }
+   int64_t ns = os_time_get_nano() - start;
+
+   map = map_resource(pipe, res, PIPE_MAP_READ, &trans);
+   if (memcmp(map, ref, test->size) != 0)
+      success = false;
+   unmap_resource(pipe, res, trans);
+
+   double gbps = (double)test->fill_size * iterations / ns;
+
+   if (verbose || !success)
+      printf("%s %-32s %8.2f GB/s\n", success ? "pass" : "FAIL", name, gbps);
+   report(fp, success, gbps, name);
+
+   FREE(ref);
+   pipe_resource_reference(&res, NULL);
+
+   return success;
+}
+
+
+bool
+test_all(unsigned verbose, FILE *fp)
+{
+   struct sw_winsys *winsys = null_sw_create();
+   struct pipe_screen *screen = llvmpipe_create_screen(winsys);
+   bool success = true;
+
+   if (!screen) {
+      winsys->destroy(winsys);
+      return false;
+   }
+
+   struct pipe_context *pipe = screen->context_create(screen, NULL, 0);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(copy_test_cases); i++)
+      success &= test_copy(verbose, fp, pipe, &copy_test_cases[i]);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(fill_test_cases); i++)
+      success &= test_fill(verbose, fp, pipe, &fill_test_cases[i]);
+
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+   winsys->destroy(winsys);
+
+   return success;
+}
+
+
+bool
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+bool
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_all(verbose, fp);
+}
@@ -0,0 +1,413 @@
+/**************************************************************************
+ *
+ * Copyright 2023 Mesa contributors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Sampling from tiled textures: checks the results match linear storage
+ * and compares the throughput of both for rotated and minified footprints.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "util/os_time.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "frontend/sw_winsys.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_jit_types.h"
+#include "gallivm/lp_bld_sample.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_jit_sample.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "lp_jit.h"
+#include "lp_public.h"
+#include "lp_texture.h"
+#include "lp_test.h"
+
+
+#define TEX_SIZE 2048
+#define DST_SIZE 512
+
+
+struct sample_test_case {
+   /* Rotation in degrees and texels per destination pixel */
+   float angle, scale;
+   unsigned filter;
+};
+
+static const struct sample_test_case sample_test_cases[] = {
+   {  0.0f, 1.0f, PIPE_TEX_FILTER_NEAREST },
+   {  0.0f, 1.0f, PIPE_TEX_FILTER_LINEAR },
+   { 30.0f, 1.0f, PIPE_TEX_FILTER_LINEAR },
+   { 90.0f, 1.0f, PIPE_TEX_FILTER_NEAREST },
+   { 90.0f, 1.0f, PIPE_TEX_FILTER_LINEAR },
+   { 90.0f, 4.0f, PIPE_TEX_FILTER_LINEAR },
+   { 45.0f, 4.0f, PIPE_TEX_FILTER_LINEAR },
+};
+
+
+typedef void
+(*sample_ptr_t)(const struct lp_jit_resources *resources,
+                const float *coords, float *texels);
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "Mtexels/s linear\t"
+           "Mtexels/s tiled\t"
+           "test\n");
+
+   fflush(fp);
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = TEX_SIZE;
+   templ.height0 = TEX_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = bind;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+static void
+upload_texture(struct pipe_context *pipe, struct pipe_resource *tex,
+               const uint32_t *data)
+{
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+
+   u_box_2d(0, 0, TEX_SIZE, TEX_SIZE, &box);
+   uint8_t *map = pipe->texture_map(pipe, tex, 0, PIPE_MAP_WRITE, &box,
+                                    &transfer);
+   for (unsigned y = 0; y < TEX_SIZE; y++)
+      memcpy(map + (size_t)y * transfer->stride, data + (size_t)y * TEX_SIZE,
+             TEX_SIZE * 4);
+   pipe->texture_unmap(pipe, transfer);
+}
+
+
+/**
+ * Build a function sampling one vector of texels from texture unit 0,
+ * with the s coordinates followed by the t ones, returning them SoA.
+ */
+static LLVMValueRef
+add_sample_test(struct gallivm_state *gallivm, struct lp_type type,
+                const struct lp_sampler_static_state *state)
+{
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef vec_type = lp_build_vec_type(gallivm, type);
+   LLVMTypeRef resources_type = lp_build_jit_resources_type(gallivm);
+   LLVMTypeRef args[3];
+   LLVMValueRef coords[5], offsets[3] = { 0 }, texel[4];
+
+   args[0] = LLVMPointerType(resources_type, 0);
+   args[2] = args[1] = LLVMPointerType(vec_type, 0);
+
+   LLVMValueRef func =
+      LLVMAddFunction(gallivm->module, "sample",
+                      LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                       args, ARRAY_SIZE(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+
+   LLVMBasicBlockRef block = LLVMAppendBasicBlockInContext(context, func,
+                                                           "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   LLVMValueRef coords_ptr = LLVMGetParam(func, 1);
+   LLVMValueRef texel_ptr = LLVMGetParam(func, 2);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(coords); i++) {
+      if (i < 2) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, i);
+         LLVMValueRef ptr = LLVMBuildGEP2(builder, vec_type, coords_ptr,
+                                          &index, 1, "");
+         coords[i] = LLVMBuildLoad2(builder, vec_type, ptr, "");
+      } else {
+         coords[i] = lp_build_undef(gallivm, type);
+      }
+   }
+
+   struct lp_build_sampler_soa *sampler =
+      lp_bld_llvm_sampler_soa_create(state, 1);
+
+   struct lp_sampler_params params;
+   memset(&params, 0, sizeof(params));
+   params.type = type;
+   params.sample_key = LP_SAMPLER_OP_TEXTURE << LP_SAMPLER_OP_TYPE_SHIFT;
+   params.resources_type = resources_type;
+   params.resources_ptr = LLVMGetParam(func, 0);
+   params.coords = coords;
+   params.offsets = offsets;
+   params.texel = texel;
+
+   sampler->emit_tex_sample(sampler, gallivm, &params);
+
+   lp_bld_llvm_sampler_soa_destroy(sampler);
+
+   for (unsigned i = 0; i < 4; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      LLVMValueRef ptr = LLVMBuildGEP2(builder, vec_type, texel_ptr,
+                                       &index, 1, "");
+      LLVMBuildStore(builder, texel[i], ptr);
+   }
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * Sample the whole destination, returning the time taken for the given
+ * number of iterations.
+ */
+static int64_t
+run_sample(sample_ptr_t sample, const struct lp_jit_resources *resources,
+           const float *coords, float *texels, unsigned length,
+           unsigned iterations)
+{
+   const unsigned num_vectors = DST_SIZE * DST_SIZE / length;
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++) {
+      for (unsigned v = 0; v < num_vectors; v++)
+         sample(resources, coords + v * 2 * length, texels + v * 4 * length);
+   }
+   return os_time_get_nano() - start;
+}
+
+
+static bool
+test_sample(unsigned verbose, FILE *fp, struct pipe_context *pipe,
+            struct pipe_sampler_view *views[2],
+            const struct sample_test_case *test)
+{
+   struct lp_type type;
+   struct pipe_sampler_state sampler;
+   struct lp_jit_resources *resources;
+   float *coords, *texels[2];
+   double mtexels[2];
+   bool success = true;
+   char name[128];
+
+   snprintf(name, sizeof(name), "%s, %.0f degrees, %.0fx",
+            test->filter == PIPE_TEX_FILTER_LINEAR ? "linear" : "nearest",
+            test->angle, test->scale);
+
+   memset(&type, 0, sizeof(type));
+   type.floating = true;
+   type.sign = true;
+   type.width = 32;
+   type.length = MIN2(lp_native_vector_width / 32, 16);
+
+   memset(&sampler, 0, sizeof(sampler));
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = test->filter;
+   sampler.mag_img_filter = test->filter;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+
+   resources = align_malloc(sizeof(*resources), 16);
+   memset(resources, 0, sizeof(*resources));
+   lp_jit_sampler_from_pipe(&resources->samplers[0], &sampler);
+   resources->aniso_filter_table = lp_build_sample_aniso_filter_table();
+
+   /*
+    * Destination pixels are laid out in spans of one vector along x,
+    * each stored as the vector of s followed by the vector of t.
+    */
+   const float c = cosf(test->angle * M_PI / 180.0f) * test->scale / TEX_SIZE;
+   const float s = sinf(test->angle * M_PI / 180.0f) * test->scale / TEX_SIZE;
+   coords = align_malloc(DST_SIZE * DST_SIZE * 2 * sizeof(float), 64);
+   for (unsigned y = 0; y < DST_SIZE; y++) {
+      for (unsigned x = 0; x < DST_SIZE; x++) {
+         const unsigned i = y * DST_SIZE + x;
+         const unsigned v = i / type.length, l = i % type.length;
+         const float u = x + 0.5f, w = y + 0.5f;
+         coords[(v * 2 + 0) * type.length + l] = 0.25f + u * c - w * s;
+         coords[(v * 2 + 1) * type.length + l] = 0.25f + u * s + w * c;
+      }
+   }
+
+   for (unsigned t = 0; t < 2; t++) {
+      struct lp_sampler_static_state state;
+      LLVMContextRef context;
+      struct gallivm_state *gallivm;
+
+      memset(&state, 0, sizeof(state));
+      lp_sampler_static_sampler_state(&state.sampler_state, &sampler);
+      lp_sampler_static_texture_state(&state.texture_state, views[t]);
+      lp_jit_texture_from_pipe(&resources->textures[0], views[t]);
+
+      context = LLVMContextCreate();
+#if LLVM_VERSION_MAJOR == 15
+      LLVMContextSetOpaquePointers(context, false);
+#endif
+      gallivm = gallivm_create("test_module_sample", context, NULL);
+
+      LLVMValueRef func = add_sample_test(gallivm, type, &state);
+
+      gallivm_compile_module(gallivm);
+
+      sample_ptr_t sample = (sample_ptr_t)gallivm_jit_function(gallivm, func);
+
+      gallivm_free_ir(gallivm);
+
+      texels[t] = align_malloc(DST_SIZE * DST_SIZE * 4 * sizeof(float), 64);
+
+      /* One untimed run to warm the caches up. */
+      run_sample(sample, resources, coords, texels[t], type.length, 1);
+
+      const unsigned iterations = 8;
+      int64_t ns = run_sample(sample, resources, coords, texels[t],
+                              type.length, iterations);
+      mtexels[t] = 1e3 * DST_SIZE * DST_SIZE * iterations / ns;
+
+      gallivm_destroy(gallivm);
+      LLVMContextDispose(context);
+   }
+
+   if (memcmp(texels[0], texels[1],
+              DST_SIZE * DST_SIZE * 4 * sizeof(float)) != 0)
+      success = false;
+
+   if (verbose || !success) {
+      printf("%s %-28s %8.1f Mtexels/s linear %8.1f Mtexels/s tiled\n",
+             success ? "pass" : "FAIL", name, mtexels[0], mtexels[1]);
+   }
+   if (fp) {
+      fprintf(fp, "%s\t%f\t%f\t%s\n", success ? "pass" : "fail",
+              mtexels[0], mtexels[1], name);
+      fflush(fp);
+   }
+
+   align_free(texels[0]);
+   align_free(texels[1]);
+   align_free(coords);
+   align_free(resources);
+
+   return success;
+}
+
+
+bool
+test_all(unsigned verbose, FILE *fp)
+{
+   struct sw_winsys *winsys = null_sw_create();
+   struct pipe_screen *screen = llvmpipe_create_screen(winsys);
+   struct pipe_resource *textures[2];
+   struct pipe_sampler_view *views[2];
+   bool success = true;
+
+   if (!screen) {
+      winsys->destroy(winsys);
+      return false;
+   }
+
+   struct pipe_context *pipe = screen->context_create(screen, NULL, 0);
+
+   /* Sampling results must not depend on the layout, so fill both alike. */
+   uint32_t *data = MALLOC(TEX_SIZE * TEX_SIZE * 4);
+   for (unsigned i = 0; i < TEX_SIZE * TEX_SIZE; i++)
+      data[i] = rand();
+
+   textures[0] = create_texture(screen, PIPE_BIND_SAMPLER_VIEW |
+                                        PIPE_BIND_LINEAR);
+   textures[1] = create_texture(screen, PIPE_BIND_SAMPLER_VIEW);
+
+   for (unsigned t = 0; t < 2; t++) {
+      struct pipe_sampler_view templ;
+
+      upload_texture(pipe, textures[t], data);
+      u_sampler_view_default_template(&templ, textures[t],
+                                      textures[t]->format);
+      views[t] = pipe->create_sampler_view(pipe, textures[t], &templ);
+   }
+
+   if (verbose && !llvmpipe_resource_is_tiled(textures[1]))
+      printf("note: texture tiling is disabled, both runs are linear\n");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(sample_test_cases); i++)
+      success &= test_sample(verbose, fp, pipe, views, &sample_test_cases[i]);
+
+   for (unsigned t = 0; t < 2; t++) {
+      pipe_sampler_view_reference(&views[t], NULL);
+      pipe_resource_reference(&textures[t], NULL);
+   }
+   FREE(data);
+
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+   winsys->destroy(winsys);
+
+   return success;
+}
+
+
+bool
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+bool
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_all(verbose, fp);
+}
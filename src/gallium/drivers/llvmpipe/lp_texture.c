@@ -41,9 +41,11 @@
 #include "util/format/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_tiling.h"
 #include "util/u_transfer.h"
 
 #include "lp_context.h"
+#include "lp_debug.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
@@ -66,6 +68,60 @@ static simple_mtx_t resource_list_mutex = SIMPLE_MTX_INITIALIZER;
 static unsigned id_counter = 0;
 
 
+/**
+ * Whether a texture can be stored in 4x4 Morton-ordered tiles, which keeps
+ * the texels of a bilinear footprint, or of a minified or rotated access
+ * pattern, within far fewer cache lines than a linear layout.
+ *
+ * Only the shader sampling and image code knows about tiles, so this is
+ * limited to textures which are never rendered to nor accessed through
+ * the linear paths, and CPU maps go through a linear staging copy.
+ *
+ * It slows down some access patterns, so it is only done when asked for
+ * with LP_PERF=tex_tiling.
+ */
+static bool
+llvmpipe_texture_can_tile(const struct pipe_resource *pt)
+{
+   const enum pipe_format format = pt->format;
+   const unsigned blocksize = util_format_get_blocksize(format);
+
+   if (!(LP_PERF & PERF_TEX_TILING))
+      return false;
+
+   if (pt->bind & ~(PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_SHADER_IMAGE))
+      return false;
+
+   if (pt->flags & (PIPE_RESOURCE_FLAG_MAP_PERSISTENT |
+                    PIPE_RESOURCE_FLAG_MAP_COHERENT))
+      return false;
+
+   if (llvmpipe_resource_is_1d(pt) || pt->nr_samples > 1)
+      return false;
+
+   return util_format_get_blockwidth(format) == 1 &&
+          util_format_get_blockheight(format) == 1 &&
+          util_is_power_of_two_nonzero(blocksize) && blocksize <= 16 &&
+          !util_format_is_depth_or_stencil(format);
+}
+
+
+/**
+ * Describe one level of a tiled texture for util_tiling.
+ */
+static void
+llvmpipe_texture_tiling_layout(const struct llvmpipe_resource *lpr,
+                               unsigned level,
+                               struct util_tiling_layout *layout)
+{
+   layout->mode = UTIL_TILING_MORTON;
+   layout->blocksize_B = util_format_get_blocksize(lpr->base.format);
+   layout->tile_width_el = 4;
+   layout->tile_height_el = 4;
+   layout->tile_row_stride_B = lpr->row_stride[level];
+}
+
+
 /**
  * Conventional allocation path for non-display textures:
  * Compute strides and allocate data (unless asked not to).
@@ -142,6 +198,17 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
 
       lpr->img_stride[level] = (uint64_t)lpr->row_stride[level] * nblocksy;
 
+      if (llvmpipe_resource_is_tiled(pt)) {
+         /* The row stride is the distance between rows of 4x4 tiles,
+          * which the 4x4 alignment above keeps whole.
+          */
+         assert(nblocksx % 4 == 0 && nblocksy % 4 == 0);
+         lpr->row_stride[level] = align(nblocksx * block_size * 4,
+                                        util_get_cpu_caps()->cacheline);
+         lpr->img_stride[level] =
+            (uint64_t)lpr->row_stride[level] * (nblocksy / 4);
+      }
+
       /* Number of 3D image slices, cube faces or texture array layers */
       if (lpr->base.target == PIPE_TEXTURE_CUBE) {
          assert(layers == 6);
@@ -249,6 +316,7 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
    lpr->screen = screen;
    pipe_reference_init(&lpr->base.reference, 1);
    lpr->base.screen = &screen->base;
+   lpr->base.flags &= ~LP_RESOURCE_FLAG_TILED;
 
    /* assert(lpr->base.bind); */
 
@@ -261,6 +329,8 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
             goto fail;
       } else {
          /* texture map */
+         if (llvmpipe_texture_can_tile(&lpr->base))
+            lpr->base.flags |= LP_RESOURCE_FLAG_TILED;
          if (!llvmpipe_texture_layout(screen, lpr, alloc_backing))
             goto fail;
       }
@@ -395,6 +465,7 @@ llvmpipe_resource_from_memobj(struct pipe_screen *pscreen,
    struct llvmpipe_memory_object *lpmo = llvmpipe_memory_object(memobj);
    struct llvmpipe_resource *lpr = CALLOC_STRUCT(llvmpipe_resource);
    lpr->base = *templat;
+   lpr->base.flags &= ~LP_RESOURCE_FLAG_TILED;
 
    lpr->screen = screen;
    pipe_reference_init(&lpr->base.reference, 1);
@@ -588,6 +659,7 @@ llvmpipe_resource_from_handle(struct pipe_screen *_screen,
    }
 
    lpr->base = *template;
+   lpr->base.flags &= ~LP_RESOURCE_FLAG_TILED;
    lpr->screen = screen;
    pipe_reference_init(&lpr->base.reference, 1);
    lpr->base.screen = _screen;
@@ -658,6 +730,7 @@ llvmpipe_resource_from_user_memory(struct pipe_screen *_screen,
    }
 
    lpr->base = *resource;
+   lpr->base.flags &= ~LP_RESOURCE_FLAG_TILED;
    lpr->screen = screen;
    pipe_reference_init(&lpr->base.reference, 1);
    lpr->base.screen = _screen;
@@ -682,6 +755,43 @@ fail:
 }
 
 
+/**
+ * Map a box of a tiled texture through a linear staging copy, which
+ * llvmpipe_transfer_unmap() tiles back if the map is for writing.
+ */
+static void *
+llvmpipe_transfer_map_tiled(struct llvmpipe_transfer *lpt)
+{
+   struct pipe_transfer *pt = &lpt->base;
+   struct llvmpipe_resource *lpr = llvmpipe_resource(pt->resource);
+   const struct pipe_box *box = &pt->box;
+   struct util_tiling_layout layout;
+
+   llvmpipe_texture_tiling_layout(lpr, pt->level, &layout);
+
+   pt->stride = align(box->width * layout.blocksize_B, 16);
+   pt->layer_stride = pt->stride * box->height;
+
+   lpt->staging = align_malloc((size_t)pt->layer_stride * box->depth, 64);
+   if (!lpt->staging)
+      return NULL;
+
+   if (!(pt->usage & (PIPE_MAP_DISCARD_RANGE |
+                      PIPE_MAP_DISCARD_WHOLE_RESOURCE))) {
+      for (int z = 0; z < box->depth; z++) {
+         util_tiling_load(&layout,
+                          (uint8_t *)lpt->staging + z * pt->layer_stride,
+                          pt->stride,
+                          llvmpipe_get_texture_image_address(lpr, box->z + z,
+                                                             pt->level),
+                          box->x, box->y, box->width, box->height);
+      }
+   }
+
+   return lpt->staging;
+}
+
+
 void *
 llvmpipe_transfer_map_ms(struct pipe_context *pipe,
                          struct pipe_resource *resource,
@@ -702,6 +812,9 @@ llvmpipe_transfer_map_ms(struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   if ((usage & PIPE_MAP_DIRECTLY) && llvmpipe_resource_is_tiled(resource))
+      return NULL;
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush
     * the context if necessary.
@@ -774,6 +887,20 @@ llvmpipe_transfer_map_ms(struct pipe_context *pipe,
 
    format = lpr->base.format;
 
+   if (llvmpipe_resource_is_tiled(resource)) {
+      assert(sample == 0);
+      if (usage & PIPE_MAP_WRITE)
+         screen->timestamp++;
+
+      map = llvmpipe_transfer_map_tiled(lpt);
+      if (!map) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         *transfer = NULL;
+      }
+      return map;
+   }
+
    map = llvmpipe_resource_map(resource, level, box->z, tex_usage);
 
 
@@ -812,6 +939,8 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
    llvmpipe_resource_unmap(transfer->resource,
@@ -819,9 +948,32 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
                            transfer->box.z);
 
    /* Effectively do the texture_update work here - if texture images
-    * needed post-processing to put them into hardware layout, this is
-    * where it would happen.  For llvmpipe, nothing to do.
+    * need post-processing to put them into hardware layout, this is
+    * where it happens.  Only tiled textures need any.
     */
+   if (lpt->staging) {
+      if (transfer->usage & PIPE_MAP_WRITE) {
+         struct llvmpipe_resource *lpr =
+            llvmpipe_resource(transfer->resource);
+         const struct pipe_box *box = &transfer->box;
+         struct util_tiling_layout layout;
+
+         llvmpipe_texture_tiling_layout(lpr, transfer->level, &layout);
+
+         for (int z = 0; z < box->depth; z++) {
+            util_tiling_store(&layout,
+                              llvmpipe_get_texture_image_address(lpr,
+                                                                 box->z + z,
+                                                                 transfer->level),
+                              (uint8_t *)lpt->staging +
+                              z * transfer->layer_stride,
+                              transfer->stride,
+                              box->x, box->y, box->width, box->height);
+         }
+      }
+      align_free(lpt->staging);
+   }
+
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
    FREE(transfer);
@@ -31,6 +31,7 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "gallivm/lp_bld_sample.h"
 #include "lp_limits.h"
 #ifdef DEBUG
 #include "util/list.h"
@@ -112,6 +113,9 @@ struct llvmpipe_resource
 struct llvmpipe_transfer
 {
    struct pipe_transfer base;
+
+   /** Linear copy of the mapped box of a tiled texture */
+   void *staging;
 };
 
 
@@ -178,6 +182,17 @@ llvmpipe_resource_is_texture(const struct pipe_resource *resource)
 }
 
 
+/**
+ * Is the texture stored in 4x4 Morton-ordered tiles (see
+ * LP_RESOURCE_FLAG_TILED) rather than linearly?
+ */
+static inline bool
+llvmpipe_resource_is_tiled(const struct pipe_resource *resource)
+{
+   return (resource->flags & LP_RESOURCE_FLAG_TILED) != 0;
+}
+
+
 static inline bool
 llvmpipe_resource_is_1d(const struct pipe_resource *resource)
 {
@@ -925,6 +925,102 @@ panfrost_store_tiled_images(struct panfrost_transfer *transfer,
    }
 }
 
+/* Largest AFBC transfer, in pixels, worth doing on the CPU rather than with a
+ * GPU blit to/from a staging resource.
+ */
+#define PAN_AFBC_CPU_MAX_PIXELS (128 * 128)
+
+static void *
+panfrost_afbc_headers(struct panfrost_resource *rsrc, unsigned level,
+                      unsigned z)
+{
+   return rsrc->image.data.bo->ptr.cpu +
+          rsrc->image.layout.slices[level].offset +
+          z * panfrost_get_layer_stride(&rsrc->image.layout, level);
+}
+
+/*
+ * Try to map a small region of an AFBC resource through the CPU codec. This
+ * only works for superblocks without actual compression, i.e. superblocks
+ * written by the CPU and untouched ones, so this fails for most resources
+ * rendered to, in which case the caller falls back to a staging blit.
+ */
+static bool
+panfrost_map_afbc_cpu(struct panfrost_context *ctx,
+                      struct panfrost_transfer *transfer,
+                      struct panfrost_resource *rsrc)
+{
+   struct panfrost_device *dev = pan_device(ctx->base.screen);
+   struct pipe_transfer *ptrans = &transfer->base;
+   const struct pipe_box *box = &ptrans->box;
+   struct panfrost_bo *bo = rsrc->image.data.bo;
+   unsigned level = ptrans->level;
+
+   if (!(dev->debug & PAN_DBG_CPU_AFBC) ||
+       !pan_afbc_can_cpu_access(&rsrc->image.layout))
+      return false;
+
+   if ((ptrans->usage & PIPE_MAP_UNSYNCHRONIZED) ||
+       box->width * box->height * box->depth > PAN_AFBC_CPU_MAX_PIXELS)
+      return false;
+
+   if (ptrans->usage & PIPE_MAP_WRITE) {
+      panfrost_flush_batches_accessing_rsrc(ctx, rsrc, "AFBC CPU write");
+      panfrost_bo_wait(bo, INT64_MAX, true);
+   } else {
+      panfrost_flush_writer(ctx, rsrc, "AFBC CPU read");
+      panfrost_bo_wait(bo, INT64_MAX, false);
+   }
+
+   panfrost_bo_mmap(bo);
+
+   unsigned stride =
+      box->width * util_format_get_blocksize(rsrc->image.layout.format);
+   unsigned layer_stride = stride * box->height;
+   void *map = ralloc_size(transfer, layer_stride * box->depth);
+   bool valid = BITSET_TEST(rsrc->valid.data, level);
+
+   for (unsigned z = 0; z < box->depth; ++z) {
+      void *headers = panfrost_afbc_headers(rsrc, level, box->z + z);
+
+      if ((ptrans->usage & PIPE_MAP_READ) && valid &&
+          !pan_afbc_decode(&rsrc->image.layout, level, headers,
+                           map + z * layer_stride, stride, box->x, box->y,
+                           box->width, box->height))
+         goto fail;
+
+      if ((ptrans->usage & PIPE_MAP_WRITE) &&
+          !pan_afbc_can_cpu_update(&rsrc->image.layout, level, headers,
+                                   box->x, box->y, box->width, box->height))
+         goto fail;
+   }
+
+   ptrans->stride = stride;
+   ptrans->layer_stride = layer_stride;
+   transfer->map = map;
+   return true;
+
+fail:
+   ralloc_free(map);
+   return false;
+}
+
+static void
+panfrost_store_afbc_images(struct panfrost_transfer *transfer,
+                           struct panfrost_resource *rsrc)
+{
+   struct pipe_transfer *ptrans = &transfer->base;
+
+   for (unsigned z = 0; z < ptrans->box.depth; ++z) {
+      pan_afbc_encode(&rsrc->image.layout, ptrans->level,
+                      panfrost_afbc_headers(rsrc, ptrans->level,
+                                            ptrans->box.z + z),
+                      transfer->map + z * ptrans->layer_stride, ptrans->stride,
+                      ptrans->box.x, ptrans->box.y, ptrans->box.width,
+                      ptrans->box.height);
+   }
+}
+
 static bool
 panfrost_box_covers_resource(const struct pipe_resource *resource,
                              const struct pipe_box *box)
@@ -964,8 +1060,12 @@ panfrost_ptr_map(struct pipe_context *pctx, struct pipe_resource *resource,
    if (usage & PIPE_MAP_WRITE)
       rsrc->constant_stencil = false;
 
-   /* We don't have s/w routines for AFBC, so use a staging texture */
+   /* Small transfers may be done with the CPU codec, otherwise use a staging
+    * texture */
    if (drm_is_afbc(rsrc->image.layout.modifier)) {
+      if (panfrost_map_afbc_cpu(ctx, transfer, rsrc))
+         return transfer->map;
+
       struct panfrost_resource *staging =
          pan_alloc_staging(ctx, rsrc, level, box);
       assert(staging);
@@ -1332,6 +1432,8 @@ panfrost_ptr_unmap(struct pipe_context *pctx, struct pipe_transfer *transfer)
             } else {
                panfrost_store_tiled_images(trans, prsrc);
             }
+         } else if (drm_is_afbc(prsrc->image.layout.modifier)) {
+            panfrost_store_afbc_images(trans, prsrc);
          }
       }
    }
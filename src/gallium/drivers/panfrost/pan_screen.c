@@ -65,6 +65,7 @@ static const struct debug_named_value panfrost_debug_options[] = {
    {"noafbc",     PAN_DBG_NO_AFBC,  "Disable AFBC support"},
    {"crc",        PAN_DBG_CRC,      "Enable transaction elimination"},
    {"msaa16",     PAN_DBG_MSAA16,   "Enable MSAA 8x and 16x support"},
+   {"cpuafbc",    PAN_DBG_CPU_AFBC, "Use the CPU for small transfers of uncompressed AFBC data"},
    {"linear",     PAN_DBG_LINEAR,   "Force linear textures"},
    {"nocache",    PAN_DBG_NO_CACHE, "Disable BO cache"},
    {"dump",       PAN_DBG_DUMP,     "Dump all graphics memory"},
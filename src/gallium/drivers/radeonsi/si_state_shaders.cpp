@@ -14,7 +14,7 @@
 #include "util/crc32.h"
 #include "util/disk_cache.h"
 #include "util/hash_table.h"
-#include "util/mesa-sha1.h"
+#include "util/mesa-cache-key.h"
 #include "util/u_async_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -177,11 +177,11 @@ void si_get_ir_cache_key(struct si_shader_selector *sel, bool ngg, bool es,
    if (sel->screen->options.inline_uniforms)
       shader_variant_flags |= 1 << 11;
 
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
-   _mesa_sha1_update(&ctx, &shader_variant_flags, 4);
-   _mesa_sha1_update(&ctx, ir_binary, ir_size);
-   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
+   _mesa_cache_key_update(&ctx, &shader_variant_flags, 4);
+   _mesa_cache_key_update(&ctx, ir_binary, ir_size);
+   _mesa_cache_key_final(&ctx, ir_sha1_cache_key);
 
    if (ir_binary == blob.data)
       blob_finish(&blob);
@@ -447,14 +447,14 @@ bool si_shader_cache_load_shader(struct si_screen *sscreen, unsigned char ir_sha
 
 static uint32_t si_shader_cache_key_hash(const void *key)
 {
-   /* Take the first dword of SHA1. */
+   /* Take the first dword of the key. */
    return *(uint32_t *)key;
 }
 
 static bool si_shader_cache_key_equals(const void *a, const void *b)
 {
-   /* Compare SHA1s. */
-   return memcmp(a, b, 20) == 0;
+   /* Compare the keys. */
+   return memcmp(a, b, MESA_CACHE_KEY_SIZE) == 0;
 }
 
 static void si_destroy_shader_cache_entry(struct hash_entry *entry)
@@ -39,6 +39,7 @@
 #include "sp_context.h"
 #include "sp_screen.h"
 #include "sp_query.h"
+#include "sp_rast.h"
 #include "sp_tile_cache.h"
 
 
@@ -68,6 +69,10 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
    softpipe_update_derived(softpipe, MESA_PRIM_TRIANGLES); /* not needed?? */
 #endif
 
+   /* The clear goes through the context's caches */
+   if (softpipe->rast)
+      sp_rast_flush(softpipe->rast, false);
+
    if (buffers & PIPE_CLEAR_COLOR) {
       for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
          if (buffers & (PIPE_CLEAR_COLOR0 << i))
@@ -46,6 +46,7 @@ struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
 struct softpipe_tex_tile_cache;
+struct sp_rast;
 struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
@@ -146,12 +147,10 @@ struct softpipe_context {
    bool render_cond_cond;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct quad_pipeline quad;
+
+   /** Tile rasterization threads, NULL if rasterizing on this thread only */
+   struct sp_rast *rast;
 
    /** TGSI exec things */
    struct {
@@ -39,6 +39,7 @@
 
 #include "sp_context.h"
 #include "sp_query.h"
+#include "sp_rast.h"
 #include "sp_state.h"
 #include "sp_texture.h"
 #include "sp_screen.h"
@@ -140,6 +141,9 @@ softpipe_draw_vbo(struct pipe_context *pipe,
    draw_collect_pipeline_statistics(draw,
                                     sp->active_statistics_queries > 0);
 
+   if (sp->rast)
+      sp_rast_begin(sp->rast);
+
    /* draw! */
    draw_vbo(draw, info, drawid_offset, indirect, draws, num_draws, 0);
 
@@ -163,6 +167,9 @@ softpipe_draw_vbo(struct pipe_context *pipe,
     */
    draw_flush(draw);
 
+   if (sp->rast)
+      sp_rast_end(sp->rast);
+
    /* Note: leave drawing surfaces mapped */
    sp->dirty_render_cache = true;
 }
@@ -29,13 +29,88 @@
 #include "sp_context.h"
 #include "sp_state.h"
 #include "pipe/p_shader_tokens.h"
+#include "util/u_memory.h"
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct quad_pipeline *pipe, struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = pipe->first;
+   pipe->first = quad;
+}
+
+
+static void
+init_stage(struct quad_stage *stage,
+           struct tgsi_exec_machine *fs_machine,
+           struct softpipe_tile_cache **cbuf_cache,
+           struct softpipe_tile_cache *zsbuf_cache)
+{
+   stage->fs_machine = fs_machine;
+   stage->cbuf_cache = cbuf_cache;
+   stage->zsbuf_cache = zsbuf_cache;
+}
+
+
+/**
+ * Create the quad stages of a pipeline which shades with the given
+ * interpreter and writes through the given render caches.
+ */
+bool
+sp_init_quad_pipeline(struct softpipe_context *sp,
+                      struct quad_pipeline *quad,
+                      struct tgsi_exec_machine *fs_machine,
+                      struct softpipe_tile_cache **cbuf_cache,
+                      struct softpipe_tile_cache *zsbuf_cache)
+{
+   quad->shade = sp_quad_shade_stage(sp);
+   quad->depth_test = sp_quad_depth_test_stage(sp);
+   quad->blend = sp_quad_blend_stage(sp);
+   quad->first = NULL;
+
+   if (!quad->shade || !quad->depth_test || !quad->blend)
+      return false;
+
+   init_stage(quad->shade, fs_machine, cbuf_cache, zsbuf_cache);
+   init_stage(quad->depth_test, fs_machine, cbuf_cache, zsbuf_cache);
+   init_stage(quad->blend, fs_machine, cbuf_cache, zsbuf_cache);
+
+   return true;
+}
+
+
+void
+sp_destroy_quad_pipeline(struct quad_pipeline *quad)
+{
+   if (quad->shade)
+      quad->shade->destroy( quad->shade );
+
+   if (quad->depth_test)
+      quad->depth_test->destroy( quad->depth_test );
+
+   if (quad->blend)
+      quad->blend->destroy( quad->blend );
+
+   memset(quad, 0, sizeof(*quad));
+}
+
+
+/**
+ * Order the stages of a pipeline according to sp->early_depth.
+ */
+void
+sp_link_quad_pipeline(struct softpipe_context *sp, struct quad_pipeline *quad)
+{
+   quad->first = quad->blend;
+
+   if (sp->early_depth) {
+      insert_stage_at_head( quad, quad->shade );
+      insert_stage_at_head( quad, quad->depth_test );
+   }
+   else {
+      insert_stage_at_head( quad, quad->depth_test );
+      insert_stage_at_head( quad, quad->shade );
+   }
 }
 
 
@@ -51,16 +126,6 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
-
    sp->early_depth = early_depth_test;
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
+   sp_link_quad_pipeline(sp, &sp->quad);
 }
-
@@ -34,6 +34,8 @@
 
 struct softpipe_context;
 struct quad_header;
+struct softpipe_tile_cache;
+struct tgsi_exec_machine;
 
 
 /**
@@ -44,6 +46,11 @@ struct quad_header;
 struct quad_stage {
    struct softpipe_context *softpipe;
 
+   /** Per-pipeline interpreter and render caches, see sp_init_quad_pipeline */
+   struct tgsi_exec_machine *fs_machine;
+   struct softpipe_tile_cache **cbuf_cache;
+   struct softpipe_tile_cache *zsbuf_cache;
+
    struct quad_stage *next;
 
    void (*begin)(struct quad_stage *qs);
@@ -66,6 +73,26 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
+
+/**
+ * The set of quad stages making up one pipeline.  The context owns one,
+ * and each tile rasterization thread (sp_rast.c) owns another.
+ */
+struct quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *first; /**< points to one of the above stages */
+};
+
+bool sp_init_quad_pipeline(struct softpipe_context *sp,
+                           struct quad_pipeline *quad,
+                           struct tgsi_exec_machine *fs_machine,
+                           struct softpipe_tile_cache **cbuf_cache,
+                           struct softpipe_tile_cache *zsbuf_cache);
+void sp_destroy_quad_pipeline(struct quad_pipeline *quad);
+void sp_link_quad_pipeline(struct softpipe_context *sp,
+                           struct quad_pipeline *quad);
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
 #endif /* SP_QUAD_PIPE_H */
@@ -0,0 +1,669 @@
+/**************************************************************************
+ *
+ * Copyright 2023 Mesa contributors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization, see sp_rast.h.
+ *
+ * Binning is only enabled for draws whose fragment processing is purely a
+ * function of the pixel position and the render caches: triangles filled
+ * on both faces, no polygon stipple, no geometry shader, no active
+ * queries and no fragment shader side effects.  Any other draw first
+ * writes the thread caches back and then goes through the context's own
+ * setup/quad pipeline as before.
+ *
+ * The context's render caches are flushed when binning starts and the
+ * thread caches when it stops being possible (sp_rast_flush), so at any
+ * time only one set of caches holds tiles of the bound surfaces.
+ */
+
+#include "pipe/p_defines.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+
+#include "sp_context.h"
+#include "sp_fs.h"
+#include "sp_quad_pipe.h"
+#include "sp_rast.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_tile_cache.h"
+
+
+/** Rasterize the pending bins once this many bytes of vertices are binned */
+#define SP_RAST_MAX_VERTEX_BYTES (16 * 1024 * 1024)
+
+
+struct sp_rast_thread {
+   struct sp_rast *rast;
+   unsigned index;
+
+   struct setup_context *setup;
+   struct quad_pipeline quad;
+   struct pipe_scissor_state tile;
+
+   struct tgsi_exec_machine *fs_machine;
+   /** The variant currently bound to fs_machine */
+   const struct sp_fragment_shader_variant *fs_variant;
+
+   /** Copy of the context's fragment sampler using this thread's caches */
+   struct sp_tgsi_sampler *sampler;
+   unsigned num_sampler_views;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+   /** Whether the render caches may hold tiles */
+   bool dirty;
+
+   struct util_queue_fence fence;
+};
+
+
+struct sp_rast {
+   struct softpipe_context *softpipe;
+
+   unsigned num_threads;
+   struct sp_rast_thread *threads[SP_MAX_THREADS];
+   /** Runs threads[1..num_threads-1], threads[0] runs on the caller */
+   struct util_queue queue;
+
+   /** Whether triangles of the current draw are binned */
+   bool binning;
+
+   /** Binned triangles, three vertices of vertex_stride bytes each */
+   struct util_dynarray verts;
+   unsigned vertex_stride;
+   unsigned num_prims;
+
+   /** Per screen tile list of triangle indices, row major */
+   struct util_dynarray *bins;
+   unsigned tiles_x, tiles_y;
+};
+
+
+static bool
+rast_draw_is_binnable(const struct softpipe_context *sp)
+{
+   const struct pipe_rasterizer_state *rast = sp->rasterizer;
+
+   return sp->reduced_api_prim == MESA_PRIM_TRIANGLES &&
+          !(sp->gs && sp->gs->shader.tokens) &&
+          rast->fill_front == PIPE_POLYGON_MODE_FILL &&
+          rast->fill_back == PIPE_POLYGON_MODE_FILL &&
+          !rast->poly_stipple_enable &&
+          !rast->rasterizer_discard &&
+          !sp->active_query_count &&
+          !sp->active_statistics_queries &&
+          sp->fs_variant &&
+          !sp->fs_variant->info.writes_memory;
+}
+
+
+/**
+ * (Re)allocate the bins for the current framebuffer size.
+ */
+static bool
+rast_update_bins(struct sp_rast *rast)
+{
+   const struct softpipe_context *sp = rast->softpipe;
+   const unsigned tiles_x = DIV_ROUND_UP(sp->framebuffer.width, TILE_SIZE);
+   const unsigned tiles_y = DIV_ROUND_UP(sp->framebuffer.height, TILE_SIZE);
+   unsigned i;
+
+   if (tiles_x == rast->tiles_x && tiles_y == rast->tiles_y)
+      return true;
+
+   for (i = 0; i < rast->tiles_x * rast->tiles_y; i++)
+      util_dynarray_fini(&rast->bins[i]);
+   FREE(rast->bins);
+   rast->tiles_x = rast->tiles_y = 0;
+
+   rast->bins = CALLOC(tiles_x * tiles_y, sizeof(*rast->bins));
+   if (!rast->bins)
+      return false;
+
+   for (i = 0; i < tiles_x * tiles_y; i++)
+      util_dynarray_init(&rast->bins[i], NULL);
+
+   rast->tiles_x = tiles_x;
+   rast->tiles_y = tiles_y;
+   return true;
+}
+
+
+/**
+ * Point a thread's caches, interpreter and quad pipeline at the current
+ * state.  Called on the context's thread before the tiles are dispatched.
+ */
+static void
+rast_prepare_thread(struct sp_rast *rast, struct sp_rast_thread *thread)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   struct sp_tgsi_sampler *sampler = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   const unsigned num_views = sp->num_sampler_views[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      sp_tile_cache_set_surface(thread->cbuf_cache[i],
+                                i < sp->framebuffer.nr_cbufs ?
+                                sp->framebuffer.cbufs[i] : NULL);
+   }
+   sp_tile_cache_set_surface(thread->zsbuf_cache, sp->framebuffer.zsbuf);
+
+   memcpy(thread->sampler->sp_sampler, sampler->sp_sampler,
+          sizeof(sampler->sp_sampler));
+
+   for (i = 0; i < MAX2(num_views, thread->num_sampler_views); i++) {
+      struct pipe_sampler_view *view = i < num_views ?
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i] : NULL;
+      struct softpipe_tex_tile_cache *tc = thread->tex_cache[i];
+
+      thread->sampler->sp_sview[i] = sampler->sp_sview[i];
+      thread->sampler->sp_sview[i].cache = tc;
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+   }
+   thread->num_sampler_views = num_views;
+
+   if (thread->fs_variant != sp->fs_variant) {
+      sp->fs_variant->prepare(sp->fs_variant,
+                              thread->fs_machine,
+                              (struct tgsi_sampler *)thread->sampler,
+                              (struct tgsi_image *)sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                              (struct tgsi_buffer *)sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+      thread->fs_variant = sp->fs_variant;
+   }
+
+   sp_link_quad_pipeline(sp, &thread->quad);
+   sp_setup_prepare(thread->setup);
+
+   thread->dirty = true;
+}
+
+
+/**
+ * Rasterize the binned triangles of the tiles owned by a thread, in
+ * submission order within each tile.
+ */
+static void
+rast_execute(void *data, void *gdata, int thread_index)
+{
+   struct sp_rast_thread *thread = data;
+   const struct sp_rast *rast = thread->rast;
+   const unsigned stride = rast->vertex_stride;
+   unsigned tx, ty;
+
+   for (ty = 0; ty < rast->tiles_y; ty++) {
+      for (tx = 0; tx < rast->tiles_x; tx++) {
+         const struct util_dynarray *bin = &rast->bins[ty * rast->tiles_x + tx];
+
+         if ((tx + ty) % rast->num_threads != thread->index || !bin->size)
+            continue;
+
+         thread->tile.minx = tx * TILE_SIZE;
+         thread->tile.miny = ty * TILE_SIZE;
+         thread->tile.maxx = thread->tile.minx + TILE_SIZE;
+         thread->tile.maxy = thread->tile.miny + TILE_SIZE;
+
+         util_dynarray_foreach(bin, uint32_t, prim) {
+            const char *v = (const char *)rast->verts.data +
+                            (size_t)*prim * 3 * stride;
+
+            sp_setup_tri(thread->setup,
+                         (const float (*)[4])v,
+                         (const float (*)[4])(v + stride),
+                         (const float (*)[4])(v + 2 * stride));
+         }
+      }
+   }
+}
+
+
+/**
+ * Rasterize and empty the bins.
+ */
+static void
+rast_run(struct sp_rast *rast)
+{
+   unsigned i;
+
+   if (!rast->num_prims)
+      return;
+
+   for (i = 0; i < rast->num_threads; i++)
+      rast_prepare_thread(rast, rast->threads[i]);
+
+   for (i = 1; i < rast->num_threads; i++) {
+      util_queue_add_job(&rast->queue, rast->threads[i],
+                         &rast->threads[i]->fence, rast_execute, NULL, 0);
+   }
+
+   rast_execute(rast->threads[0], NULL, 0);
+
+   for (i = 1; i < rast->num_threads; i++)
+      util_queue_fence_wait(&rast->threads[i]->fence);
+
+   for (i = 0; i < rast->tiles_x * rast->tiles_y; i++)
+      util_dynarray_clear(&rast->bins[i]);
+   util_dynarray_clear(&rast->verts);
+   rast->num_prims = 0;
+}
+
+
+/**
+ * Take back a triangle that only made it into some of its bins.  It is the
+ * last one binned, so it can only be at the end of each bin.
+ */
+static void
+rast_unbin_tri(struct sp_rast *rast, uint32_t prim,
+               unsigned tx0, unsigned ty0, unsigned tx1, unsigned ty1)
+{
+   unsigned tx, ty;
+
+   for (ty = ty0; ty <= ty1; ty++) {
+      for (tx = tx0; tx <= tx1; tx++) {
+         struct util_dynarray *bin = &rast->bins[ty * rast->tiles_x + tx];
+
+         if (util_dynarray_contains(bin, uint32_t) &&
+             util_dynarray_top(bin, uint32_t) == prim)
+            (void)util_dynarray_pop(bin, uint32_t);
+      }
+   }
+
+   rast->verts.size -= 3 * rast->vertex_stride;
+   rast->num_prims--;
+}
+
+
+/**
+ * Bin a triangle, called by the context's setup code in place of
+ * rasterizing it.
+ * \\return false if the triangle should be rasterized by the caller
+ */
+bool
+sp_rast_bin_tri(struct sp_rast *rast,
+                const float (*v0)[4],
+                const float (*v1)[4],
+                const float (*v2)[4])
+{
+   const struct softpipe_context *sp = rast->softpipe;
+   const unsigned stride = sp->vertex_info.size * sizeof(float);
+   const struct pipe_scissor_state *cliprect;
+   unsigned viewport_index = 0;
+   float minx, miny, maxx, maxy;
+   unsigned tx0, ty0, tx1, ty1, tx, ty;
+   uint32_t prim;
+   char *v;
+
+   if (!rast->binning)
+      return false;
+
+   if (rast->num_prims &&
+       (stride != rast->vertex_stride ||
+        rast->verts.size >= SP_RAST_MAX_VERTEX_BYTES))
+      rast_run(rast);
+   rast->vertex_stride = stride;
+
+   if (sp->viewport_index_slot > 0) {
+      unsigned *udata = (unsigned*)v0[sp->viewport_index_slot];
+      viewport_index = sp_clamp_viewport_idx(*udata);
+   }
+   cliprect = &sp->cliprect[viewport_index];
+
+   /* Conservative bounds: one extra pixel covers the pixel center offset
+    * and the truncation done when walking the edges.
+    */
+   minx = MIN3(v0[0][0], v1[0][0], v2[0][0]) - 1.0f;
+   miny = MIN3(v0[0][1], v1[0][1], v2[0][1]) - 1.0f;
+   maxx = MAX3(v0[0][0], v1[0][0], v2[0][0]) + 1.0f;
+   maxy = MAX3(v0[0][1], v1[0][1], v2[0][1]) + 1.0f;
+
+   minx = MAX2(minx, (float)cliprect->minx);
+   miny = MAX2(miny, (float)cliprect->miny);
+   maxx = MIN2(maxx, (float)cliprect->maxx);
+   maxy = MIN2(maxy, (float)cliprect->maxy);
+
+   if (!(minx < maxx && miny < maxy))
+      return true;
+
+   tx0 = (unsigned)minx / TILE_SIZE;
+   ty0 = (unsigned)miny / TILE_SIZE;
+   tx1 = MIN2((unsigned)ceilf(maxx) - 1, sp->framebuffer.width - 1) / TILE_SIZE;
+   ty1 = MIN2((unsigned)ceilf(maxy) - 1, sp->framebuffer.height - 1) / TILE_SIZE;
+
+   /* Out of memory: rasterize what we have, and draw the rest of the draw
+    * unbinned.  The caller draws into the context's caches, so the threads'
+    * caches have to be written back first.
+    */
+   v = util_dynarray_grow_bytes(&rast->verts, 3, stride);
+   if (!v) {
+      sp_rast_finish(rast);
+      return false;
+   }
+
+   memcpy(v, v0, stride);
+   memcpy(v + stride, v1, stride);
+   memcpy(v + 2 * stride, v2, stride);
+
+   prim = rast->num_prims++;
+
+   for (ty = ty0; ty <= ty1; ty++) {
+      for (tx = tx0; tx <= tx1; tx++) {
+         uint32_t *slot =
+            util_dynarray_grow(&rast->bins[ty * rast->tiles_x + tx],
+                               uint32_t, 1);
+         if (!slot) {
+            rast_unbin_tri(rast, prim, tx0, ty0, tx1, ty1);
+            sp_rast_finish(rast);
+            return false;
+         }
+         *slot = prim;
+      }
+   }
+
+   return true;
+}
+
+
+/**
+ * Called before a draw is handed to the draw module.  Start binning if
+ * the draw's state allows it, otherwise make the thread caches' contents
+ * visible to the context's caches.
+ */
+void
+sp_rast_begin(struct sp_rast *rast)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   unsigned i;
+
+   if (!rast_draw_is_binnable(sp) || !rast_update_bins(rast)) {
+      sp_rast_flush(rast, false);
+      return;
+   }
+
+   for (i = 0; i < sp->framebuffer.nr_cbufs; i++)
+      if (sp->cbuf_cache[i])
+         sp_flush_tile_cache(sp->cbuf_cache[i]);
+
+   if (sp->zsbuf_cache)
+      sp_flush_tile_cache(sp->zsbuf_cache);
+
+   rast->binning = true;
+}
+
+
+/**
+ * Called once the draw module has been flushed: rasterize the bins.
+ */
+void
+sp_rast_end(struct sp_rast *rast)
+{
+   if (!rast->binning)
+      return;
+
+   rast_run(rast);
+   rast->binning = false;
+}
+
+
+/**
+ * Rasterize the bins and stop binning for the rest of the draw, so that
+ * the caller can render into the context's caches directly.
+ */
+void
+sp_rast_finish(struct sp_rast *rast)
+{
+   if (!rast->binning)
+      return;
+
+   sp_rast_end(rast);
+   sp_rast_flush(rast, false);
+}
+
+
+/**
+ * Write the threads' render caches back to the surfaces, and drop the
+ * texture cache contents too if \\p textures is set.
+ */
+void
+sp_rast_flush(struct sp_rast *rast, bool textures)
+{
+   unsigned i, j;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      if (thread->dirty) {
+         for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+            sp_flush_tile_cache(thread->cbuf_cache[j]);
+         sp_flush_tile_cache(thread->zsbuf_cache);
+         thread->dirty = false;
+      }
+
+      if (textures) {
+         for (j = 0; j < ARRAY_SIZE(thread->tex_cache); j++) {
+            if (thread->tex_cache[j])
+               sp_flush_tex_tile_cache(thread->tex_cache[j]);
+         }
+      }
+   }
+}
+
+
+/**
+ * Flush and unmap the bound surfaces, called when the framebuffer changes
+ * (the caches don't hold surface references).
+ */
+void
+sp_rast_release_surfaces(struct sp_rast *rast)
+{
+   unsigned i, j;
+
+   sp_rast_flush(rast, false);
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         sp_tile_cache_set_surface(thread->cbuf_cache[j], NULL);
+      sp_tile_cache_set_surface(thread->zsbuf_cache, NULL);
+   }
+}
+
+
+/**
+ * Called before a fragment shader variant is deleted.
+ */
+void
+sp_rast_unbind_fs_variant(struct sp_rast *rast,
+                          struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_rast_thread *thread = rast->threads[i];
+
+      if (thread->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(thread->fs_machine, NULL, NULL, NULL, NULL);
+         thread->fs_variant = NULL;
+      }
+   }
+}
+
+
+static void
+rast_destroy_thread(struct sp_rast_thread *thread)
+{
+   unsigned i;
+
+   if (thread->setup)
+      sp_setup_destroy_context(thread->setup);
+
+   sp_destroy_quad_pipeline(&thread->quad);
+
+   if (thread->fs_machine)
+      tgsi_exec_machine_destroy(thread->fs_machine);
+
+   for (i = 0; i < ARRAY_SIZE(thread->tex_cache); i++) {
+      if (thread->tex_cache[i])
+         sp_destroy_tex_tile_cache(thread->tex_cache[i]);
+   }
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      if (thread->cbuf_cache[i])
+         sp_destroy_tile_cache(thread->cbuf_cache[i]);
+   }
+
+   if (thread->zsbuf_cache)
+      sp_destroy_tile_cache(thread->zsbuf_cache);
+
+   FREE(thread->sampler);
+   FREE(thread);
+}
+
+
+static struct sp_rast_thread *
+rast_create_thread(struct sp_rast *rast, unsigned index)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   struct sp_rast_thread *thread = CALLOC_STRUCT(sp_rast_thread);
+   unsigned i;
+
+   if (!thread)
+      return NULL;
+
+   thread->rast = rast;
+   thread->index = index;
+   util_queue_fence_init(&thread->fence);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      thread->cbuf_cache[i] = sp_create_tile_cache(&sp->pipe);
+      if (!thread->cbuf_cache[i])
+         goto fail;
+   }
+
+   thread->zsbuf_cache = sp_create_tile_cache(&sp->pipe);
+   if (!thread->zsbuf_cache)
+      goto fail;
+
+   for (i = 0; i < ARRAY_SIZE(thread->tex_cache); i++) {
+      thread->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+      if (!thread->tex_cache[i])
+         goto fail;
+   }
+
+   thread->sampler = sp_create_tgsi_sampler();
+   if (!thread->sampler)
+      goto fail;
+
+   thread->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   if (!thread->fs_machine)
+      goto fail;
+
+   if (!sp_init_quad_pipeline(sp, &thread->quad, thread->fs_machine,
+                              thread->cbuf_cache, thread->zsbuf_cache))
+      goto fail;
+
+   thread->setup = sp_setup_create_context(sp, &thread->quad);
+   if (!thread->setup)
+      goto fail;
+
+   sp_setup_set_tile(thread->setup, &thread->tile);
+
+   return thread;
+
+fail:
+   rast_destroy_thread(thread);
+   return NULL;
+}
+
+
+struct sp_rast *
+sp_rast_create(struct softpipe_context *sp, unsigned num_threads)
+{
+   struct sp_rast *rast;
+   unsigned i;
+
+   assert(num_threads > 1 && num_threads <= SP_MAX_THREADS);
+
+   rast = CALLOC_STRUCT(sp_rast);
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = sp;
+   util_dynarray_init(&rast->verts, NULL);
+
+   for (i = 0; i < num_threads; i++) {
+      rast->threads[i] = rast_create_thread(rast, i);
+      if (!rast->threads[i])
+         goto fail;
+      rast->num_threads++;
+   }
+
+   if (!util_queue_init(&rast->queue, "sprast", num_threads - 1,
+                        num_threads - 1, 0, NULL))
+      goto fail;
+
+   return rast;
+
+fail:
+   for (i = 0; i < rast->num_threads; i++)
+      rast_destroy_thread(rast->threads[i]);
+   util_dynarray_fini(&rast->verts);
+   FREE(rast);
+   return NULL;
+}
+
+
+void
+sp_rast_destroy(struct sp_rast *rast)
+{
+   unsigned i;
+
+   util_queue_destroy(&rast->queue);
+
+   for (i = 0; i < rast->num_threads; i++)
+      rast_destroy_thread(rast->threads[i]);
+
+   for (i = 0; i < rast->tiles_x * rast->tiles_y; i++)
+      util_dynarray_fini(&rast->bins[i]);
+   FREE(rast->bins);
+   util_dynarray_fini(&rast->verts);
+   FREE(rast);
+}
@@ -0,0 +1,79 @@
+/**************************************************************************
+ *
+ * Copyright 2023 Mesa contributors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization.
+ *
+ * Triangles emitted by the draw module are binned into screen tiles of
+ * TILE_SIZE x TILE_SIZE pixels (the render tile cache granularity) and
+ * rasterized at the end of the draw by a pool of threads.  Each thread
+ * owns a fixed subset of the screen tiles and has its own setup context,
+ * quad pipeline, TGSI interpreter and tile caches, so no two threads ever
+ * touch the same cached tile.
+ */
+
+#ifndef SP_RAST_H
+#define SP_RAST_H
+
+#include "util/compiler.h"
+
+struct softpipe_context;
+struct sp_fragment_shader_variant;
+struct sp_rast;
+
+struct sp_rast *
+sp_rast_create(struct softpipe_context *sp, unsigned num_threads);
+
+void
+sp_rast_destroy(struct sp_rast *rast);
+
+void
+sp_rast_begin(struct sp_rast *rast);
+
+void
+sp_rast_end(struct sp_rast *rast);
+
+void
+sp_rast_finish(struct sp_rast *rast);
+
+bool
+sp_rast_bin_tri(struct sp_rast *rast,
+                const float (*v0)[4],
+                const float (*v1)[4],
+                const float (*v2)[4]);
+
+void
+sp_rast_flush(struct sp_rast *rast, bool textures);
+
+void
+sp_rast_release_surfaces(struct sp_rast *rast);
+
+void
+sp_rast_unbind_fs_variant(struct sp_rast *rast,
+                          struct sp_fragment_shader_variant *var);
+
+#endif /* SP_RAST_H */
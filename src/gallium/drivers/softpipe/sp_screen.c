@@ -607,6 +607,12 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_compiler_options = softpipe_get_compiler_options;
    screen->use_llvm = sp_debug & SP_DBG_USE_LLVM;
 
+   /* The binned path doesn't always match the serial one to the last bit,
+    * and softpipe is the reference rasterizer, so only bin when asked to.
+    */
+   screen->num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   screen->num_threads = MIN2(screen->num_threads, SP_MAX_THREADS);
+
    softpipe_init_screen_texture_funcs(&screen->base);
    softpipe_init_screen_fence_funcs(&screen->base);
 
@@ -47,6 +47,9 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    bool use_llvm;
+
+   /** Number of tile rasterization threads, 0 or 1 for none */
+   unsigned num_threads;
 };
 
 static inline struct softpipe_screen *
@@ -36,6 +36,7 @@
 #include "sp_screen.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -75,6 +76,16 @@ struct edge {
 struct setup_context {
    struct softpipe_context *softpipe;
 
+   /** Quad pipeline fed by this setup context */
+   struct quad_pipeline *quad_pipe;
+
+   /**
+    * Screen tile this context rasterizes into, intersected with the
+    * cliprect.  NULL for the context's own setup, which may bin
+    * triangles for the tile threads instead (see sp_rast.c).
+    */
+   const struct pipe_scissor_state *tile;
+
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
     * Codegen will help cope with this.
@@ -122,6 +133,26 @@ struct setup_context {
 
 
 
+/**
+ * Return the scissor/surface bounds for the given viewport, restricted
+ * to the setup context's screen tile if it has one.
+ */
+static inline struct pipe_scissor_state
+setup_cliprect(const struct setup_context *setup, unsigned viewport_index)
+{
+   struct pipe_scissor_state cliprect = setup->softpipe->cliprect[viewport_index];
+
+   if (setup->tile) {
+      cliprect.minx = MAX2(cliprect.minx, setup->tile->minx);
+      cliprect.miny = MAX2(cliprect.miny, setup->tile->miny);
+      cliprect.maxx = MIN2(cliprect.maxx, setup->tile->maxx);
+      cliprect.maxy = MIN2(cliprect.maxy, setup->tile->maxy);
+   }
+
+   return cliprect;
+}
+
+
 /**
  * Clip setup->quad against the scissor/surface bounds.
  */
@@ -129,11 +160,11 @@ static inline void
 quad_clip(struct setup_context *setup, struct quad_header *quad)
 {
    unsigned viewport_index = quad[0].input.viewport_index;
-   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect[viewport_index];
-   const int minx = (int) cliprect->minx;
-   const int maxx = (int) cliprect->maxx;
-   const int miny = (int) cliprect->miny;
-   const int maxy = (int) cliprect->maxy;
+   const struct pipe_scissor_state cliprect = setup_cliprect(setup, viewport_index);
+   const int minx = (int) cliprect.minx;
+   const int maxx = (int) cliprect.maxx;
+   const int miny = (int) cliprect.miny;
+   const int maxy = (int) cliprect.maxy;
 
    if (quad->input.x0 >= maxx ||
        quad->input.y0 >= maxy ||
@@ -163,13 +194,13 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip(setup, quad);
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct quad_stage *pipe = setup->quad_pipe->first;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      pipe->run( pipe, &quad, 1 );
    }
 }
 
@@ -204,7 +235,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = setup->quad_pipe->first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -653,11 +684,11 @@ subtriangle(struct setup_context *setup,
             int lines,
             unsigned viewport_index)
 {
-   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect[viewport_index];
-   const int minx = (int) cliprect->minx;
-   const int maxx = (int) cliprect->maxx;
-   const int miny = (int) cliprect->miny;
-   const int maxy = (int) cliprect->maxy;
+   const struct pipe_scissor_state cliprect = setup_cliprect(setup, viewport_index);
+   const int minx = (int) cliprect.minx;
+   const int maxx = (int) cliprect.maxx;
+   const int miny = (int) cliprect.miny;
+   const int maxy = (int) cliprect.maxy;
    int y, start_y, finish_y;
    int sy = (int)eleft->sy;
 
@@ -776,6 +807,11 @@ sp_setup_tri(struct setup_context *setup,
    if (!setup_sort_vertices( setup, det, v0, v1, v2 ))
       return;
 
+   /* Leave triangles that survived culling to the tile threads, if active */
+   if (!setup->tile && setup->softpipe->rast &&
+       sp_rast_bin_tri(setup->softpipe->rast, v0, v1, v2))
+      return;
+
    setup_tri_coefficients( setup );
    setup_tri_edges( setup );
 
@@ -1019,6 +1055,10 @@ sp_setup_line(struct setup_context *setup,
        setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   /* Binned triangles must land before this primitive */
+   if (!setup->tile && setup->softpipe->rast)
+      sp_rast_finish(setup->softpipe->rast);
+
    if (dx == 0 && dy == 0)
       return;
 
@@ -1167,6 +1207,10 @@ sp_setup_point(struct setup_context *setup,
        setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   /* Binned triangles must land before this primitive */
+   if (!setup->tile && setup->softpipe->rast)
+      sp_rast_finish(setup->softpipe->rast);
+
    assert(setup->softpipe->reduced_prim == MESA_PRIM_POINTS);
 
    if (setup->softpipe->layer_slot > 0) {
@@ -1401,7 +1445,7 @@ sp_setup_prepare(struct setup_context *setup)
 
    setup->max_layer = max_layer;
 
-   sp->quad.first->begin( sp->quad.first );
+   setup->quad_pipe->first->begin( setup->quad_pipe->first );
 
    if (sp->reduced_api_prim == MESA_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1416,6 +1460,17 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Restrict rasterization to the given screen tile (used by sp_rast.c).
+ */
+void
+sp_setup_set_tile(struct setup_context *setup,
+                  const struct pipe_scissor_state *tile)
+{
+   setup->tile = tile;
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
@@ -1427,12 +1482,17 @@ sp_setup_destroy_context(struct setup_context *setup)
  * Create a new primitive setup/render stage.
  */
 struct setup_context *
-sp_setup_create_context(struct softpipe_context *softpipe)
+sp_setup_create_context(struct softpipe_context *softpipe,
+                        struct quad_pipeline *quad)
 {
    struct setup_context *setup = CALLOC_STRUCT(setup_context);
    unsigned i;
 
+   if (!setup)
+      return NULL;
+
    setup->softpipe = softpipe;
+   setup->quad_pipe = quad;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
@@ -29,6 +29,8 @@
 
 struct setup_context;
 struct softpipe_context;
+struct quad_pipeline;
+struct pipe_scissor_state;
 
 /**
  * Attribute interpolation mode
@@ -70,8 +72,11 @@ sp_clamp_viewport_idx(int idx)
    return (PIPE_MAX_VIEWPORTS > idx && idx >= 0) ? idx : 0;
 }
 
-struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
+struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe,
+                                               struct quad_pipeline *quad );
 void sp_setup_prepare( struct setup_context *setup );
+void sp_setup_set_tile( struct setup_context *setup,
+                        const struct pipe_scissor_state *tile );
 void sp_setup_destroy_context( struct setup_context *setup );
 
 #endif
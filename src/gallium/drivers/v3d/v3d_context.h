@@ -209,6 +209,12 @@ struct v3d_uncompiled_shader {
         uint32_t program_id;
         /** How many variants of this program were compiled, for shader-db. */
         uint32_t compiled_variant_count;
+        /**
+         * Compile strategy used by the last variant of this program. New
+         * variants still try the default strategy first, but go straight
+         * to this one if that fails to register allocate.
+         */
+        uint32_t strategy_hint;
         struct pipe_shader_state base;
         uint32_t num_tf_outputs;
         struct v3d_varying_slot *tf_outputs;
@@ -814,6 +820,13 @@ void v3d_disk_cache_store(struct v3d_context *v3d,
                           const struct v3d_compiled_shader *shader,
                           uint64_t *qpu_insts,
                           uint32_t qpu_size);
+
+uint32_t v3d_disk_cache_retrieve_strategy(struct v3d_context *v3d,
+                                          const struct v3d_uncompiled_shader *so);
+
+void v3d_disk_cache_store_strategy(struct v3d_context *v3d,
+                                   const struct v3d_uncompiled_shader *so,
+                                   uint32_t strategy_idx);
 #endif /* ENABLE_SHADER_CACHE */
 
 /* Helper to call hw ver specific functions */
@@ -232,5 +232,88 @@ v3d_disk_cache_store(struct v3d_context *v3d,
         blob_finish(&blob);
 }
 
+/* The compile strategy hints are keyed only by the uncompiled shader, since
+ * the variants of a program usually have very similar register pressure.
+ */
+static void
+v3d_disk_cache_compute_strategy_key(struct disk_cache *cache,
+                                    const struct v3d_uncompiled_shader *so,
+                                    cache_key cache_key)
+{
+        assert(cache);
+        assert(so->base.type == PIPE_SHADER_IR_NIR);
+
+        static const char prefix[] = "v3d compile strategy";
+
+        struct blob blob;
+        blob_init(&blob);
+
+        blob_write_bytes(&blob, prefix, sizeof(prefix));
+        nir_serialize(&blob, so->base.ir.nir, true);
+
+        disk_cache_compute_key(cache, blob.data, blob.size, cache_key);
+
+        blob_finish(&blob);
+}
+
+uint32_t
+v3d_disk_cache_retrieve_strategy(struct v3d_context *v3d,
+                                 const struct v3d_uncompiled_shader *so)
+{
+        struct disk_cache *cache = v3d->screen->disk_cache;
+
+        if (!cache)
+                return 0;
+
+        cache_key cache_key;
+        v3d_disk_cache_compute_strategy_key(cache, so, cache_key);
+
+        size_t buffer_size;
+        void *buffer = disk_cache_get(cache, cache_key, &buffer_size);
+
+        if (V3D_DBG(CACHE)) {
+                char sha1[41];
+                _mesa_sha1_format(sha1, cache_key);
+                fprintf(stderr, "[v3d on-disk cache] strategy %s %s\n",
+                        buffer ? "hit" : "miss",
+                        sha1);
+        }
+
+        if (!buffer)
+                return 0;
+
+        uint32_t strategy_idx = 0;
+        if (buffer_size == sizeof(strategy_idx))
+                memcpy(&strategy_idx, buffer, sizeof(strategy_idx));
+
+        free(buffer);
+
+        return strategy_idx;
+}
+
+void
+v3d_disk_cache_store_strategy(struct v3d_context *v3d,
+                              const struct v3d_uncompiled_shader *so,
+                              uint32_t strategy_idx)
+{
+        struct disk_cache *cache = v3d->screen->disk_cache;
+
+        if (!cache)
+                return;
+
+        cache_key cache_key;
+        v3d_disk_cache_compute_strategy_key(cache, so, cache_key);
+
+        if (V3D_DBG(CACHE)) {
+                char sha1[41];
+                _mesa_sha1_format(sha1, cache_key);
+                fprintf(stderr, "[v3d on-disk cache] storing strategy %s\n",
+                        sha1);
+        }
+
+        disk_cache_put(cache, cache_key, &strategy_idx, sizeof(strategy_idx),
+                       NULL);
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
@@ -412,11 +412,21 @@ v3d_get_compiled_shader(struct v3d_context *v3d,
                 uint64_t *qpu_insts;
                 uint32_t shader_size;
 
+                uint32_t strategy_hint = p_atomic_read(&shader_state->strategy_hint);
+#ifdef ENABLE_SHADER_CACHE
+                /* The first variant compiled in this process can still
+                 * benefit from the strategy that a previous run settled on.
+                 */
+                if (variant_id == 1)
+                        strategy_hint = v3d_disk_cache_retrieve_strategy(v3d, shader_state);
+#endif
+
                 qpu_insts = v3d_compile(v3d->screen->compiler, key,
                                         &shader->prog_data.base, s,
                                         v3d_shader_debug_output,
                                         v3d,
-                                        program_id, variant_id, &shader_size);
+                                        program_id, variant_id,
+                                        strategy_hint, &shader_size);
 
                 /* qpu_insts being NULL can happen if the register allocation
                  * failed. At this point we can't really trigger an OpenGL API
@@ -434,11 +444,19 @@ v3d_get_compiled_shader(struct v3d_context *v3d,
 
 #ifdef ENABLE_SHADER_CACHE
                 v3d_disk_cache_store(v3d, key, shader, qpu_insts, shader_size);
+
+                if (shader->prog_data.base->compile_strategy_idx != strategy_hint) {
+                        v3d_disk_cache_store_strategy(v3d, shader_state,
+                                                      shader->prog_data.base->compile_strategy_idx);
+                }
 #endif
 
                 free(qpu_insts);
         }
 
+        p_atomic_set(&shader_state->strategy_hint,
+                     shader->prog_data.base->compile_strategy_idx);
+
         v3d_set_shader_uniform_dirty_flags(shader);
 
         if (ht) {
@@ -193,6 +193,16 @@ dri_destroy_drawable(struct dri_drawable *drawable)
    struct dri_screen *screen = drawable->screen;
    int i;
 
+   /* Let the drisw present thread drain before the loader drawable goes */
+   if (util_queue_is_initialized(&drawable->present_queue)) {
+      util_queue_finish(&drawable->present_queue);
+      util_queue_destroy(&drawable->present_queue);
+   }
+   for (i = 0; i < drawable->num_present_buffers; i++) {
+      util_queue_fence_destroy(&drawable->present_jobs[i].fence);
+      pipe_resource_reference(&drawable->present_textures[i], NULL);
+   }
+
    for (i = 0; i < ST_ATTACHMENT_COUNT; i++)
       pipe_resource_reference(&drawable->textures[i], NULL);
    for (i = 0; i < ST_ATTACHMENT_COUNT; i++)
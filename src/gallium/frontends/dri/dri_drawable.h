@@ -30,12 +30,24 @@
 
 #include "util/compiler.h"
 #include "util/format/u_formats.h"
+#include "util/u_queue.h"
 #include "frontend/api.h"
 #include "dri_util.h"
 
 struct dri_context;
 struct dri_screen;
 
+#define DRISW_MAX_PRESENT_BUFFERS 4
+
+/* A back buffer handed to the drisw present thread */
+struct drisw_present_job
+{
+   struct util_queue_fence fence;
+   struct dri_drawable *drawable;
+   struct pipe_resource *ptex;
+   struct pipe_fence_handle *rendered;
+};
+
 struct dri_drawable
 {
    struct pipe_frontend_drawable base;
@@ -89,6 +101,13 @@ struct dri_drawable
    __DRIimage   *image; //texture_from_pixmap
    bool is_window;
 
+   /* drisw pipelined present */
+   struct util_queue present_queue;
+   struct drisw_present_job present_jobs[DRISW_MAX_PRESENT_BUFFERS];
+   struct pipe_resource *present_textures[DRISW_MAX_PRESENT_BUFFERS];
+   unsigned num_present_buffers;
+   unsigned present_index;
+
    /* hooks filled in by dri2 & drisw */
    void (*allocate_textures)(struct dri_context *ctx,
                              struct dri_drawable *drawable,
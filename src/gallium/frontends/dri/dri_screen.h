@@ -112,6 +112,8 @@ struct dri_screen
    enum pipe_texture_target target;
 
    bool swrast_no_present;
+   /* back buffers cycled through the drisw present thread, <= 1 is off */
+   unsigned swrast_present_buffers;
 
    /* hooks filled in by dri2 & drisw */
    __DRIimage * (*lookup_egl_image)(struct dri_screen *ctx, void *handle);
@@ -44,6 +44,7 @@
 #include "dri_query_renderer.h"
 
 DEBUG_GET_ONCE_BOOL_OPTION(swrast_no_present, "SWRAST_NO_PRESENT", false);
+DEBUG_GET_ONCE_NUM_OPTION(swrast_present_buffers, "SWRAST_PRESENT_BUFFERS", 0);
 
 static inline void
 get_drawable_info(struct dri_drawable *drawable, int *x, int *y, int *w, int *h)
@@ -214,6 +215,91 @@ drisw_copy_to_front(struct pipe_context *pipe,
    drisw_invalidate_drawable(drawable);
 }
 
+/*
+ * Pipelined present.
+ *
+ * With SWRAST_PRESENT_BUFFERS=n (n >= 2) the back buffer is not waited on at
+ * swap time.  It is handed to a per-drawable thread which waits for the
+ * rendering fence and then copies it to the window, while the application
+ * renders the next frame into the next buffer of the ring.  The loader's
+ * put_image callbacks are then called from that thread, so this is only done
+ * when the loader reports itself thread safe (Xlib needs XInitThreads).
+ *
+ * Rotating the back buffer loses its contents, so the ring is not used for
+ * swap-copy configs.  The EGL loader doesn't expose the background callable,
+ * as EGL_SWAP_BEHAVIOR can be switched to preserved without telling us.
+ */
+
+static bool
+drisw_present_thread_safe(struct dri_context *ctx)
+{
+   const __DRIbackgroundCallableExtension *backgroundCallable =
+      ctx->screen->dri2.backgroundCallable;
+
+   /* Loaders that can't tell are assumed not to be */
+   return backgroundCallable &&
+          backgroundCallable->base.version >= 2 &&
+          backgroundCallable->isThreadSafe &&
+          backgroundCallable->isThreadSafe(ctx->loaderPrivate);
+}
+
+static void
+drisw_present_execute(void *data, void *gdata, int thread_index)
+{
+   struct drisw_present_job *job = data;
+   struct pipe_screen *pscreen = job->drawable->screen->base.screen;
+
+   if (job->rendered) {
+      pscreen->fence_finish(pscreen, NULL, job->rendered, OS_TIMEOUT_INFINITE);
+      pscreen->fence_reference(pscreen, &job->rendered, NULL);
+   }
+
+   drisw_present_texture(NULL, job->drawable, job->ptex, NULL);
+
+   pipe_resource_reference(&job->ptex, NULL);
+}
+
+/* Waits for all queued presents, before anything else touches the window */
+static void
+drisw_finish_present(struct dri_drawable *drawable)
+{
+   if (util_queue_is_initialized(&drawable->present_queue))
+      util_queue_finish(&drawable->present_queue);
+}
+
+static bool
+drisw_queue_present(struct dri_drawable *drawable, struct pipe_resource *ptex,
+                    struct pipe_fence_handle **fence)
+{
+   struct drisw_present_job *job;
+
+   if (!util_queue_is_initialized(&drawable->present_queue) &&
+       !util_queue_init(&drawable->present_queue, "swpresent",
+                        drawable->num_present_buffers, 1, 0, NULL))
+      return false;
+
+   job = &drawable->present_jobs[drawable->present_index];
+   assert(util_queue_fence_is_signalled(&job->fence));
+
+   job->drawable = drawable;
+   pipe_resource_reference(&job->ptex, ptex);
+   job->rendered = *fence;
+   *fence = NULL;
+
+   util_queue_add_job(&drawable->present_queue, job, &job->fence,
+                      drisw_present_execute, NULL, 0);
+
+   /* Move on to the next buffer of the ring once its previous present is
+    * done.  A NULL slot makes drisw_allocate_textures create it.
+    */
+   drawable->present_index =
+      (drawable->present_index + 1) % drawable->num_present_buffers;
+   util_queue_fence_wait(&drawable->present_jobs[drawable->present_index].fence);
+   pipe_resource_reference(&drawable->textures[ST_ATTACHMENT_BACK_LEFT],
+                           drawable->present_textures[drawable->present_index]);
+   return true;
+}
+
 /*
  * Backend functions for pipe_frontend_drawable and swap_buffers.
  */
@@ -243,13 +329,34 @@ drisw_swap_buffers(struct dri_drawable *drawable)
       if (ctx->hud)
          hud_run(ctx->hud, ctx->st->cso_context, ptex);
 
-      st_context_flush(ctx->st, ST_FLUSH_FRONT, &fence, NULL, NULL);
-
-      if (drawable->stvis.samples > 1) {
-         /* Resolve the back buffer. */
-         dri_pipe_blit(ctx->st->pipe,
-                       drawable->textures[ST_ATTACHMENT_BACK_LEFT],
-                       drawable->msaa_textures[ST_ATTACHMENT_BACK_LEFT]);
+      if (drawable->num_present_buffers > 1 && !screen->swrast_no_present &&
+          drisw_present_thread_safe(ctx)) {
+         /* The resolve has to be covered by the fence the thread waits on */
+         if (drawable->stvis.samples > 1) {
+            dri_pipe_blit(ctx->st->pipe,
+                          drawable->textures[ST_ATTACHMENT_BACK_LEFT],
+                          drawable->msaa_textures[ST_ATTACHMENT_BACK_LEFT]);
+         }
+
+         st_context_flush(ctx->st, ST_FLUSH_FRONT, &fence, NULL, NULL);
+
+         if (drisw_queue_present(drawable, ptex, &fence)) {
+            screen->base.screen->fence_reference(screen->base.screen, &fence,
+                                                 NULL);
+            drisw_invalidate_drawable(drawable);
+            st_context_invalidate_state(ctx->st, ST_INVALIDATE_FB_STATE);
+            return;
+         }
+      } else {
+         drisw_finish_present(drawable);
+         st_context_flush(ctx->st, ST_FLUSH_FRONT, &fence, NULL, NULL);
+
+         if (drawable->stvis.samples > 1) {
+            /* Resolve the back buffer. */
+            dri_pipe_blit(ctx->st->pipe,
+                          drawable->textures[ST_ATTACHMENT_BACK_LEFT],
+                          drawable->msaa_textures[ST_ATTACHMENT_BACK_LEFT]);
+         }
       }
 
       screen->base.screen->fence_finish(screen->base.screen, ctx->st->pipe,
@@ -280,6 +387,7 @@ drisw_copy_sub_buffer(struct dri_drawable *drawable, int x, int y,
        * multiple threads.
        */
       _mesa_glthread_finish(ctx->st->ctx);
+      drisw_finish_present(drawable);
 
       struct pipe_fence_handle *fence = NULL;
       if (ctx->pp && drawable->textures[ST_ATTACHMENT_DEPTH_STENCIL])
@@ -327,6 +435,7 @@ drisw_flush_frontbuffer(struct dri_context *ctx,
    ptex = drawable->textures[statt];
 
    if (ptex) {
+      drisw_finish_present(ctx->draw);
       drisw_copy_to_front(ctx->st->pipe, ctx->draw, ptex);
    }
 
@@ -366,6 +475,9 @@ drisw_allocate_textures(struct dri_context *stctx,
 
    /* remove outdated textures */
    if (resized) {
+      drisw_finish_present(drawable);
+      for (i = 0; i < drawable->num_present_buffers; i++)
+         pipe_resource_reference(&drawable->present_textures[i], NULL);
       for (i = 0; i < ST_ATTACHMENT_COUNT; i++) {
          pipe_resource_reference(&drawable->textures[i], NULL);
          pipe_resource_reference(&drawable->msaa_textures[i], NULL);
@@ -411,7 +523,16 @@ drisw_allocate_textures(struct dri_context *stctx,
          drawable->textures[statts[i]] =
             screen->base.screen->resource_create(screen->base.screen, &templ);
 
-      if (drawable->stvis.samples > 1) {
+      /* Remember new back buffers in the present ring */
+      if (statts[i] == ST_ATTACHMENT_BACK_LEFT &&
+          drawable->num_present_buffers > 1) {
+         pipe_resource_reference(
+            &drawable->present_textures[drawable->present_index],
+            drawable->textures[statts[i]]);
+      }
+
+      /* A back buffer taken from the present ring keeps its resolve source */
+      if (drawable->stvis.samples > 1 && !drawable->msaa_textures[statts[i]]) {
          templ.bind = templ.bind &
             ~(PIPE_BIND_SCANOUT | PIPE_BIND_SHARED | PIPE_BIND_DISPLAY_TARGET);
          templ.nr_samples = drawable->stvis.samples;
@@ -446,6 +567,7 @@ drisw_update_tex_buffer(struct dri_drawable *drawable,
     * multiple threads.
     */
    _mesa_glthread_finish(ctx->st->ctx);
+   drisw_finish_present(drawable);
 
    get_drawable_info(drawable, &x, &y, &w, &h);
 
@@ -535,6 +657,14 @@ drisw_create_drawable(struct dri_screen *screen, const struct gl_config * visual
    drawable->update_tex_buffer = drisw_update_tex_buffer;
    drawable->swap_buffers = drisw_swap_buffers;
 
+   if (screen->swrast_present_buffers > 1 &&
+       visual->swapMethod != __DRI_ATTRIB_SWAP_COPY) {
+      drawable->num_present_buffers = MIN2(screen->swrast_present_buffers,
+                                           DRISW_MAX_PRESENT_BUFFERS);
+      for (unsigned i = 0; i < drawable->num_present_buffers; i++)
+         util_queue_fence_init(&drawable->present_jobs[i].fence);
+   }
+
    return drawable;
 }
 
@@ -547,6 +677,7 @@ drisw_init_screen(struct dri_screen *screen)
    const struct drisw_loader_funcs *lf = &drisw_lf;
 
    screen->swrast_no_present = debug_get_option_swrast_no_present();
+   screen->swrast_present_buffers = debug_get_option_swrast_present_buffers();
 
    if (loader->base.version >= 4) {
       if (loader->putImageShm)
@@ -689,13 +689,9 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateDescriptorUpdateTemplate(VkDevice _devi
                                             VkDescriptorUpdateTemplate *pDescriptorUpdateTemplate)
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
-   const uint32_t entry_count = pCreateInfo->descriptorUpdateEntryCount;
-   const size_t size = sizeof(struct lvp_descriptor_update_template) +
-      sizeof(VkDescriptorUpdateTemplateEntry) * entry_count;
-
    struct lvp_descriptor_update_template *templ;
 
-   templ = vk_alloc(&device->vk.alloc, size, 8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   templ = vk_alloc(&device->vk.alloc, sizeof(*templ), 8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
    if (!templ)
       return vk_error(device, VK_ERROR_OUT_OF_HOST_MEMORY);
 
@@ -706,16 +702,52 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateDescriptorUpdateTemplate(VkDevice _devi
    templ->type = pCreateInfo->templateType;
    templ->bind_point = pCreateInfo->pipelineBindPoint;
    templ->set = pCreateInfo->set;
+
+   const struct lvp_descriptor_set_layout *set_layout;
    /* This parameter is ignored if templateType is not VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR */
-   if (pCreateInfo->templateType == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR)
+   if (pCreateInfo->templateType == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR) {
       templ->pipeline_layout = lvp_pipeline_layout_from_handle(pCreateInfo->pipelineLayout);
-   else
+      set_layout = vk_to_lvp_descriptor_set_layout(templ->pipeline_layout->vk.set_layouts[templ->set]);
+   } else {
       templ->pipeline_layout = NULL;
-   templ->entry_count = entry_count;
+      set_layout = lvp_descriptor_set_layout_from_handle(pCreateInfo->descriptorSetLayout);
+   }
 
-   VkDescriptorUpdateTemplateEntry *entries = (VkDescriptorUpdateTemplateEntry *)(templ + 1);
-   for (unsigned i = 0; i < entry_count; i++) {
-      entries[i] = pCreateInfo->pDescriptorUpdateEntries[i];
+   struct vk_descriptor_template_binding *bindings =
+      vk_alloc(&device->vk.alloc, set_layout->binding_count * sizeof(*bindings), 8,
+               VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+   if (set_layout->binding_count && !bindings) {
+      lvp_descriptor_template_destroy(device, templ);
+      return vk_error(device, VK_ERROR_OUT_OF_HOST_MEMORY);
+   }
+
+   for (unsigned i = 0; i < set_layout->binding_count; i++) {
+      const struct lvp_descriptor_set_binding_layout *bind_layout = &set_layout->binding[i];
+
+      if (bind_layout->type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK) {
+         bindings[i] = (struct vk_descriptor_template_binding) {
+            .array_size = bind_layout->uniform_block_size,
+            .offset = bind_layout->uniform_block_offset,
+         };
+      } else {
+         bindings[i] = (struct vk_descriptor_template_binding) {
+            .array_size = bind_layout->valid ? bind_layout->array_size : 0,
+            .offset = bind_layout->descriptor_index * sizeof(struct lp_descriptor),
+            .stride = sizeof(struct lp_descriptor),
+            .flags = bind_layout->immutable_samplers ? LVP_TEMPLATE_IMMUTABLE_SAMPLERS : 0,
+         };
+      }
+   }
+
+   templ->program = NULL;
+   VkResult result =
+      vk_descriptor_template_program_create(&device->vk, NULL, pCreateInfo,
+                                            bindings, set_layout->binding_count,
+                                            &templ->program);
+   vk_free(&device->vk.alloc, bindings);
+   if (result != VK_SUCCESS) {
+      lvp_descriptor_template_destroy(device, templ);
+      return result;
    }
 
    *pDescriptorUpdateTemplate = lvp_descriptor_update_template_to_handle(templ);
@@ -728,6 +760,8 @@ lvp_descriptor_template_destroy(struct lvp_device *device, struct lvp_descriptor
    if (!templ)
       return;
 
+   if (templ->program)
+      vk_descriptor_template_program_destroy(&device->vk, NULL, templ->program);
    vk_object_base_finish(&templ->base);
    vk_free(&device->vk.alloc, templ);
 }
@@ -741,28 +775,6 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroyDescriptorUpdateTemplate(VkDevice _device,
    lvp_descriptor_template_templ_unref(device, templ);
 }
 
-uint32_t
-lvp_descriptor_update_template_entry_size(VkDescriptorType type)
-{
-   switch (type) {
-   case VK_DESCRIPTOR_TYPE_SAMPLER:
-   case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-   case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-   case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-   case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-      return sizeof(VkDescriptorImageInfo);
-   case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-   case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-      return sizeof(VkBufferView);
-   case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-   case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-   case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-   case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
-   default:
-      return sizeof(VkDescriptorBufferInfo);
-   }
-}
-
 void
 lvp_descriptor_set_update_with_template(VkDevice _device, VkDescriptorSet descriptorSet,
                                         VkDescriptorUpdateTemplate descriptorUpdateTemplate,
@@ -771,113 +783,107 @@ lvp_descriptor_set_update_with_template(VkDevice _device, VkDescriptorSet descri
    LVP_FROM_HANDLE(lvp_device, device, _device);
    LVP_FROM_HANDLE(lvp_descriptor_set, set, descriptorSet);
    LVP_FROM_HANDLE(lvp_descriptor_update_template, templ, descriptorUpdateTemplate);
-   uint32_t i, j;
-
-   const uint8_t *pSrc = pData;
+   const struct vk_descriptor_template_program *program = templ->program;
 
-   for (i = 0; i < templ->entry_count; ++i) {
-      VkDescriptorUpdateTemplateEntry *entry = &templ->entry[i];
+   /* Push descriptor data was packed by lvp_CmdPushDescriptorSetWithTemplateKHR */
+   for (uint32_t i = 0; i < program->op_count; ++i) {
+      const struct vk_descriptor_template_op *op = &program->ops[i];
+      size_t src_stride;
+      const uint8_t *pSrc = vk_descriptor_template_op_src(op, pData, push, &src_stride);
+      uint8_t *dst = (uint8_t *)set->map + op->dst_offset;
 
-      if (!push)
-         pSrc = ((const uint8_t *) pData) + entry->offset;
-
-      const struct lvp_descriptor_set_binding_layout *bind_layout =
-         &set->layout->binding[entry->dstBinding];
-
-      if (entry->descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK) {
-         memcpy((uint8_t *)set->map + bind_layout->uniform_block_offset + entry->dstArrayElement, pSrc, entry->descriptorCount);
+      if (op->type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK) {
+         memcpy(dst, pSrc, op->count);
          continue;
       }
 
-      struct lp_descriptor *desc = set->map;
-      desc += bind_layout->descriptor_index;
+      for (uint32_t j = 0; j < op->count; ++j, pSrc += src_stride, dst += op->dst_stride) {
+         struct lp_descriptor *desc = (struct lp_descriptor *)dst;
 
-      for (j = 0; j < entry->descriptorCount; ++j) {
-         unsigned idx = j + entry->dstArrayElement;
-         switch (entry->descriptorType) {
+         switch (op->type) {
          case VK_DESCRIPTOR_TYPE_SAMPLER: {
             LVP_FROM_HANDLE(lvp_sampler, sampler,
-                            *(VkSampler *)pSrc);
+                            ((const VkDescriptorImageInfo *)pSrc)->sampler);
 
-            desc[idx].sampler = sampler->desc.sampler;
-            desc[idx].sampler_index = sampler->desc.sampler_index;
+            desc->sampler = sampler->desc.sampler;
+            desc->sampler_index = sampler->desc.sampler_index;
             break;
          }
          case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
-            VkDescriptorImageInfo *info = (VkDescriptorImageInfo *)pSrc;
+            const VkDescriptorImageInfo *info = (const VkDescriptorImageInfo *)pSrc;
             LVP_FROM_HANDLE(lvp_image_view, iview, info->imageView);
 
             if (iview) {
-               lp_jit_texture_from_pipe(&desc[idx].texture, iview->sv);
-               desc[idx].functions = iview->texture_handle->functions;
+               lp_jit_texture_from_pipe(&desc->texture, iview->sv);
+               desc->functions = iview->texture_handle->functions;
 
-               if (!bind_layout->immutable_samplers) {
+               if (!(op->flags & LVP_TEMPLATE_IMMUTABLE_SAMPLERS)) {
                   LVP_FROM_HANDLE(lvp_sampler, sampler, info->sampler);
 
-                  desc[idx].sampler = sampler->desc.sampler;
-                  desc[idx].sampler_index = sampler->desc.sampler_index;
+                  desc->sampler = sampler->desc.sampler;
+                  desc->sampler_index = sampler->desc.sampler_index;
                }
             } else {
-               desc[j].functions = device->null_texture_handle->functions;
-               desc[j].sampler_index = 0;
+               desc->functions = device->null_texture_handle->functions;
+               desc->sampler_index = 0;
             }
             break;
          }
          case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: {
-            VkDescriptorImageInfo *info = (VkDescriptorImageInfo *)pSrc;
+            const VkDescriptorImageInfo *info = (const VkDescriptorImageInfo *)pSrc;
             LVP_FROM_HANDLE(lvp_image_view, iview, info->imageView);
 
             if (iview) {
-               lp_jit_texture_from_pipe(&desc[idx].texture, iview->sv);
-               desc[idx].functions = iview->texture_handle->functions;
+               lp_jit_texture_from_pipe(&desc->texture, iview->sv);
+               desc->functions = iview->texture_handle->functions;
             } else {
-               desc[j].functions = device->null_texture_handle->functions;
-               desc[j].sampler_index = 0;
+               desc->functions = device->null_texture_handle->functions;
+               desc->sampler_index = 0;
             }
             break;
          }
          case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
          case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: {
             LVP_FROM_HANDLE(lvp_image_view, iview,
-                            ((VkDescriptorImageInfo *)pSrc)->imageView);
+                            ((const VkDescriptorImageInfo *)pSrc)->imageView);
 
             if (iview) {
-               lp_jit_image_from_pipe(&desc[idx].image, &iview->iv);
-               desc[idx].functions = iview->image_handle->functions;
+               lp_jit_image_from_pipe(&desc->image, &iview->iv);
+               desc->functions = iview->image_handle->functions;
             } else {
-               desc[idx].functions = device->null_image_handle->functions;
+               desc->functions = device->null_image_handle->functions;
             }
             break;
          }
          case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: {
             LVP_FROM_HANDLE(lvp_buffer_view, bview,
-                            *(VkBufferView *)pSrc);
+                            *(const VkBufferView *)pSrc);
 
             if (bview) {
-               lp_jit_texture_from_pipe(&desc[idx].texture, bview->sv);
-               desc[idx].functions = bview->texture_handle->functions;
+               lp_jit_texture_from_pipe(&desc->texture, bview->sv);
+               desc->functions = bview->texture_handle->functions;
             } else {
-               desc[j].functions = device->null_texture_handle->functions;
-               desc[j].sampler_index = 0;
+               desc->functions = device->null_texture_handle->functions;
+               desc->sampler_index = 0;
             }
             break;
          }
          case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: {
             LVP_FROM_HANDLE(lvp_buffer_view, bview,
-                            *(VkBufferView *)pSrc);
+                            *(const VkBufferView *)pSrc);
 
             if (bview) {
-               lp_jit_image_from_pipe(&desc[idx].image, &bview->iv);
-               desc[idx].functions = bview->image_handle->functions;
+               lp_jit_image_from_pipe(&desc->image, &bview->iv);
+               desc->functions = bview->image_handle->functions;
             } else {
-               desc[idx].functions = device->null_image_handle->functions;
+               desc->functions = device->null_image_handle->functions;
             }
             break;
          }
 
          case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
          case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC: {
-            VkDescriptorBufferInfo *info = (VkDescriptorBufferInfo *)pSrc;
+            const VkDescriptorBufferInfo *info = (const VkDescriptorBufferInfo *)pSrc;
             LVP_FROM_HANDLE(lvp_buffer, buffer, info->buffer);
 
             if (buffer) {
@@ -890,16 +896,16 @@ lvp_descriptor_set_update_with_template(VkDevice _device, VkDescriptorSet descri
                if (info->range == VK_WHOLE_SIZE)
                   ubo.buffer_size = buffer->bo->width0 - ubo.buffer_offset;
 
-               lp_jit_buffer_from_pipe_const(&desc[idx].buffer, &ubo, device->pscreen);
+               lp_jit_buffer_from_pipe_const(&desc->buffer, &ubo, device->pscreen);
             } else {
-               lp_jit_buffer_from_pipe_const(&desc[idx].buffer, &((struct pipe_constant_buffer){0}), device->pscreen);
+               lp_jit_buffer_from_pipe_const(&desc->buffer, &((struct pipe_constant_buffer){0}), device->pscreen);
             }
             break;
          }
 
          case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
          case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: {
-            VkDescriptorBufferInfo *info = (VkDescriptorBufferInfo *)pSrc;
+            const VkDescriptorBufferInfo *info = (const VkDescriptorBufferInfo *)pSrc;
             LVP_FROM_HANDLE(lvp_buffer, buffer, info->buffer);
 
             if (buffer) {
@@ -912,20 +918,15 @@ lvp_descriptor_set_update_with_template(VkDevice _device, VkDescriptorSet descri
                if (info->range == VK_WHOLE_SIZE)
                   ubo.buffer_size = buffer->bo->width0 - ubo.buffer_offset;
 
-               lp_jit_buffer_from_pipe(&desc[idx].buffer, &ubo);
+               lp_jit_buffer_from_pipe(&desc->buffer, &ubo);
             } else {
-               lp_jit_buffer_from_pipe(&desc[idx].buffer, &((struct pipe_shader_buffer){0}));
+               lp_jit_buffer_from_pipe(&desc->buffer, &((struct pipe_shader_buffer){0}));
             }
             break;
          }
          default:
             break;
          }
-
-         if (push)
-            pSrc += lvp_descriptor_update_template_entry_size(entry->descriptorType);
-         else
-            pSrc += entry->stride;
       }
    }
 }
@@ -91,6 +91,14 @@ lvp_image_create(VkDevice _device,
                                 VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT))
          template.bind |= PIPE_BIND_SHADER_IMAGE;
 
+      /* The host accesses linear images through their memory, and other
+       * devices external ones, so keep them out of driver-private layouts.
+       */
+      if (pCreateInfo->tiling != VK_IMAGE_TILING_OPTIMAL ||
+          vk_find_struct_const(pCreateInfo->pNext,
+                               EXTERNAL_MEMORY_IMAGE_CREATE_INFO))
+         template.bind |= PIPE_BIND_LINEAR;
+
       template.width0 = pCreateInfo->extent.width;
       template.height0 = pCreateInfo->extent.height;
       template.depth0 = pCreateInfo->extent.depth;
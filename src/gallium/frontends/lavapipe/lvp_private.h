@@ -68,6 +68,7 @@ typedef uint32_t xcb_window_t;
 #include "vk_command_buffer.h"
 #include "vk_command_pool.h"
 #include "vk_descriptor_set_layout.h"
+#include "vk_descriptor_update_template.h"
 #include "vk_graphics_state.h"
 #include "vk_pipeline_layout.h"
 #include "vk_queue.h"
@@ -348,18 +349,20 @@ struct lvp_descriptor_pool {
    struct list_head sets;
 };
 
+/* vk_descriptor_template_binding::flags */
+#define LVP_TEMPLATE_IMMUTABLE_SAMPLERS (1 << 0)
+
 struct lvp_descriptor_update_template {
    struct vk_object_base base;
    unsigned ref_cnt;
-   uint32_t entry_count;
    uint32_t set;
    VkDescriptorUpdateTemplateType type;
    VkPipelineBindPoint bind_point;
    struct lvp_pipeline_layout *pipeline_layout;
-   VkDescriptorUpdateTemplateEntry entry[0];
-};
 
-uint32_t lvp_descriptor_update_template_entry_size(VkDescriptorType type);
+   /* Byte offsets into lvp_descriptor_set::map */
+   struct vk_descriptor_template_program *program;
+};
 
 static inline void
 lvp_descriptor_template_templ_ref(struct lvp_descriptor_update_template *templ)
@@ -31,16 +31,17 @@
  * Otherwise we use softpipe.  The GALLIUM_DRIVER environment variable
  * may be set to "softpipe" or "llvmpipe" to override.
  *
- * With softpipe we could render directly into the user's buffer by using a
- * display target resource.  However, softpipe doesn't support "upside-down"
- * rendering which would be needed for the OSMESA_Y_UP=TRUE case.
+ * When the driver can wrap the user's buffer in a resource with the same
+ * layout (PIPE_CAP_RESOURCE_FROM_USER_MEMORY), we render directly into it.
+ * For OSMESA_Y_UP=TRUE, the window framebuffer is then made Y_0_BOTTOM, like
+ * an FBO with GL_FRAMEBUFFER_FLIP_Y_MESA cleared, so the viewport transform
+ * does the flip.  llvmpipe pads rows to a cache line and a multiple of 4
+ * pixels, and the height to a multiple of 4 rows, so this needs the user's
+ * row stride and height to match.
  *
- * With llvmpipe we could only render directly into the user's buffer when its
- * width and height is a multiple of the tile size (64 pixels).
- *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Otherwise (softpipe, or a buffer llvmpipe can't use as is) we render into
+ * ordinary resources then copy the results to the user's buffer in the
+ * flush_front() function which is called when the app calls glFlush/Finish.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -52,6 +53,7 @@
 #include <stdio.h>
 #include <c11/threads.h>
 
+#include "main/context.h"
 #include "state_tracker/st_context.h"
 
 #include "GL/osmesa.h"
@@ -68,6 +70,7 @@
 #include "util/format/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/os_time.h"
 
 #include "postprocess/filters.h"
 #include "postprocess/postprocess.h"
@@ -91,6 +94,13 @@ struct osmesa_buffer
 
    void *map;
 
+   /* The user's buffer wrapped as the front-left attachment, if the driver
+    * can render to it directly, and the map and row stride it wraps.
+    */
+   struct pipe_resource *user_res;
+   void *user_map;
+   unsigned user_stride;
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -210,6 +220,33 @@ osmesa_read_buffer(OSMesaContext osmesa, struct pipe_resource *res, void *dst,
 }
 
 
+/**
+ * Return the row stride of the user's color buffer in bytes.
+ */
+static unsigned
+osmesa_user_stride(OSMesaContext osmesa, struct osmesa_buffer *osbuffer)
+{
+   unsigned bpp = util_format_get_blocksize(osbuffer->visual.color_format);
+
+   if (osmesa->user_row_length)
+      return bpp * osmesa->user_row_length;
+   else
+      return bpp * osbuffer->width;
+}
+
+
+/**
+ * Whether the framebuffer is Y_0_TOP and we need to flip rows when copying
+ * it to the user in OpenGL's bottom-to-top order.  That's the case unless
+ * we render directly into a Y_UP user buffer.
+ */
+static bool
+osmesa_flip_y(OSMesaContext osmesa, struct osmesa_buffer *osbuffer)
+{
+   return !(osbuffer->user_res && osmesa->y_up);
+}
+
+
 /**
  * Given an OSMESA_x format and a GL_y type, return the best
  * matching PIPE_FORMAT_z.
@@ -348,8 +385,6 @@ osmesa_st_framebuffer_flush_front(struct st_context *st,
    OSMesaContext osmesa = OSMesaGetCurrentContext();
    struct osmesa_buffer *osbuffer = drawable_to_osbuffer(drawable);
    struct pipe_resource *res = osbuffer->textures[statt];
-   unsigned bpp;
-   int dst_stride;
 
    if (statt != ST_ATTACHMENT_FRONT_LEFT)
       return false;
@@ -376,19 +411,28 @@ osmesa_st_framebuffer_flush_front(struct st_context *st,
       pp_run(osmesa->pp, res, res, zsbuf);
    }
 
-   /* Snapshot the color buffer to the user's buffer. */
-   bpp = util_format_get_blocksize(osbuffer->visual.color_format);
-   if (osmesa->user_row_length)
-      dst_stride = bpp * osmesa->user_row_length;
-   else
-      dst_stride = bpp * osbuffer->width;
+   if (res == osbuffer->user_res) {
+      /* We rendered into the user's buffer, just wait for it to land. */
+      struct pipe_screen *screen = get_st_manager()->screen;
+      struct pipe_context *pipe = osmesa->st->pipe;
+      struct pipe_fence_handle *fence = NULL;
 
-   osmesa_read_buffer(osmesa, res, osbuffer->map, dst_stride, osmesa->y_up);
+      pipe->flush(pipe, &fence, 0);
+      if (fence) {
+         screen->fence_finish(screen, NULL, fence, OS_TIMEOUT_INFINITE);
+         screen->fence_reference(screen, &fence, NULL);
+      }
+   } else {
+      /* Snapshot the color buffer to the user's buffer. */
+      osmesa_read_buffer(osmesa, res, osbuffer->map,
+                         osmesa_user_stride(osmesa, osbuffer), osmesa->y_up);
+   }
 
    /* If the user has requested the Z/S buffer, then snapshot that one too. */
    if (osmesa->zs) {
       osmesa_read_buffer(osmesa, osbuffer->textures[ST_ATTACHMENT_DEPTH_STENCIL],
-                         osmesa->zs, osmesa->zs_stride, true);
+                         osmesa->zs, osmesa->zs_stride,
+                         osmesa_flip_y(osmesa, osbuffer));
    }
 
    return true;
@@ -434,6 +478,12 @@ osmesa_st_framebuffer_validate(struct st_context *st,
        * osmesa_init_st_visual().
        */
       if (statts[i] == ST_ATTACHMENT_FRONT_LEFT) {
+         if (osbuffer->user_res) {
+            pipe_resource_reference(&out[i], osbuffer->user_res);
+            osbuffer->textures[statts[i]] = osbuffer->user_res;
+            continue;
+         }
+
          format = osbuffer->visual.color_format;
          bind = PIPE_BIND_RENDER_TARGET;
       }
@@ -460,6 +510,105 @@ osmesa_st_framebuffer_validate(struct st_context *st,
    return true;
 }
 
+
+/**
+ * Try to wrap the user's color buffer in a resource that the driver renders
+ * to directly.  Returns NULL if the driver can't do that or would lay the
+ * resource out differently than the user's buffer.
+ */
+static struct pipe_resource *
+osmesa_wrap_user_buffer(struct osmesa_buffer *osbuffer, unsigned stride)
+{
+   struct pipe_screen *screen = get_st_manager()->screen;
+   struct pipe_resource templat, *res;
+   uint64_t res_stride, layer_stride;
+
+   if (!screen->resource_from_user_memory ||
+       !screen->get_param(screen, PIPE_CAP_RESOURCE_FROM_USER_MEMORY))
+      return NULL;
+
+   if ((uintptr_t)osbuffer->map %
+       screen->get_param(screen, PIPE_CAP_MIN_MAP_BUFFER_ALIGNMENT))
+      return NULL;
+
+   memset(&templat, 0, sizeof(templat));
+   templat.target = PIPE_TEXTURE_RECT;
+   templat.format = osbuffer->visual.color_format;
+   templat.width0 = osbuffer->width;
+   templat.height0 = osbuffer->height;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.usage = PIPE_USAGE_DEFAULT;
+   templat.bind = PIPE_BIND_RENDER_TARGET;
+
+   res = screen->resource_from_user_memory(screen, &templat, osbuffer->map);
+   if (!res)
+      return NULL;
+
+   /* The driver may pad rows and read or write the padding, so the resource
+    * must not reach past the end of the user's buffer.
+    */
+   if (!screen->resource_get_param ||
+       !screen->resource_get_param(screen, NULL, res, 0, 0, 0,
+                                   PIPE_RESOURCE_PARAM_STRIDE, 0,
+                                   &res_stride) ||
+       !screen->resource_get_param(screen, NULL, res, 0, 0, 0,
+                                   PIPE_RESOURCE_PARAM_LAYER_STRIDE, 0,
+                                   &layer_stride) ||
+       res_stride != stride ||
+       layer_stride > (uint64_t)stride * osbuffer->height) {
+      pipe_resource_reference(&res, NULL);
+      return NULL;
+   }
+
+   return res;
+}
+
+
+/**
+ * (Re)wrap the user's buffer after its address or row length changed.
+ */
+static void
+osmesa_update_user_buffer(OSMesaContext osmesa)
+{
+   struct osmesa_buffer *osbuffer = osmesa->current_buffer;
+   unsigned stride = osmesa_user_stride(osmesa, osbuffer);
+   bool had_user_res = osbuffer->user_res != NULL;
+
+   if (osbuffer->user_map == osbuffer->map &&
+       osbuffer->user_stride == stride)
+      return;
+
+   osbuffer->user_map = osbuffer->map;
+   osbuffer->user_stride = stride;
+
+   pipe_resource_reference(&osbuffer->user_res, NULL);
+   osbuffer->user_res = osmesa_wrap_user_buffer(osbuffer, stride);
+
+   /* Make the st validate the framebuffer again to pick up the change. */
+   if (had_user_res || osbuffer->user_res)
+      p_atomic_inc(&osbuffer->base.stamp);
+}
+
+
+/**
+ * Make the window framebuffer Y_0_BOTTOM when we render directly into a
+ * Y_UP user buffer.  Must be called with the context current.
+ */
+static void
+osmesa_update_orientation(OSMesaContext osmesa)
+{
+   struct gl_context *ctx = osmesa->st->ctx;
+   struct gl_framebuffer *fb = ctx->WinSysDrawBuffer;
+   bool flip_y = osmesa_flip_y(osmesa, osmesa->current_buffer);
+
+   if (fb && fb->FlipY != flip_y) {
+      FLUSH_VERTICES(ctx, _NEW_BUFFERS, 0);
+      fb->FlipY = flip_y;
+   }
+}
+
+
 static uint32_t osmesa_fb_ID = 0;
 
 
@@ -497,6 +646,7 @@ osmesa_destroy_buffer(struct osmesa_buffer *osbuffer)
     */
    st_api_destroy_drawable(&osbuffer->base);
 
+   pipe_resource_reference(&osbuffer->user_res, NULL);
    FREE(osbuffer);
 }
 
@@ -773,11 +923,16 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
 
    osmesa->type = type;
 
+   osmesa_update_user_buffer(osmesa);
+
    st_api_make_current(osmesa->st, &osbuffer->base, &osbuffer->base);
 
-   /* XXX: We should probably load the current color value into the buffer here
-    * to match classic swrast behavior (context's fb starts with the contents of
-    * your pixel buffer).
+   osmesa_update_orientation(osmesa);
+
+   /* XXX: Unless we render directly into the user's buffer, we should
+    * probably load the current color value into the buffer here to match
+    * classic swrast behavior (context's fb starts with the contents of your
+    * pixel buffer).
     */
 
    if (!osmesa->ever_used) {
@@ -827,6 +982,7 @@ OSMesaPixelStore(GLint pname, GLint value)
    switch (pname) {
    case OSMESA_ROW_LENGTH:
       osmesa->user_row_length = value;
+      osmesa_update_user_buffer(osmesa);
       break;
    case OSMESA_Y_UP:
       osmesa->y_up = value ? GL_TRUE : GL_FALSE;
@@ -835,6 +991,8 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   osmesa_update_orientation(osmesa);
 }
 
 
@@ -912,7 +1070,8 @@ OSMesaGetDepthBuffer(OSMesaContext c, GLint *width, GLint *height,
       if (!c->zs)
          return GL_FALSE;
 
-      osmesa_read_buffer(c, res, c->zs, c->zs_stride, true);
+      osmesa_read_buffer(c, res, c->zs, c->zs_stride,
+                         osmesa_flip_y(c, osbuffer));
    }
 
    *buffer = c->zs;
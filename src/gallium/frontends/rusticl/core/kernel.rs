@@ -2,6 +2,7 @@ use crate::api::icd::*;
 use crate::core::device::*;
 use crate::core::event::*;
 use crate::core::memory::*;
+use crate::core::platform::Platform;
 use crate::core::program::*;
 use crate::core::queue::*;
 use crate::impl_cl_type_trait;
@@ -25,6 +26,7 @@ use std::os::raw::c_void;
 use std::ptr;
 use std::slice;
 use std::sync::Arc;
+use std::sync::Mutex;
 
 // ugh, we are not allowed to take refs, so...
 #[derive(Clone)]
@@ -250,11 +252,177 @@ impl InternalKernelArg {
     }
 }
 
+/// Launches with identical specialization values after which a specialized variant gets compiled.
+const SPECIALIZE_AFTER_LAUNCHES: u32 = 8;
+/// Limits on the number of tracked value sets and compiled variants per kernel and device.
+const MAX_SPECIALIZATION_CANDIDATES: usize = 32;
+const MAX_SPECIALIZED_VARIANTS: usize = 8;
+/// Only scalars and vectors are folded into the kernel.
+const MAX_SPECIALIZED_ARG_SIZE: usize = 16;
+
+/// The values a kernel variant is compiled for.
+#[derive(Hash, PartialEq, Eq, Clone)]
+pub struct KernelSpecialization {
+    /// Index and value of the by-value arguments
+    args: Vec<(u32, Vec<u8>)>,
+    /// The local size, if the kernel doesn't require one already
+    block: Option<[u16; 3]>,
+}
+
+impl KernelSpecialization {
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut bin = Vec::new();
+
+        bin.extend_from_slice(&self.args.len().to_ne_bytes());
+        for (idx, val) in &self.args {
+            bin.extend_from_slice(&idx.to_ne_bytes());
+            bin.extend_from_slice(&val.len().to_ne_bytes());
+            bin.extend_from_slice(val);
+        }
+
+        if let Some(block) = self.block {
+            bin.push(1);
+            for b in block {
+                bin.extend_from_slice(&b.to_ne_bytes());
+            }
+        } else {
+            bin.push(0);
+        }
+
+        bin
+    }
+}
+
+fn specialize_nir(nir: &mut NirShader, spec: &KernelSpecialization, dev: &Device) {
+    if let Some(block) = &spec.block {
+        nir.set_workgroup_size(block);
+    }
+
+    let args: Vec<_> = spec
+        .args
+        .iter()
+        .map(|(idx, val)| rusticl_spec_arg {
+            location: *idx,
+            size: val.len() as u32,
+            data: val.as_ptr().cast(),
+        })
+        .collect();
+    nir.pass2(rusticl_specialize_args, args.as_ptr(), args.len() as u32);
+
+    // get rid of the loads so that the late lowering sees the arguments as dead
+    opt_nir(nir, dev);
+}
+
+/// A kernel compiled for a specific set of argument values and local size. It has its own
+/// argument layout, as specialized arguments are dead.
+struct KernelVariant {
+    dev: &'static Device,
+    nir: NirShader,
+    args: Vec<KernelArg>,
+    internal_args: Vec<InternalKernelArg>,
+    constant_buffer: Option<Arc<PipeResource>>,
+    cso: *mut c_void,
+    info: pipe_compute_state_object_info,
+}
+
+impl KernelVariant {
+    fn new(
+        dev: &'static Device,
+        (nir, args, internal_args): (NirShader, Vec<KernelArg>, Vec<InternalKernelArg>),
+    ) -> Self {
+        let constant_buffer = KernelDevState::create_nir_constant_buffer(dev, &nir);
+        let mut cso = dev
+            .helper_ctx()
+            .create_compute_state(&nir, nir.shared_size());
+        let info = dev.helper_ctx().compute_state_info(cso);
+
+        // if we can't share the cso between threads, destroy it now.
+        if !dev.shareable_shaders() {
+            dev.helper_ctx().delete_compute_state(cso);
+            cso = ptr::null_mut();
+        };
+
+        Self {
+            dev: dev,
+            nir: nir,
+            args: args,
+            internal_args: internal_args,
+            constant_buffer: constant_buffer,
+            cso: cso,
+            info: info,
+        }
+    }
+}
+
+impl Drop for KernelVariant {
+    fn drop(&mut self) {
+        if !self.cso.is_null() {
+            self.dev.helper_ctx().delete_compute_state(self.cso);
+        }
+    }
+}
+
+/// Launch count of a candidate value set, and when it was last seen.
+struct SpecializationCandidate {
+    launches: u32,
+    last_launch: u64,
+}
+
+#[derive(Default)]
+struct KernelSpecializations {
+    /// Counts the tracked launches, to find the least recently seen candidate.
+    launch_count: u64,
+    candidates: HashMap<KernelSpecialization, SpecializationCandidate>,
+    /// None while the variant gets compiled, or if it can't run with the local size it was
+    /// compiled for.
+    variants: HashMap<KernelSpecialization, Option<Arc<KernelVariant>>>,
+}
+
+impl KernelSpecializations {
+    /// Counts a launch with the given values and returns true once they are worth a variant.
+    fn count_launch(&mut self, key: &KernelSpecialization) -> bool {
+        self.launch_count += 1;
+
+        // Make room by dropping the candidate that was seen the longest time ago, otherwise a
+        // kernel launched with many different values early on never gets specialized again.
+        if self.candidates.len() >= MAX_SPECIALIZATION_CANDIDATES
+            && !self.candidates.contains_key(key)
+        {
+            let oldest = self
+                .candidates
+                .iter()
+                .min_by_key(|(_, c)| c.last_launch)
+                .map(|(k, _)| k.clone());
+            if let Some(oldest) = oldest {
+                self.candidates.remove(&oldest);
+            }
+        }
+
+        let candidate = self
+            .candidates
+            .entry(key.clone())
+            .or_insert(SpecializationCandidate {
+                launches: 0,
+                last_launch: 0,
+            });
+        candidate.launches += 1;
+        candidate.last_launch = self.launch_count;
+
+        if candidate.launches < SPECIALIZE_AFTER_LAUNCHES {
+            return false;
+        }
+
+        self.candidates.remove(key);
+        true
+    }
+}
+
 struct KernelDevStateInner {
     nir: Arc<NirShader>,
     constant_buffer: Option<Arc<PipeResource>>,
     cso: *mut c_void,
     info: pipe_compute_state_object_info,
+    specializations: Mutex<KernelSpecializations>,
 }
 
 struct KernelDevState {
@@ -295,6 +463,7 @@ impl KernelDevState {
                         constant_buffer: cb,
                         cso: cso,
                         info: info,
+                        specializations: Mutex::new(KernelSpecializations::default()),
                     },
                 )
             })
@@ -735,9 +904,10 @@ pub(super) fn convert_spirv_to_nir(
     name: &str,
     args: &[spirv::SPIRVKernelArg],
     dev: &Device,
+    spec: Option<&KernelSpecialization>,
 ) -> (NirShader, Vec<KernelArg>, Vec<InternalKernelArg>) {
     let cache = dev.screen().shader_cache();
-    let key = build.hash_key(dev, name);
+    let key = build.hash_key(dev, name, spec);
 
     let res = if let Some(cache) = &cache {
         cache.get(&mut key.unwrap()).and_then(|entry| {
@@ -760,6 +930,9 @@ pub(super) fn convert_spirv_to_nir(
 
         lower_and_optimize_nir_pre_inputs(dev, &mut nir, &dev.lib_clc);
         let mut args = KernelArg::from_spirv_nir(args, &mut nir);
+        if let Some(spec) = spec {
+            specialize_nir(&mut nir, spec, dev);
+        }
         let internal_args = lower_and_optimize_nir_late(dev, &mut nir, &mut args);
 
         if let Some(cache) = cache {
@@ -861,6 +1034,89 @@ impl Kernel {
         }
     }
 
+    fn specialization_key(
+        &self,
+        dev_state: &KernelDevStateInner,
+        block: &[u32; 3],
+    ) -> Option<KernelSpecialization> {
+        let args: Vec<_> = self
+            .build
+            .args
+            .iter()
+            .zip(&self.values)
+            .enumerate()
+            .filter(|(_, (arg, _))| {
+                !arg.dead
+                    && arg.kind == KernelArgType::Constant
+                    && arg.size <= MAX_SPECIALIZED_ARG_SIZE
+            })
+            .filter_map(|(idx, (_, val))| match val.borrow().as_ref() {
+                Some(KernelArgValue::Constant(c)) => Some((idx as u32, c.clone())),
+                _ => None,
+            })
+            .collect();
+
+        let block = if dev_state.nir.workgroup_size_variable() {
+            Some([block[0] as u16, block[1] as u16, block[2] as u16])
+        } else {
+            None
+        };
+
+        if args.is_empty() && block.is_none() {
+            return None;
+        }
+
+        Some(KernelSpecialization {
+            args: args,
+            block: block,
+        })
+    }
+
+    /// Returns a variant of the kernel compiled for the current argument values and local size,
+    /// once the kernel got launched with those often enough.
+    fn specialized_variant(
+        &self,
+        dev: &'static Device,
+        dev_state: &KernelDevStateInner,
+        block: &[u32; 3],
+    ) -> Option<Arc<KernelVariant>> {
+        if Platform::dbg().no_spec {
+            return None;
+        }
+
+        let key = self.specialization_key(dev_state, block)?;
+
+        {
+            let mut specs = dev_state.specializations.lock().unwrap();
+
+            if let Some(variant) = specs.variants.get(&key) {
+                return variant.clone();
+            }
+
+            if specs.variants.len() >= MAX_SPECIALIZED_VARIANTS || !specs.count_launch(&key) {
+                return None;
+            }
+
+            // Other launches keep using the generic kernel until the variant is ready.
+            specs.variants.insert(key.clone(), None);
+        }
+
+        let variant = KernelVariant::new(dev, self.prog.specialize_kernel(&self.name, dev, &key));
+
+        // Folding the arguments can change the register usage, so check the limits of the
+        // compiled variant and not the ones of the generic kernel.
+        let threads: u32 = block.iter().product();
+        let variant = (threads <= variant.info.max_threads).then(|| Arc::new(variant));
+
+        dev_state
+            .specializations
+            .lock()
+            .unwrap()
+            .variants
+            .insert(key, variant.clone());
+        variant
+    }
+
     // the painful part is, that host threads are allowed to modify the kernel object once it was
     // enqueued, so return a closure with all req data included.
     pub fn launch(
@@ -877,9 +1133,6 @@ impl Kernel {
         let offsets = create_kernel_arr::<u64>(offsets, 0);
         let mut input: Vec<u8> = Vec::new();
         let mut resource_info = Vec::new();
-        // Set it once so we get the alignment padding right
-        let static_local_size: u64 = dev_state.nir.shared_size() as u64;
-        let mut variable_local_size: u64 = static_local_size;
         let printf_size = q.device.printf_buffer_size() as u32;
         let mut samplers = Vec::new();
         let mut iviews = Vec::new();
@@ -896,7 +1149,22 @@ impl Kernel {
 
         self.optimize_local_size(q.device, &mut grid, &mut block);
 
-        for (arg, val) in self.build.args.iter().zip(&self.values) {
+        let variant = self.specialized_variant(q.device, dev_state, &block);
+        let (nir, args, internal_args, constant_buffer) = match &variant {
+            Some(v) => (&v.nir, &v.args, &v.internal_args, &v.constant_buffer),
+            None => (
+                dev_state.nir.as_ref(),
+                &self.build.args,
+                &self.build.internal_args,
+                &dev_state.constant_buffer,
+            ),
+        };
+
+        // Set it once so we get the alignment padding right
+        let static_local_size: u64 = nir.shared_size() as u64;
+        let mut variable_local_size: u64 = static_local_size;
+
+        for (arg, val) in args.iter().zip(&self.values) {
             if arg.dead {
                 continue;
             }
@@ -980,18 +1248,18 @@ impl Kernel {
         }
 
         // subtract the shader local_size as we only request something on top of that.
-        variable_local_size -= dev_state.nir.shared_size() as u64;
+        variable_local_size -= static_local_size;
 
         let mut printf_buf = None;
-        for arg in &self.build.internal_args {
+        for arg in internal_args {
             if arg.offset > input.len() {
                 input.resize(arg.offset, 0);
             }
             match arg.kind {
                 InternalKernelArgType::ConstantBuffer => {
-                    assert!(dev_state.constant_buffer.is_some());
+                    assert!(constant_buffer.is_some());
                     input.extend_from_slice(null_ptr);
-                    resource_info.push((dev_state.constant_buffer.clone().unwrap(), arg.offset));
+                    resource_info.push((constant_buffer.clone().unwrap(), arg.offset));
                 }
                 InternalKernelArgType::GlobalWorkOffsets => {
                     if q.device.address_bits() == 64 {
@@ -1039,10 +1307,14 @@ impl Kernel {
         let k = Arc::clone(self);
         Ok(Box::new(move |q, ctx| {
             let dev_state = k.dev_state.get(q.device);
+            let (nir, shared_cso) = match &variant {
+                Some(v) => (&v.nir, v.cso),
+                None => (dev_state.nir.as_ref(), dev_state.cso),
+            };
             let mut input = input.clone();
             let mut resources = Vec::with_capacity(resource_info.len());
             let mut globals: Vec<*mut u32> = Vec::new();
-            let printf_format = dev_state.nir.printf_format();
+            let printf_format = nir.printf_format();
 
             let mut sviews: Vec<_> = sviews
                 .iter()
@@ -1068,10 +1340,10 @@ impl Kernel {
                 );
             }
 
-            let cso = if dev_state.cso.is_null() {
-                ctx.create_compute_state(&dev_state.nir, static_local_size as u32)
+            let cso = if shared_cso.is_null() {
+                ctx.create_compute_state(nir, static_local_size as u32)
             } else {
-                dev_state.cso
+                shared_cso
             };
 
             ctx.bind_compute_state(cso);
@@ -1089,7 +1361,7 @@ impl Kernel {
             ctx.clear_sampler_states(samplers.len() as u32);
 
             ctx.bind_compute_state(ptr::null_mut());
-            if dev_state.cso.is_null() {
+            if shared_cso.is_null() {
                 ctx.delete_compute_state(cso);
             }
 
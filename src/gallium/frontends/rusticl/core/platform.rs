@@ -19,6 +19,7 @@ pub struct Platform {
 pub struct PlatformDebug {
     pub allow_invalid_spirv: bool,
     pub clc: bool,
+    pub no_spec: bool,
     pub program: bool,
 }
 
@@ -60,6 +61,7 @@ static mut PLATFORM: Platform = Platform {
 static mut PLATFORM_DBG: PlatformDebug = PlatformDebug {
     allow_invalid_spirv: false,
     clc: false,
+    no_spec: false,
     program: false,
 };
 static mut PLATFORM_FEATURES: PlatformFeatures = PlatformFeatures {
@@ -74,6 +76,7 @@ fn load_env() {
             match flag {
                 "allow_invalid_spirv" => debug.allow_invalid_spirv = true,
                 "clc" => debug.clc = true,
+                "nospec" => debug.no_spec = true,
                 "program" => debug.program = true,
                 _ => eprintln!("Unknown RUSTICL_DEBUG flag found: {}", flag),
             }
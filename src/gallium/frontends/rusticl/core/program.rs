@@ -120,7 +120,8 @@ impl ProgramBuild {
 
             // TODO: we could run this in parallel?
             for d in self.devs_with_build() {
-                let (nir, args, internal_args) = convert_spirv_to_nir(self, kernel_name, &args, d);
+                let (nir, args, internal_args) =
+                    convert_spirv_to_nir(self, kernel_name, &args, d, None);
                 let attributes_string = self.attribute_str(kernel_name, d);
                 nirs.insert(d, Arc::new(nir));
                 args_set.insert(args);
@@ -171,7 +172,12 @@ impl ProgramBuild {
             .collect()
     }
 
-    pub fn hash_key(&self, dev: &Device, name: &str) -> Option<cache_key> {
+    pub fn hash_key(
+        &self,
+        dev: &Device,
+        name: &str,
+        spec: Option<&KernelSpecialization>,
+    ) -> Option<cache_key> {
         if let Some(cache) = dev.screen().shader_cache() {
             let info = self.dev_build(dev);
             assert_eq!(info.status, CL_BUILD_SUCCESS as cl_build_status);
@@ -188,6 +194,10 @@ impl ProgramBuild {
                 }
             }
 
+            if let Some(spec) = spec {
+                bin.append(&mut spec.serialize());
+            }
+
             Some(cache.gen_key(&bin))
         } else {
             None
@@ -419,6 +429,17 @@ impl Program {
         info.kernel_builds.get(name).unwrap().clone()
     }
 
+    pub fn specialize_kernel(
+        &self,
+        name: &str,
+        dev: &Device,
+        spec: &KernelSpecialization,
+    ) -> (NirShader, Vec<KernelArg>, Vec<InternalKernelArg>) {
+        let info = self.build_info();
+        let args = info.args(dev, name);
+        convert_spirv_to_nir(&info, name, &args, dev, Some(spec))
+    }
+
     pub fn status(&self, dev: &Device) -> cl_build_status {
         self.build_info().dev_build(dev).status
     }
@@ -149,7 +149,7 @@ impl SPIRVBin {
         let logger = create_clc_logger(&mut msgs);
         let mut out = clc_binary::default();
 
-        let res = unsafe { clc_compile_c_to_spirv(&args, &logger, &mut out) };
+        let res = unsafe { clc_compile_c_to_spirv(&args, &logger, ptr::null_mut(), &mut out) };
 
         let res = if res {
             let spirv = SPIRVBin {
@@ -200,6 +200,16 @@ impl NirShader {
         unsafe { (*self.nir.as_ptr()).info.num_subgroups }
     }
 
+    pub fn workgroup_size_variable(&self) -> bool {
+        unsafe { (*self.nir.as_ptr()).info.workgroup_size_variable() }
+    }
+
+    pub fn set_workgroup_size(&mut self, size: &[u16; 3]) {
+        let nir = unsafe { self.nir.as_mut() };
+        nir.info.workgroup_size = *size;
+        nir.info.set_workgroup_size_variable(false);
+    }
+
     pub fn set_workgroup_size_variable_if_zero(&self) {
         let nir = self.nir.as_ptr();
         unsafe {
@@ -141,3 +141,86 @@ rusticl_lower_inputs(nir_shader *shader)
    shader->info.first_ubo_is_default_ubo = true;
    return progress;
 }
+
+struct rusticl_specialize_state {
+   const struct rusticl_spec_arg *args;
+   uint32_t count;
+};
+
+static bool
+rusticl_specialize_args_filter(const nir_instr *instr, const void *_)
+{
+   if (instr->type != nir_instr_type_intrinsic)
+      return false;
+
+   nir_intrinsic_instr *intrins = nir_instr_as_intrinsic(instr);
+   if (intrins->intrinsic != nir_intrinsic_load_deref)
+      return false;
+
+   nir_deref_instr *deref = nir_src_as_deref(intrins->src[0]);
+   return deref->deref_type == nir_deref_type_var &&
+          nir_deref_mode_is(deref, nir_var_uniform) &&
+          glsl_type_is_vector_or_scalar(deref->type);
+}
+
+static nir_ssa_def*
+rusticl_specialize_args_instr(struct nir_builder *b, nir_instr *instr, void *_state)
+{
+   nir_intrinsic_instr *intrins = nir_instr_as_intrinsic(instr);
+   const struct rusticl_specialize_state *state = _state;
+   nir_variable *var = nir_intrinsic_get_var(intrins, 0);
+   const struct rusticl_spec_arg *arg = NULL;
+
+   for (uint32_t i = 0; i < state->count; i++) {
+      if (state->args[i].location == var->data.location) {
+         arg = &state->args[i];
+         break;
+      }
+   }
+
+   unsigned num_components = intrins->dest.ssa.num_components;
+   unsigned bit_size = intrins->dest.ssa.bit_size;
+   if (!arg || bit_size < 8 || num_components * bit_size / 8 > arg->size)
+      return NULL;
+
+   nir_const_value values[NIR_MAX_VEC_COMPONENTS];
+   const uint8_t *data = arg->data;
+   for (unsigned c = 0; c < num_components; c++) {
+      const uint8_t *comp = data + c * bit_size / 8;
+      switch (bit_size) {
+      case 8:
+         memcpy(&values[c].u8, comp, 1);
+         break;
+      case 16:
+         memcpy(&values[c].u16, comp, 2);
+         break;
+      case 32:
+         memcpy(&values[c].u32, comp, 4);
+         break;
+      case 64:
+         memcpy(&values[c].u64, comp, 8);
+         break;
+      default:
+         unreachable("invalid kernel argument bit size");
+      }
+   }
+
+   return nir_build_imm(b, num_components, bit_size, values);
+}
+
+/* Replaces loads of the given by-value kernel arguments with their values */
+bool
+rusticl_specialize_args(nir_shader *nir, const struct rusticl_spec_arg *args, uint32_t count)
+{
+   struct rusticl_specialize_state state = {
+      .args = args,
+      .count = count,
+   };
+
+   return nir_shader_lower_instructions(
+      nir,
+      rusticl_specialize_args_filter,
+      rusticl_specialize_args_instr,
+      &state
+   );
+}
@@ -7,5 +7,13 @@ struct rusticl_lower_state {
     nir_variable *work_dim;
 };
 
+struct rusticl_spec_arg {
+    /* the location of the kernel argument variable */
+    uint32_t location;
+    uint32_t size;
+    const void *data;
+};
+
 bool rusticl_lower_intrinsics(nir_shader *nir, struct rusticl_lower_state *state);
 bool rusticl_lower_inputs(nir_shader *nir);
+bool rusticl_specialize_args(nir_shader *nir, const struct rusticl_spec_arg *args, uint32_t count);
@@ -498,7 +498,7 @@ vlVaGetImage(VADriverContextP ctx, VASurfaceID surface, int x, int y,
    VAImage *vaimage;
    struct pipe_resource *view_resources[VL_NUM_COMPONENTS];
    enum pipe_format format;
-   bool convert = false;
+   bool convert = false, narrow = false;
    uint8_t *data[3];
    unsigned pitches[3], i, j;
 
@@ -551,19 +551,18 @@ vlVaGetImage(VADriverContextP ctx, VASurfaceID surface, int x, int y,
 
 
    if (format != surf->buffer->buffer_format) {
-      /* support NV12 to YV12 and IYUV conversion now only */
-      if ((format == PIPE_FORMAT_YV12 &&
-         surf->buffer->buffer_format == PIPE_FORMAT_NV12) ||
-         (format == PIPE_FORMAT_IYUV &&
-         surf->buffer->buffer_format == PIPE_FORMAT_NV12))
+      bool is_16bit = surf->buffer->buffer_format == PIPE_FORMAT_P010 ||
+                      surf->buffer->buffer_format == PIPE_FORMAT_P016;
+
+      /* support NV12, P010 and P016 to YV12 and IYUV conversion, and P010
+       * and P016 to NV12 conversion now only */
+      if ((format == PIPE_FORMAT_YV12 || format == PIPE_FORMAT_IYUV) &&
+          (surf->buffer->buffer_format == PIPE_FORMAT_NV12 || is_16bit)) {
          convert = true;
-      else if (format == PIPE_FORMAT_NV12 &&
-         (surf->buffer->buffer_format == PIPE_FORMAT_P010 ||
-          surf->buffer->buffer_format == PIPE_FORMAT_P016)) {
-         mtx_unlock(&drv->mutex);
-         return VA_STATUS_ERROR_OPERATION_FAILED;
-      }
-      else {
+         narrow = is_16bit;
+      } else if (format == PIPE_FORMAT_NV12 && is_16bit) {
+         narrow = true;
+      } else {
          mtx_unlock(&drv->mutex);
          return VA_STATUS_ERROR_OPERATION_FAILED;
       }
@@ -609,10 +608,18 @@ vlVaGetImage(VADriverContextP ctx, VASurfaceID surface, int x, int y,
             return VA_STATUS_ERROR_OPERATION_FAILED;
          }
 
-         if (i == 1 && convert) {
+         if (i == 1 && convert && narrow) {
+            u_copy_p016_to_yv12((void *const *)data, pitches, i, j,
+               transfer->stride, view_resources[i]->array_size,
+               map, box.width, box.height);
+         } else if (i == 1 && convert) {
             u_copy_nv12_to_yv12((void *const *)data, pitches, i, j,
                transfer->stride, view_resources[i]->array_size,
                map, box.width, box.height);
+         } else if (narrow) {
+            u_copy_p016_to_nv12((void *const *)data, pitches, i, j,
+               transfer->stride, view_resources[i]->array_size,
+               map, box.width, box.height);
          } else {
             util_copy_rect((uint8_t*)(data[i] + pitches[i] * j),
                view_resources[i]->format,
@@ -308,3 +308,63 @@ TEST(OSMesaRenderTest, resize)
       EXPECT_EQ(draw2[i], be_bswap32(0x0000ff00));
    EXPECT_EQ(draw1[0], be_bswap32(0x000000ff));
 }
+
+/* A buffer llvmpipe can render to directly, so Y_UP has to be handled by the
+ * framebuffer orientation rather than when copying.
+ */
+TEST(OSMesaRenderTest, y_up)
+{
+   std::unique_ptr<osmesa_context, decltype(&OSMesaDestroyContext)> ctx{
+      OSMesaCreateContext(GL_RGBA, NULL), &OSMesaDestroyContext};
+   ASSERT_TRUE(ctx);
+
+   const int w = 16, h = 4;
+   alignas(64) uint32_t pixels[w * h];
+
+   ASSERT_EQ(OSMesaMakeCurrent(ctx.get(), pixels, GL_UNSIGNED_BYTE, w, h), GL_TRUE);
+
+   for (int y_up = 1; y_up >= 0; y_up--) {
+      OSMesaPixelStore(OSMESA_Y_UP, y_up);
+
+      glDisable(GL_SCISSOR_TEST);
+      glClearColor(1.0, 0.0, 0.0, 0.0);
+      glClear(GL_COLOR_BUFFER_BIT);
+
+      /* Clear the bottom row */
+      glEnable(GL_SCISSOR_TEST);
+      glScissor(0, 0, w, 1);
+      glClearColor(0.0, 1.0, 0.0, 0.0);
+      glClear(GL_COLOR_BUFFER_BIT);
+      glFinish();
+
+      unsigned bottom = y_up ? 0 : h - 1;
+      for (unsigned y = 0; y < h; y++) {
+         for (unsigned x = 0; x < w; x++) {
+            EXPECT_EQ(pixels[y * w + x],
+                      be_bswap32(y == bottom ? 0x0000ff00 : 0x000000ff));
+         }
+      }
+
+      /* Reads are in GL order whatever the orientation */
+      uint32_t row[w];
+      glReadPixels(0, 0, w, 1, GL_RGBA, GL_UNSIGNED_BYTE, row);
+      for (unsigned x = 0; x < w; x++)
+         EXPECT_EQ(row[x], be_bswap32(0x0000ff00));
+
+      /* Geometry goes through the viewport transform, draw the top half */
+      glDisable(GL_SCISSOR_TEST);
+      glClearColor(1.0, 0.0, 0.0, 0.0);
+      glClear(GL_COLOR_BUFFER_BIT);
+      glColor4f(0.0, 1.0, 0.0, 0.0);
+      glRectf(-1.0, 0.0, 1.0, 1.0);
+      glFinish();
+
+      for (unsigned y = 0; y < h; y++) {
+         bool top = y_up ? y >= h / 2 : y < h / 2;
+         for (unsigned x = 0; x < w; x++) {
+            EXPECT_EQ(pixels[y * w + x],
+                      be_bswap32(top ? 0x0000ff00 : 0x000000ff));
+         }
+      }
+   }
+}
@@ -0,0 +1,234 @@
+/*
+ * Checks that tgsi_exec's pre-decoded instruction path computes exactly
+ * what the opcode switch does, and reports the throughput of both on a
+ * few representative vertex and fragment shaders.
+ *
+ * Usage: tgsi_exec_test [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+
+struct test_shader {
+   const char *name;
+   enum pipe_shader_type type;
+   unsigned num_inputs;
+   unsigned num_outputs;
+   const char *text;
+};
+
+static const struct test_shader shaders[] = {
+   {
+      "vs transform + lighting", PIPE_SHADER_VERTEX, 2, 3,
+      "VERT\n"
+      "DCL IN[0]\n"
+      "DCL IN[1]\n"
+      "DCL OUT[0], POSITION\n"
+      "DCL OUT[1], COLOR\n"
+      "DCL OUT[2], GENERIC[0]\n"
+      "DCL CONST[0][0..7]\n"
+      "DCL TEMP[0..2]\n"
+      "IMM[0] FLT32 {    0.0000,     1.0000,     0.5000,    16.0000}\n"
+      "  0: MUL TEMP[0], IN[0].xxxx, CONST[0][0]\n"
+      "  1: MAD TEMP[0], IN[0].yyyy, CONST[0][1], TEMP[0]\n"
+      "  2: MAD TEMP[0], IN[0].zzzz, CONST[0][2], TEMP[0]\n"
+      "  3: MAD OUT[0], IN[0].wwww, CONST[0][3], TEMP[0]\n"
+      "  4: DP3 TEMP[1].x, IN[1], IN[1]\n"
+      "  5: RSQ TEMP[1].x, |TEMP[1].xxxx|\n"
+      "  6: MUL TEMP[1].xyz, IN[1], TEMP[1].xxxx\n"
+      "  7: DP3 TEMP[2].x, TEMP[1], CONST[0][4]\n"
+      "  8: DP3 TEMP[2].y, TEMP[1], CONST[0][5]\n"
+      "  9: MOV TEMP[2].w, IMM[0].wwww\n"
+      " 10: LIT TEMP[2], TEMP[2]\n"
+      " 11: MAD TEMP[0], CONST[0][6], TEMP[2].yyyy, CONST[0][7]\n"
+      " 12: MAD_SAT OUT[1], CONST[0][6], TEMP[2].zzzz, TEMP[0]\n"
+      " 13: ADD OUT[2], -IN[0].xyzw, IMM[0].yyyz\n"
+      " 14: END\n",
+   },
+   {
+      "fs procedural", PIPE_SHADER_FRAGMENT, 2, 1,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL IN[1], COLOR, COLOR\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL CONST[0][0..1]\n"
+      "DCL TEMP[0..2]\n"
+      "IMM[0] FLT32 {    0.5000,     2.0000,    -1.0000,     0.2500}\n"
+      "  0: MAD TEMP[0], IN[0], IMM[0].yyyy, IMM[0].zzzz\n"
+      "  1: DP3 TEMP[1].x, TEMP[0], TEMP[0]\n"
+      "  2: RSQ TEMP[1].x, |TEMP[1].xxxx|\n"
+      "  3: MUL TEMP[0].xyz, TEMP[0], TEMP[1].xxxx\n"
+      "  4: DP3_SAT TEMP[1].y, TEMP[0], CONST[0][0]\n"
+      "  5: FRC TEMP[2], IN[0]\n"
+      "  6: SLT TEMP[2], TEMP[2], IMM[0].xxxx\n"
+      "  7: LRP TEMP[2], TEMP[2].xxxx, IN[1], CONST[0][1]\n"
+      "  8: MUL TEMP[2].xyz, TEMP[2], TEMP[1].yyyy\n"
+      "  9: CMP TEMP[2].w, -TEMP[1].yyyy, IMM[0].wwww, IN[1].wwww\n"
+      " 10: MOV OUT[0], TEMP[2]\n"
+      " 11: END\n",
+   },
+   {
+      "fs integer + control flow", PIPE_SHADER_FRAGMENT, 1, 1,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0..1]\n"
+      "IMM[0] FLT32 {   16.0000,     0.0625,     1.0000,     0.0000}\n"
+      "IMM[1] UINT32 {15, 1, 3, 0}\n"
+      "  0: MUL TEMP[0], IN[0], IMM[0].xxxx\n"
+      "  1: F2U TEMP[0], TEMP[0]\n"
+      "  2: AND TEMP[1], TEMP[0], IMM[1].xxxx\n"
+      "  3: XOR TEMP[1].x, TEMP[1].xxxx, TEMP[1].yyyy\n"
+      "  4: AND TEMP[0].x, TEMP[1].xxxx, IMM[1].yyyy\n"
+      "  5: UIF TEMP[0].xxxx :7\n"
+      "  6:   SHL TEMP[1], TEMP[1], IMM[1].yyyy\n"
+      "  7: ELSE :9\n"
+      "  8:   USHR TEMP[1], TEMP[1], IMM[1].yyyy\n"
+      "  9: ENDIF\n"
+      " 10: U2F TEMP[1], TEMP[1]\n"
+      " 11: MUL_SAT OUT[0], TEMP[1], IMM[0].yyyy\n"
+      " 12: END\n",
+   },
+};
+
+static float
+rand_float(void)
+{
+   return (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+static struct tgsi_exec_machine *
+create_machine(const struct test_shader *shader,
+               const struct tgsi_token *tokens,
+               const struct tgsi_exec_consts_info *consts,
+               const struct tgsi_interp_coef *coefs,
+               bool predecode)
+{
+   struct tgsi_exec_machine *mach = tgsi_exec_machine_create(shader->type);
+
+   mach->DisablePredecode = !predecode;
+   tgsi_exec_machine_bind_shader(mach, tokens, NULL, NULL, NULL);
+   tgsi_exec_set_constant_buffers(mach, 1, consts);
+   mach->InterpCoefs = coefs;
+   return mach;
+}
+
+static void
+set_inputs(struct tgsi_exec_machine *mach, const struct test_shader *shader,
+           unsigned iter)
+{
+   unsigned i, c, q;
+
+   if (shader->type == PIPE_SHADER_FRAGMENT) {
+      for (q = 0; q < TGSI_QUAD_SIZE; q++) {
+         mach->QuadPos.xyzw[0].f[q] = (float)(iter % 64 + (q & 1));
+         mach->QuadPos.xyzw[1].f[q] = (float)(iter / 64 % 64 + (q >> 1));
+         mach->QuadPos.xyzw[2].f[q] = 0.5f;
+         mach->QuadPos.xyzw[3].f[q] = 1.0f;
+      }
+      return;
+   }
+
+   for (i = 0; i < shader->num_inputs; i++) {
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+         for (q = 0; q < TGSI_QUAD_SIZE; q++)
+            mach->Inputs[i].xyzw[c].f[q] =
+               (float)((iter * 7 + i * 5 + c * 3 + q) % 23) / 11.0f - 1.0f;
+      }
+   }
+}
+
+static int
+test_shader(const struct test_shader *shader, unsigned iterations)
+{
+   struct tgsi_token tokens[1024];
+   struct tgsi_exec_machine *mach[2];
+   struct tgsi_interp_coef coefs[PIPE_MAX_SHADER_INPUTS];
+   float constants[8][4];
+   struct tgsi_exec_consts_info consts = { constants, sizeof(constants) };
+   unsigned num_instructions;
+   int64_t elapsed[2];
+   unsigned i, j;
+   int ret = 0;
+
+   if (!tgsi_text_translate(shader->text, tokens, ARRAY_SIZE(tokens))) {
+      printf("%s: failed to translate shader\n", shader->name);
+      return 1;
+   }
+
+   for (i = 0; i < ARRAY_SIZE(constants); i++)
+      for (j = 0; j < 4; j++)
+         constants[i][j] = rand_float();
+
+   for (i = 0; i < ARRAY_SIZE(coefs); i++) {
+      for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
+         coefs[i].a0[j] = rand_float();
+         coefs[i].dadx[j] = rand_float() / 64.0f;
+         coefs[i].dady[j] = rand_float() / 64.0f;
+      }
+   }
+
+   for (i = 0; i < 2; i++)
+      mach[i] = create_machine(shader, tokens, &consts, coefs, i == 1);
+
+   /* Results first, bit for bit. */
+   for (i = 0; i < 1024; i++) {
+      for (j = 0; j < 2; j++) {
+         set_inputs(mach[j], shader, i);
+         tgsi_exec_machine_run(mach[j], 0);
+      }
+      if (memcmp(mach[0]->Outputs, mach[1]->Outputs,
+                 shader->num_outputs * sizeof(mach[0]->Outputs[0]))) {
+         printf("%s: pre-decoded output mismatch at iteration %u\n",
+                shader->name, i);
+         ret = 1;
+         break;
+      }
+   }
+
+   num_instructions = mach[0]->NumInstructions;
+
+   for (j = 0; j < 2; j++) {
+      int64_t start = os_time_get_nano();
+
+      for (i = 0; i < iterations; i++) {
+         set_inputs(mach[j], shader, i);
+         tgsi_exec_machine_run(mach[j], 0);
+      }
+      elapsed[j] = MAX2(os_time_get_nano() - start, 1);
+   }
+
+   printf("%-28s switch %8.2f Minst/s, pre-decoded %8.2f Minst/s (%.2fx)\n",
+          shader->name,
+          (double)num_instructions * iterations * 1e3 / elapsed[0],
+          (double)num_instructions * iterations * 1e3 / elapsed[1],
+          (double)elapsed[0] / elapsed[1]);
+
+   for (i = 0; i < 2; i++) {
+      tgsi_exec_machine_bind_shader(mach[i], NULL, NULL, NULL, NULL);
+      tgsi_exec_machine_destroy(mach[i]);
+   }
+
+   return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned iterations = argc > 1 ? atoi(argv[1]) : 20000;
+   int ret = 0;
+   unsigned i;
+
+   srand(0);
+
+   for (i = 0; i < ARRAY_SIZE(shaders); i++)
+      ret |= test_shader(&shaders[i], iterations);
+
+   printf(ret ? "Failure!\n" : "Success!\n");
+   return ret;
+}
@@ -391,21 +391,26 @@ static const __DRIkopperLoaderExtension kopperLoaderExtension = {
     .SetSurfaceCreateInfo   = kopperSetSurfaceCreateInfo,
 };
 
+extern const __DRIuseInvalidateExtension dri2UseInvalidate;
+extern const __DRIbackgroundCallableExtension driBackgroundCallable;
+
+/* driBackgroundCallable tells the driver whether Xlib may be called from
+ * other threads, which pipelined presents (SWRAST_PRESENT_BUFFERS) need.
+ */
 static const __DRIextension *loader_extensions_shm[] = {
    &swrastLoaderExtension_shm.base,
    &kopperLoaderExtension.base,
+   &driBackgroundCallable.base,
    NULL
 };
 
 static const __DRIextension *loader_extensions_noshm[] = {
    &swrastLoaderExtension.base,
    &kopperLoaderExtension.base,
+   &driBackgroundCallable.base,
    NULL
 };
 
-extern const __DRIuseInvalidateExtension dri2UseInvalidate;
-extern const __DRIbackgroundCallableExtension driBackgroundCallable;
-
 static const __DRIextension *kopper_extensions_noshm[] = {
    &swrastLoaderExtension.base,
    &kopperLoaderExtension.base,
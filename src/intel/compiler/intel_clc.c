@@ -447,7 +447,7 @@ int main(int argc, char **argv)
       struct clc_binary *spirv_out =
          util_dynarray_grow(&spirv_objs, struct clc_binary, 1);
 
-      if (!clc_compile_c_to_spirv(&clc_args, &logger, spirv_out)) {
+      if (!clc_compile_c_to_spirv(&clc_args, &logger, NULL, spirv_out)) {
          ralloc_free(mem_ctx);
          return 1;
       }
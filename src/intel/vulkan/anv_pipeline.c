@@ -27,7 +27,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 
-#include "util/mesa-sha1.h"
+#include "util/mesa-cache-key.h"
 #include "util/os_time.h"
 #include "common/intel_l3_config.h"
 #include "common/intel_disasm.h"
@@ -704,18 +704,18 @@ anv_graphics_pipeline_stage_fragment_dynamic(const struct anv_pipeline_stage *st
 }
 
 static void
-anv_pipeline_hash_common(struct mesa_sha1 *ctx,
+anv_pipeline_hash_common(struct mesa_cache_key_ctx *ctx,
                          const struct anv_pipeline *pipeline)
 {
    struct anv_device *device = pipeline->device;
 
-   _mesa_sha1_update(ctx, pipeline->layout.sha1, sizeof(pipeline->layout.sha1));
+   _mesa_cache_key_update(ctx, pipeline->layout.sha1, sizeof(pipeline->layout.sha1));
 
    const bool indirect_descriptors = device->physical->indirect_descriptors;
-   _mesa_sha1_update(ctx, &indirect_descriptors, sizeof(indirect_descriptors));
+   _mesa_cache_key_update(ctx, &indirect_descriptors, sizeof(indirect_descriptors));
 
    const bool rba = device->robust_buffer_access;
-   _mesa_sha1_update(ctx, &rba, sizeof(rba));
+   _mesa_cache_key_update(ctx, &rba, sizeof(rba));
 }
 
 static void
@@ -725,27 +725,27 @@ anv_pipeline_hash_graphics(struct anv_graphics_base_pipeline *pipeline,
                            unsigned char *sha1_out)
 {
    const struct anv_device *device = pipeline->base.device;
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
 
    anv_pipeline_hash_common(&ctx, &pipeline->base);
 
-   _mesa_sha1_update(&ctx, &view_mask, sizeof(view_mask));
+   _mesa_cache_key_update(&ctx, &view_mask, sizeof(view_mask));
 
    for (uint32_t s = 0; s < ANV_GRAPHICS_SHADER_STAGE_COUNT; s++) {
       if (pipeline->base.active_stages & BITFIELD_BIT(s)) {
-         _mesa_sha1_update(&ctx, stages[s].shader_sha1,
-                           sizeof(stages[s].shader_sha1));
-         _mesa_sha1_update(&ctx, &stages[s].key, brw_prog_key_size(s));
+         _mesa_cache_key_update(&ctx, stages[s].shader_sha1,
+                                sizeof(stages[s].shader_sha1));
+         _mesa_cache_key_update(&ctx, &stages[s].key, brw_prog_key_size(s));
       }
    }
 
    if (stages[MESA_SHADER_MESH].info || stages[MESA_SHADER_TASK].info) {
       const bool afs = device->physical->instance->assume_full_subgroups;
-      _mesa_sha1_update(&ctx, &afs, sizeof(afs));
+      _mesa_cache_key_update(&ctx, &afs, sizeof(afs));
    }
 
-   _mesa_sha1_final(&ctx, sha1_out);
+   _mesa_cache_key_final(&ctx, sha1_out);
 }
 
 static void
@@ -754,19 +754,19 @@ anv_pipeline_hash_compute(struct anv_compute_pipeline *pipeline,
                           unsigned char *sha1_out)
 {
    const struct anv_device *device = pipeline->base.device;
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
 
    anv_pipeline_hash_common(&ctx, &pipeline->base);
 
    const bool afs = device->physical->instance->assume_full_subgroups;
-   _mesa_sha1_update(&ctx, &afs, sizeof(afs));
+   _mesa_cache_key_update(&ctx, &afs, sizeof(afs));
 
-   _mesa_sha1_update(&ctx, stage->shader_sha1,
-                     sizeof(stage->shader_sha1));
-   _mesa_sha1_update(&ctx, &stage->key.cs, sizeof(stage->key.cs));
+   _mesa_cache_key_update(&ctx, stage->shader_sha1,
+                          sizeof(stage->shader_sha1));
+   _mesa_cache_key_update(&ctx, &stage->key.cs, sizeof(stage->key.cs));
 
-   _mesa_sha1_final(&ctx, sha1_out);
+   _mesa_cache_key_final(&ctx, sha1_out);
 }
 
 static void
@@ -774,15 +774,15 @@ anv_pipeline_hash_ray_tracing_shader(struct anv_ray_tracing_pipeline *pipeline,
                                      struct anv_pipeline_stage *stage,
                                      unsigned char *sha1_out)
 {
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
 
    anv_pipeline_hash_common(&ctx, &pipeline->base);
 
-   _mesa_sha1_update(&ctx, stage->shader_sha1, sizeof(stage->shader_sha1));
-   _mesa_sha1_update(&ctx, &stage->key, sizeof(stage->key.bs));
+   _mesa_cache_key_update(&ctx, stage->shader_sha1, sizeof(stage->shader_sha1));
+   _mesa_cache_key_update(&ctx, &stage->key, sizeof(stage->key.bs));
 
-   _mesa_sha1_final(&ctx, sha1_out);
+   _mesa_cache_key_final(&ctx, sha1_out);
 }
 
 static void
@@ -791,21 +791,21 @@ anv_pipeline_hash_ray_tracing_combined_shader(struct anv_ray_tracing_pipeline *p
                                               struct anv_pipeline_stage *any_hit,
                                               unsigned char *sha1_out)
 {
-   struct mesa_sha1 ctx;
-   _mesa_sha1_init(&ctx);
+   struct mesa_cache_key_ctx ctx;
+   _mesa_cache_key_init(&ctx);
 
-   _mesa_sha1_update(&ctx, pipeline->base.layout.sha1,
-                     sizeof(pipeline->base.layout.sha1));
+   _mesa_cache_key_update(&ctx, pipeline->base.layout.sha1,
+                          sizeof(pipeline->base.layout.sha1));
 
    const bool rba = pipeline->base.device->robust_buffer_access;
-   _mesa_sha1_update(&ctx, &rba, sizeof(rba));
+   _mesa_cache_key_update(&ctx, &rba, sizeof(rba));
 
-   _mesa_sha1_update(&ctx, intersection->shader_sha1, sizeof(intersection->shader_sha1));
-   _mesa_sha1_update(&ctx, &intersection->key, sizeof(intersection->key.bs));
-   _mesa_sha1_update(&ctx, any_hit->shader_sha1, sizeof(any_hit->shader_sha1));
-   _mesa_sha1_update(&ctx, &any_hit->key, sizeof(any_hit->key.bs));
+   _mesa_cache_key_update(&ctx, intersection->shader_sha1, sizeof(intersection->shader_sha1));
+   _mesa_cache_key_update(&ctx, &intersection->key, sizeof(intersection->key.bs));
+   _mesa_cache_key_update(&ctx, any_hit->shader_sha1, sizeof(any_hit->shader_sha1));
+   _mesa_cache_key_update(&ctx, &any_hit->key, sizeof(any_hit->key.bs));
 
-   _mesa_sha1_final(&ctx, sha1_out);
+   _mesa_cache_key_final(&ctx, sha1_out);
 }
 
 static nir_shader *
@@ -30,9 +30,11 @@
 #include "texcompress.h"
 #include "texcompress_bptc.h"
 #include "util/format/texcompress_bptc_tmp.h"
+#include "util/format/u_format_compress.h"
 #include "texstore.h"
 #include "image.h"
 #include "mtypes.h"
+#include "frontend/api.h"
 
 static void
 fetch_bptc_rgb_float(const GLubyte *map,
@@ -122,9 +124,64 @@ _mesa_get_bptc_fetch_func(mesa_format format)
    }
 }
 
+struct bptc_compress {
+   int width;
+   const uint8_t *pixels;
+   int rowstride;
+   uint8_t *dst;
+   int dst_rowstride;
+   int dst_block_rowstride;
+   int quality;
+   bool is_signed;
+};
+
+static void
+bptc_compress_init(struct bptc_compress *c,
+                   int width, const void *pixels, int rowstride,
+                   uint8_t *dst, int dst_rowstride)
+{
+   c->width = width;
+   c->pixels = pixels;
+   c->rowstride = rowstride;
+   c->dst = dst;
+   c->dst_rowstride = dst_rowstride;
+
+   /* Like compress_rgba_unorm(), which packs the rows of blocks together
+    * when the stride is too small.
+    */
+   if (dst_rowstride >= width * 4)
+      c->dst_block_rowstride = dst_rowstride;
+   else
+      c->dst_block_rowstride = DIV_ROUND_UP(width, BLOCK_SIZE) * BLOCK_BYTES;
+}
+
+static void
+compress_rgba_unorm_rows(void *data, unsigned y, unsigned height)
+{
+   const struct bptc_compress *c = data;
+
+   compress_rgba_unorm(c->width, height,
+                       c->pixels + y * c->rowstride, c->rowstride,
+                       c->dst + y / BLOCK_SIZE * c->dst_block_rowstride,
+                       c->dst_rowstride, c->quality);
+}
+
+static void
+compress_rgb_float_rows(void *data, unsigned y, unsigned height)
+{
+   const struct bptc_compress *c = data;
+
+   compress_rgb_float(c->width, height,
+                      (const float *) (c->pixels + y * c->rowstride),
+                      c->rowstride,
+                      c->dst + y / BLOCK_SIZE * c->dst_block_rowstride,
+                      c->dst_rowstride, c->is_signed);
+}
+
 GLboolean
 _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
 {
+   struct bptc_compress compress = { 0 };
    const GLubyte *pixels;
    const GLubyte *tempImage = NULL;
    int rowstride;
@@ -161,9 +218,11 @@ _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
                                          srcFormat, srcType);
    }
 
-   compress_rgba_unorm(srcWidth, srcHeight,
-                       pixels, rowstride,
-                       dstSlices[0], dstRowStride);
+   bptc_compress_init(&compress, srcWidth, pixels, rowstride,
+                      dstSlices[0], dstRowStride);
+   compress.quality = ctx->st_opts->texcompress_quality;
+   util_format_compress_rows(srcWidth, srcHeight, BLOCK_SIZE,
+                             compress_rgba_unorm_rows, &compress);
 
    free((void *) tempImage);
 
@@ -174,6 +233,7 @@ static GLboolean
 texstore_bptc_rgb_float(TEXSTORE_PARAMS,
                         bool is_signed)
 {
+   struct bptc_compress compress = { 0 };
    const float *pixels;
    const float *tempImage = NULL;
    int rowstride;
@@ -206,10 +266,11 @@ texstore_bptc_rgb_float(TEXSTORE_PARAMS,
                                          srcFormat, srcType);
    }
 
-   compress_rgb_float(srcWidth, srcHeight,
-                      pixels, rowstride,
-                      dstSlices[0], dstRowStride,
-                      is_signed);
+   bptc_compress_init(&compress, srcWidth, pixels, rowstride,
+                      dstSlices[0], dstRowStride);
+   compress.is_signed = is_signed;
+   util_format_compress_rows(srcWidth, srcHeight, BLOCK_SIZE,
+                             compress_rgb_float_rows, &compress);
 
    free((void *) tempImage);
 
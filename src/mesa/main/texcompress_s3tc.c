@@ -40,9 +40,63 @@
 #include "texstore.h"
 #include "format_unpack.h"
 #include "util/format_srgb.h"
+#include "util/format/u_format_compress.h"
 #include "util/format/u_format_s3tc.h"
 
 
+struct dxtn_compress {
+   GLint srccomps;
+   GLint width;
+   const GLubyte *pixels;
+   GLenum format;
+   GLubyte *dst;
+   GLint dstRowStride;
+   GLint dstBlockRowStride;
+};
+
+static void
+compress_dxtn_rows(void *data, unsigned y, unsigned height)
+{
+   const struct dxtn_compress *c = data;
+
+   tx_compress_dxtn(c->srccomps, c->width, height,
+                    c->pixels + y * c->width * c->srccomps, c->format,
+                    c->dst + y / 4 * c->dstBlockRowStride, c->dstRowStride);
+}
+
+/**
+ * Compress a tightly packed image, with the rows of blocks spread over
+ * threads for large images.
+ */
+static void
+compress_dxtn(GLint srccomps, GLint width, GLint height,
+              const GLubyte *pixels, GLenum format,
+              GLubyte *dst, GLint dstRowStride)
+{
+   const GLint blockBytes = (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ||
+                             format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ?
+                            8 : 16;
+   struct dxtn_compress c = {
+      .srccomps = srccomps,
+      .width = width,
+      .pixels = pixels,
+      .format = format,
+      .dst = dst,
+      .dstRowStride = dstRowStride,
+   };
+
+   /* Like tx_compress_dxtn(), which packs the rows of blocks together when
+    * the stride is too small.
+    */
+   if (dstRowStride >= width * blockBytes / 4)
+      c.dstBlockRowStride = dstRowStride;
+   else
+      c.dstBlockRowStride = DIV_ROUND_UP(width, 4) * blockBytes;
+
+   util_format_compress_rows(width, height, 4, compress_dxtn_rows, &c);
+}
+
+
 /**
  * Store user's image in rgb_dxt1 format.
  */
@@ -88,8 +142,8 @@ _mesa_texstore_rgb_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxt1(srccomps, srcWidth, srcHeight, pixels,
-                    dst, dstRowStride, 3);
+   compress_dxtn(srccomps, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGB_S3TC_DXT1_EXT, dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -144,7 +198,8 @@ _mesa_texstore_rgba_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxt1(4, srcWidth, srcHeight, pixels, dst, dstRowStride, 4);
+   compress_dxtn(4, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, dst, dstRowStride);
 
    free((void*) tempImage);
 
@@ -198,7 +253,8 @@ _mesa_texstore_rgba_dxt3(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxt3(4, srcWidth, srcHeight, pixels, dst, dstRowStride);
+   compress_dxtn(4, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -252,7 +308,8 @@ _mesa_texstore_rgba_dxt5(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxt5(4, srcWidth, srcHeight, pixels, dst, dstRowStride);
+   compress_dxtn(4, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, dst, dstRowStride);
 
    free((void *) tempImage);
 
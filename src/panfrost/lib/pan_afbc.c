@@ -24,6 +24,7 @@
  *   Alyssa Rosenzweig <alyssa.rosenzweig@collabora.com>
  */
 
+#include <string.h>
 #include "pan_texture.h"
 
 /* Arm FrameBuffer Compression (AFBC) is a lossless compression scheme natively
@@ -64,6 +65,11 @@
  * and the driver never needs to know the internal data. For edge cases where
  * the driver really does need to read/write from the AFBC resource, we
  * generate a linear staging buffer and use the GPU to blit AFBC<--->linear.
+ *
+ * The one exception is the subset of AFBC that does not involve the actual
+ * compression: solid colour superblocks and uncompressed subblocks. The CPU
+ * can produce and consume those directly, see pan_afbc_encode() and
+ * pan_afbc_decode() below.
  */
 
 static enum pipe_format
@@ -196,3 +202,443 @@ panfrost_afbc_can_tile(const struct panfrost_device *dev)
 {
    return (dev->arch >= 7);
 }
+
+/*
+ * CPU access to AFBC images.
+ *
+ * Each 16x16 superblock has a 16-byte header. Normally, the header holds the
+ * offset of the superblock payload from the start of the headers, followed by
+ * the 6-bit sizes of the 16 4x4 subblocks making up the payload. A size of 1
+ * denotes an uncompressed subblock, stored as 4 rows of 4 pixels. A payload
+ * offset of zero instead denotes a solid colour superblock, whose colour is
+ * in the second half of the header (zeroed headers are hence transparent
+ * black).
+ *
+ * The subblocks are stored in the following order within the payload:
+ *
+ *     2  1 14 15
+ *     3  0 13 12
+ *     4  7  8 11
+ *     5  6  9 10
+ *
+ * The CPU does not implement the actual compression, so it writes solid
+ * colour superblocks when allowed to and uncompressed payloads otherwise,
+ * and fails to decode superblocks with compressed subblocks. With sparse
+ * AFBC, each superblock has a slot the size of the uncompressed superblock
+ * in the body, in header order, so superblocks can be rewritten in place.
+ */
+
+#define AFBC_SUPERBLOCK_SIZE 16
+#define AFBC_SUBBLOCK_SIZE   4
+#define AFBC_TILE_SIZE       8
+
+struct pan_afbc_header {
+   union {
+      struct {
+         uint32_t payload_offset;
+         uint8_t subblock_sizes[12];
+      };
+
+      struct {
+         uint64_t zero;
+         uint64_t color;
+      } solid;
+   };
+};
+
+static_assert(sizeof(struct pan_afbc_header) == AFBC_HEADER_BYTES_PER_TILE,
+              "AFBC header size");
+
+/* Position of each subblock of the payload, in subblocks */
+static const uint8_t afbc_subblock_order[16][2] = {
+   {1, 1}, {1, 0}, {0, 0}, {0, 1}, {0, 2}, {0, 3}, {1, 3}, {1, 2},
+   {2, 2}, {2, 3}, {3, 3}, {3, 2}, {3, 1}, {2, 1}, {2, 0}, {3, 0},
+};
+
+/* Sixteen 6-bit sizes of 1, for fully uncompressed superblocks */
+static const uint8_t afbc_uncompressed_sizes[12] = {
+   0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04,
+};
+
+struct pan_afbc_cpu_surface {
+   uint8_t *headers;
+   unsigned blocksize;
+   unsigned width, height;
+   unsigned stride_sb;
+   uint32_t header_size;
+   uint32_t size;
+   bool tiled;
+   bool solid;
+};
+
+/*
+ * Check if the CPU can access an AFBC image. Only the layouts the CPU
+ * codec knows about are supported: sparse 16x16 superblocks with no colour
+ * transform and no block splitting, on 2D surfaces.
+ */
+bool
+pan_afbc_can_cpu_access(const struct pan_image_layout *layout)
+{
+   uint64_t modifier = layout->modifier;
+
+   if (!drm_is_afbc(modifier))
+      return false;
+
+   if ((modifier & AFBC_FORMAT_MOD_BLOCK_SIZE_MASK) !=
+       AFBC_FORMAT_MOD_BLOCK_SIZE_16x16)
+      return false;
+
+   if (!(modifier & AFBC_FORMAT_MOD_SPARSE) ||
+       (modifier & (AFBC_FORMAT_MOD_YTR | AFBC_FORMAT_MOD_SPLIT)))
+      return false;
+
+   /* 3D images have all their headers first, and solid colours must fit in
+    * the header.
+    */
+   return layout->dim != MALI_TEXTURE_DIMENSION_3D && layout->nr_samples == 1 &&
+          util_format_get_blocksize(layout->format) <= 8;
+}
+
+static struct pan_afbc_cpu_surface
+pan_afbc_cpu_surface(const struct pan_image_layout *layout, unsigned level,
+                     const void *headers)
+{
+   const struct pan_image_slice_layout *slice = &layout->slices[level];
+
+   assert(pan_afbc_can_cpu_access(layout));
+
+   return (struct pan_afbc_cpu_surface){
+      .headers = (uint8_t *)headers,
+      .blocksize = util_format_get_blocksize(layout->format),
+      .width = u_minify(layout->width, level),
+      .height = u_minify(layout->height, level),
+      .stride_sb = pan_afbc_stride_blocks(layout->modifier, slice->row_stride),
+      .header_size = slice->afbc.header_size,
+      .size = slice->afbc.header_size + slice->afbc.body_size,
+      .tiled = !!(layout->modifier & AFBC_FORMAT_MOD_TILED),
+      .solid = !!(layout->modifier & AFBC_FORMAT_MOD_SC),
+   };
+}
+
+/* Index of a superblock's header, which is also the index of its slot in the
+ * body. Tiled headers are grouped in 8x8 tiles of superblocks.
+ */
+static unsigned
+pan_afbc_superblock_index(const struct pan_afbc_cpu_surface *surf,
+                          unsigned sx, unsigned sy)
+{
+   if (!surf->tiled)
+      return sy * surf->stride_sb + sx;
+
+   unsigned tile_area = AFBC_TILE_SIZE * AFBC_TILE_SIZE;
+
+   return (sy / AFBC_TILE_SIZE) * surf->stride_sb * AFBC_TILE_SIZE +
+          (sx / AFBC_TILE_SIZE) * tile_area +
+          (sy % AFBC_TILE_SIZE) * AFBC_TILE_SIZE + (sx % AFBC_TILE_SIZE);
+}
+
+/* The headers may have been written by the GPU from untrusted data, so check
+ * that the payload is within the body of the level before reading it.
+ */
+static bool
+pan_afbc_header_is_decodable(const struct pan_afbc_cpu_surface *surf,
+                             const struct pan_afbc_header *header)
+{
+   const uint32_t superblock_size =
+      AFBC_SUPERBLOCK_SIZE * AFBC_SUPERBLOCK_SIZE * surf->blocksize;
+
+   if (header->payload_offset == 0)
+      return true;
+
+   if (header->payload_offset < surf->header_size ||
+       header->payload_offset > surf->size ||
+       surf->size - header->payload_offset < superblock_size)
+      return false;
+
+   return !memcmp(header->subblock_sizes, afbc_uncompressed_sizes,
+                  sizeof(afbc_uncompressed_sizes));
+}
+
+static bool
+pan_afbc_decode_superblock(const struct pan_afbc_cpu_surface *surf,
+                           const struct pan_afbc_header *header, uint8_t *dst,
+                           unsigned dst_stride)
+{
+   const unsigned bs = surf->blocksize;
+   const unsigned subblock_row = AFBC_SUBBLOCK_SIZE * bs;
+
+   if (header->payload_offset == 0) {
+      uint8_t row[AFBC_SUPERBLOCK_SIZE * 8];
+
+      for (unsigned x = 0; x < AFBC_SUPERBLOCK_SIZE; ++x)
+         memcpy(row + x * bs, &header->solid.color, bs);
+
+      for (unsigned y = 0; y < AFBC_SUPERBLOCK_SIZE; ++y)
+         memcpy(dst + y * dst_stride, row, AFBC_SUPERBLOCK_SIZE * bs);
+
+      return true;
+   }
+
+   if (!pan_afbc_header_is_decodable(surf, header))
+      return false;
+
+   const uint8_t *payload = surf->headers + header->payload_offset;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(afbc_subblock_order); ++i) {
+      uint8_t *out = dst + afbc_subblock_order[i][1] * AFBC_SUBBLOCK_SIZE *
+                              dst_stride +
+                     afbc_subblock_order[i][0] * subblock_row;
+
+      for (unsigned y = 0; y < AFBC_SUBBLOCK_SIZE; ++y) {
+         memcpy(out, payload, subblock_row);
+         out += dst_stride;
+         payload += subblock_row;
+      }
+   }
+
+   return true;
+}
+
+static bool
+pan_afbc_is_solid(const struct pan_afbc_cpu_surface *surf, const uint8_t *src,
+                  unsigned src_stride)
+{
+   const unsigned bs = surf->blocksize;
+   uint8_t row[AFBC_SUPERBLOCK_SIZE * 8];
+
+   for (unsigned x = 0; x < AFBC_SUPERBLOCK_SIZE; ++x)
+      memcpy(row + x * bs, src, bs);
+
+   for (unsigned y = 0; y < AFBC_SUPERBLOCK_SIZE; ++y) {
+      if (memcmp(src + y * src_stride, row, AFBC_SUPERBLOCK_SIZE * bs))
+         return false;
+   }
+
+   return true;
+}
+
+static void
+pan_afbc_encode_superblock(const struct pan_afbc_cpu_surface *surf,
+                           unsigned index, const uint8_t *src,
+                           unsigned src_stride)
+{
+   const unsigned bs = surf->blocksize;
+   const unsigned subblock_row = AFBC_SUBBLOCK_SIZE * bs;
+   const unsigned superblock_size =
+      AFBC_SUPERBLOCK_SIZE * AFBC_SUPERBLOCK_SIZE * bs;
+   struct pan_afbc_header header = {0};
+
+   if (surf->solid && pan_afbc_is_solid(surf, src, src_stride)) {
+      memcpy(&header.solid.color, src, bs);
+   } else {
+      uint32_t offset = surf->header_size + index * superblock_size;
+      uint8_t *payload = surf->headers + offset;
+
+      for (unsigned i = 0; i < ARRAY_SIZE(afbc_subblock_order); ++i) {
+         const uint8_t *in = src +
+                             afbc_subblock_order[i][1] * AFBC_SUBBLOCK_SIZE *
+                                src_stride +
+                             afbc_subblock_order[i][0] * subblock_row;
+
+         for (unsigned y = 0; y < AFBC_SUBBLOCK_SIZE; ++y) {
+            memcpy(payload, in, subblock_row);
+            in += src_stride;
+            payload += subblock_row;
+         }
+      }
+
+      header.payload_offset = offset;
+      memcpy(header.subblock_sizes, afbc_uncompressed_sizes,
+             sizeof(afbc_uncompressed_sizes));
+   }
+
+   memcpy(surf->headers + index * AFBC_HEADER_BYTES_PER_TILE, &header,
+          sizeof(header));
+}
+
+/* Intersection of the region of interest with a superblock, clamped to the
+ * image, in pixels relative to the superblock.
+ */
+struct pan_afbc_overlap {
+   unsigned x0, y0, x1, y1;
+
+   /* Whether the region covers all of the superblock within the image */
+   bool full;
+
+   /* Whether the whole superblock is within the image and region */
+   bool aligned;
+};
+
+static struct pan_afbc_overlap
+pan_afbc_overlap(const struct pan_afbc_cpu_surface *surf, unsigned sx,
+                 unsigned sy, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+   unsigned sb_x = sx * AFBC_SUPERBLOCK_SIZE, sb_y = sy * AFBC_SUPERBLOCK_SIZE;
+   unsigned sb_w = MIN2(AFBC_SUPERBLOCK_SIZE, surf->width - sb_x);
+   unsigned sb_h = MIN2(AFBC_SUPERBLOCK_SIZE, surf->height - sb_y);
+   struct pan_afbc_overlap o = {
+      .x0 = MAX2(x, sb_x) - sb_x,
+      .y0 = MAX2(y, sb_y) - sb_y,
+      .x1 = MIN2(x + w, sb_x + sb_w) - sb_x,
+      .y1 = MIN2(y + h, sb_y + sb_h) - sb_y,
+   };
+
+   o.full = o.x0 == 0 && o.y0 == 0 && o.x1 == sb_w && o.y1 == sb_h;
+   o.aligned = o.full && sb_w == AFBC_SUPERBLOCK_SIZE &&
+               sb_h == AFBC_SUPERBLOCK_SIZE;
+   return o;
+}
+
+#define foreach_superblock(x, y, w, h, sx, sy)                                 \
+   for (unsigned sy = (y) / AFBC_SUPERBLOCK_SIZE;                              \
+        sy <= ((y) + (h)-1) / AFBC_SUPERBLOCK_SIZE; ++sy)                      \
+      for (unsigned sx = (x) / AFBC_SUPERBLOCK_SIZE;                           \
+           sx <= ((x) + (w)-1) / AFBC_SUPERBLOCK_SIZE; ++sx)
+
+/*
+ * Check that a region of an AFBC surface can be written by pan_afbc_encode(),
+ * which requires the superblocks the region only partially covers to be
+ * decodable.
+ */
+bool
+pan_afbc_can_cpu_update(const struct pan_image_layout *layout, unsigned level,
+                        const void *headers, unsigned x, unsigned y,
+                        unsigned w, unsigned h)
+{
+   struct pan_afbc_cpu_surface surf =
+      pan_afbc_cpu_surface(layout, level, headers);
+
+   if (!w || !h)
+      return true;
+
+   foreach_superblock(x, y, w, h, sx, sy) {
+      if (pan_afbc_overlap(&surf, sx, sy, x, y, w, h).full)
+         continue;
+
+      const struct pan_afbc_header *header =
+         (const struct pan_afbc_header *)(surf.headers +
+                                          pan_afbc_superblock_index(&surf, sx, sy) *
+                                             AFBC_HEADER_BYTES_PER_TILE);
+
+      if (!pan_afbc_header_is_decodable(&surf, header))
+         return false;
+   }
+
+   return true;
+}
+
+/*
+ * Decode a region of an AFBC surface to a linear buffer. The region is
+ * specified in pixels, and `headers` points to the AFBC headers of the
+ * surface, followed by its body. Returns false if the region contains
+ * compressed superblocks, in which case the linear buffer is left partially
+ * written.
+ */
+bool
+pan_afbc_decode(const struct pan_image_layout *layout, unsigned level,
+                const void *headers, void *linear, unsigned linear_stride,
+                unsigned x, unsigned y, unsigned w, unsigned h)
+{
+   struct pan_afbc_cpu_surface surf =
+      pan_afbc_cpu_surface(layout, level, headers);
+   const unsigned bs = surf.blocksize;
+   uint8_t tmp[AFBC_SUPERBLOCK_SIZE * AFBC_SUPERBLOCK_SIZE * 8];
+
+   if (!w || !h)
+      return true;
+
+   foreach_superblock(x, y, w, h, sx, sy) {
+      struct pan_afbc_overlap o = pan_afbc_overlap(&surf, sx, sy, x, y, w, h);
+      unsigned index = pan_afbc_superblock_index(&surf, sx, sy);
+      const struct pan_afbc_header *header =
+         (const struct pan_afbc_header *)(surf.headers +
+                                          index * AFBC_HEADER_BYTES_PER_TILE);
+      uint8_t *dst = (uint8_t *)linear +
+                     (sy * AFBC_SUPERBLOCK_SIZE + o.y0 - y) * linear_stride +
+                     (sx * AFBC_SUPERBLOCK_SIZE + o.x0 - x) * bs;
+
+      if (o.aligned) {
+         if (!pan_afbc_decode_superblock(&surf, header, dst, linear_stride))
+            return false;
+
+         continue;
+      }
+
+      unsigned tmp_stride = AFBC_SUPERBLOCK_SIZE * bs;
+
+      if (!pan_afbc_decode_superblock(&surf, header, tmp, tmp_stride))
+         return false;
+
+      for (unsigned r = o.y0; r < o.y1; ++r) {
+         memcpy(dst + (r - o.y0) * linear_stride,
+                tmp + r * tmp_stride + o.x0 * bs, (o.x1 - o.x0) * bs);
+      }
+   }
+
+   return true;
+}
+
+/*
+ * Encode a region of a linear buffer to an AFBC surface, the counterpart of
+ * pan_afbc_decode(). pan_afbc_can_cpu_update() must hold for the region.
+ */
+void
+pan_afbc_encode(const struct pan_image_layout *layout, unsigned level,
+                void *headers, const void *linear, unsigned linear_stride,
+                unsigned x, unsigned y, unsigned w, unsigned h)
+{
+   struct pan_afbc_cpu_surface surf =
+      pan_afbc_cpu_surface(layout, level, headers);
+   const unsigned bs = surf.blocksize;
+   uint8_t tmp[AFBC_SUPERBLOCK_SIZE * AFBC_SUPERBLOCK_SIZE * 8];
+
+   if (!w || !h)
+      return;
+
+   foreach_superblock(x, y, w, h, sx, sy) {
+      struct pan_afbc_overlap o = pan_afbc_overlap(&surf, sx, sy, x, y, w, h);
+      unsigned index = pan_afbc_superblock_index(&surf, sx, sy);
+      const uint8_t *src = (const uint8_t *)linear +
+                           (sy * AFBC_SUPERBLOCK_SIZE + o.y0 - y) * linear_stride +
+                           (sx * AFBC_SUPERBLOCK_SIZE + o.x0 - x) * bs;
+
+      if (o.aligned) {
+         pan_afbc_encode_superblock(&surf, index, src, linear_stride);
+         continue;
+      }
+
+      /* Merge with the existing contents, unless the region covers all of the
+       * superblock within the image. The padding is undefined then, so make it
+       * a copy of the closest pixels to keep solid colour detection working.
+       */
+      unsigned tmp_stride = AFBC_SUPERBLOCK_SIZE * bs;
+
+      if (!o.full) {
+         ASSERTED bool ok = pan_afbc_decode_superblock(
+            &surf,
+            (const struct pan_afbc_header *)(surf.headers +
+                                             index * AFBC_HEADER_BYTES_PER_TILE),
+            tmp, tmp_stride);
+         assert(ok && "pan_afbc_can_cpu_update must be checked first");
+      }
+
+      for (unsigned r = o.y0; r < o.y1; ++r) {
+         memcpy(tmp + r * tmp_stride + o.x0 * bs,
+                src + (r - o.y0) * linear_stride, (o.x1 - o.x0) * bs);
+      }
+
+      if (o.full) {
+         for (unsigned r = 0; r < o.y1; ++r) {
+            for (unsigned c = o.x1; c < AFBC_SUPERBLOCK_SIZE; ++c)
+               memcpy(tmp + r * tmp_stride + c * bs,
+                      tmp + r * tmp_stride + (o.x1 - 1) * bs, bs);
+         }
+
+         for (unsigned r = o.y1; r < AFBC_SUPERBLOCK_SIZE; ++r)
+            memcpy(tmp + r * tmp_stride, tmp + (o.y1 - 1) * tmp_stride,
+                   tmp_stride);
+      }
+
+      pan_afbc_encode_superblock(&surf, index, tmp, tmp_stride);
+   }
+}
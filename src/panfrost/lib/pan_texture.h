@@ -176,6 +176,20 @@ bool panfrost_afbc_can_ytr(enum pipe_format format);
 
 bool panfrost_afbc_can_tile(const struct panfrost_device *dev);
 
+bool pan_afbc_can_cpu_access(const struct pan_image_layout *layout);
+
+bool pan_afbc_can_cpu_update(const struct pan_image_layout *layout,
+                             unsigned level, const void *headers, unsigned x,
+                             unsigned y, unsigned w, unsigned h);
+
+bool pan_afbc_decode(const struct pan_image_layout *layout, unsigned level,
+                     const void *headers, void *linear, unsigned linear_stride,
+                     unsigned x, unsigned y, unsigned w, unsigned h);
+
+void pan_afbc_encode(const struct pan_image_layout *layout, unsigned level,
+                     void *headers, const void *linear, unsigned linear_stride,
+                     unsigned x, unsigned y, unsigned w, unsigned h);
+
 /*
  * Represents the block size of a single plane. For AFBC, this represents the
  * superblock size. For u-interleaving, this represents the tile size.
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2023 Collabora, Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pan_texture.h"
+#include "util/os_time.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <vector>
+
+#define AFBC_SPARSE                                                            \
+   (AFBC_FORMAT_MOD_BLOCK_SIZE_16x16 | AFBC_FORMAT_MOD_SPARSE)
+
+static const uint64_t modifiers[] = {
+   DRM_FORMAT_MOD_ARM_AFBC(AFBC_SPARSE),
+   DRM_FORMAT_MOD_ARM_AFBC(AFBC_SPARSE | AFBC_FORMAT_MOD_SC),
+   DRM_FORMAT_MOD_ARM_AFBC(AFBC_SPARSE | AFBC_FORMAT_MOD_TILED |
+                           AFBC_FORMAT_MOD_SC),
+};
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_R8_UNORM,       PIPE_FORMAT_R8G8_UNORM,
+   PIPE_FORMAT_R5G6B5_UNORM,   PIPE_FORMAT_R8G8B8_UNORM,
+   PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_Z24_UNORM_S8_UINT,
+};
+
+struct afbc_image {
+   struct pan_image_layout layout;
+   std::vector<uint8_t> data;
+   unsigned bs;
+
+   afbc_image(uint64_t modifier, enum pipe_format format, unsigned width,
+              unsigned height)
+   {
+      layout = {};
+      layout.modifier = modifier;
+      layout.format = format;
+      layout.width = width;
+      layout.height = height;
+      layout.depth = 1;
+      layout.nr_samples = 1;
+      layout.dim = MALI_TEXTURE_DIMENSION_2D;
+      layout.nr_slices = 1;
+      layout.array_size = 1;
+
+      EXPECT_TRUE(pan_image_layout_init(&layout, NULL));
+      EXPECT_TRUE(pan_afbc_can_cpu_access(&layout));
+
+      /* Zeroed headers, as for a new resource */
+      data.resize(layout.data_size, 0);
+      bs = util_format_get_blocksize(format);
+   }
+
+   void *headers()
+   {
+      return data.data() + layout.slices[0].offset;
+   }
+};
+
+static std::vector<uint8_t>
+random_pixels(size_t size)
+{
+   std::vector<uint8_t> v(size);
+
+   for (size_t i = 0; i < size; ++i)
+      v[i] = rand();
+
+   return v;
+}
+
+TEST(AFBC, CPUAccess)
+{
+   struct pan_image_layout l = {};
+   l.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   l.dim = MALI_TEXTURE_DIMENSION_2D;
+   l.nr_samples = 1;
+
+   l.modifier = DRM_FORMAT_MOD_ARM_AFBC(AFBC_SPARSE);
+   EXPECT_TRUE(pan_afbc_can_cpu_access(&l));
+
+   l.modifier = DRM_FORMAT_MOD_ARM_AFBC(AFBC_SPARSE | AFBC_FORMAT_MOD_YTR);
+   EXPECT_FALSE(pan_afbc_can_cpu_access(&l));
+
+   l.modifier = DRM_FORMAT_MOD_ARM_AFBC(AFBC_FORMAT_MOD_BLOCK_SIZE_16x16);
+   EXPECT_FALSE(pan_afbc_can_cpu_access(&l));
+
+   l.modifier = DRM_FORMAT_MOD_ARM_AFBC(AFBC_FORMAT_MOD_BLOCK_SIZE_32x8 |
+                                        AFBC_FORMAT_MOD_SPARSE);
+   EXPECT_FALSE(pan_afbc_can_cpu_access(&l));
+
+   l.modifier = DRM_FORMAT_MOD_ARM_16X16_BLOCK_U_INTERLEAVED;
+   EXPECT_FALSE(pan_afbc_can_cpu_access(&l));
+
+   l.modifier = DRM_FORMAT_MOD_ARM_AFBC(AFBC_SPARSE);
+   l.dim = MALI_TEXTURE_DIMENSION_3D;
+   EXPECT_FALSE(pan_afbc_can_cpu_access(&l));
+}
+
+TEST(AFBC, ZeroedHeadersDecodeToZero)
+{
+   afbc_image img(modifiers[0], PIPE_FORMAT_R8G8B8A8_UNORM, 40, 20);
+   unsigned stride = 40 * img.bs;
+   std::vector<uint8_t> linear(stride * 20, 0xaa);
+
+   ASSERT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(), linear.data(),
+                               stride, 0, 0, 40, 20));
+
+   for (uint8_t v : linear)
+      ASSERT_EQ(v, 0);
+}
+
+TEST(AFBC, RoundTrip)
+{
+   const unsigned sizes[][2] = {{64, 64}, {37, 50}, {130, 17}, {1, 1}};
+
+   srand(0);
+
+   for (uint64_t modifier : modifiers) {
+      for (enum pipe_format format : formats) {
+         for (auto &size : sizes) {
+            unsigned w = size[0], h = size[1];
+            afbc_image img(modifier, format, w, h);
+            unsigned stride = w * img.bs;
+            std::vector<uint8_t> ref = random_pixels(stride * h);
+            std::vector<uint8_t> out(stride * h);
+
+            ASSERT_TRUE(pan_afbc_can_cpu_update(&img.layout, 0, img.headers(),
+                                                0, 0, w, h));
+            pan_afbc_encode(&img.layout, 0, img.headers(), ref.data(), stride,
+                            0, 0, w, h);
+            ASSERT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(),
+                                        out.data(), stride, 0, 0, w, h));
+
+            EXPECT_TRUE(ref == out)
+               << util_format_short_name(format) << " " << w << "x" << h
+               << " modifier " << std::hex << modifier;
+         }
+      }
+   }
+}
+
+TEST(AFBC, PartialUpdate)
+{
+   const unsigned w = 75, h = 45;
+   const unsigned regions[][4] = {
+      {5, 7, 20, 13}, {16, 16, 16, 16}, {60, 30, 15, 15}, {0, 44, 75, 1},
+   };
+
+   srand(1);
+
+   for (uint64_t modifier : modifiers) {
+      for (enum pipe_format format : formats) {
+         afbc_image img(modifier, format, w, h);
+         unsigned stride = w * img.bs;
+         std::vector<uint8_t> ref = random_pixels(stride * h);
+
+         pan_afbc_encode(&img.layout, 0, img.headers(), ref.data(), stride, 0,
+                         0, w, h);
+
+         for (auto &r : regions) {
+            unsigned rstride = r[2] * img.bs;
+            std::vector<uint8_t> update = random_pixels(rstride * r[3]);
+
+            for (unsigned y = 0; y < r[3]; ++y) {
+               memcpy(&ref[(r[1] + y) * stride + r[0] * img.bs],
+                      &update[y * rstride], rstride);
+            }
+
+            ASSERT_TRUE(pan_afbc_can_cpu_update(&img.layout, 0, img.headers(),
+                                                r[0], r[1], r[2], r[3]));
+            pan_afbc_encode(&img.layout, 0, img.headers(), update.data(),
+                            rstride, r[0], r[1], r[2], r[3]);
+
+            /* Read back both the region and the whole image */
+            std::vector<uint8_t> out(rstride * r[3]);
+            ASSERT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(),
+                                        out.data(), rstride, r[0], r[1], r[2],
+                                        r[3]));
+            EXPECT_TRUE(update == out);
+         }
+
+         std::vector<uint8_t> out(stride * h);
+         ASSERT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(), out.data(),
+                                     stride, 0, 0, w, h));
+         EXPECT_TRUE(ref == out) << util_format_short_name(format);
+      }
+   }
+}
+
+TEST(AFBC, SolidColour)
+{
+   afbc_image img(modifiers[1], PIPE_FORMAT_R8G8B8A8_UNORM, 48, 32);
+   unsigned stride = 48 * 4;
+   std::vector<uint8_t> linear(stride * 32);
+
+   for (unsigned i = 0; i < 48 * 32; ++i)
+      memcpy(&linear[i * 4], "\x12\x34\x56\x78", 4);
+
+   /* Break the uniformity of the last superblock */
+   linear[stride * 31 + 47 * 4] = 0;
+
+   pan_afbc_encode(&img.layout, 0, img.headers(), linear.data(), stride, 0, 0,
+                   48, 32);
+
+   uint32_t *headers = (uint32_t *)img.headers();
+
+   for (unsigned i = 0; i < 6; ++i) {
+      uint32_t *header = headers + i * 4;
+
+      if (i < 5) {
+         /* Solid: no payload, the colour is in the header */
+         EXPECT_EQ(header[0], 0);
+         EXPECT_EQ(header[1], 0);
+         EXPECT_EQ(header[2], 0x78563412);
+      } else {
+         EXPECT_NE(header[0], 0);
+      }
+   }
+
+   std::vector<uint8_t> out(stride * 32);
+   ASSERT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(), out.data(),
+                               stride, 0, 0, 48, 32));
+   EXPECT_TRUE(linear == out);
+}
+
+TEST(AFBC, CompressedSuperblocks)
+{
+   afbc_image img(modifiers[0], PIPE_FORMAT_R8G8B8A8_UNORM, 32, 16);
+   unsigned stride = 32 * 4;
+   std::vector<uint8_t> linear = random_pixels(stride * 16);
+
+   pan_afbc_encode(&img.layout, 0, img.headers(), linear.data(), stride, 0, 0,
+                   32, 16);
+
+   /* Pretend the GPU compressed the second superblock */
+   uint8_t *header = (uint8_t *)img.headers() + AFBC_HEADER_BYTES_PER_TILE;
+   header[4] = 0x3f;
+
+   std::vector<uint8_t> out(stride * 16);
+   EXPECT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(), out.data(),
+                               stride, 0, 0, 16, 16));
+   EXPECT_FALSE(pan_afbc_decode(&img.layout, 0, img.headers(), out.data(),
+                                stride, 0, 0, 32, 16));
+
+   /* It can only be replaced as a whole */
+   EXPECT_FALSE(pan_afbc_can_cpu_update(&img.layout, 0, img.headers(), 8, 0,
+                                        16, 16));
+   EXPECT_TRUE(pan_afbc_can_cpu_update(&img.layout, 0, img.headers(), 16, 0,
+                                       16, 16));
+   EXPECT_TRUE(pan_afbc_can_cpu_update(&img.layout, 0, img.headers(), 0, 0,
+                                       16, 8));
+}
+
+TEST(AFBC, CorruptPayloadOffsets)
+{
+   afbc_image img(modifiers[0], PIPE_FORMAT_R8G8B8A8_UNORM, 32, 16);
+   unsigned stride = 32 * 4;
+   std::vector<uint8_t> linear = random_pixels(stride * 16);
+   std::vector<uint8_t> out(stride * 16);
+
+   pan_afbc_encode(&img.layout, 0, img.headers(), linear.data(), stride, 0, 0,
+                   32, 16);
+
+   const struct pan_image_slice_layout *slice = &img.layout.slices[0];
+   uint32_t *header = (uint32_t *)img.headers() + 4;
+   uint32_t end = slice->afbc.header_size + slice->afbc.body_size;
+   uint32_t superblock_size = 16 * 16 * 4;
+
+   /* The last slot of the body is fine */
+   header[0] = end - superblock_size;
+   EXPECT_TRUE(pan_afbc_decode(&img.layout, 0, img.headers(), out.data(),
+                               stride, 0, 0, 32, 16));
+
+   /* Anything reaching past the level or into the headers is not */
+   const uint32_t bad_offsets[] = {
+      end - superblock_size + 1,
+      end,
+      UINT32_MAX - 16,
+      4,
+   };
+
+   for (uint32_t offset : bad_offsets) {
+      header[0] = offset;
+      EXPECT_FALSE(pan_afbc_decode(&img.layout, 0, img.headers(), out.data(),
+                                   stride, 0, 0, 32, 16));
+      EXPECT_FALSE(pan_afbc_can_cpu_update(&img.layout, 0, img.headers(), 8,
+                                           0, 16, 16));
+   }
+}
+
+/* Reference AFBC image written out byte by byte from the AFBC
+ * specification rather than produced by pan_afbc_encode(): a 32x16 R8
+ * image with an uncompressed superblock and a solid colour superblock.
+ *
+ * The payload of an uncompressed superblock is the sixteen 4x4 subblocks
+ * in the order below, each stored row by row. Filling the payload with
+ * 0..255 thus gives each pixel the value (subblock * 16) + (y * 4) + x.
+ */
+static const uint8_t afbc_reference_subblocks[4][4] = {
+   {2, 1, 14, 15},
+   {3, 0, 13, 12},
+   {4, 7, 8, 11},
+   {5, 6, 9, 10},
+};
+
+TEST(AFBC, ReferenceImage)
+{
+   afbc_image img(modifiers[1], PIPE_FORMAT_R8_UNORM, 32, 16);
+   uint32_t header_size = img.layout.slices[0].afbc.header_size;
+   std::vector<uint8_t> dump(img.data.size(), 0);
+   uint8_t *headers = dump.data() + img.layout.slices[0].offset;
+
+   const uint8_t reference_headers[2][AFBC_HEADER_BYTES_PER_TILE] = {
+      /* Payload at the start of the body, sixteen 6-bit sizes of 1 */
+      {(uint8_t)header_size, (uint8_t)(header_size >> 8), 0, 0, 0x41, 0x10,
+       0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04},
+      /* Solid colour 0x5a */
+      {0, 0, 0, 0, 0, 0, 0, 0, 0x5a, 0, 0, 0, 0, 0, 0, 0},
+   };
+
+   ASSERT_LT(header_size, 1u << 16);
+   memcpy(headers, reference_headers, sizeof(reference_headers));
+   for (unsigned i = 0; i < 256; ++i)
+      headers[header_size + i] = i;
+
+   std::vector<uint8_t> expected(32 * 16);
+   for (unsigned y = 0; y < 16; ++y) {
+      for (unsigned x = 0; x < 32; ++x) {
+         expected[y * 32 + x] =
+            x >= 16 ? 0x5a
+                    : afbc_reference_subblocks[y / 4][x / 4] * 16 +
+                         (y % 4) * 4 + (x % 4);
+      }
+   }
+
+   std::vector<uint8_t> out(32 * 16);
+   ASSERT_TRUE(pan_afbc_decode(&img.layout, 0, headers, out.data(), 32, 0, 0,
+                               32, 16));
+   EXPECT_TRUE(expected == out);
+
+   /* Encoding the decoded image gives back the reference bytes */
+   pan_afbc_encode(&img.layout, 0, img.headers(), expected.data(), 32, 0, 0,
+                   32, 16);
+   EXPECT_TRUE(img.data == dump);
+}
+
+/* Throughput of full-image encode and decode, run with
+ * --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+ */
+TEST(AFBC, DISABLED_Benchmark)
+{
+   const unsigned size = 1024, iterations = 20;
+
+   for (uint64_t modifier : modifiers) {
+      afbc_image img(modifier, PIPE_FORMAT_R8G8B8A8_UNORM, size, size);
+      unsigned stride = size * img.bs;
+      std::vector<uint8_t> linear = random_pixels(stride * size);
+
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < iterations; ++i) {
+         pan_afbc_encode(&img.layout, 0, img.headers(), linear.data(), stride,
+                         0, 0, size, size);
+      }
+      int64_t encode_ns = os_time_get_nano() - start;
+
+      start = os_time_get_nano();
+      for (unsigned i = 0; i < iterations; ++i) {
+         pan_afbc_decode(&img.layout, 0, img.headers(), linear.data(), stride,
+                         0, 0, size, size);
+      }
+      int64_t decode_ns = os_time_get_nano() - start;
+
+      double mb = (double)stride * size * iterations / (1024 * 1024);
+      printf("modifier %" PRIx64 ": encode %8.1f MB/s, decode %8.1f MB/s\n",
+             modifier, mb / (encode_ns / 1e9), mb / (decode_ns / 1e9));
+   }
+}
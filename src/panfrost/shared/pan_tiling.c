@@ -29,6 +29,7 @@
 #include <stdbool.h>
 #include "util/bitscan.h"
 #include "util/macros.h"
+#include "util/u_tiling.h"
 
 /*
  * This file implements software encode/decode of u-interleaved textures.
@@ -107,22 +108,8 @@ const unsigned space_4[16] = {
 
 #define TILE_WIDTH      16
 #define TILE_HEIGHT     16
-#define PIXELS_PER_TILE (TILE_WIDTH * TILE_HEIGHT)
-
-/* We need a 128-bit type for idiomatically tiling bpp128 formats. The type must
- * only support copies and sizeof, so emulating with a packed structure works
- * well enough, but if there's a native 128-bit type we may we well prefer
- * that. */
-
-#ifdef __SIZEOF_INT128__
-typedef __uint128_t pan_uint128_t;
-#else
-typedef struct {
-   uint64_t lo;
-   uint64_t hi;
-} __attribute__((packed)) pan_uint128_t;
-#endif
 
+/* Packed types for the non-power-of-two formats */
 typedef struct {
    uint16_t lo;
    uint8_t hi;
@@ -138,67 +125,6 @@ typedef struct {
    uint32_t hi;
 } __attribute__((packed)) pan_uint96_t;
 
-/* Optimized routine to tile an aligned (w & 0xF == 0) texture. Explanation:
- *
- * dest_start precomputes the offset to the beginning of the first horizontal
- * tile we're writing to, knowing that x is 16-aligned. Tiles themselves are
- * stored linearly, so we get the X tile number by shifting and then multiply
- * by the bytes per tile .
- *
- * We iterate across the pixels we're trying to store in source-order. For each
- * row in the destination image, we figure out which row of 16x16 block we're
- * in, by slicing off the lower 4-bits (block_y).
- *
- * dest then precomputes the location of the top-left corner of the block the
- * row starts in. In pixel coordinates (where the origin is the top-left),
- * (block_y, 0) is the top-left corner of the leftmost tile in this row.  While
- * pixels are reordered within a block, the blocks themselves are stored
- * linearly, so multiplying block_y by the pixel stride of the destination
- * image equals the byte offset of that top-left corner of the block this row
- * is in.
- *
- * On the other hand, the source is linear so we compute the locations of the
- * start and end of the row in the source by a simple linear addressing.
- *
- * For indexing within the tile, we need to XOR with the [y3 y3 y2 y2 y1 y1 y0
- * y0] value. Since this is constant across a row, we look it up per-row and
- * store in expanded_y.
- *
- * Finally, we iterate each row in source order. In the outer loop, we iterate
- * each 16 pixel tile. Within each tile, we iterate the 16 pixels (this should
- * be unrolled), calculating the index within the tile and writing.
- */
-
-#define TILED_ACCESS_TYPE(pixel_t, shift)                                      \
-   static ALWAYS_INLINE void panfrost_access_tiled_image_##pixel_t(            \
-      void *dst, void *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h,  \
-      uint32_t dst_stride, uint32_t src_stride, bool is_store)                 \
-   {                                                                           \
-      uint8_t *dest_start =                                                    \
-         dst + ((sx >> 4) * PIXELS_PER_TILE * sizeof(pixel_t));                \
-      for (int y = sy, src_y = 0; src_y < h; ++y, ++src_y) {                   \
-         uint8_t *dest = (uint8_t *)(dest_start + ((y >> 4) * dst_stride));    \
-         pixel_t *source = src + (src_y * src_stride);                         \
-         pixel_t *source_end = source + w;                                     \
-         unsigned expanded_y = bit_duplication[y & 0xF] << shift;              \
-         for (; source < source_end; dest += (PIXELS_PER_TILE << shift)) {     \
-            for (uint8_t i = 0; i < 16; ++i) {                                 \
-               unsigned index = expanded_y ^ (space_4[i] << shift);            \
-               if (is_store)                                                   \
-                  *((pixel_t *)(dest + index)) = *(source++);                  \
-               else                                                            \
-                  *(source++) = *((pixel_t *)(dest + index));                  \
-            }                                                                  \
-         }                                                                     \
-      }                                                                        \
-   }
-
-TILED_ACCESS_TYPE(uint8_t, 0);
-TILED_ACCESS_TYPE(uint16_t, 1);
-TILED_ACCESS_TYPE(uint32_t, 2);
-TILED_ACCESS_TYPE(uint64_t, 3);
-TILED_ACCESS_TYPE(pan_uint128_t, 4);
-
 #define TILED_UNALIGNED_TYPE(pixel_t, is_store, tile_shift)                    \
    {                                                                           \
       const unsigned mask = (1 << tile_shift) - 1;                             \
@@ -223,27 +149,18 @@ TILED_ACCESS_TYPE(pan_uint128_t, 4);
 
 #define TILED_UNALIGNED_TYPES(store, shift)                                    \
    {                                                                           \
-      if (bpp == 8)                                                            \
-         TILED_UNALIGNED_TYPE(uint8_t, store, shift)                           \
-      else if (bpp == 16)                                                      \
-         TILED_UNALIGNED_TYPE(uint16_t, store, shift)                          \
-      else if (bpp == 24)                                                      \
+      if (bpp == 24)                                                           \
          TILED_UNALIGNED_TYPE(pan_uint24_t, store, shift)                      \
-      else if (bpp == 32)                                                      \
-         TILED_UNALIGNED_TYPE(uint32_t, store, shift)                          \
       else if (bpp == 48)                                                      \
          TILED_UNALIGNED_TYPE(pan_uint48_t, store, shift)                      \
-      else if (bpp == 64)                                                      \
-         TILED_UNALIGNED_TYPE(uint64_t, store, shift)                          \
       else if (bpp == 96)                                                      \
          TILED_UNALIGNED_TYPE(pan_uint96_t, store, shift)                      \
-      else if (bpp == 128)                                                     \
-         TILED_UNALIGNED_TYPE(pan_uint128_t, store, shift)                     \
    }
 
 /*
- * Perform a generic access to a tiled image with a given format. This works
- * even for block-compressed images on entire blocks at a time. sx/sy/w/h are
+ * Perform a generic access to a tiled image with a given non-power-of-two
+ * format. This works even for block-compressed images on entire blocks at a
+ * time. sx/sy/w/h are
  * specified in pixels, not blocks, but our internal routines work in blocks,
  * so we divide here. Alignment is assumed.
  */
@@ -275,10 +192,12 @@ panfrost_access_tiled_image_generic(void *dst, void *src, unsigned sx,
    }
 }
 
-#define OFFSET(src, _x, _y)                                                    \
-   (void *)((uint8_t *)src + ((_y)-orig_y) * src_stride +                      \
-            (((_x)-orig_x) * (bpp / 8)))
-
+/*
+ * Power-of-two formats are handled by the shared SIMD tiling code, which
+ * implements the u-interleaved order with 16x16 tiles of pixels (or 4x4 tiles
+ * of blocks for block-compressed formats) and takes care of unaligned edges
+ * itself.
+ */
 static ALWAYS_INLINE void
 panfrost_access_tiled_image(void *dst, void *src, unsigned x, unsigned y,
                             unsigned w, unsigned h, uint32_t dst_stride,
@@ -296,89 +215,32 @@ panfrost_access_tiled_image(void *dst, void *src, unsigned x, unsigned y,
    assert((dst_stride % (bpp / 8)) == 0 && "unaligned destination stride");
    assert((src_stride % (bpp / 8)) == 0 && "unaligned source stride");
 
-   if (desc->block.width > 1 ||
-       !util_is_power_of_two_nonzero(desc->block.bits)) {
+   if (!util_is_power_of_two_nonzero(bpp)) {
       panfrost_access_tiled_image_generic(
          dst, (void *)src, x, y, w, h, dst_stride, src_stride, desc, is_store);
 
       return;
    }
 
-   unsigned first_full_tile_x = DIV_ROUND_UP(x, TILE_WIDTH) * TILE_WIDTH;
-   unsigned first_full_tile_y = DIV_ROUND_UP(y, TILE_HEIGHT) * TILE_HEIGHT;
-   unsigned last_full_tile_x = ((x + w) / TILE_WIDTH) * TILE_WIDTH;
-   unsigned last_full_tile_y = ((y + h) / TILE_HEIGHT) * TILE_HEIGHT;
-
-   /* First, tile the top portion */
+   bool compressed = desc->block.width > 1;
+   const struct util_tiling_layout layout = {
+      .mode = UTIL_TILING_U_INTERLEAVED,
+      .blocksize_B = bpp / 8,
+      .tile_width_el = compressed ? 4 : TILE_WIDTH,
+      .tile_height_el = compressed ? 4 : TILE_HEIGHT,
+      .tile_row_stride_B = dst_stride,
+   };
 
-   unsigned orig_x = x, orig_y = y;
-
-   if (first_full_tile_y != y) {
-      unsigned dist = MIN2(first_full_tile_y - y, h);
-
-      panfrost_access_tiled_image_generic(dst, OFFSET(src, x, y), x, y, w, dist,
-                                          dst_stride, src_stride, desc,
-                                          is_store);
-
-      if (dist == h)
-         return;
-
-      y += dist;
-      h -= dist;
-   }
-
-   /* Next, the bottom portion */
-   if (last_full_tile_y != (y + h)) {
-      unsigned dist = (y + h) - last_full_tile_y;
-
-      panfrost_access_tiled_image_generic(
-         dst, OFFSET(src, x, last_full_tile_y), x, last_full_tile_y, w, dist,
-         dst_stride, src_stride, desc, is_store);
-
-      h -= dist;
-   }
-
-   /* The left portion */
-   if (first_full_tile_x != x) {
-      unsigned dist = MIN2(first_full_tile_x - x, w);
-
-      panfrost_access_tiled_image_generic(dst, OFFSET(src, x, y), x, y, dist, h,
-                                          dst_stride, src_stride, desc,
-                                          is_store);
-
-      if (dist == w)
-         return;
-
-      x += dist;
-      w -= dist;
-   }
-
-   /* Finally, the right portion */
-   if (last_full_tile_x != (x + w)) {
-      unsigned dist = (x + w) - last_full_tile_x;
-
-      panfrost_access_tiled_image_generic(
-         dst, OFFSET(src, last_full_tile_x, y), last_full_tile_x, y, dist, h,
-         dst_stride, src_stride, desc, is_store);
-
-      w -= dist;
-   }
-
-   if (bpp == 8)
-      panfrost_access_tiled_image_uint8_t(dst, OFFSET(src, x, y), x, y, w, h,
-                                          dst_stride, src_stride, is_store);
-   else if (bpp == 16)
-      panfrost_access_tiled_image_uint16_t(dst, OFFSET(src, x, y), x, y, w, h,
-                                           dst_stride, src_stride, is_store);
-   else if (bpp == 32)
-      panfrost_access_tiled_image_uint32_t(dst, OFFSET(src, x, y), x, y, w, h,
-                                           dst_stride, src_stride, is_store);
-   else if (bpp == 64)
-      panfrost_access_tiled_image_uint64_t(dst, OFFSET(src, x, y), x, y, w, h,
-                                           dst_stride, src_stride, is_store);
-   else if (bpp == 128)
-      panfrost_access_tiled_image_pan_uint128_t(
-         dst, OFFSET(src, x, y), x, y, w, h, dst_stride, src_stride, is_store);
+   /* Convert units */
+   unsigned x_el = x / desc->block.width;
+   unsigned y_el = y / desc->block.height;
+   unsigned w_el = DIV_ROUND_UP(w, desc->block.width);
+   unsigned h_el = DIV_ROUND_UP(h, desc->block.height);
+
+   if (is_store)
+      util_tiling_store(&layout, dst, src, src_stride, x_el, y_el, w_el, h_el);
+   else
+      util_tiling_load(&layout, src, src_stride, dst, x_el, y_el, w_el, h_el);
 }
 
 /**
@@ -33,6 +33,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include "util/mesa-cache-key.h"
 #include "util/mesa-sha1.h"
 #include "util/detect_os.h"
 
@@ -41,11 +42,18 @@ extern "C" {
 #endif
 
 /* Size of cache keys in bytes. */
-#define CACHE_KEY_SIZE 20
+#define CACHE_KEY_SIZE MESA_CACHE_KEY_SIZE
 
-#define CACHE_DIR_NAME "mesa_shader_cache"
-#define CACHE_DIR_NAME_SF "mesa_shader_cache_sf"
-#define CACHE_DIR_NAME_DB "mesa_shader_cache_db"
+/* Appended to the cache directory names, and bumped whenever the way keys
+ * are computed changes (2: BLAKE3 keys, see mesa-cache-key.h).  Mesa builds
+ * computing keys differently would never hit each other's entries, so this
+ * keeps them from evicting those entries when they share a cache location.
+ */
+#define CACHE_DIR_VERSION "_v2"
+
+#define CACHE_DIR_NAME "mesa_shader_cache" CACHE_DIR_VERSION
+#define CACHE_DIR_NAME_SF "mesa_shader_cache_sf" CACHE_DIR_VERSION
+#define CACHE_DIR_NAME_DB "mesa_shader_cache_db" CACHE_DIR_VERSION
 
 typedef uint8_t cache_key[CACHE_KEY_SIZE];
 
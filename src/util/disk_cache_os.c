@@ -836,8 +836,8 @@ disk_cache_write_item_to_disk(struct disk_cache_put_job *dc_job,
 /* Determine path for cache based on the first defined name as follows:
  *
  *   $MESA_SHADER_CACHE_DIR
- *   $XDG_CACHE_HOME/mesa_shader_cache
- *   <pwd.pw_dir>/.cache/mesa_shader_cache
+ *   $XDG_CACHE_HOME/mesa_shader_cache_v2
+ *   <pwd.pw_dir>/.cache/mesa_shader_cache_v2
  */
 char *
 disk_cache_generate_cache_dir(void *mem_ctx, const char *gpu_name,
@@ -322,6 +322,10 @@
    DRI_CONF_OPT_B(precise_trig, def, \
                   "Prefer accuracy over performance in trig functions")
 
+#define DRI_CONF_TEXCOMPRESS_QUALITY(def) \
+   DRI_CONF_OPT_I(texcompress_quality, def, 0, 1, \
+                  "Quality of textures compressed by the CPU on upload: 0 is the fastest, 1 tries more BPTC modes")
+
 #define DRI_CONF_PP_CELSHADE(def) \
    DRI_CONF_OPT_E(pp_celshade, def, 0, 1, \
                   "A post-processing filter to cel-shade the output", \
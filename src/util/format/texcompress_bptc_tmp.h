@@ -28,6 +28,9 @@
 #ifndef TEXCOMPRESS_BPTC_TMP_H
 #define TEXCOMPRESS_BPTC_TMP_H
 
+#include <float.h>
+#include <limits.h>
+
 #include "util/bitscan.h"
 #include "util/format_srgb.h"
 #include "util/half_float.h"
@@ -1566,10 +1569,349 @@ compress_rgba_unorm_block(int src_width, int src_height,
                              endpoints);
 }
 
+/* Mode 6 is a single subset of 7-bit RGBA endpoints with a p-bit each and
+ * 4-bit indices.  It is tried next to mode 4 when a better quality is asked
+ * for: the endpoints come from the principal axis of the texels, and are
+ * refined with a least-squares fit to the indices found for them.
+ */
+
+#define MODE6_REFINE_PASSES 1
+
+static const uint8_t
+mode6_weights[16] = {
+   0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+static void
+quantize_mode6_endpoint(const float value[4], uint8_t endpoint[4])
+{
+   int best_error = INT_MAX;
+   int pbit, component;
+
+   /* Both p-bits, keeping the one closest to the value */
+   for (pbit = 0; pbit < 2; pbit++) {
+      uint8_t quantized[4];
+      int error = 0;
+
+      for (component = 0; component < 4; component++) {
+         int q = (int) ((value[component] - pbit) * 0.5f + 0.5f);
+         int diff;
+
+         quantized[component] = (CLAMP(q, 0, 127) << 1) | pbit;
+         diff = quantized[component] - (int) (value[component] + 0.5f);
+         error += diff * diff;
+      }
+
+      if (error < best_error) {
+         best_error = error;
+         memcpy(endpoint, quantized, 4);
+      }
+   }
+}
+
+/* Picks the closest palette entry for each texel, returning the total
+ * squared error.  The palette lies on the line between the endpoints, so
+ * only the entries around the projection of the texel on it are tried.
+ */
+static int
+select_mode6_indices(int src_width, int src_height,
+                     const uint8_t *src, int src_rowstride,
+                     uint8_t endpoints[][4],
+                     uint8_t indices[BLOCK_SIZE * BLOCK_SIZE])
+{
+   int palette[16][4];
+   int axis[4], axis_length = 0;
+   int total_error = 0;
+   int y, x, i, component;
+
+   for (component = 0; component < 4; component++) {
+      for (i = 0; i < 16; i++) {
+         palette[i][component] = interpolate(endpoints[0][component],
+                                             endpoints[1][component],
+                                             i, 4);
+      }
+      axis[component] = endpoints[1][component] - endpoints[0][component];
+      axis_length += axis[component] * axis[component];
+   }
+
+   memset(indices, 0, BLOCK_SIZE * BLOCK_SIZE);
+
+   for (y = 0; y < src_height; y++) {
+      const uint8_t *p = src + y * src_rowstride;
+
+      for (x = 0; x < src_width; x++, p += 4) {
+         int best = 0, best_error = INT_MAX;
+         int first = 0, last = 0;
+
+         if (axis_length) {
+            int t = 0;
+
+            for (component = 0; component < 4; component++)
+               t += (p[component] - endpoints[0][component]) * axis[component];
+
+            t = CLAMP((t * 15 + axis_length / 2) / axis_length, 0, 15);
+            first = MAX2(t - 1, 0);
+            last = MIN2(t + 1, 15);
+         }
+
+         for (i = first; i <= last; i++) {
+            int error = 0;
+
+            for (component = 0; component < 4; component++) {
+               int diff = palette[i][component] - p[component];
+               error += diff * diff;
+            }
+
+            if (error < best_error) {
+               best_error = error;
+               best = i;
+            }
+         }
+
+         indices[y * BLOCK_SIZE + x] = best;
+         total_error += best_error;
+      }
+   }
+
+   return total_error;
+}
+
+static void
+get_mode6_endpoints(int src_width, int src_height,
+                    const uint8_t *src, int src_rowstride,
+                    float endpoints[][4])
+{
+   const int n_texels = src_width * src_height;
+   float mean[4] = { 0 }, axis[4], covariance[4][4] = { { 0 } };
+   float t, t_min = FLT_MAX, t_max = -FLT_MAX, length;
+   int y, x, i, j, iteration;
+
+   for (y = 0; y < src_height; y++) {
+      for (x = 0; x < src_width; x++) {
+         for (i = 0; i < 4; i++)
+            mean[i] += src[y * src_rowstride + x * 4 + i];
+      }
+   }
+   for (i = 0; i < 4; i++)
+      mean[i] /= n_texels;
+
+   for (y = 0; y < src_height; y++) {
+      for (x = 0; x < src_width; x++) {
+         const uint8_t *p = src + y * src_rowstride + x * 4;
+
+         for (i = 0; i < 4; i++) {
+            for (j = 0; j < 4; j++)
+               covariance[i][j] += (p[i] - mean[i]) * (p[j] - mean[j]);
+         }
+      }
+   }
+
+   /* Power iteration for the principal axis, starting from the largest
+    * diagonal so it can't be orthogonal to it.
+    */
+   for (i = 0; i < 4; i++)
+      axis[i] = covariance[i][i];
+
+   for (iteration = 0; iteration < 8; iteration++) {
+      float next[4] = { 0 };
+
+      for (i = 0; i < 4; i++) {
+         for (j = 0; j < 4; j++)
+            next[i] += covariance[i][j] * axis[j];
+      }
+
+      length = 0;
+      for (i = 0; i < 4; i++)
+         length = MAX2(length, fabsf(next[i]));
+
+      if (length == 0.0f)
+         break;
+
+      for (i = 0; i < 4; i++)
+         axis[i] = next[i] / length;
+   }
+
+   length = 0;
+   for (i = 0; i < 4; i++)
+      length += axis[i] * axis[i];
+
+   if (length == 0.0f) {
+      /* All of the texels are the same */
+      memcpy(endpoints[0], mean, sizeof mean);
+      memcpy(endpoints[1], mean, sizeof mean);
+      return;
+   }
+
+   for (i = 0; i < 4; i++)
+      axis[i] /= sqrtf(length);
+
+   for (y = 0; y < src_height; y++) {
+      for (x = 0; x < src_width; x++) {
+         const uint8_t *p = src + y * src_rowstride + x * 4;
+
+         t = 0;
+         for (i = 0; i < 4; i++)
+            t += (p[i] - mean[i]) * axis[i];
+         t_min = MIN2(t_min, t);
+         t_max = MAX2(t_max, t);
+      }
+   }
+
+   for (i = 0; i < 4; i++) {
+      endpoints[0][i] = CLAMP(mean[i] + axis[i] * t_min, 0.0f, 255.0f);
+      endpoints[1][i] = CLAMP(mean[i] + axis[i] * t_max, 0.0f, 255.0f);
+   }
+}
+
+/* Least-squares endpoints for the given indices.  Returns false when the
+ * indices don't constrain both endpoints.
+ */
+static bool
+fit_mode6_endpoints(int src_width, int src_height,
+                    const uint8_t *src, int src_rowstride,
+                    const uint8_t indices[BLOCK_SIZE * BLOCK_SIZE],
+                    float endpoints[][4])
+{
+   float aa = 0, ab = 0, bb = 0, det;
+   float ax[4] = { 0 }, bx[4] = { 0 };
+   int y, x, i;
+
+   for (y = 0; y < src_height; y++) {
+      for (x = 0; x < src_width; x++) {
+         const uint8_t *p = src + y * src_rowstride + x * 4;
+         float b = mode6_weights[indices[y * BLOCK_SIZE + x]] / 64.0f;
+         float a = 1.0f - b;
+
+         aa += a * a;
+         ab += a * b;
+         bb += b * b;
+         for (i = 0; i < 4; i++) {
+            ax[i] += a * p[i];
+            bx[i] += b * p[i];
+         }
+      }
+   }
+
+   det = aa * bb - ab * ab;
+   if (fabsf(det) < 1e-6f)
+      return false;
+
+   for (i = 0; i < 4; i++) {
+      endpoints[0][i] = CLAMP((bb * ax[i] - ab * bx[i]) / det, 0.0f, 255.0f);
+      endpoints[1][i] = CLAMP((aa * bx[i] - ab * ax[i]) / det, 0.0f, 255.0f);
+   }
+
+   return true;
+}
+
+static int
+compress_rgba_unorm_block_mode6(int src_width, int src_height,
+                                const uint8_t *src, int src_rowstride,
+                                uint8_t *dst)
+{
+   float fit[2][4];
+   uint8_t endpoints[2][4], candidate[2][4];
+   uint8_t indices[BLOCK_SIZE * BLOCK_SIZE];
+   uint8_t candidate_indices[BLOCK_SIZE * BLOCK_SIZE];
+   struct bit_writer writer;
+   int error, candidate_error;
+   int pass, component, endpoint, i;
+
+   get_mode6_endpoints(src_width, src_height, src, src_rowstride, fit);
+   quantize_mode6_endpoint(fit[0], endpoints[0]);
+   quantize_mode6_endpoint(fit[1], endpoints[1]);
+   error = select_mode6_indices(src_width, src_height, src, src_rowstride,
+                                endpoints, indices);
+
+   for (pass = 0; pass < MODE6_REFINE_PASSES && error > 0; pass++) {
+      if (!fit_mode6_endpoints(src_width, src_height, src, src_rowstride,
+                               indices, fit))
+         break;
+
+      quantize_mode6_endpoint(fit[0], candidate[0]);
+      quantize_mode6_endpoint(fit[1], candidate[1]);
+      candidate_error = select_mode6_indices(src_width, src_height,
+                                             src, src_rowstride,
+                                             candidate, candidate_indices);
+      if (candidate_error >= error)
+         break;
+
+      error = candidate_error;
+      memcpy(endpoints, candidate, sizeof endpoints);
+      memcpy(indices, candidate_indices, sizeof indices);
+   }
+
+   /* The most-significant bit of the first index is implied to be zero.
+    * Swapping the endpoints and inverting the indices gives the same colors
+    * because the weights are symmetric.
+    */
+   if (indices[0] & 8) {
+      memcpy(candidate[0], endpoints[0], 4);
+      memcpy(endpoints[0], endpoints[1], 4);
+      memcpy(endpoints[1], candidate[0], 4);
+      for (i = 0; i < BLOCK_SIZE * BLOCK_SIZE; i++)
+         indices[i] = 15 - indices[i];
+   }
+
+   writer.dst = dst;
+   writer.pos = 0;
+   writer.buf = 0;
+
+   write_bits(&writer, 7, 0x40); /* mode 6 */
+
+   for (component = 0; component < 4; component++)
+      for (endpoint = 0; endpoint < 2; endpoint++)
+         write_bits(&writer, 7, endpoints[endpoint][component] >> 1);
+
+   for (endpoint = 0; endpoint < 2; endpoint++)
+      write_bits(&writer, 1, endpoints[endpoint][0] & 1);
+
+   /* Texels outside of a partial block keep index 0, or 15 after a swap,
+    * which is harmless since they are never sampled.
+    */
+   write_bits(&writer, 3, indices[0]);
+   for (i = 1; i < BLOCK_SIZE * BLOCK_SIZE; i++)
+      write_bits(&writer, 4, indices[i]);
+
+   return error;
+}
+
+static int
+get_rgba_unorm_block_error(int src_width, int src_height,
+                           const uint8_t *src, int src_rowstride,
+                           const uint8_t *block)
+{
+   uint8_t decoded[BLOCK_SIZE * BLOCK_SIZE * 4];
+   int error = 0;
+   int y, x, i;
+
+   decompress_rgba_unorm_block(src_width, src_height, block,
+                               decoded, BLOCK_SIZE * 4);
+
+   for (y = 0; y < src_height; y++) {
+      for (x = 0; x < src_width; x++) {
+         for (i = 0; i < 4; i++) {
+            int diff = decoded[(y * BLOCK_SIZE + x) * 4 + i] -
+                       src[y * src_rowstride + x * 4 + i];
+            error += diff * diff;
+         }
+      }
+   }
+
+   return error;
+}
+
+/**
+ * Compresses to BPTC unorm.  With a quality of 0 every block is encoded in
+ * mode 4 with endpoints taken from the average luminance.  With a quality
+ * of 1 mode 6 is tried as well, and the block with the least squared error
+ * is kept.
+ */
 static void
 compress_rgba_unorm(int width, int height,
                     const uint8_t *src, int src_rowstride,
-                    uint8_t *dst, int dst_rowstride)
+                    uint8_t *dst, int dst_rowstride,
+                    int quality)
 {
    int dst_row_diff;
    int y, x;
@@ -1581,11 +1923,29 @@ compress_rgba_unorm(int width, int height,
 
    for (y = 0; y < height; y += BLOCK_SIZE) {
       for (x = 0; x < width; x += BLOCK_SIZE) {
-         compress_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
-                                   MIN2(height - y, BLOCK_SIZE),
-                                   src + x * 4 + y * src_rowstride,
-                                   src_rowstride,
+         const int block_width = MIN2(width - x, BLOCK_SIZE);
+         const int block_height = MIN2(height - y, BLOCK_SIZE);
+         const uint8_t *block_src = src + x * 4 + y * src_rowstride;
+
+         compress_rgba_unorm_block(block_width, block_height,
+                                   block_src, src_rowstride,
                                    dst);
+
+         if (quality > 0) {
+            uint8_t mode6[BLOCK_BYTES];
+            int mode6_error =
+               compress_rgba_unorm_block_mode6(block_width, block_height,
+                                               block_src, src_rowstride,
+                                               mode6);
+
+            if (mode6_error < get_rgba_unorm_block_error(block_width,
+                                                         block_height,
+                                                         block_src,
+                                                         src_rowstride,
+                                                         dst))
+               memcpy(dst, mode6, BLOCK_BYTES);
+         }
+
          dst += BLOCK_BYTES;
       }
       dst += dst_row_diff;
@@ -1186,24 +1186,56 @@ util_format_rgb_to_bgr(enum pipe_format format)
    }
 }
 
+static const struct util_format_pack_description *util_format_pack_table[PIPE_FORMAT_COUNT];
 static const struct util_format_unpack_description *util_format_unpack_table[PIPE_FORMAT_COUNT];
 
+static void
+util_format_pack_table_init(void)
+{
+   for (enum pipe_format format = PIPE_FORMAT_NONE; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_pack_description *pack = NULL;
+
+#if (DETECT_ARCH_X86 || DETECT_ARCH_X86_64) && !defined(NO_FORMAT_ASM)
+      pack = util_format_pack_description_avx2(format);
+      if (!pack)
+         pack = util_format_pack_description_sse41(format);
+#endif
+#if (DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM) && !defined(NO_FORMAT_ASM) && !defined(__SOFTFP__)
+      pack = util_format_pack_description_neon(format);
+#endif
+
+      util_format_pack_table[format] = pack ? pack : util_format_pack_description_generic(format);
+   }
+}
+
 static void
 util_format_unpack_table_init(void)
 {
    for (enum pipe_format format = PIPE_FORMAT_NONE; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_unpack_description *unpack = NULL;
+
+#if (DETECT_ARCH_X86 || DETECT_ARCH_X86_64) && !defined(NO_FORMAT_ASM)
+      unpack = util_format_unpack_description_avx2(format);
+      if (!unpack)
+         unpack = util_format_unpack_description_sse41(format);
+#endif
 #if (DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM) && !defined(NO_FORMAT_ASM) && !defined(__SOFTFP__)
-      const struct util_format_unpack_description *unpack = util_format_unpack_description_neon(format);
-      if (unpack) {
-         util_format_unpack_table[format] = unpack;
-         continue;
-      }
+      unpack = util_format_unpack_description_neon(format);
 #endif
 
-      util_format_unpack_table[format] = util_format_unpack_description_generic(format);
+      util_format_unpack_table[format] = unpack ? unpack : util_format_unpack_description_generic(format);
    }
 }
 
+const struct util_format_pack_description *
+util_format_pack_description(enum pipe_format format)
+{
+   static once_flag flag = ONCE_FLAG_INIT;
+   call_once(&flag, util_format_pack_table_init);
+
+   return util_format_pack_table[format];
+}
+
 const struct util_format_unpack_description *
 util_format_unpack_description(enum pipe_format format)
 {
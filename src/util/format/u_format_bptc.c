@@ -48,7 +48,7 @@ util_format_bptc_rgba_unorm_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned
 {
    compress_rgba_unorm(width, height,
                        src_row, src_stride,
-                       dst_row, dst_stride);
+                       dst_row, dst_stride, 0);
 }
 
 void
@@ -90,7 +90,7 @@ util_format_bptc_rgba_unorm_pack_rgba_float(uint8_t *restrict dst_row, unsigned
    }
    compress_rgba_unorm(width, height,
                        temp_block, width * 4 * sizeof(uint8_t),
-                       dst_row, dst_stride);
+                       dst_row, dst_stride, 0);
    free((void *) temp_block);
 }
 
@@ -126,7 +126,7 @@ util_format_bptc_srgba_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_
 {
    compress_rgba_unorm(width, height,
                        src_row, src_stride,
-                       dst_row, dst_stride);
+                       dst_row, dst_stride, 0);
 }
 
 void
@@ -204,7 +204,7 @@ util_format_bptc_rgb_float_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned
 {
    compress_rgba_unorm(width, height,
                        src_row, src_stride,
-                       dst_row, dst_stride);
+                       dst_row, dst_stride, 0);
 }
 
 void
@@ -266,7 +266,7 @@ util_format_bptc_rgb_ufloat_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned
 {
    compress_rgba_unorm(width, height,
                        src_row, src_stride,
-                       dst_row, dst_stride);
+                       dst_row, dst_stride, 0);
 }
 
 void
@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "util/format/u_format_compress.h"
+
+#include "util/macros.h"
+#include "util/u_bands.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+
+/* Images smaller than this many pixels per band aren't worth the threads */
+#define MIN_BAND_PIXELS (128 * 128)
+
+DEBUG_GET_ONCE_NUM_OPTION(texcompress_threads, "MESA_TEXCOMPRESS_THREADS",
+                          UTIL_BANDS_MAX - 1)
+
+struct compress_bands {
+   util_format_compress_rows_func func;
+   void *data;
+   unsigned height, rows_per_band;
+};
+
+static void
+compress_band(void *data, unsigned band)
+{
+   struct compress_bands *bands = data;
+   unsigned y = band * bands->rows_per_band;
+
+   bands->func(bands->data, y, MIN2(bands->rows_per_band, bands->height - y));
+}
+
+void
+util_format_compress_rows(unsigned width, unsigned height,
+                          unsigned block_height,
+                          util_format_compress_rows_func func, void *data)
+{
+   const unsigned block_rows = DIV_ROUND_UP(height, block_height);
+   const uint64_t pixels = (uint64_t)width * height;
+   const unsigned max_bands =
+      MIN2(MAX2(debug_get_option_texcompress_threads(), 0) + 1,
+           util_bands_max());
+   unsigned n_bands, rows_per_band;
+
+   n_bands = MIN3(max_bands, block_rows, pixels / MIN_BAND_PIXELS);
+   if (n_bands <= 1) {
+      func(data, 0, height);
+      return;
+   }
+
+   rows_per_band = DIV_ROUND_UP(block_rows, n_bands);
+   n_bands = DIV_ROUND_UP(block_rows, rows_per_band);
+
+   struct compress_bands bands = {
+      .func = func,
+      .data = data,
+      .height = height,
+      .rows_per_band = rows_per_band * block_height,
+   };
+
+   util_run_bands(n_bands, compress_band, &bands);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef U_FORMAT_COMPRESS_H
+#define U_FORMAT_COMPRESS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compresses rows [y, y + height) of an image.  'y' and 'height' are
+ * multiples of the block height, except for the end of the image.
+ */
+typedef void (*util_format_compress_rows_func)(void *data,
+                                                unsigned y, unsigned height);
+
+/**
+ * Runs 'func' over the rows of a 'width' x 'height' image, split in bands of
+ * whole rows of 'block_height' blocks that are compressed concurrently on
+ * the util_run_bands() pool.  Small images are compressed by the calling
+ * thread alone.  Returns once all of the rows are done.
+ *
+ * MESA_TEXCOMPRESS_THREADS can lower the number of threads used.
+ */
+void
+util_format_compress_rows(unsigned width, unsigned height,
+                          unsigned block_height,
+                          util_format_compress_rows_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_FORMAT_COMPRESS_H */
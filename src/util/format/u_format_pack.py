@@ -751,3 +751,80 @@ def generate(formats):
 
                 generate_format_unpack(format, channel, native_type, suffix)
                 generate_format_pack(format, channel, native_type, suffix)
+
+
+simd_swizzle_map = {
+    SWIZZLE_X: 'PIPE_SWIZZLE_X',
+    SWIZZLE_Y: 'PIPE_SWIZZLE_Y',
+    SWIZZLE_Z: 'PIPE_SWIZZLE_Z',
+    SWIZZLE_W: 'PIPE_SWIZZLE_W',
+    SWIZZLE_0: 'PIPE_SWIZZLE_0',
+    SWIZZLE_1: 'PIPE_SWIZZLE_1',
+}
+
+
+def simd_format_type(format):
+    '''Get the kind of SIMD row kernel that handles a format, if any.
+
+    The kernels only move whole 8 or 16-bit array elements around, so this is
+    limited to little-endian-compatible array formats of 1, 2 or 4 elements
+    whose colorspace needs no conversion.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return None
+    if format.block_width != 1 or format.block_height != 1 or format.block_depth != 1:
+        return None
+    if not format.is_array() or format.nr_channels() not in (1, 2, 4):
+        return None
+    if SWIZZLE_NONE in format.le_swizzles:
+        return None
+
+    channel = format.array_element()
+    if channel.type == UNSIGNED and channel.norm and not channel.pure:
+        if channel.size == 8:
+            return 'UNORM8'
+        if channel.size == 16:
+            return 'UNORM16'
+    if channel.type == FLOAT and channel.size == 16:
+        return 'FLOAT16'
+
+    return None
+
+
+def generate_simd(formats):
+    '''Generate the list of formats with SIMD row kernels.
+
+    Each entry gives the number of array elements per pixel, the element each
+    of R, G, B and A is unpacked from (or a 0/1 constant), and the RGBA
+    component each element is packed from (or 0 for padding).  The users
+    define UTIL_FORMAT_SIMD_<type>() for the types they implement.'''
+
+    print('/* This file is autogenerated by u_format_table.py from u_format.csv. Do not edit directly. */')
+    print()
+    for type in ('UNORM8', 'UNORM16', 'FLOAT16'):
+        print('#ifndef UTIL_FORMAT_SIMD_%s' % type)
+        print('#define UTIL_FORMAT_SIMD_%s(format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3)' % type)
+        print('#endif')
+    print()
+
+    for format in formats:
+        type = simd_format_type(format)
+        if type is None:
+            continue
+
+        nr = format.nr_channels()
+        inv_swizzle = inv_swizzles(format.le_swizzles)
+        pack = []
+        for i in range(4):
+            if i < nr and format.le_channels[i].type != VOID and inv_swizzle[i] is not None:
+                pack.append(simd_swizzle_map[inv_swizzle[i]])
+            else:
+                pack.append(simd_swizzle_map[SWIZZLE_0])
+
+        print('UTIL_FORMAT_SIMD_%s(%s, %s, %u,' % (type, format.name, format.short_name(), nr))
+        print('   %s,' % ', '.join([simd_swizzle_map[s] for s in format.le_swizzles]))
+        print('   %s)' % ', '.join(pack))
+
+    print()
+    for type in ('UNORM8', 'UNORM16', 'FLOAT16'):
+        print('#undef UTIL_FORMAT_SIMD_%s' % type)
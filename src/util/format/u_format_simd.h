@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Shared pieces of the SIMD pack/unpack row kernels.
+ *
+ * u_format_simd_table.h, generated from u_format.csv, lists the array
+ * formats of 8-bit unorm, 16-bit unorm and 16-bit float elements that the
+ * kernels handle, as UTIL_FORMAT_SIMD_<type>() entries.  Each kernel file
+ * instantiates its row functions from those entries and describes them in
+ * a pack and an unpack table that u_format.c picks from at runtime.
+ *
+ * The kernels compute exactly what the generated C functions do, and hand
+ * the pixels at the end of a row that don't fill a vector to them.
+ */
+
+#ifndef U_FORMAT_SIMD_H
+#define U_FORMAT_SIMD_H
+
+#include <string.h>
+
+#include "util/format/u_format.h"
+
+/**
+ * Element layout of one format, see u_format_pack.py:generate_simd().
+ */
+struct util_format_simd_layout {
+   enum pipe_format format;
+   /** array elements per pixel */
+   unsigned nr;
+   /** element each of R, G, B, A comes from, or PIPE_SWIZZLE_0/1 */
+   uint8_t unpack[4];
+   /** RGBA component each element comes from, or PIPE_SWIZZLE_0 */
+   uint8_t pack[4];
+};
+
+#define UTIL_FORMAT_SIMD_LAYOUT(format, nr, u0, u1, u2, u3, p0, p1, p2, p3) \
+   { format, nr, { u0, u1, u2, u3 }, { p0, p1, p2, p3 } }
+
+/* Formats stored as 8-bit RGBA, that the compiler already packs from 8-bit
+ * RGBA with a plain copy.
+ */
+#define UTIL_FORMAT_SIMD_IS_RGBA8(nr, p0, p1, p2, p3) \
+   ((nr) == 4 && (p0) == PIPE_SWIZZLE_X && (p1) == PIPE_SWIZZLE_Y && \
+    (p2) == PIPE_SWIZZLE_Z && (p3) == PIPE_SWIZZLE_W)
+
+/* Byte shuffle index that produces zero with both PSHUFB and TBL */
+#define UTIL_FORMAT_SIMD_ZERO 0x80
+
+/**
+ * Fills 'mask' with a byte shuffle from pixels 'first' to 'first + npix' of
+ * the format, with 'elem_size'-byte elements, to RGBA with 'out_size' bytes
+ * per component.  Elements are zero-extended, and 0/1 components are zero.
+ * Pixel i is read at offset (i % wrap) pixels, so that a row spread over
+ * several vectors, or over the 128-bit lanes of one, can start over in each.
+ */
+static inline void
+util_format_simd_unpack_shuffle(uint8_t *mask,
+                                const struct util_format_simd_layout *layout,
+                                unsigned elem_size, unsigned out_size,
+                                unsigned first, unsigned npix, unsigned wrap)
+{
+   const unsigned pix_size = layout->nr * elem_size;
+
+   for (unsigned i = first; i < first + npix; i++) {
+      for (unsigned c = 0; c < 4; c++) {
+         const unsigned swizzle = layout->unpack[c];
+
+         for (unsigned b = 0; b < out_size; b++) {
+            *mask++ = swizzle <= PIPE_SWIZZLE_W && b < elem_size ?
+               (i % wrap) * pix_size + swizzle * elem_size + b :
+               UTIL_FORMAT_SIMD_ZERO;
+         }
+      }
+   }
+}
+
+/**
+ * Fills 'mask' with a byte shuffle from 'npix' RGBA pixels with
+ * 'elem_size'-byte components to the elements of the format, with zeros in
+ * padding elements.  The rest of the 'size'-byte mask is zeros.
+ */
+static inline void
+util_format_simd_pack_shuffle(uint8_t *mask,
+                              const struct util_format_simd_layout *layout,
+                              unsigned elem_size, unsigned npix, unsigned wrap,
+                              unsigned size)
+{
+   unsigned n = 0;
+
+   for (unsigned i = 0; i < npix; i++) {
+      for (unsigned e = 0; e < layout->nr; e++) {
+         const unsigned swizzle = layout->pack[e];
+
+         for (unsigned b = 0; b < elem_size; b++) {
+            mask[n++] = swizzle <= PIPE_SWIZZLE_W ?
+               (i % wrap) * 4 * elem_size + swizzle * elem_size + b :
+               UTIL_FORMAT_SIMD_ZERO;
+         }
+      }
+   }
+   while (n < size)
+      mask[n++] = UTIL_FORMAT_SIMD_ZERO;
+}
+
+/**
+ * Fills 'ones' with 'npix' RGBA pixels of 'size'-byte components, that are
+ * all ones bits in the components that unpack as a constant 1 (for 8-bit
+ * unorm results), or 'one' there (for float results).
+ */
+static inline void
+util_format_simd_unpack_ones(void *ones,
+                             const struct util_format_simd_layout *layout,
+                             unsigned size, unsigned npix, uint32_t one)
+{
+   uint8_t *dst = ones;
+
+   for (unsigned i = 0; i < npix; i++) {
+      for (unsigned c = 0; c < 4; c++) {
+         const uint32_t value = layout->unpack[c] == PIPE_SWIZZLE_1 ? one : 0;
+
+         memcpy(dst, &value, size);
+         dst += size;
+      }
+   }
+}
+
+/* The generated functions, for the ends of rows */
+static inline void
+util_format_simd_unpack_tail_8unorm(const struct util_format_simd_layout *layout,
+                                    uint8_t *restrict dst,
+                                    const uint8_t *restrict src,
+                                    unsigned width)
+{
+   if (width)
+      util_format_unpack_description_generic(layout->format)->unpack_rgba_8unorm(dst, src, width);
+}
+
+static inline void
+util_format_simd_unpack_tail_float(const struct util_format_simd_layout *layout,
+                                   float *restrict dst,
+                                   const uint8_t *restrict src,
+                                   unsigned width)
+{
+   if (width)
+      util_format_unpack_description_generic(layout->format)->unpack_rgba(dst, src, width);
+}
+
+static inline void
+util_format_simd_pack_tail_8unorm(const struct util_format_simd_layout *layout,
+                                  uint8_t *restrict dst,
+                                  const uint8_t *restrict src,
+                                  unsigned width)
+{
+   if (width)
+      util_format_pack_description_generic(layout->format)->pack_rgba_8unorm(dst, 0, src, 0, width, 1);
+}
+
+static inline void
+util_format_simd_pack_tail_float(const struct util_format_simd_layout *layout,
+                                 uint8_t *restrict dst,
+                                 const float *restrict src,
+                                 unsigned width)
+{
+   if (width)
+      util_format_pack_description_generic(layout->format)->pack_rgba_float(dst, 0, src, 0, width, 1);
+}
+
+#endif /* U_FORMAT_SIMD_H */
@@ -0,0 +1,654 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* AVX2 pack/unpack row kernels for the 8 and 16-bit unorm and the 16-bit
+ * float array formats, eight pixels at a time.  Built with -mavx2 and only
+ * used when the CPU supports it.
+ *
+ * The 16-bit elements are handled as 16-bit RGBA, four pixels to a vector
+ * with two in each 128-bit lane, so that the lanes can be widened to 32 bits
+ * or narrowed to 8 bits without crossing.
+ */
+
+#include "util/format/u_format_simd.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#include "c11/threads.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+
+#include "u_format_pack.h"
+
+struct avx2_format {
+   struct util_format_simd_layout layout;
+   /* 8-bit elements: eight pixels to 8-bit RGBA.
+    * 16-bit elements: pixels 0-3 and 4-7 to 16-bit RGBA.
+    */
+   __m256i unpack[2];
+   /* Per lane, four 8-bit RGBA pixels or two 16-bit ones to elements */
+   __m256i pack;
+   __m256i ones8;
+   __m256 ones;
+};
+
+/* Loads 8, 16 or 32 bytes, the first two into both lanes */
+static ALWAYS_INLINE __m256i
+load_lanes(const uint8_t *src, unsigned size)
+{
+   if (size == 32)
+      return _mm256_loadu_si256((const __m256i *)src);
+
+   __m128i v = size == 8 ? _mm_loadl_epi64((const __m128i *)src) :
+                           _mm_loadu_si128((const __m128i *)src);
+   return _mm256_broadcastsi128_si256(v);
+}
+
+/* Stores the first 4, 8 or 16 bytes of each lane */
+static ALWAYS_INLINE void
+store_lanes(uint8_t *dst, __m256i v, unsigned size)
+{
+   if (size == 16) {
+      _mm256_storeu_si256((__m256i *)dst, v);
+   } else if (size == 8) {
+      v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(v));
+   } else {
+      __m128i lo = _mm256_castsi256_si128(v);
+      __m128i hi = _mm256_extracti128_si256(v, 1);
+      _mm_storel_epi64((__m128i *)dst, _mm_unpacklo_epi32(lo, hi));
+   }
+}
+
+/* float_to_ubyte(), in the low byte of each 32-bit lane */
+static ALWAYS_INLINE __m256i
+float_to_ubyte_avx2(__m256 f)
+{
+   /* Separate multiply and add, as in the C version */
+   __m256 biased = _mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(255.0f / 256.0f)),
+                                 _mm256_set1_ps(32768.0f));
+   __m256 ge1 = _mm256_cmp_ps(f, _mm256_set1_ps(1.0f), _CMP_GE_OQ);
+   __m256 gt0 = _mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_GT_OQ);
+   __m256i bits = _mm256_or_si256(_mm256_castps_si256(biased), _mm256_castps_si256(ge1));
+
+   bits = _mm256_and_si256(bits, _mm256_castps_si256(gt0));
+   return _mm256_and_si256(bits, _mm256_set1_epi32(0xff));
+}
+
+/* (uint16_t)util_iround(CLAMP(f, 0.0f, 1.0f) * 0xffff) */
+static ALWAYS_INLINE __m256i
+float_to_unorm16_avx2(__m256 f)
+{
+   /* MAXPS returns the second operand for NaN, like CLAMP() gives 0 */
+   f = _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+   return _mm256_cvtps_epi32(_mm256_mul_ps(f, _mm256_set1_ps(65535.0f)));
+}
+
+/* _mesa_unorm_to_unorm(x, 16, 8) of 32-bit lanes */
+static ALWAYS_INLINE __m256i
+unorm16_to_unorm8_avx2(__m256i x)
+{
+   /* (x * 255 + 32767) / 65535 == (n + (n >> 16) + 1) >> 16 for 16-bit x */
+   __m256i n = _mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(x, 8), x),
+                                _mm256_set1_epi32(32767));
+
+   n = _mm256_add_epi32(_mm256_add_epi32(n, _mm256_srli_epi32(n, 16)),
+                        _mm256_set1_epi32(1));
+   return _mm256_srli_epi32(n, 16);
+}
+
+/* Narrows eight pixels of 32-bit RGBA, two to a vector, to 8-bit RGBA */
+static ALWAYS_INLINE __m256i
+narrow_rgba8(__m256i p01, __m256i p23, __m256i p45, __m256i p67)
+{
+   /* The lane-wise packs leave pixels 0, 2, 4, 6 in the low lane */
+   __m256i rgba = _mm256_packus_epi16(_mm256_packus_epi32(p01, p23),
+                                      _mm256_packus_epi32(p45, p67));
+
+   return _mm256_permutevar8x32_epi32(rgba, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+/* Narrows four pixels of 32-bit RGBA, two to a vector, to 16-bit RGBA */
+static ALWAYS_INLINE __m256i
+narrow_rgba16(__m256i p01, __m256i p23)
+{
+   return _mm256_permute4x64_epi64(_mm256_packus_epi32(p01, p23),
+                                   _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+/* Loads eight pixels of 16-bit elements as 16-bit RGBA */
+static ALWAYS_INLINE void
+load_unpack16(const struct avx2_format *f, unsigned nr,
+              const uint8_t *src, __m256i *p0123, __m256i *p4567)
+{
+   __m256i lo, hi;
+
+   if (nr == 4) {
+      lo = _mm256_loadu_si256((const __m256i *)src);
+      hi = _mm256_loadu_si256((const __m256i *)(src + 32));
+   } else {
+      lo = load_lanes(src, 16);
+      hi = nr == 2 ? load_lanes(src + 16, 16) : lo;
+   }
+
+   *p0123 = _mm256_shuffle_epi8(lo, f->unpack[0]);
+   *p4567 = _mm256_shuffle_epi8(hi, f->unpack[1]);
+}
+
+/* Stores eight pixels of 16-bit elements from 16-bit RGBA */
+static ALWAYS_INLINE void
+store_pack16(const struct avx2_format *f, unsigned nr, uint8_t *dst,
+             __m256i p0123, __m256i p4567)
+{
+   store_lanes(dst, _mm256_shuffle_epi8(p0123, f->pack), 4 * nr);
+   store_lanes(dst + 8 * nr, _mm256_shuffle_epi8(p4567, f->pack), 4 * nr);
+}
+
+/*
+ * 8-bit unorm elements
+ */
+
+static ALWAYS_INLINE void
+unorm8_unpack_rgba_8unorm(const struct avx2_format *f, unsigned nr,
+                          uint8_t *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i rgba = _mm256_shuffle_epi8(load_lanes(src, 8 * nr), f->unpack[0]);
+
+      _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(rgba, f->ones8));
+      src += 8 * nr;
+      dst += 32;
+   }
+   util_format_simd_unpack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_unpack_rgba_float(const struct avx2_format *f, unsigned nr,
+                         float *restrict dst, const uint8_t *restrict src,
+                         unsigned width)
+{
+   const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+
+   for (; width >= 8; width -= 8) {
+      __m256i rgba = _mm256_shuffle_epi8(load_lanes(src, 8 * nr), f->unpack[0]);
+      __m128i half[2] = {
+         _mm256_castsi256_si128(rgba),
+         _mm256_extracti128_si256(rgba, 1),
+      };
+
+      for (unsigned i = 0; i < 4; i++) {
+         __m128i pair = i & 1 ? _mm_srli_si128(half[i / 2], 8) : half[i / 2];
+         __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(pair));
+
+         _mm256_storeu_ps(dst + 8 * i, _mm256_or_ps(_mm256_mul_ps(c, scale), f->ones));
+      }
+      src += 8 * nr;
+      dst += 32;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_pack_rgba_8unorm(const struct avx2_format *f, unsigned nr,
+                        uint8_t *restrict dst, const uint8_t *restrict src,
+                        unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i rgba = _mm256_loadu_si256((const __m256i *)src);
+
+      store_lanes(dst, _mm256_shuffle_epi8(rgba, f->pack), 4 * nr);
+      src += 32;
+      dst += 8 * nr;
+   }
+   util_format_simd_pack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_pack_rgba_float(const struct avx2_format *f, unsigned nr,
+                       uint8_t *restrict dst, const float *restrict src,
+                       unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i rgba = narrow_rgba8(float_to_ubyte_avx2(_mm256_loadu_ps(src)),
+                                  float_to_ubyte_avx2(_mm256_loadu_ps(src + 8)),
+                                  float_to_ubyte_avx2(_mm256_loadu_ps(src + 16)),
+                                  float_to_ubyte_avx2(_mm256_loadu_ps(src + 24)));
+
+      store_lanes(dst, _mm256_shuffle_epi8(rgba, f->pack), 4 * nr);
+      src += 32;
+      dst += 8 * nr;
+   }
+   util_format_simd_pack_tail_float(&f->layout, dst, src, width);
+}
+
+/*
+ * 16-bit unorm elements
+ */
+
+static ALWAYS_INLINE void
+unorm16_unpack_rgba_8unorm(const struct avx2_format *f, unsigned nr,
+                           uint8_t *restrict dst, const uint8_t *restrict src,
+                           unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i p0123, p4567;
+
+      load_unpack16(f, nr, src, &p0123, &p4567);
+
+      __m256i rgba = narrow_rgba8(
+         unorm16_to_unorm8_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(p0123))),
+         unorm16_to_unorm8_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(p0123, 1))),
+         unorm16_to_unorm8_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(p4567))),
+         unorm16_to_unorm8_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(p4567, 1))));
+
+      _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(rgba, f->ones8));
+      src += 16 * nr;
+      dst += 32;
+   }
+   util_format_simd_unpack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm16_unpack_rgba_float(const struct avx2_format *f, unsigned nr,
+                          float *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   const __m256 scale = _mm256_set1_ps(1.0f / 0xffff);
+
+   for (; width >= 8; width -= 8) {
+      __m256i p[2];
+
+      load_unpack16(f, nr, src, &p[0], &p[1]);
+
+      for (unsigned i = 0; i < 4; i++) {
+         __m128i pair = i & 1 ? _mm256_extracti128_si256(p[i / 2], 1) :
+                                _mm256_castsi256_si128(p[i / 2]);
+         __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(pair));
+
+         _mm256_storeu_ps(dst + 8 * i, _mm256_or_ps(_mm256_mul_ps(c, scale), f->ones));
+      }
+      src += 16 * nr;
+      dst += 32;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm16_pack_rgba_8unorm(const struct avx2_format *f, unsigned nr,
+                         uint8_t *restrict dst, const uint8_t *restrict src,
+                         unsigned width)
+{
+   /* EXTEND_NORMALIZED_INT(x, 8, 16) is x * 0x101 */
+   const __m256i extend = _mm256_set1_epi16(0x101);
+
+   for (; width >= 8; width -= 8) {
+      __m256i rgba = _mm256_loadu_si256((const __m256i *)src);
+      __m256i p0123 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(rgba));
+      __m256i p4567 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(rgba, 1));
+
+      store_pack16(f, nr, dst, _mm256_mullo_epi16(p0123, extend),
+                   _mm256_mullo_epi16(p4567, extend));
+      src += 32;
+      dst += 16 * nr;
+   }
+   util_format_simd_pack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm16_pack_rgba_float(const struct avx2_format *f, unsigned nr,
+                        uint8_t *restrict dst, const float *restrict src,
+                        unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i p0123 = narrow_rgba16(float_to_unorm16_avx2(_mm256_loadu_ps(src)),
+                                    float_to_unorm16_avx2(_mm256_loadu_ps(src + 8)));
+      __m256i p4567 = narrow_rgba16(float_to_unorm16_avx2(_mm256_loadu_ps(src + 16)),
+                                    float_to_unorm16_avx2(_mm256_loadu_ps(src + 24)));
+
+      store_pack16(f, nr, dst, p0123, p4567);
+      src += 32;
+      dst += 16 * nr;
+   }
+   util_format_simd_pack_tail_float(&f->layout, dst, src, width);
+}
+
+/*
+ * 16-bit float elements
+ *
+ * The C code converts with F16C under USE_X86_64_ASM when the CPU has it,
+ * and is only matched then.  -mavx2 doesn't enable F16C, so these use the
+ * same inline assembly as half_float.h.
+ */
+
+#if defined(USE_X86_64_ASM)
+
+static ALWAYS_INLINE __m256
+half_to_float_avx2(__m128i h)
+{
+   __m256 f;
+
+   __asm("vcvtph2ps %1, %0" : "=x"(f) : "x"(h));
+   return f;
+}
+
+/* _mesa_float_to_float16_rtz() */
+static ALWAYS_INLINE __m128i
+float_to_half_rtz_avx2(__m256 f)
+{
+   __m128i h;
+
+   /* $3 = round towards zero (truncate) */
+   __asm("vcvtps2ph $3, %1, %0" : "=x"(h) : "x"(f));
+   return h;
+}
+
+static ALWAYS_INLINE void
+float16_unpack_rgba_8unorm(const struct avx2_format *f, unsigned nr,
+                           uint8_t *restrict dst, const uint8_t *restrict src,
+                           unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i p0123, p4567;
+
+      load_unpack16(f, nr, src, &p0123, &p4567);
+
+      __m256i rgba = narrow_rgba8(
+         float_to_ubyte_avx2(half_to_float_avx2(_mm256_castsi256_si128(p0123))),
+         float_to_ubyte_avx2(half_to_float_avx2(_mm256_extracti128_si256(p0123, 1))),
+         float_to_ubyte_avx2(half_to_float_avx2(_mm256_castsi256_si128(p4567))),
+         float_to_ubyte_avx2(half_to_float_avx2(_mm256_extracti128_si256(p4567, 1))));
+
+      _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(rgba, f->ones8));
+      src += 16 * nr;
+      dst += 32;
+   }
+   util_format_simd_unpack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+float16_unpack_rgba_float(const struct avx2_format *f, unsigned nr,
+                          float *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m256i p[2];
+
+      load_unpack16(f, nr, src, &p[0], &p[1]);
+
+      for (unsigned i = 0; i < 4; i++) {
+         __m128i pair = i & 1 ? _mm256_extracti128_si256(p[i / 2], 1) :
+                                _mm256_castsi256_si128(p[i / 2]);
+
+         _mm256_storeu_ps(dst + 8 * i, _mm256_or_ps(half_to_float_avx2(pair), f->ones));
+      }
+      src += 16 * nr;
+      dst += 32;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+float16_pack_rgba_8unorm(const struct avx2_format *f, unsigned nr,
+                         uint8_t *restrict dst, const uint8_t *restrict src,
+                         unsigned width)
+{
+   const __m256 scale = _mm256_set1_ps(1.0f / 0xff);
+
+   for (; width >= 8; width -= 8) {
+      __m256i rgba = _mm256_loadu_si256((const __m256i *)src);
+      __m128i half[2] = {
+         _mm256_castsi256_si128(rgba),
+         _mm256_extracti128_si256(rgba, 1),
+      };
+      __m128i h[4];
+
+      for (unsigned i = 0; i < 4; i++) {
+         __m128i pair = i & 1 ? _mm_srli_si128(half[i / 2], 8) : half[i / 2];
+         __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(pair));
+
+         h[i] = float_to_half_rtz_avx2(_mm256_mul_ps(c, scale));
+      }
+
+      store_pack16(f, nr, dst, _mm256_set_m128i(h[1], h[0]),
+                   _mm256_set_m128i(h[3], h[2]));
+      src += 32;
+      dst += 16 * nr;
+   }
+   util_format_simd_pack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+float16_pack_rgba_float(const struct avx2_format *f, unsigned nr,
+                        uint8_t *restrict dst, const float *restrict src,
+                        unsigned width)
+{
+   for (; width >= 8; width -= 8) {
+      __m128i h0 = float_to_half_rtz_avx2(_mm256_loadu_ps(src));
+      __m128i h1 = float_to_half_rtz_avx2(_mm256_loadu_ps(src + 8));
+      __m128i h2 = float_to_half_rtz_avx2(_mm256_loadu_ps(src + 16));
+      __m128i h3 = float_to_half_rtz_avx2(_mm256_loadu_ps(src + 24));
+
+      store_pack16(f, nr, dst, _mm256_set_m128i(h1, h0), _mm256_set_m128i(h3, h2));
+      src += 32;
+      dst += 16 * nr;
+   }
+   util_format_simd_pack_tail_float(&f->layout, dst, src, width);
+}
+
+#endif /* USE_X86_64_ASM */
+
+/*
+ * Per-format entry points, from u_format_simd_table.h
+ */
+
+#define AVX2_FORMAT(type, format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3)    \
+   static struct avx2_format name##_avx2 = {                                   \
+      .layout = UTIL_FORMAT_SIMD_LAYOUT(format, nr, u0, u1, u2, u3,            \
+                                        p0, p1, p2, p3),                       \
+   };                                                                          \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_unpack_rgba_8unorm_avx2(uint8_t *restrict dst,         \
+                                                const uint8_t *restrict src,   \
+                                                unsigned width)                \
+   {                                                                           \
+      type##_unpack_rgba_8unorm(&name##_avx2, nr, dst, src, width);            \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_unpack_rgba_float_avx2(void *restrict dst,             \
+                                               const uint8_t *restrict src,    \
+                                               unsigned width)                 \
+   {                                                                           \
+      type##_unpack_rgba_float(&name##_avx2, nr, dst, src, width);             \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_pack_rgba_8unorm_avx2(uint8_t *restrict dst,           \
+                                              unsigned dst_stride,             \
+                                              const uint8_t *restrict src,     \
+                                              unsigned src_stride,             \
+                                              unsigned width, unsigned height) \
+   {                                                                           \
+      for (unsigned y = 0; y < height; y++) {                                  \
+         type##_pack_rgba_8unorm(&name##_avx2, nr, dst, src, width);           \
+         dst += dst_stride;                                                    \
+         src += src_stride;                                                    \
+      }                                                                        \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_pack_rgba_float_avx2(uint8_t *restrict dst,            \
+                                             unsigned dst_stride,              \
+                                             const float *restrict src,        \
+                                             unsigned src_stride,              \
+                                             unsigned width, unsigned height)  \
+   {                                                                           \
+      for (unsigned y = 0; y < height; y++) {                                  \
+         type##_pack_rgba_float(&name##_avx2, nr, dst, src, width);            \
+         dst += dst_stride;                                                    \
+         src += src_stride / sizeof(*src);                                     \
+      }                                                                        \
+   }
+
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, nr, ...) \
+   AVX2_FORMAT(unorm8, format, name, nr, __VA_ARGS__)
+#define UTIL_FORMAT_SIMD_UNORM16(format, name, nr, ...) \
+   AVX2_FORMAT(unorm16, format, name, nr, __VA_ARGS__)
+#if defined(USE_X86_64_ASM)
+#define UTIL_FORMAT_SIMD_FLOAT16(format, name, nr, ...) \
+   AVX2_FORMAT(float16, format, name, nr, __VA_ARGS__)
+#endif
+#include "u_format_simd_table.h"
+
+#define AVX2_ENTRY(format, name, ...) &name##_avx2,
+static struct avx2_format *avx2_formats[] = {
+#define UTIL_FORMAT_SIMD_UNORM8 AVX2_ENTRY
+#define UTIL_FORMAT_SIMD_UNORM16 AVX2_ENTRY
+#if defined(USE_X86_64_ASM)
+#define UTIL_FORMAT_SIMD_FLOAT16 AVX2_ENTRY
+#endif
+#include "u_format_simd_table.h"
+};
+
+#define AVX2_UNPACK_DESC(format, name, ...)                                    \
+   [format] = {                                                                \
+      .unpack_rgba_8unorm = &util_format_##name##_unpack_rgba_8unorm_avx2,     \
+      .unpack_rgba = &util_format_##name##_unpack_rgba_float_avx2,             \
+   },
+static const struct util_format_unpack_description
+util_format_unpack_descriptions_avx2[PIPE_FORMAT_COUNT] = {
+#define UTIL_FORMAT_SIMD_UNORM8 AVX2_UNPACK_DESC
+#define UTIL_FORMAT_SIMD_UNORM16 AVX2_UNPACK_DESC
+#if defined(USE_X86_64_ASM)
+#define UTIL_FORMAT_SIMD_FLOAT16 AVX2_UNPACK_DESC
+#endif
+#include "u_format_simd_table.h"
+};
+
+#define AVX2_PACK_DESC(format, name, pack_8unorm)                              \
+   [format] = {                                                                \
+      .pack_rgba_8unorm = pack_8unorm,                                         \
+      .pack_rgba_float = &util_format_##name##_pack_rgba_float_avx2,           \
+   },
+static const struct util_format_pack_description
+util_format_pack_descriptions_avx2[PIPE_FORMAT_COUNT] = {
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3) \
+   AVX2_PACK_DESC(format, name,                                                \
+                  UTIL_FORMAT_SIMD_IS_RGBA8(nr, p0, p1, p2, p3) ?              \
+                  &util_format_##name##_pack_rgba_8unorm :                     \
+                  &util_format_##name##_pack_rgba_8unorm_avx2)
+#define UTIL_FORMAT_SIMD_UNORM16(format, name, ...) \
+   AVX2_PACK_DESC(format, name, &util_format_##name##_pack_rgba_8unorm_avx2)
+#if defined(USE_X86_64_ASM)
+#define UTIL_FORMAT_SIMD_FLOAT16(format, name, ...) \
+   AVX2_PACK_DESC(format, name, &util_format_##name##_pack_rgba_8unorm_avx2)
+#endif
+#include "u_format_simd_table.h"
+};
+
+static void
+avx2_format_init(struct avx2_format *f)
+{
+   const struct util_format_simd_layout *l = &f->layout;
+   const unsigned nr = l->nr;
+   uint8_t mask[2][32];
+
+   if (util_format_get_blocksize(l->format) == nr) {
+      util_format_simd_unpack_shuffle(mask[0], l, 1, 1, 0, 8, nr == 4 ? 4 : 8);
+      util_format_simd_pack_shuffle(mask[1], l, 1, 4, 4, 16);
+   } else {
+      const unsigned wrap = 8 / nr;
+
+      util_format_simd_unpack_shuffle(mask[0], l, 2, 2, 0, 4, wrap);
+      util_format_simd_unpack_shuffle(mask[1], l, 2, 2, 4, 4, wrap);
+      f->unpack[1] = _mm256_loadu_si256((const __m256i *)mask[1]);
+      util_format_simd_pack_shuffle(mask[1], l, 2, 2, 2, 16);
+   }
+   f->unpack[0] = _mm256_loadu_si256((const __m256i *)mask[0]);
+   f->pack = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)mask[1]));
+
+   util_format_simd_unpack_ones(mask[0], l, 1, 8, 0xff);
+   f->ones8 = _mm256_loadu_si256((const __m256i *)mask[0]);
+   util_format_simd_unpack_ones(mask[0], l, 4, 2, fui(1.0f));
+   f->ones = _mm256_loadu_ps((const float *)mask[0]);
+}
+
+static void
+avx2_init(void)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(avx2_formats); i++)
+      avx2_format_init(avx2_formats[i]);
+}
+
+static bool
+avx2_supported(enum pipe_format format)
+{
+   static once_flag flag = ONCE_FLAG_INIT;
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+
+   if (!caps->has_avx2 || (util_format_is_float(format) && !caps->has_f16c))
+      return false;
+
+   call_once(&flag, avx2_init);
+   return true;
+}
+
+const struct util_format_unpack_description *
+util_format_unpack_description_avx2(enum pipe_format format)
+{
+   if (!util_format_unpack_descriptions_avx2[format].unpack_rgba ||
+       !avx2_supported(format))
+      return NULL;
+
+   return &util_format_unpack_descriptions_avx2[format];
+}
+
+const struct util_format_pack_description *
+util_format_pack_description_avx2(enum pipe_format format)
+{
+   if (!util_format_pack_descriptions_avx2[format].pack_rgba_float ||
+       !avx2_supported(format))
+      return NULL;
+
+   return &util_format_pack_descriptions_avx2[format];
+}
+
+#else
+
+const struct util_format_unpack_description *
+util_format_unpack_description_avx2(enum pipe_format format)
+{
+   return NULL;
+}
+
+const struct util_format_pack_description *
+util_format_pack_description_avx2(enum pipe_format format)
+{
+   return NULL;
+}
+
+#endif /* __AVX2__ */
@@ -0,0 +1,491 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* SSE4.1 pack/unpack row kernels for the 8 and 16-bit unorm array formats,
+ * four pixels at a time.  Built with -msse4.1 and only used when the CPU
+ * supports it.
+ */
+
+#include "util/format/u_format_simd.h"
+
+#if defined(__SSE4_1__)
+
+#include <smmintrin.h>
+
+#include "c11/threads.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+
+#include "u_format_pack.h"
+
+struct sse41_format {
+   struct util_format_simd_layout layout;
+   /* 8-bit elements: four pixels to 8-bit RGBA.
+    * 16-bit elements: pixels 0-1 and 2-3 to 16-bit RGBA.
+    */
+   __m128i unpack[2];
+   /* 16-bit elements: pixel i to 32-bit RGBA */
+   __m128i unpack32[4];
+   /* Four 8-bit RGBA pixels, or two 16-bit ones, to elements */
+   __m128i pack;
+   __m128i ones8;
+   __m128 ones;
+};
+
+static ALWAYS_INLINE __m128i
+load_bytes(const uint8_t *src, unsigned size)
+{
+   if (size == 4) {
+      uint32_t value;
+      memcpy(&value, src, sizeof(value));
+      return _mm_cvtsi32_si128(value);
+   } else if (size == 8) {
+      return _mm_loadl_epi64((const __m128i *)src);
+   } else {
+      return _mm_loadu_si128((const __m128i *)src);
+   }
+}
+
+static ALWAYS_INLINE void
+store_bytes(uint8_t *dst, __m128i value, unsigned size)
+{
+   if (size == 4) {
+      uint32_t bits = _mm_cvtsi128_si32(value);
+      memcpy(dst, &bits, sizeof(bits));
+   } else if (size == 8) {
+      _mm_storel_epi64((__m128i *)dst, value);
+   } else {
+      _mm_storeu_si128((__m128i *)dst, value);
+   }
+}
+
+/* float_to_ubyte(), in the low byte of each 32-bit lane */
+static ALWAYS_INLINE __m128i
+float_to_ubyte_sse41(__m128 f)
+{
+   /* Separate multiply and add, as in the C version */
+   __m128 biased = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f / 256.0f)),
+                              _mm_set1_ps(32768.0f));
+   __m128i bits = _mm_or_si128(_mm_castps_si128(biased),
+                               _mm_castps_si128(_mm_cmpge_ps(f, _mm_set1_ps(1.0f))));
+
+   bits = _mm_and_si128(bits, _mm_castps_si128(_mm_cmpgt_ps(f, _mm_setzero_ps())));
+   return _mm_and_si128(bits, _mm_set1_epi32(0xff));
+}
+
+/* (uint16_t)util_iround(CLAMP(f, 0.0f, 1.0f) * 0xffff) */
+static ALWAYS_INLINE __m128i
+float_to_unorm16_sse41(__m128 f)
+{
+   /* MAXPS returns the second operand for NaN, like CLAMP() gives 0 */
+   f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   return _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set1_ps(65535.0f)));
+}
+
+/* _mesa_unorm_to_unorm(x, 16, 8) of 32-bit lanes */
+static ALWAYS_INLINE __m128i
+unorm16_to_unorm8_sse41(__m128i x)
+{
+   /* (x * 255 + 32767) / 65535 == (n + (n >> 16) + 1) >> 16 for 16-bit x */
+   __m128i n = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(x, 8), x),
+                             _mm_set1_epi32(32767));
+
+   n = _mm_add_epi32(_mm_add_epi32(n, _mm_srli_epi32(n, 16)), _mm_set1_epi32(1));
+   return _mm_srli_epi32(n, 16);
+}
+
+/* Stores four pixels of 16-bit elements, from the pack shuffle of pixels
+ * 0-1 and 2-3.
+ */
+static ALWAYS_INLINE void
+store_elements16(uint8_t *dst, __m128i p01, __m128i p23, unsigned nr)
+{
+   if (nr == 1) {
+      _mm_storel_epi64((__m128i *)dst, _mm_unpacklo_epi32(p01, p23));
+   } else if (nr == 2) {
+      _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(p01, p23));
+   } else {
+      _mm_storeu_si128((__m128i *)dst, p01);
+      _mm_storeu_si128((__m128i *)(dst + 16), p23);
+   }
+}
+
+/* Loads four pixels of 16-bit elements as 16-bit RGBA */
+static ALWAYS_INLINE void
+load_unpack16(const struct sse41_format *f, unsigned nr,
+              const uint8_t *src, __m128i *p01, __m128i *p23)
+{
+   __m128i lo = load_bytes(src, MIN2(8 * nr, 16));
+   __m128i hi = nr == 4 ? _mm_loadu_si128((const __m128i *)(src + 16)) : lo;
+
+   *p01 = _mm_shuffle_epi8(lo, f->unpack[0]);
+   *p23 = _mm_shuffle_epi8(hi, f->unpack[1]);
+}
+
+/*
+ * 8-bit unorm elements
+ */
+
+static ALWAYS_INLINE void
+unorm8_unpack_rgba_8unorm(const struct sse41_format *f, unsigned nr,
+                          uint8_t *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i rgba = _mm_shuffle_epi8(load_bytes(src, 4 * nr), f->unpack[0]);
+
+      _mm_storeu_si128((__m128i *)dst, _mm_or_si128(rgba, f->ones8));
+      src += 4 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_unpack_rgba_float(const struct sse41_format *f, unsigned nr,
+                         float *restrict dst, const uint8_t *restrict src,
+                         unsigned width)
+{
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+
+   for (; width >= 4; width -= 4) {
+      __m128i rgba = _mm_shuffle_epi8(load_bytes(src, 4 * nr), f->unpack[0]);
+
+      for (unsigned i = 0; i < 4; i++) {
+         __m128 c = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(rgba));
+
+         _mm_storeu_ps(dst + 4 * i, _mm_or_ps(_mm_mul_ps(c, scale), f->ones));
+         rgba = _mm_srli_si128(rgba, 4);
+      }
+      src += 4 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_pack_rgba_8unorm(const struct sse41_format *f, unsigned nr,
+                        uint8_t *restrict dst, const uint8_t *restrict src,
+                        unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i rgba = _mm_loadu_si128((const __m128i *)src);
+
+      store_bytes(dst, _mm_shuffle_epi8(rgba, f->pack), 4 * nr);
+      src += 16;
+      dst += 4 * nr;
+   }
+   util_format_simd_pack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_pack_rgba_float(const struct sse41_format *f, unsigned nr,
+                       uint8_t *restrict dst, const float *restrict src,
+                       unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i p0 = float_to_ubyte_sse41(_mm_loadu_ps(src));
+      __m128i p1 = float_to_ubyte_sse41(_mm_loadu_ps(src + 4));
+      __m128i p2 = float_to_ubyte_sse41(_mm_loadu_ps(src + 8));
+      __m128i p3 = float_to_ubyte_sse41(_mm_loadu_ps(src + 12));
+      __m128i rgba = _mm_packus_epi16(_mm_packus_epi32(p0, p1),
+                                      _mm_packus_epi32(p2, p3));
+
+      store_bytes(dst, _mm_shuffle_epi8(rgba, f->pack), 4 * nr);
+      src += 16;
+      dst += 4 * nr;
+   }
+   util_format_simd_pack_tail_float(&f->layout, dst, src, width);
+}
+
+/*
+ * 16-bit unorm elements
+ */
+
+static ALWAYS_INLINE void
+unorm16_unpack_rgba_8unorm(const struct sse41_format *f, unsigned nr,
+                           uint8_t *restrict dst, const uint8_t *restrict src,
+                           unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i p01, p23;
+
+      load_unpack16(f, nr, src, &p01, &p23);
+
+      __m128i p0 = unorm16_to_unorm8_sse41(_mm_cvtepu16_epi32(p01));
+      __m128i p1 = unorm16_to_unorm8_sse41(_mm_cvtepu16_epi32(_mm_srli_si128(p01, 8)));
+      __m128i p2 = unorm16_to_unorm8_sse41(_mm_cvtepu16_epi32(p23));
+      __m128i p3 = unorm16_to_unorm8_sse41(_mm_cvtepu16_epi32(_mm_srli_si128(p23, 8)));
+      __m128i rgba = _mm_packus_epi16(_mm_packus_epi32(p0, p1),
+                                      _mm_packus_epi32(p2, p3));
+
+      _mm_storeu_si128((__m128i *)dst, _mm_or_si128(rgba, f->ones8));
+      src += 8 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm16_unpack_rgba_float(const struct sse41_format *f, unsigned nr,
+                          float *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   const __m128 scale = _mm_set1_ps(1.0f / 0xffff);
+
+   for (; width >= 4; width -= 4) {
+      __m128i lo = load_bytes(src, MIN2(8 * nr, 16));
+      __m128i hi = nr == 4 ? _mm_loadu_si128((const __m128i *)(src + 16)) : lo;
+
+      for (unsigned i = 0; i < 4; i++) {
+         __m128i x = _mm_shuffle_epi8(i < 2 ? lo : hi, f->unpack32[i]);
+         __m128 c = _mm_mul_ps(_mm_cvtepi32_ps(x), scale);
+
+         _mm_storeu_ps(dst + 4 * i, _mm_or_ps(c, f->ones));
+      }
+      src += 8 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm16_pack_rgba_8unorm(const struct sse41_format *f, unsigned nr,
+                         uint8_t *restrict dst, const uint8_t *restrict src,
+                         unsigned width)
+{
+   /* EXTEND_NORMALIZED_INT(x, 8, 16) is x * 0x101 */
+   const __m128i extend = _mm_set1_epi16(0x101);
+
+   for (; width >= 4; width -= 4) {
+      __m128i rgba = _mm_loadu_si128((const __m128i *)src);
+      __m128i p01 = _mm_mullo_epi16(_mm_cvtepu8_epi16(rgba), extend);
+      __m128i p23 = _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(rgba, 8)), extend);
+
+      store_elements16(dst, _mm_shuffle_epi8(p01, f->pack),
+                       _mm_shuffle_epi8(p23, f->pack), nr);
+      src += 16;
+      dst += 8 * nr;
+   }
+   util_format_simd_pack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm16_pack_rgba_float(const struct sse41_format *f, unsigned nr,
+                        uint8_t *restrict dst, const float *restrict src,
+                        unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i p01 = _mm_packus_epi32(float_to_unorm16_sse41(_mm_loadu_ps(src)),
+                                     float_to_unorm16_sse41(_mm_loadu_ps(src + 4)));
+      __m128i p23 = _mm_packus_epi32(float_to_unorm16_sse41(_mm_loadu_ps(src + 8)),
+                                     float_to_unorm16_sse41(_mm_loadu_ps(src + 12)));
+
+      store_elements16(dst, _mm_shuffle_epi8(p01, f->pack),
+                       _mm_shuffle_epi8(p23, f->pack), nr);
+      src += 16;
+      dst += 8 * nr;
+   }
+   util_format_simd_pack_tail_float(&f->layout, dst, src, width);
+}
+
+/*
+ * Per-format entry points, from u_format_simd_table.h
+ */
+
+#define SSE41_FORMAT(type, format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3)   \
+   static struct sse41_format name##_sse41 = {                                 \
+      .layout = UTIL_FORMAT_SIMD_LAYOUT(format, nr, u0, u1, u2, u3,            \
+                                        p0, p1, p2, p3),                       \
+   };                                                                          \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_unpack_rgba_8unorm_sse41(uint8_t *restrict dst,        \
+                                                const uint8_t *restrict src,   \
+                                                unsigned width)                \
+   {                                                                           \
+      type##_unpack_rgba_8unorm(&name##_sse41, nr, dst, src, width);           \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_unpack_rgba_float_sse41(void *restrict dst,            \
+                                               const uint8_t *restrict src,    \
+                                               unsigned width)                 \
+   {                                                                           \
+      type##_unpack_rgba_float(&name##_sse41, nr, dst, src, width);            \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_pack_rgba_8unorm_sse41(uint8_t *restrict dst,          \
+                                              unsigned dst_stride,             \
+                                              const uint8_t *restrict src,     \
+                                              unsigned src_stride,             \
+                                              unsigned width, unsigned height) \
+   {                                                                           \
+      for (unsigned y = 0; y < height; y++) {                                  \
+         type##_pack_rgba_8unorm(&name##_sse41, nr, dst, src, width);          \
+         dst += dst_stride;                                                    \
+         src += src_stride;                                                    \
+      }                                                                        \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_pack_rgba_float_sse41(uint8_t *restrict dst,           \
+                                             unsigned dst_stride,              \
+                                             const float *restrict src,        \
+                                             unsigned src_stride,              \
+                                             unsigned width, unsigned height)  \
+   {                                                                           \
+      for (unsigned y = 0; y < height; y++) {                                  \
+         type##_pack_rgba_float(&name##_sse41, nr, dst, src, width);           \
+         dst += dst_stride;                                                    \
+         src += src_stride / sizeof(*src);                                     \
+      }                                                                        \
+   }
+
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, nr, ...) \
+   SSE41_FORMAT(unorm8, format, name, nr, __VA_ARGS__)
+#define UTIL_FORMAT_SIMD_UNORM16(format, name, nr, ...) \
+   SSE41_FORMAT(unorm16, format, name, nr, __VA_ARGS__)
+#include "u_format_simd_table.h"
+
+#define SSE41_ENTRY(format, name, ...) &name##_sse41,
+static struct sse41_format *sse41_formats[] = {
+#define UTIL_FORMAT_SIMD_UNORM8 SSE41_ENTRY
+#define UTIL_FORMAT_SIMD_UNORM16 SSE41_ENTRY
+#include "u_format_simd_table.h"
+};
+
+#define SSE41_UNPACK_DESC(format, name, ...)                                   \
+   [format] = {                                                                \
+      .unpack_rgba_8unorm = &util_format_##name##_unpack_rgba_8unorm_sse41,    \
+      .unpack_rgba = &util_format_##name##_unpack_rgba_float_sse41,            \
+   },
+static const struct util_format_unpack_description
+util_format_unpack_descriptions_sse41[PIPE_FORMAT_COUNT] = {
+#define UTIL_FORMAT_SIMD_UNORM8 SSE41_UNPACK_DESC
+#define UTIL_FORMAT_SIMD_UNORM16 SSE41_UNPACK_DESC
+#include "u_format_simd_table.h"
+};
+
+#define SSE41_PACK_DESC(format, name, pack_8unorm)                             \
+   [format] = {                                                                \
+      .pack_rgba_8unorm = pack_8unorm,                                         \
+      .pack_rgba_float = &util_format_##name##_pack_rgba_float_sse41,          \
+   },
+static const struct util_format_pack_description
+util_format_pack_descriptions_sse41[PIPE_FORMAT_COUNT] = {
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3) \
+   SSE41_PACK_DESC(format, name,                                               \
+                   UTIL_FORMAT_SIMD_IS_RGBA8(nr, p0, p1, p2, p3) ?             \
+                   &util_format_##name##_pack_rgba_8unorm :                    \
+                   &util_format_##name##_pack_rgba_8unorm_sse41)
+#define UTIL_FORMAT_SIMD_UNORM16(format, name, ...) \
+   SSE41_PACK_DESC(format, name, &util_format_##name##_pack_rgba_8unorm_sse41)
+#include "u_format_simd_table.h"
+};
+
+static void
+sse41_format_init(struct sse41_format *f)
+{
+   const struct util_format_simd_layout *l = &f->layout;
+   uint8_t mask[2][16];
+
+   if (util_format_get_blocksize(l->format) == l->nr) {
+      util_format_simd_unpack_shuffle(mask[0], l, 1, 1, 0, 4, 4);
+      util_format_simd_pack_shuffle(mask[1], l, 1, 4, 4, 16);
+   } else {
+      const unsigned wrap = l->nr == 4 ? 2 : 4;
+
+      util_format_simd_unpack_shuffle(mask[0], l, 2, 2, 0, 2, wrap);
+      util_format_simd_unpack_shuffle(mask[1], l, 2, 2, 2, 2, wrap);
+      f->unpack[1] = _mm_loadu_si128((const __m128i *)mask[1]);
+      for (unsigned i = 0; i < 4; i++) {
+         util_format_simd_unpack_shuffle(mask[1], l, 2, 4, i, 1, wrap);
+         f->unpack32[i] = _mm_loadu_si128((const __m128i *)mask[1]);
+      }
+      util_format_simd_pack_shuffle(mask[1], l, 2, 2, 2, 16);
+   }
+   f->unpack[0] = _mm_loadu_si128((const __m128i *)mask[0]);
+   f->pack = _mm_loadu_si128((const __m128i *)mask[1]);
+
+   util_format_simd_unpack_ones(mask[0], l, 1, 4, 0xff);
+   f->ones8 = _mm_loadu_si128((const __m128i *)mask[0]);
+   util_format_simd_unpack_ones(mask[0], l, 4, 1, fui(1.0f));
+   f->ones = _mm_loadu_ps((const float *)mask[0]);
+}
+
+static void
+sse41_init(void)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(sse41_formats); i++)
+      sse41_format_init(sse41_formats[i]);
+}
+
+static bool
+sse41_supported(void)
+{
+   static once_flag flag = ONCE_FLAG_INIT;
+
+   if (!util_get_cpu_caps()->has_sse4_1)
+      return false;
+
+   call_once(&flag, sse41_init);
+   return true;
+}
+
+const struct util_format_unpack_description *
+util_format_unpack_description_sse41(enum pipe_format format)
+{
+   if (!util_format_unpack_descriptions_sse41[format].unpack_rgba ||
+       !sse41_supported())
+      return NULL;
+
+   return &util_format_unpack_descriptions_sse41[format];
+}
+
+const struct util_format_pack_description *
+util_format_pack_description_sse41(enum pipe_format format)
+{
+   if (!util_format_pack_descriptions_sse41[format].pack_rgba_float ||
+       !sse41_supported())
+      return NULL;
+
+   return &util_format_pack_descriptions_sse41[format];
+}
+
+#else
+
+const struct util_format_unpack_description *
+util_format_unpack_description_sse41(enum pipe_format format)
+{
+   return NULL;
+}
+
+const struct util_format_pack_description *
+util_format_pack_description_sse41(enum pipe_format format)
+{
+   return NULL;
+}
+
+#endif /* __SSE4_1__ */
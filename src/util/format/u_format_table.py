@@ -188,7 +188,7 @@ def write_format_table(formats):
 
     def generate_table_getter(type):
         suffix = ""
-        if type == "unpack_":
+        if type in ("pack_", "unpack_"):
             suffix = "_generic"
         print("ATTRIBUTE_RETURNS_NONNULL const struct util_format_%sdescription *" % type)
         print("util_format_%sdescription%s(enum pipe_format format)" % (type, suffix))
@@ -322,14 +322,23 @@ def main():
 
     sys.stdout2 = open(os.devnull, "w")
 
+    simd = False
+
     for arg in sys.argv[1:]:
         if arg == '--header':
             sys.stdout2 = sys.stdout
             sys.stdout = open(os.devnull, "w")
             continue
+        if arg == '--simd':
+            simd = True
+            continue
 
         formats.extend(parse(arg))
 
+    if simd:
+        u_format_pack.generate_simd(formats)
+        return
+
     write_format_table(formats)
 
 if __name__ == '__main__':
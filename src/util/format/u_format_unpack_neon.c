@@ -37,6 +37,8 @@
 #include "u_format_pack.h"
 #include "util/u_cpu_detect.h"
 
+#if DETECT_ARCH_ARM
+
 static void
 util_format_b8g8r8a8_unorm_unpack_rgba_8unorm_neon(uint8_t *restrict dst, const uint8_t *restrict src, unsigned width)
 {
@@ -63,10 +65,8 @@ const struct util_format_unpack_description *
 util_format_unpack_description_neon(enum pipe_format format)
 {
    /* CPU detect for NEON support.  On arm64, it's implied. */
-#if DETECT_ARCH_ARM
    if (!util_get_cpu_caps()->has_neon)
       return NULL;
-#endif
 
    if (format >= ARRAY_SIZE(util_format_unpack_descriptions_neon))
       return NULL;
@@ -77,4 +77,349 @@ util_format_unpack_description_neon(enum pipe_format format)
    return &util_format_unpack_descriptions_neon[format];
 }
 
+const struct util_format_pack_description *
+util_format_pack_description_neon(enum pipe_format format)
+{
+   return NULL;
+}
+
+#else /* DETECT_ARCH_AARCH64 */
+
+/*
+ * Row kernels for the array formats of u_format_simd_table.h, using TBL
+ * byte shuffles.  They cover unpacking, and packing from 8-bit unorm.
+ * Packing from float, and unpacking 16-bit float to 8-bit unorm, go through
+ * float_to_ubyte(), whose multiply-add the compiler may or may not fuse in
+ * the C code, so those are left to it.
+ */
+
+#include "c11/threads.h"
+#include "util/u_math.h"
+#include "u_format_simd.h"
+
+struct neon_format {
+   struct util_format_simd_layout layout;
+   /* 8-bit elements: four pixels to 8-bit RGBA.
+    * 16-bit elements: pixel i to 32-bit RGBA.
+    */
+   uint8x16_t unpack[4];
+   /* Four 8-bit RGBA pixels to 8-bit elements */
+   uint8x16_t pack;
+   uint8x16_t ones8;
+   uint32x4_t ones;
+};
+
+static ALWAYS_INLINE uint8x16_t
+load_bytes(const uint8_t *src, unsigned size)
+{
+   if (size == 4) {
+      uint32_t value;
+      memcpy(&value, src, sizeof(value));
+      return vreinterpretq_u8_u32(vsetq_lane_u32(value, vdupq_n_u32(0), 0));
+   } else if (size == 8) {
+      return vcombine_u8(vld1_u8(src), vdup_n_u8(0));
+   } else {
+      return vld1q_u8(src);
+   }
+}
+
+static ALWAYS_INLINE void
+store_bytes(uint8_t *dst, uint8x16_t value, unsigned size)
+{
+   if (size == 4) {
+      uint32_t bits = vgetq_lane_u32(vreinterpretq_u32_u8(value), 0);
+      memcpy(dst, &bits, sizeof(bits));
+   } else if (size == 8) {
+      vst1_u8(dst, vget_low_u8(value));
+   } else {
+      vst1q_u8(dst, value);
+   }
+}
+
+/* One unorm pixel of 32-bit RGBA to float, as (float)x * scale */
+static ALWAYS_INLINE void
+store_unorm_float(const struct neon_format *f, float *dst, uint32x4_t x,
+                  float32x4_t scale)
+{
+   float32x4_t c = vmulq_f32(vcvtq_f32_u32(x), scale);
+
+   vst1q_f32(dst, vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(c), f->ones)));
+}
+
+/* _mesa_half_to_float_slow(), which unlike FCVT leaves signaling NaNs alone */
+static ALWAYS_INLINE float32x4_t
+half_to_float_neon(uint32x4_t h)
+{
+   uint32x4_t bits = vshlq_n_u32(vandq_u32(h, vdupq_n_u32(0x7fff)), 13);
+   float32x4_t f = vmulq_f32(vreinterpretq_f32_u32(bits),
+                             vreinterpretq_f32_u32(vdupq_n_u32(0xef << 23)));
+   uint32x4_t infnan = vcgeq_f32(f, vdupq_n_f32(65536.0f));
+
+   bits = vorrq_u32(vreinterpretq_u32_f32(f), vandq_u32(infnan, vdupq_n_u32(0xff << 23)));
+   bits = vorrq_u32(bits, vshlq_n_u32(vandq_u32(h, vdupq_n_u32(0x8000)), 16));
+   return vreinterpretq_f32_u32(bits);
+}
+
+static ALWAYS_INLINE uint8x16_t
+select_channel(uint8x16x4_t v, unsigned swizzle)
+{
+   if (swizzle <= PIPE_SWIZZLE_W)
+      return v.val[swizzle];
+   return vdupq_n_u8(swizzle == PIPE_SWIZZLE_1 ? 0xff : 0);
+}
+
+static ALWAYS_INLINE void
+unorm8_unpack_rgba_8unorm(const struct neon_format *f, unsigned nr,
+                          unsigned u0, unsigned u1, unsigned u2, unsigned u3,
+                          uint8_t *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   if (nr == 4) {
+      /* Sixteen pixels at a time, with the channels deinterleaved */
+      for (; width >= 16; width -= 16) {
+         uint8x16x4_t load = vld4q_u8(src);
+         uint8x16x4_t rgba = { .val = {
+            select_channel(load, u0), select_channel(load, u1),
+            select_channel(load, u2), select_channel(load, u3),
+         } };
+
+         vst4q_u8(dst, rgba);
+         src += 16 * 4;
+         dst += 16 * 4;
+      }
+   } else {
+      for (; width >= 4; width -= 4) {
+         uint8x16_t rgba = vqtbl1q_u8(load_bytes(src, 4 * nr), f->unpack[0]);
+
+         vst1q_u8(dst, vorrq_u8(rgba, f->ones8));
+         src += 4 * nr;
+         dst += 16;
+      }
+   }
+   util_format_simd_unpack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_unpack_rgba_float(const struct neon_format *f, unsigned nr,
+                         float *restrict dst, const uint8_t *restrict src,
+                         unsigned width)
+{
+   const float32x4_t scale = vdupq_n_f32(1.0f / 255.0f);
+
+   for (; width >= 4; width -= 4) {
+      uint8x16_t rgba = vqtbl1q_u8(load_bytes(src, 4 * nr), f->unpack[0]);
+      uint16x8_t p01 = vmovl_u8(vget_low_u8(rgba));
+      uint16x8_t p23 = vmovl_high_u8(rgba);
+
+      store_unorm_float(f, dst, vmovl_u16(vget_low_u16(p01)), scale);
+      store_unorm_float(f, dst + 4, vmovl_high_u16(p01), scale);
+      store_unorm_float(f, dst + 8, vmovl_u16(vget_low_u16(p23)), scale);
+      store_unorm_float(f, dst + 12, vmovl_high_u16(p23), scale);
+      src += 4 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+unorm8_pack_rgba_8unorm(const struct neon_format *f, unsigned nr,
+                        uint8_t *restrict dst, const uint8_t *restrict src,
+                        unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      store_bytes(dst, vqtbl1q_u8(vld1q_u8(src), f->pack), 4 * nr);
+      src += 16;
+      dst += 4 * nr;
+   }
+   util_format_simd_pack_tail_8unorm(&f->layout, dst, src, width);
+}
+
+/* Four pixels of 16-bit elements, as 32-bit RGBA in p[0..3] */
+static ALWAYS_INLINE void
+load_unpack16(const struct neon_format *f, unsigned nr,
+              const uint8_t *src, uint32x4_t p[4])
+{
+   uint8x16_t lo = load_bytes(src, MIN2(8 * nr, 16));
+   uint8x16_t hi = nr == 4 ? vld1q_u8(src + 16) : lo;
+
+   for (unsigned i = 0; i < 4; i++)
+      p[i] = vreinterpretq_u32_u8(vqtbl1q_u8(i < 2 ? lo : hi, f->unpack[i]));
+}
+
+static ALWAYS_INLINE void
+unorm16_unpack_rgba_float(const struct neon_format *f, unsigned nr,
+                          float *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   const float32x4_t scale = vdupq_n_f32(1.0f / 0xffff);
+
+   for (; width >= 4; width -= 4) {
+      uint32x4_t p[4];
+
+      load_unpack16(f, nr, src, p);
+      for (unsigned i = 0; i < 4; i++)
+         store_unorm_float(f, dst + 4 * i, p[i], scale);
+      src += 8 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+static ALWAYS_INLINE void
+float16_unpack_rgba_float(const struct neon_format *f, unsigned nr,
+                          float *restrict dst, const uint8_t *restrict src,
+                          unsigned width)
+{
+   for (; width >= 4; width -= 4) {
+      uint32x4_t p[4];
+
+      load_unpack16(f, nr, src, p);
+      for (unsigned i = 0; i < 4; i++) {
+         uint32x4_t c = vreinterpretq_u32_f32(half_to_float_neon(p[i]));
+         vst1q_f32(dst + 4 * i, vreinterpretq_f32_u32(vorrq_u32(c, f->ones)));
+      }
+      src += 8 * nr;
+      dst += 16;
+   }
+   util_format_simd_unpack_tail_float(&f->layout, dst, src, width);
+}
+
+#define NEON_FORMAT(type, format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3)    \
+   static struct neon_format name##_neon = {                                   \
+      .layout = UTIL_FORMAT_SIMD_LAYOUT(format, nr, u0, u1, u2, u3,            \
+                                        p0, p1, p2, p3),                       \
+   };                                                                          \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_unpack_rgba_float_neon(void *restrict dst,             \
+                                              const uint8_t *restrict src,     \
+                                              unsigned width)                  \
+   {                                                                           \
+      type##_unpack_rgba_float(&name##_neon, nr, dst, src, width);             \
+   }
+
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, nr, u0, u1, u2, u3, ...)         \
+   NEON_FORMAT(unorm8, format, name, nr, u0, u1, u2, u3, __VA_ARGS__)          \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_unpack_rgba_8unorm_neon(uint8_t *restrict dst,         \
+                                               const uint8_t *restrict src,    \
+                                               unsigned width)                 \
+   {                                                                           \
+      unorm8_unpack_rgba_8unorm(&name##_neon, nr, u0, u1, u2, u3,              \
+                                dst, src, width);                              \
+   }                                                                           \
+                                                                               \
+   static void                                                                 \
+   util_format_##name##_pack_rgba_8unorm_neon(uint8_t *restrict dst,           \
+                                             unsigned dst_stride,              \
+                                             const uint8_t *restrict src,      \
+                                             unsigned src_stride,              \
+                                             unsigned width, unsigned height)  \
+   {                                                                           \
+      for (unsigned y = 0; y < height; y++) {                                  \
+         unorm8_pack_rgba_8unorm(&name##_neon, nr, dst, src, width);           \
+         dst += dst_stride;                                                    \
+         src += src_stride;                                                    \
+      }                                                                        \
+   }
+#define UTIL_FORMAT_SIMD_UNORM16(format, name, nr, ...) \
+   NEON_FORMAT(unorm16, format, name, nr, __VA_ARGS__)
+#define UTIL_FORMAT_SIMD_FLOAT16(format, name, nr, ...) \
+   NEON_FORMAT(float16, format, name, nr, __VA_ARGS__)
+#include "u_format_simd_table.h"
+
+#define NEON_ENTRY(format, name, ...) &name##_neon,
+static struct neon_format *neon_formats[] = {
+#define UTIL_FORMAT_SIMD_UNORM8 NEON_ENTRY
+#define UTIL_FORMAT_SIMD_UNORM16 NEON_ENTRY
+#define UTIL_FORMAT_SIMD_FLOAT16 NEON_ENTRY
+#include "u_format_simd_table.h"
+};
+
+#define NEON_UNPACK_DESC(format, name, unpack_8unorm)                          \
+   [format] = {                                                                \
+      .unpack_rgba_8unorm = unpack_8unorm,                                     \
+      .unpack_rgba = &util_format_##name##_unpack_rgba_float_neon,             \
+   },
+static const struct util_format_unpack_description
+util_format_unpack_descriptions_neon[PIPE_FORMAT_COUNT] = {
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, ...) \
+   NEON_UNPACK_DESC(format, name, &util_format_##name##_unpack_rgba_8unorm_neon)
+#define UTIL_FORMAT_SIMD_UNORM16(format, name, ...) \
+   NEON_UNPACK_DESC(format, name, &util_format_##name##_unpack_rgba_8unorm)
+#define UTIL_FORMAT_SIMD_FLOAT16(format, name, ...) \
+   NEON_UNPACK_DESC(format, name, &util_format_##name##_unpack_rgba_8unorm)
+#include "u_format_simd_table.h"
+};
+
+static const struct util_format_pack_description
+util_format_pack_descriptions_neon[PIPE_FORMAT_COUNT] = {
+#define UTIL_FORMAT_SIMD_UNORM8(format, name, nr, u0, u1, u2, u3, p0, p1, p2, p3) \
+   [format] = {                                                                \
+      .pack_rgba_8unorm = UTIL_FORMAT_SIMD_IS_RGBA8(nr, p0, p1, p2, p3) ?      \
+                          &util_format_##name##_pack_rgba_8unorm :             \
+                          &util_format_##name##_pack_rgba_8unorm_neon,         \
+      .pack_rgba_float = &util_format_##name##_pack_rgba_float,                \
+   },
+#include "u_format_simd_table.h"
+};
+
+static void
+neon_format_init(struct neon_format *f)
+{
+   const struct util_format_simd_layout *l = &f->layout;
+   uint8_t mask[16];
+
+   if (util_format_get_blocksize(l->format) == l->nr) {
+      util_format_simd_unpack_shuffle(mask, l, 1, 1, 0, 4, 4);
+      f->unpack[0] = vld1q_u8(mask);
+      util_format_simd_pack_shuffle(mask, l, 1, 4, 4, 16);
+      f->pack = vld1q_u8(mask);
+   } else {
+      const unsigned wrap = l->nr == 4 ? 2 : 4;
+
+      for (unsigned i = 0; i < 4; i++) {
+         util_format_simd_unpack_shuffle(mask, l, 2, 4, i, 1, wrap);
+         f->unpack[i] = vld1q_u8(mask);
+      }
+   }
+
+   util_format_simd_unpack_ones(mask, l, 1, 4, 0xff);
+   f->ones8 = vld1q_u8(mask);
+   util_format_simd_unpack_ones(mask, l, 4, 1, fui(1.0f));
+   f->ones = vreinterpretq_u32_u8(vld1q_u8(mask));
+}
+
+static void
+neon_init(void)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(neon_formats); i++)
+      neon_format_init(neon_formats[i]);
+}
+
+static once_flag neon_once = ONCE_FLAG_INIT;
+
+const struct util_format_unpack_description *
+util_format_unpack_description_neon(enum pipe_format format)
+{
+   if (!util_format_unpack_descriptions_neon[format].unpack_rgba)
+      return NULL;
+
+   call_once(&neon_once, neon_init);
+   return &util_format_unpack_descriptions_neon[format];
+}
+
+const struct util_format_pack_description *
+util_format_pack_description_neon(enum pipe_format format)
+{
+   if (!util_format_pack_descriptions_neon[format].pack_rgba_8unorm)
+      return NULL;
+
+   call_once(&neon_once, neon_init);
+   return &util_format_pack_descriptions_neon[format];
+}
+
+#endif /* DETECT_ARCH_ARM */
+
 #endif /* DETECT_ARCH_AARCH64 | DETECT_ARCH_ARM */
@@ -0,0 +1,84 @@
+/* Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Hashing of shader and pipeline cache keys.
+ *
+ * Keys are BLAKE3 hashes cut down to the 20 bytes of the SHA-1 digests they
+ * used to be, so that the structs and cache entries holding them keep their
+ * layout.  BLAKE3 uses SIMD when the CPU has it and is several times faster
+ * than SHA-1 on large NIR and SPIR-V blobs.
+ *
+ * Keep using _mesa_sha1_*() where the digest has to be SHA-1 because it is
+ * shown to users or compared with one computed elsewhere, like the shader
+ * source hashes used for shader replacement.
+ */
+
+#ifndef MESA_CACHE_KEY_H
+#define MESA_CACHE_KEY_H
+
+#include "util/mesa-blake3.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESA_CACHE_KEY_SIZE 20
+
+#define mesa_cache_key_ctx blake3_hasher
+
+static inline void
+_mesa_cache_key_init(struct mesa_cache_key_ctx *ctx)
+{
+   blake3_hasher_init(ctx);
+}
+
+static inline void
+_mesa_cache_key_update(struct mesa_cache_key_ctx *ctx,
+                       const void *data, size_t size)
+{
+   blake3_hasher_update(ctx, data, size);
+}
+
+static inline void
+_mesa_cache_key_final(struct mesa_cache_key_ctx *ctx,
+                      unsigned char key[MESA_CACHE_KEY_SIZE])
+{
+   blake3_hasher_finalize(ctx, key, MESA_CACHE_KEY_SIZE);
+}
+
+static inline void
+_mesa_cache_key_compute(const void *data, size_t size,
+                        unsigned char key[MESA_CACHE_KEY_SIZE])
+{
+   struct mesa_cache_key_ctx ctx;
+
+   _mesa_cache_key_init(&ctx);
+   _mesa_cache_key_update(&ctx, data, size);
+   _mesa_cache_key_final(&ctx, key);
+}
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* MESA_CACHE_KEY_H */
@@ -124,7 +124,8 @@ rb_tree_splice(struct rb_tree *T, struct rb_node *u, struct rb_node *v)
 }
 
 static void
-rb_tree_rotate_left(struct rb_tree *T, struct rb_node *x)
+rb_tree_rotate_left(struct rb_tree *T, struct rb_node *x,
+                    rb_augment_func augment)
 {
     assert(x && x->right);
 
@@ -135,10 +136,19 @@ rb_tree_rotate_left(struct rb_tree *T, struct rb_node *x)
     rb_tree_splice(T, x, y);
     y->left = x;
     rb_node_set_parent(x, y);
+
+    /* x is now a child of y, and the subtree of y's new parent is the same
+     * set of nodes as before.
+     */
+    if (augment) {
+        augment(x);
+        augment(y);
+    }
 }
 
 static void
-rb_tree_rotate_right(struct rb_tree *T, struct rb_node *y)
+rb_tree_rotate_right(struct rb_tree *T, struct rb_node *y,
+                     rb_augment_func augment)
 {
     assert(y && y->left);
 
@@ -149,11 +159,17 @@ rb_tree_rotate_right(struct rb_tree *T, struct rb_node *y)
     rb_tree_splice(T, y, x);
     x->right = y;
     rb_node_set_parent(y, x);
+
+    if (augment) {
+        augment(y);
+        augment(x);
+    }
 }
 
-void
-rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
-                  struct rb_node *node, bool insert_left)
+static void
+rb_tree_do_insert_at(struct rb_tree *T, struct rb_node *parent,
+                     struct rb_node *node, bool insert_left,
+                     rb_augment_func augment)
 {
     /* This sets null children, parent, and a color of red */
     memset(node, 0, sizeof(*node));
@@ -162,6 +178,8 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
         assert(T->root == NULL);
         T->root = node;
         rb_node_set_black(node);
+        if (augment)
+            augment(node);
         return;
     }
 
@@ -174,6 +192,12 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
     }
     rb_node_set_parent(node, parent);
 
+    /* Every ancestor of the new node gained it.  The rotations below keep
+     * the rest up to date.
+     */
+    if (augment)
+        rb_augmented_tree_propagate(node, augment);
+
     /* Now we do the insertion fixup */
     struct rb_node *z = node;
     while (rb_node_is_red(rb_node_parent(z))) {
@@ -191,7 +215,7 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
             } else {
                 if (z == z_p->right) {
                     z = z_p;
-                    rb_tree_rotate_left(T, z);
+                    rb_tree_rotate_left(T, z, augment);
                     /* We changed z */
                     z_p = rb_node_parent(z);
                     assert(z == z_p->left || z == z_p->right);
@@ -199,7 +223,7 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
                 }
                 rb_node_set_black(z_p);
                 rb_node_set_red(z_p_p);
-                rb_tree_rotate_right(T, z_p_p);
+                rb_tree_rotate_right(T, z_p_p, augment);
             }
         } else {
             struct rb_node *y = z_p_p->left;
@@ -211,7 +235,7 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
             } else {
                 if (z == z_p->left) {
                     z = z_p;
-                    rb_tree_rotate_right(T, z);
+                    rb_tree_rotate_right(T, z, augment);
                     /* We changed z */
                     z_p = rb_node_parent(z);
                     assert(z == z_p->left || z == z_p->right);
@@ -219,7 +243,7 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
                 }
                 rb_node_set_black(z_p);
                 rb_node_set_red(z_p_p);
-                rb_tree_rotate_left(T, z_p_p);
+                rb_tree_rotate_left(T, z_p_p, augment);
             }
         }
     }
@@ -227,7 +251,23 @@ rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
 }
 
 void
-rb_tree_remove(struct rb_tree *T, struct rb_node *z)
+rb_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
+                  struct rb_node *node, bool insert_left)
+{
+    rb_tree_do_insert_at(T, parent, node, insert_left, NULL);
+}
+
+void
+rb_augmented_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
+                            struct rb_node *node, bool insert_left,
+                            rb_augment_func augment)
+{
+    rb_tree_do_insert_at(T, parent, node, insert_left, augment);
+}
+
+static void
+rb_tree_do_remove(struct rb_tree *T, struct rb_node *z,
+                  rb_augment_func augment)
 {
     /* x_p is always the parent node of X.  We have to track this
      * separately because x may be NULL.
@@ -266,6 +306,12 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
 
     assert(x_p == NULL || x == x_p->left || x == x_p->right);
 
+    /* x_p is the lowest node whose subtree changed, and y, if it moved, is
+     * one of its ancestors now.
+     */
+    if (augment && x_p)
+        rb_augmented_tree_propagate(x_p, augment);
+
     if (!y_was_black)
         return;
 
@@ -276,7 +322,7 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
             if (rb_node_is_red(w)) {
                 rb_node_set_black(w);
                 rb_node_set_red(x_p);
-                rb_tree_rotate_left(T, x_p);
+                rb_tree_rotate_left(T, x_p, augment);
                 assert(x == x_p->left);
                 w = x_p->right;
             }
@@ -287,13 +333,13 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
                 if (rb_node_is_black(w->right)) {
                     rb_node_set_black(w->left);
                     rb_node_set_red(w);
-                    rb_tree_rotate_right(T, w);
+                    rb_tree_rotate_right(T, w, augment);
                     w = x_p->right;
                 }
                 rb_node_copy_color(w, x_p);
                 rb_node_set_black(x_p);
                 rb_node_set_black(w->right);
-                rb_tree_rotate_left(T, x_p);
+                rb_tree_rotate_left(T, x_p, augment);
                 x = T->root;
             }
         } else {
@@ -301,7 +347,7 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
             if (rb_node_is_red(w)) {
                 rb_node_set_black(w);
                 rb_node_set_red(x_p);
-                rb_tree_rotate_right(T, x_p);
+                rb_tree_rotate_right(T, x_p, augment);
                 assert(x == x_p->right);
                 w = x_p->left;
             }
@@ -312,13 +358,13 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
                 if (rb_node_is_black(w->left)) {
                     rb_node_set_black(w->right);
                     rb_node_set_red(w);
-                    rb_tree_rotate_left(T, w);
+                    rb_tree_rotate_left(T, w, augment);
                     w = x_p->left;
                 }
                 rb_node_copy_color(w, x_p);
                 rb_node_set_black(x_p);
                 rb_node_set_black(w->left);
-                rb_tree_rotate_right(T, x_p);
+                rb_tree_rotate_right(T, x_p, augment);
                 x = T->root;
             }
         }
@@ -328,6 +374,26 @@ rb_tree_remove(struct rb_tree *T, struct rb_node *z)
         rb_node_set_black(x);
 }
 
+void
+rb_tree_remove(struct rb_tree *T, struct rb_node *z)
+{
+    rb_tree_do_remove(T, z, NULL);
+}
+
+void
+rb_augmented_tree_remove(struct rb_tree *T, struct rb_node *z,
+                         rb_augment_func augment)
+{
+    rb_tree_do_remove(T, z, augment);
+}
+
+void
+rb_augmented_tree_propagate(struct rb_node *node, rb_augment_func augment)
+{
+    for (; node != NULL; node = rb_node_parent(node))
+        augment(node);
+}
+
 struct rb_node *
 rb_tree_first(struct rb_tree *T)
 {
@@ -219,6 +219,69 @@ rb_tree_search_sloppy(struct rb_tree *T, const void *key,
     return y;
 }
 
+/** Recompute the data a node keeps about its subtree
+ *
+ * An augmented tree keeps, in each node, something computed from the node
+ * and its children, like the largest key of the subtree.  This callback
+ * recomputes it for \p node, assuming the children are already up to date.
+ */
+typedef void (*rb_augment_func)(struct rb_node *node);
+
+/** Insert a node into an augmented tree at a particular location
+ *
+ * Like rb_tree_insert_at, but also calls \p augment on every node whose
+ * subtree changed, bottom-up.
+ */
+void rb_augmented_tree_insert_at(struct rb_tree *T, struct rb_node *parent,
+                                 struct rb_node *node, bool insert_left,
+                                 rb_augment_func augment);
+
+/** Insert a node into an augmented tree
+ *
+ * \param   T       The red-black tree into which to insert the new node
+ *
+ * \param   node    The node to insert
+ *
+ * \param   cmp     A comparison function to use to order the nodes.
+ *
+ * \param   augment The callback that updates the subtree data of a node
+ */
+static inline void
+rb_augmented_tree_insert(struct rb_tree *T, struct rb_node *node,
+                         int (*cmp)(const struct rb_node *, const struct rb_node *),
+                         rb_augment_func augment)
+{
+    struct rb_node *y = NULL;
+    struct rb_node *x = T->root;
+    bool left = false;
+    while (x != NULL) {
+        y = x;
+        left = cmp(x, node) < 0;
+        if (left)
+            x = x->left;
+        else
+            x = x->right;
+    }
+
+    rb_augmented_tree_insert_at(T, y, node, left, augment);
+}
+
+/** Remove a node from an augmented tree
+ *
+ * Like rb_tree_remove, but also calls \p augment on every node whose
+ * subtree changed, bottom-up.
+ */
+void rb_augmented_tree_remove(struct rb_tree *T, struct rb_node *z,
+                              rb_augment_func augment);
+
+/** Call \p augment on a node and all of its ancestors
+ *
+ * This has to be called when the data of a node that the subtree data is
+ * computed from changes in place.
+ */
+void rb_augmented_tree_propagate(struct rb_node *node,
+                                 rb_augment_func augment);
+
 /** Get the first (left-most) node in the tree or NULL */
 struct rb_node *rb_tree_first(struct rb_tree *T);
 
@@ -0,0 +1,225 @@
+/*
+ * Compresses a few generated images to BPTC and S3TC, and checks that
+ * spreading the rows over threads with util_format_compress_rows() gives
+ * the same blocks as compressing the whole image at once, and that the
+ * better BPTC quality is no worse than the fast one.  Prints the PSNR and
+ * throughput of each encoder.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/format/u_format.h"
+#include "util/format/u_format_bptc.h"
+#include "util/format/u_format_compress.h"
+#include "util/format/u_format_s3tc.h"
+#include "util/os_time.h"
+#include "util/u_math.h"
+
+#include "util/format/texcompress_bptc_tmp.h"
+
+struct test_image {
+   const char *name;
+   unsigned width, height;
+   uint8_t *pixels;
+};
+
+struct encoder {
+   const char *name;
+   enum pipe_format format;
+   int quality;
+   enum util_format_dxtn dxtn;
+};
+
+static const struct encoder encoders[] = {
+   { "bptc q0", PIPE_FORMAT_BPTC_RGBA_UNORM, 0 },
+   { "bptc q1", PIPE_FORMAT_BPTC_RGBA_UNORM, 1 },
+   { "dxt1", PIPE_FORMAT_DXT1_RGB, 0, UTIL_FORMAT_DXT1_RGB },
+   { "dxt5", PIPE_FORMAT_DXT5_RGBA, 0, UTIL_FORMAT_DXT5_RGBA },
+};
+
+struct compress_job {
+   const struct encoder *encoder;
+   const struct test_image *image;
+   uint8_t *dst;
+   unsigned dst_stride;
+};
+
+static uint32_t
+hash(uint32_t x)
+{
+   x ^= x >> 16;
+   x *= 0x7feb352d;
+   x ^= x >> 15;
+   x *= 0x846ca68b;
+   x ^= x >> 16;
+   return x;
+}
+
+static void
+generate(struct test_image *image, unsigned kind)
+{
+   uint8_t *p = image->pixels = malloc(image->width * image->height * 4);
+
+   for (unsigned y = 0; y < image->height; y++) {
+      for (unsigned x = 0; x < image->width; x++, p += 4) {
+         const uint32_t h = hash(y * image->width + x);
+         float fx = (float)x / image->width, fy = (float)y / image->height;
+
+         switch (kind) {
+         case 0: /* smooth gradients */
+            p[0] = fx * 255;
+            p[1] = fy * 255;
+            p[2] = (1.0f - fx * fy) * 255;
+            p[3] = 255;
+            break;
+         case 1: /* photo-like: low frequencies, a bit of grain, soft alpha */
+            p[0] = CLAMP(128 + 90 * sinf(fx * 7) * cosf(fy * 5) +
+                         (int)(h & 7) - 4, 0, 255);
+            p[1] = CLAMP(110 + 80 * sinf(fx * 3 + fy * 11) +
+                         (int)(h >> 8 & 7) - 4, 0, 255);
+            p[2] = CLAMP(90 + 60 * cosf(fx * 13 - fy * 2), 0, 255);
+            p[3] = CLAMP(200 + 55 * sinf(fy * 9), 0, 255);
+            break;
+         case 2: /* hard edged tiles with cutout alpha */
+            p[0] = (x / 8 + y / 8) % 2 ? 230 : 20;
+            p[1] = (x / 16) % 3 * 100;
+            p[2] = (y / 12) % 4 * 80;
+            p[3] = (x + y) % 32 < 24 ? 255 : 0;
+            break;
+         default: /* noise */
+            memcpy(p, &h, 4);
+            break;
+         }
+      }
+   }
+}
+
+static unsigned
+block_bytes(const struct encoder *encoder)
+{
+   return util_format_get_blocksize(encoder->format);
+}
+
+static void
+compress_rows(void *data, unsigned y, unsigned height)
+{
+   const struct compress_job *job = data;
+   const struct test_image *image = job->image;
+   const uint8_t *src = image->pixels + y * image->width * 4;
+   uint8_t *dst = job->dst + y / 4 * job->dst_stride;
+
+   if (job->encoder->dxtn) {
+      util_format_dxtn_pack(4, image->width, height, src, job->encoder->dxtn,
+                            dst, job->dst_stride);
+   } else {
+      compress_rgba_unorm(image->width, height, src, image->width * 4,
+                          dst, job->dst_stride, job->encoder->quality);
+   }
+}
+
+static double
+psnr(const struct encoder *encoder, const struct test_image *image,
+     const uint8_t *compressed, unsigned compressed_stride)
+{
+   const unsigned n_components = encoder->format == PIPE_FORMAT_DXT1_RGB ? 3 : 4;
+   uint8_t *decoded = malloc(image->width * image->height * 4);
+   double error = 0;
+
+   util_format_unpack_rgba_8unorm_rect(encoder->format,
+                                       decoded, image->width * 4,
+                                       compressed, compressed_stride,
+                                       image->width, image->height);
+
+   for (unsigned i = 0; i < image->width * image->height; i++) {
+      for (unsigned c = 0; c < n_components; c++) {
+         const int diff = decoded[i * 4 + c] - image->pixels[i * 4 + c];
+         error += diff * diff;
+      }
+   }
+   free(decoded);
+
+   error /= image->width * image->height * n_components;
+   return error ? 10 * log10(255.0 * 255.0 / error) : INFINITY;
+}
+
+static bool
+test_encoder(const struct encoder *encoder, const struct test_image *image,
+             double *psnr_out)
+{
+   const unsigned stride = DIV_ROUND_UP(image->width, 4) * block_bytes(encoder);
+   const unsigned size = stride * DIV_ROUND_UP(image->height, 4);
+   uint8_t *serial = calloc(1, size), *threaded = calloc(1, size);
+   struct compress_job job = { encoder, image, serial, stride };
+   int64_t start, serial_time, threaded_time;
+   bool pass = true;
+
+   start = os_time_get_nano();
+   compress_rows(&job, 0, image->height);
+   serial_time = MAX2(os_time_get_nano() - start, 1);
+
+   job.dst = threaded;
+   start = os_time_get_nano();
+   util_format_compress_rows(image->width, image->height, 4,
+                             compress_rows, &job);
+   threaded_time = MAX2(os_time_get_nano() - start, 1);
+
+   if (memcmp(serial, threaded, size)) {
+      printf("FAILED: %s %s: threaded compression differs\n",
+             encoder->name, image->name);
+      pass = false;
+   }
+
+   *psnr_out = psnr(encoder, image, serial, stride);
+   printf("%-10s %-9s %4ux%-4u PSNR %6.2f dB, %7.2f Mpix/s, threaded %7.2f Mpix/s\n",
+          image->name, encoder->name, image->width, image->height, *psnr_out,
+          image->width * image->height * 1e3 / serial_time,
+          image->width * image->height * 1e3 / threaded_time);
+
+   free(serial);
+   free(threaded);
+   return pass;
+}
+
+int
+main(void)
+{
+   struct test_image images[] = {
+      { "gradient", 512, 512 },
+      { "photo", 509, 263 },
+      { "tiles", 256, 256 },
+      { "noise", 256, 130 },
+   };
+   bool pass = true;
+
+   /* Use a few threads regardless of the number of CPUs, so the band split
+    * is always exercised.
+    */
+   setenv("MESA_TEXCOMPRESS_THREADS", "3", 0);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(images); i++) {
+      double bptc_psnr[2];
+
+      generate(&images[i], i);
+
+      for (unsigned e = 0; e < ARRAY_SIZE(encoders); e++) {
+         double result;
+
+         pass &= test_encoder(&encoders[e], &images[i], &result);
+         if (encoders[e].format == PIPE_FORMAT_BPTC_RGBA_UNORM)
+            bptc_psnr[encoders[e].quality] = result;
+      }
+
+      if (bptc_psnr[1] < bptc_psnr[0]) {
+         printf("FAILED: %s: BPTC quality 1 is worse than quality 0\n",
+                images[i].name);
+         pass = false;
+      }
+
+      free(images[i].pixels);
+   }
+
+   return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,9 +28,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <float.h>
+#include <math.h>
 
+#include "util/detect_arch.h"
 #include "util/half_float.h"
+#include "util/os_time.h"
 #include "util/u_math.h"
 #include "util/format/u_format.h"
 #include "util/format/u_format_tests.h"
@@ -865,11 +869,308 @@ test_all(void)
 }
 
 
+/*
+ * The CPU-specific pack/unpack functions must give exactly what the generated
+ * ones do, for any row width and stride.
+ */
+
+struct simd_variant {
+   const char *name;
+   const struct util_format_pack_description *(*pack)(enum pipe_format format);
+   const struct util_format_unpack_description *(*unpack)(enum pipe_format format);
+};
+
+static const struct simd_variant simd_variants[] = {
+#if (DETECT_ARCH_X86 || DETECT_ARCH_X86_64) && !defined(NO_FORMAT_ASM)
+   { "sse41", util_format_pack_description_sse41, util_format_unpack_description_sse41 },
+   { "avx2", util_format_pack_description_avx2, util_format_unpack_description_avx2 },
+#endif
+#if (DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM) && !defined(NO_FORMAT_ASM) && !defined(__SOFTFP__)
+   { "neon", util_format_pack_description_neon, util_format_unpack_description_neon },
+#endif
+};
+
+#define ROW_WIDTH 37
+#define ROW_ROUNDS 16
+
+struct simd_rows {
+   uint8_t packed[ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+   float rgba_float[ROW_WIDTH * 4];
+   uint8_t rgba_8unorm[ROW_WIDTH * 4];
+};
+
+static float
+random_float(void)
+{
+   static const float special[] = {
+      0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.0f, 1.0f / 255.0f, 254.5f / 255.0f,
+      0.99999994f, 1e-10f, 6.1e-5f, 65504.0f, 65520.0f, 1e30f,
+      INFINITY, -INFINITY, NAN, -NAN,
+   };
+   uint32_t bits;
+
+   switch (rand() % 4) {
+   case 0:
+      return special[rand() % ARRAY_SIZE(special)];
+   case 1:
+      bits = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+      return uif(bits);
+   default:
+      return (float)rand() / (float)RAND_MAX * 1.5f - 0.25f;
+   }
+}
+
+/* The first round repeats the test cases of the format, the others are
+ * random.
+ */
+static void
+fill_rows(enum pipe_format format, unsigned round, struct simd_rows *rows)
+{
+   const unsigned size = util_format_get_blocksize(format);
+   const struct util_format_test_case *tests[ROW_WIDTH];
+   unsigned num_tests = 0;
+
+   if (round == 0) {
+      for (unsigned i = 0; i < util_format_nr_test_cases && num_tests < ROW_WIDTH; ++i) {
+         if (util_format_test_cases[i].format == format)
+            tests[num_tests++] = &util_format_test_cases[i];
+      }
+   }
+
+   for (unsigned x = 0; x < ROW_WIDTH; x++) {
+      if (num_tests) {
+         const struct util_format_test_case *test = tests[x % num_tests];
+         uint8_t unpacked[UTIL_FORMAT_MAX_UNPACKED_HEIGHT][UTIL_FORMAT_MAX_UNPACKED_WIDTH][4];
+
+         convert_float_to_8unorm(&unpacked[0][0][0], &test->unpacked[0][0][0]);
+         memcpy(&rows->packed[x * size], test->packed, size);
+         memcpy(&rows->rgba_8unorm[x * 4], unpacked[0][0], 4);
+         for (unsigned c = 0; c < 4; c++)
+            rows->rgba_float[x * 4 + c] = test->unpacked[0][0][c];
+      } else {
+         for (unsigned i = 0; i < size; i++)
+            rows->packed[x * size + i] = rand();
+         for (unsigned c = 0; c < 4; c++) {
+            rows->rgba_8unorm[x * 4 + c] = rand();
+            rows->rgba_float[x * 4 + c] = random_float();
+         }
+      }
+   }
+}
+
+static bool
+check_row(const struct util_format_description *format_desc,
+          const struct simd_variant *variant, const char *func, unsigned width,
+          const void *expected, const void *obtained, size_t size)
+{
+   if (!memcmp(expected, obtained, size))
+      return true;
+
+   printf("FAILED: util_format_%s_%s_%s with width %u\n",
+          format_desc->short_name, func, variant->name, width);
+   return false;
+}
+
+static bool
+test_format_rows(const struct util_format_description *format_desc,
+                 const struct simd_variant *variant)
+{
+   const enum pipe_format format = format_desc->format;
+   const struct util_format_pack_description *pack = variant->pack(format);
+   const struct util_format_unpack_description *unpack = variant->unpack(format);
+   const struct util_format_pack_description *pack_generic =
+      util_format_pack_description_generic(format);
+   const struct util_format_unpack_description *unpack_generic =
+      util_format_unpack_description_generic(format);
+   /* Two rows, with some padding after each to check the strides */
+   const unsigned packed_stride = ROW_WIDTH * util_format_get_blocksize(format) + 3;
+   const unsigned float_stride = (ROW_WIDTH + 1) * 4 * sizeof(float);
+   const unsigned unorm_stride = (ROW_WIDTH + 1) * 4;
+   static struct simd_rows rows[2];
+   static uint8_t expected[2][2 * (ROW_WIDTH + 1) * 4 * sizeof(float)];
+   static uint8_t obtained[2][2 * (ROW_WIDTH + 1) * 4 * sizeof(float)];
+   bool success = true;
+
+   if (!pack && !unpack)
+      return true;
+
+   printf("Testing util_format_%s rows with %s ...\n",
+          format_desc->short_name, variant->name);
+   fflush(stdout);
+
+   for (unsigned round = 0; round < ROW_ROUNDS && success; round++) {
+      fill_rows(format, round, &rows[0]);
+      fill_rows(format, round + ROW_ROUNDS, &rows[1]);
+
+      for (unsigned width = 1; width <= ROW_WIDTH && success; width++) {
+         if (unpack) {
+            memset(expected, 0xcd, sizeof(expected));
+            memset(obtained, 0xcd, sizeof(obtained));
+            unpack_generic->unpack_rgba(expected[0], rows[0].packed, width);
+            unpack->unpack_rgba(obtained[0], rows[0].packed, width);
+            success &= check_row(format_desc, variant, "unpack_rgba_float", width,
+                                 expected, obtained, sizeof(expected));
+
+            unpack_generic->unpack_rgba_8unorm(expected[0], rows[0].packed, width);
+            unpack->unpack_rgba_8unorm(obtained[0], rows[0].packed, width);
+            success &= check_row(format_desc, variant, "unpack_rgba_8unorm", width,
+                                 expected, obtained, sizeof(expected));
+         }
+
+         if (pack) {
+            float src_float[2][ROW_WIDTH + 1][4];
+            uint8_t src_8unorm[2][ROW_WIDTH + 1][4];
+
+            for (unsigned y = 0; y < 2; y++) {
+               memcpy(src_float[y], rows[y].rgba_float, sizeof(rows[y].rgba_float));
+               memcpy(src_8unorm[y], rows[y].rgba_8unorm, sizeof(rows[y].rgba_8unorm));
+            }
+
+            memset(expected, 0xcd, sizeof(expected));
+            memset(obtained, 0xcd, sizeof(obtained));
+            pack_generic->pack_rgba_float(expected[0], packed_stride,
+                                          &src_float[0][0][0], float_stride, width, 2);
+            pack->pack_rgba_float(obtained[0], packed_stride,
+                                  &src_float[0][0][0], float_stride, width, 2);
+            success &= check_row(format_desc, variant, "pack_rgba_float", width,
+                                 expected, obtained, sizeof(expected));
+
+            pack_generic->pack_rgba_8unorm(expected[0], packed_stride,
+                                           &src_8unorm[0][0][0], unorm_stride, width, 2);
+            pack->pack_rgba_8unorm(obtained[0], packed_stride,
+                                   &src_8unorm[0][0][0], unorm_stride, width, 2);
+            success &= check_row(format_desc, variant, "pack_rgba_8unorm", width,
+                                 expected, obtained, sizeof(expected));
+         }
+      }
+   }
+
+   return success;
+}
+
+static bool
+test_all_rows(void)
+{
+   bool success = true;
+
+   for (unsigned v = 0; v < ARRAY_SIZE(simd_variants); v++) {
+      for (enum pipe_format format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+         const struct util_format_description *format_desc = util_format_description(format);
+
+         if (format_desc && !test_format_rows(format_desc, &simd_variants[v]))
+            success = false;
+      }
+   }
+
+   return success;
+}
+
+/*
+ * Per-format throughput of the CPU-specific functions against the generated
+ * ones, with "--bench".
+ */
+
+#define BENCH_WIDTH 1024
+#define BENCH_ROWS 2000
+
+static double
+bench_mpix(int64_t start)
+{
+   return (double)BENCH_WIDTH * BENCH_ROWS * 1e3 / MAX2(os_time_get_nano() - start, 1);
+}
+
+static void
+bench_format(const struct util_format_description *format_desc,
+             const struct simd_variant *variant)
+{
+   const enum pipe_format format = format_desc->format;
+   const struct util_format_pack_description *pack[2] = {
+      util_format_pack_description_generic(format), variant->pack(format),
+   };
+   const struct util_format_unpack_description *unpack[2] = {
+      util_format_unpack_description_generic(format), variant->unpack(format),
+   };
+   static uint8_t packed[BENCH_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+   static float rgba_float[BENCH_WIDTH * 4];
+   static uint8_t rgba_8unorm[BENCH_WIDTH * 4];
+   double mpix[4][2] = { { 0 } };
+
+   if (!pack[1] && !unpack[1])
+      return;
+
+   for (unsigned i = 0; i < sizeof(packed); i++)
+      packed[i] = rand();
+   for (unsigned i = 0; i < ARRAY_SIZE(rgba_float); i++) {
+      rgba_float[i] = (float)rand() / (float)RAND_MAX;
+      rgba_8unorm[i] = rand();
+   }
+
+   for (unsigned v = 0; v < 2; v++) {
+      int64_t start;
+
+      if (unpack[1]) {
+         start = os_time_get_nano();
+         for (unsigned y = 0; y < BENCH_ROWS; y++)
+            unpack[v]->unpack_rgba(rgba_float, packed, BENCH_WIDTH);
+         mpix[0][v] = bench_mpix(start);
+
+         start = os_time_get_nano();
+         for (unsigned y = 0; y < BENCH_ROWS; y++)
+            unpack[v]->unpack_rgba_8unorm(rgba_8unorm, packed, BENCH_WIDTH);
+         mpix[1][v] = bench_mpix(start);
+      }
+
+      if (pack[1]) {
+         start = os_time_get_nano();
+         for (unsigned y = 0; y < BENCH_ROWS; y++)
+            pack[v]->pack_rgba_float(packed, 0, rgba_float, 0, BENCH_WIDTH, 1);
+         mpix[2][v] = bench_mpix(start);
+
+         start = os_time_get_nano();
+         for (unsigned y = 0; y < BENCH_ROWS; y++)
+            pack[v]->pack_rgba_8unorm(packed, 0, rgba_8unorm, 0, BENCH_WIDTH, 1);
+         mpix[3][v] = bench_mpix(start);
+      }
+   }
+
+   printf("%-5s %-30s", variant->name, format_desc->short_name);
+   for (unsigned i = 0; i < 4; i++) {
+      if (mpix[i][1])
+         printf(" %7.0f (%5.2fx)", mpix[i][1], mpix[i][1] / mpix[i][0]);
+      else
+         printf(" %16s", "-");
+   }
+   printf("\n");
+}
+
+static void
+bench_all(void)
+{
+   printf("%-5s %-30s %16s %16s %16s %16s\n", "", "Mpixel/s (speedup)",
+          "unpack float", "unpack 8unorm", "pack float", "pack 8unorm");
+
+   for (unsigned v = 0; v < ARRAY_SIZE(simd_variants); v++) {
+      for (enum pipe_format format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+         const struct util_format_description *format_desc = util_format_description(format);
+
+         if (format_desc)
+            bench_format(format_desc, &simd_variants[v]);
+      }
+   }
+}
+
+
 int main(int argc, char **argv)
 {
    bool success;
 
+   if (argc > 1 && !strcmp(argv[1], "--bench")) {
+      bench_all();
+      return 0;
+   }
+
    success = test_all();
+   success &= test_all_rows();
 
    return success ? 0 : 1;
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "mesa-cache-key.h"
+#include "mesa-sha1.h"
+#include "macros.h"
+
+#include <gtest/gtest.h>
+
+static std::vector<unsigned char>
+make_blob(size_t size)
+{
+   std::vector<unsigned char> blob(size);
+   uint32_t x = 0x12345678;
+
+   for (size_t i = 0; i < size; i++) {
+      x = x * 1664525 + 1013904223;
+      blob[i] = x >> 24;
+   }
+   return blob;
+}
+
+TEST(MesaCacheKey, TruncatedBlake3)
+{
+   for (size_t size : {0, 1, 63, 64, 1023, 1024, 1025, 100000}) {
+      std::vector<unsigned char> blob = make_blob(size);
+      blake3_hash full;
+      unsigned char key[MESA_CACHE_KEY_SIZE];
+
+      _mesa_blake3_compute(blob.data(), size, full);
+      _mesa_cache_key_compute(blob.data(), size, key);
+
+      EXPECT_EQ(memcmp(key, full, MESA_CACHE_KEY_SIZE), 0)
+         << "blob of " << size << " bytes";
+   }
+}
+
+TEST(MesaCacheKey, Empty)
+{
+   /* First 20 bytes of BLAKE3("") */
+   static const unsigned char expected[MESA_CACHE_KEY_SIZE] = {
+      0xaf, 0x13, 0x49, 0xb9, 0xf5, 0xf9, 0xa1, 0xa6, 0xa0, 0x40,
+      0x4d, 0xea, 0x36, 0xdc, 0xc9, 0x49, 0x9b, 0xcb, 0x25, 0xc9,
+   };
+   unsigned char key[MESA_CACHE_KEY_SIZE];
+
+   _mesa_cache_key_compute(NULL, 0, key);
+   EXPECT_EQ(memcmp(key, expected, sizeof(expected)), 0);
+}
+
+TEST(MesaCacheKey, Incremental)
+{
+   std::vector<unsigned char> blob = make_blob(70000);
+   unsigned char whole[MESA_CACHE_KEY_SIZE], pieces[MESA_CACHE_KEY_SIZE];
+   struct mesa_cache_key_ctx ctx;
+
+   _mesa_cache_key_compute(blob.data(), blob.size(), whole);
+
+   _mesa_cache_key_init(&ctx);
+   for (size_t offset = 0, step = 1; offset < blob.size(); step = step * 3 + 1) {
+      size_t n = MIN2(step % 4099, blob.size() - offset);
+      _mesa_cache_key_update(&ctx, blob.data() + offset, n);
+      offset += n;
+   }
+   _mesa_cache_key_final(&ctx, pieces);
+
+   EXPECT_EQ(memcmp(whole, pieces, MESA_CACHE_KEY_SIZE), 0);
+}
+
+template <typename F> static double
+mb_per_s(const std::vector<unsigned char> &blob, F hash)
+{
+   const size_t total = 64 << 20;
+   const unsigned iters = MAX2(total / blob.size(), 1);
+   unsigned char key[20];
+
+   auto start = std::chrono::steady_clock::now();
+   for (unsigned i = 0; i < iters; i++)
+      hash(blob.data(), blob.size(), key);
+   auto end = std::chrono::steady_clock::now();
+
+   return (double)iters * blob.size() /
+          std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+/* Not a pass/fail test, just prints how the key hash compares with SHA-1 on
+ * the sizes typical of shader keys, NIR and SPIR-V.
+ */
+TEST(MesaCacheKey, Throughput)
+{
+   for (size_t size : {64, 1024, 16 * 1024, 1024 * 1024}) {
+      std::vector<unsigned char> blob = make_blob(size);
+
+      double sha1 = mb_per_s(blob, _mesa_sha1_compute);
+      double key = mb_per_s(blob, _mesa_cache_key_compute);
+
+      printf("%8zu bytes: SHA-1 %8.1f MB/s, cache key %8.1f MB/s (%.1fx)\n",
+             size, sha1, key, key / sha1);
+   }
+}
@@ -227,3 +227,74 @@ TEST(RBTreeTest, InsertAndSearch)
         validate_search(&tree, i + 1, ARRAY_SIZE(test_numbers) - 1);
     }
 }
+
+struct rb_augmented_test_node {
+    int key;
+    /* Number of nodes in the subtree rooted at this one */
+    unsigned count;
+    struct rb_node node;
+};
+
+static unsigned
+rb_augmented_test_count(const struct rb_node *n)
+{
+    return n ? rb_node_data(struct rb_augmented_test_node, n, node)->count : 0;
+}
+
+static void
+rb_augmented_test_node_augment(struct rb_node *n)
+{
+    struct rb_augmented_test_node *tn =
+        rb_node_data(struct rb_augmented_test_node, n, node);
+
+    tn->count = 1 + rb_augmented_test_count(n->left) +
+                rb_augmented_test_count(n->right);
+}
+
+static int
+rb_augmented_test_node_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_node_data(struct rb_augmented_test_node, b, node)->key -
+           rb_node_data(struct rb_augmented_test_node, a, node)->key;
+}
+
+static unsigned
+validate_augmented_subtree(struct rb_node *n)
+{
+    if (n == NULL)
+        return 0;
+
+    unsigned count = 1 + validate_augmented_subtree(n->left) +
+                     validate_augmented_subtree(n->right);
+    assert(rb_augmented_test_count(n) == count);
+    return count;
+}
+
+TEST(RBTreeTest, Augmented)
+{
+    struct rb_augmented_test_node nodes[ARRAY_SIZE(test_numbers)];
+    struct rb_tree tree;
+
+    rb_tree_init(&tree);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(test_numbers); i++) {
+        nodes[i].key = test_numbers[i];
+        rb_augmented_tree_insert(&tree, &nodes[i].node,
+                                 rb_augmented_test_node_cmp,
+                                 rb_augmented_test_node_augment);
+        rb_tree_validate(&tree);
+        EXPECT_EQ(validate_augmented_subtree(tree.root), i + 1);
+    }
+
+    /* Remove in a different order than the insertions, so that nodes with
+     * two children get removed too.
+     */
+    for (unsigned i = 0; i < ARRAY_SIZE(test_numbers); i++) {
+        unsigned n = (i * 37) % ARRAY_SIZE(test_numbers);
+        rb_augmented_tree_remove(&tree, &nodes[n].node,
+                                 rb_augmented_test_node_augment);
+        rb_tree_validate(&tree);
+        EXPECT_EQ(validate_augmented_subtree(tree.root),
+                  ARRAY_SIZE(test_numbers) - i - 1);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "util/u_bands.h"
+
+struct band_counts {
+   std::atomic<unsigned> runs[UTIL_BANDS_MAX];
+};
+
+static void
+count_band(void *data, unsigned band)
+{
+   struct band_counts *counts = (struct band_counts *)data;
+
+   counts->runs[band]++;
+}
+
+TEST(UtilBands, EachBandRunsOnce)
+{
+   EXPECT_GE(util_bands_max(), 1u);
+   EXPECT_LE(util_bands_max(), (unsigned)UTIL_BANDS_MAX);
+
+   for (unsigned n = 0; n <= UTIL_BANDS_MAX; n++) {
+      struct band_counts counts = {};
+
+      util_run_bands(n, count_band, &counts);
+
+      for (unsigned b = 0; b < UTIL_BANDS_MAX; b++)
+         EXPECT_EQ(counts.runs[b], b < n ? 1u : 0u) << n << " bands";
+   }
+}
+
+TEST(UtilBands, ConcurrentCallers)
+{
+   const unsigned num_callers = 4, iterations = 200;
+   std::vector<std::thread> callers;
+   struct band_counts counts[num_callers] = {};
+
+   for (unsigned c = 0; c < num_callers; c++) {
+      callers.emplace_back([&counts, c]() {
+         for (unsigned i = 0; i < iterations; i++)
+            util_run_bands(UTIL_BANDS_MAX, count_band, &counts[c]);
+      });
+   }
+
+   for (auto &t : callers)
+      t.join();
+
+   for (unsigned c = 0; c < num_callers; c++) {
+      for (unsigned b = 0; b < UTIL_BANDS_MAX; b++)
+         EXPECT_EQ(counts[c].runs[b], iterations);
+   }
+}
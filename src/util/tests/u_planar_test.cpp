@@ -0,0 +1,207 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/u_planar.h"
+
+/* Bytes per element of each plane, as { dst[0], dst[1], src[0], src[1] } */
+static const unsigned op_sizes[UTIL_PLANAR_NUM_OPS][4] = {
+   { 1, 1, 2, 0 }, /* DEINTERLEAVE_8 */
+   { 2, 0, 1, 1 }, /* INTERLEAVE_8 */
+   { 2, 0, 1, 0 }, /* INSERT_8_EVEN */
+   { 2, 0, 1, 0 }, /* INSERT_8_ODD */
+   { 2, 0, 2, 0 }, /* SWAP_16 */
+   { 1, 0, 2, 0 }, /* NARROW_16 */
+   { 1, 1, 4, 0 }, /* DEINTERLEAVE_NARROW_16 */
+};
+
+static void
+ref_row(enum util_planar_op op, uint8_t *const *dst, const uint8_t *const *src,
+        unsigned width)
+{
+   for (unsigned x = 0; x < width; x++) {
+      switch (op) {
+      case UTIL_PLANAR_DEINTERLEAVE_8:
+         dst[0][x] = src[0][2 * x];
+         dst[1][x] = src[0][2 * x + 1];
+         break;
+      case UTIL_PLANAR_INTERLEAVE_8:
+         dst[0][2 * x] = src[0][x];
+         dst[0][2 * x + 1] = src[1][x];
+         break;
+      case UTIL_PLANAR_INSERT_8_EVEN:
+         dst[0][2 * x] = src[0][x];
+         break;
+      case UTIL_PLANAR_INSERT_8_ODD:
+         dst[0][2 * x + 1] = src[0][x];
+         break;
+      case UTIL_PLANAR_SWAP_16:
+         dst[0][2 * x] = src[0][2 * x + 1];
+         dst[0][2 * x + 1] = src[0][2 * x];
+         break;
+      case UTIL_PLANAR_NARROW_16:
+         dst[0][x] = ((src[0][2 * x + 1] << 8) | src[0][2 * x]) >> 8;
+         break;
+      case UTIL_PLANAR_DEINTERLEAVE_NARROW_16:
+         dst[0][x] = ((src[0][4 * x + 1] << 8) | src[0][4 * x]) >> 8;
+         dst[1][x] = ((src[0][4 * x + 3] << 8) | src[0][4 * x + 2]) >> 8;
+         break;
+      default:
+         unreachable("Invalid op");
+      }
+   }
+}
+
+struct planes {
+   /* dst[0], dst[1], src[0], src[1] */
+   std::vector<uint8_t> data[4];
+   ptrdiff_t stride[4];
+
+   planes(enum util_planar_op op, unsigned width, unsigned height,
+          unsigned padding)
+   {
+      for (unsigned i = 0; i < 4; i++) {
+         stride[i] = op_sizes[op][i] ? op_sizes[op][i] * width + padding : 0;
+         data[i].resize(stride[i] * height);
+         for (size_t j = 0; j < data[i].size(); j++)
+            data[i][j] = rand();
+      }
+   }
+
+   struct util_planar_copy copy(enum util_planar_op op, unsigned width,
+                                unsigned height)
+   {
+      struct util_planar_copy copy = {};
+
+      copy.op = op;
+      for (unsigned i = 0; i < 2; i++) {
+         copy.dst[i] = stride[i] ? data[i].data() : NULL;
+         copy.dst_stride[i] = stride[i];
+         copy.src[i] = stride[2 + i] ? data[2 + i].data() : NULL;
+         copy.src_stride[i] = stride[2 + i];
+      }
+      copy.width = width;
+      copy.height = height;
+      return copy;
+   }
+};
+
+static void
+test_op(enum util_planar_op op, unsigned width, unsigned height,
+        unsigned padding)
+{
+   planes p(op, width, height, padding);
+   planes expected = p;
+
+   for (unsigned y = 0; y < height; y++) {
+      uint8_t *dst[2] = { expected.data[0].data() + y * expected.stride[0],
+                          expected.data[1].data() + y * expected.stride[1] };
+      const uint8_t *src[2] = { expected.data[2].data() + y * expected.stride[2],
+                                expected.data[3].data() + y * expected.stride[3] };
+      ref_row(op, dst, src, width);
+   }
+
+   struct util_planar_copy copy = p.copy(op, width, height);
+   util_planar_copy(&copy);
+
+   /* Including the padding, which must be left alone */
+   for (unsigned i = 0; i < 2; i++) {
+      ASSERT_TRUE(p.data[i] == expected.data[i])
+         << "op " << op << " plane " << i << " " << width << "x" << height
+         << " padding " << padding;
+   }
+}
+
+TEST(u_planar_test, ops)
+{
+   static const unsigned widths[] = { 1, 7, 15, 16, 17, 31, 32, 33, 63, 100, 960 };
+
+   srand(0);
+
+   for (unsigned op = 0; op < UTIL_PLANAR_NUM_OPS; op++) {
+      for (unsigned w = 0; w < ARRAY_SIZE(widths); w++) {
+         test_op((enum util_planar_op)op, widths[w], 3, 0);
+         test_op((enum util_planar_op)op, widths[w], 5, 13);
+      }
+   }
+}
+
+/* Large enough to be split in bands of rows */
+TEST(u_planar_test, bands)
+{
+   srand(1);
+
+   for (unsigned op = 0; op < UTIL_PLANAR_NUM_OPS; op++) {
+      test_op((enum util_planar_op)op, 1920, 1080, 64);
+      test_op((enum util_planar_op)op, 1027, 1031, 5);
+   }
+}
+
+/* Throughput of the conversions done on VA image transfers, run with
+ * --gtest_also_run_disabled_tests --gtest_filter=*benchmark*
+ */
+TEST(u_planar_test, DISABLED_benchmark)
+{
+   static const struct {
+      const char *name;
+      enum util_planar_op op;
+      unsigned width_div;
+   } convs[] = {
+      /* NV12 <-> YV12 chroma, P010 luma and chroma to NV12, YUYV <-> UYVY */
+      { "deinterleave 8       ", UTIL_PLANAR_DEINTERLEAVE_8, 2 },
+      { "interleave 8         ", UTIL_PLANAR_INTERLEAVE_8, 2 },
+      { "insert 8             ", UTIL_PLANAR_INSERT_8_EVEN, 2 },
+      { "narrow 16            ", UTIL_PLANAR_NARROW_16, 1 },
+      { "deinterleave narrow 16", UTIL_PLANAR_DEINTERLEAVE_NARROW_16, 2 },
+      { "swap 16              ", UTIL_PLANAR_SWAP_16, 1 },
+   };
+   static const unsigned sizes[][2] = {
+      { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 },
+   };
+   const unsigned iterations = 50;
+
+   for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+      for (unsigned c = 0; c < ARRAY_SIZE(convs); c++) {
+         unsigned width = sizes[s][0] / convs[c].width_div;
+         unsigned height = sizes[s][1] / convs[c].width_div;
+         planes p(convs[c].op, width, height, 0);
+         struct util_planar_copy copy = p.copy(convs[c].op, width, height);
+
+         int64_t start = os_time_get_nano();
+         for (unsigned i = 0; i < iterations; i++)
+            util_planar_copy(&copy);
+         int64_t ns = os_time_get_nano() - start;
+
+         double mb = (double)(p.data[0].size() + p.data[1].size()) *
+                     iterations / (1024 * 1024);
+         printf("%4ux%-4u %s: %8.1f MB/s written\n", sizes[s][0], sizes[s][1],
+                convs[c].name, mb / (ns / 1e9));
+      }
+   }
+}
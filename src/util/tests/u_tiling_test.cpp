@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "util/os_time.h"
+#include "util/u_math.h"
+#include "util/u_tiling.h"
+
+/* Straightforward reference, one bit at a time */
+static uint64_t
+ref_offset_B(const struct util_tiling_layout *layout, unsigned x, unsigned y)
+{
+   unsigned tx = x % layout->tile_width_el, ty = y % layout->tile_height_el;
+   unsigned ix = layout->mode == UTIL_TILING_U_INTERLEAVED ? tx ^ ty : tx;
+   uint32_t index = 0;
+
+   for (unsigned b = 0; b < 16; ++b) {
+      index |= ((ix >> b) & 1) << (2 * b);
+      index |= ((ty >> b) & 1) << (2 * b + 1);
+   }
+
+   uint64_t tile_size_B =
+      layout->tile_width_el * layout->tile_height_el * layout->blocksize_B;
+
+   return (uint64_t)(y / layout->tile_height_el) * layout->tile_row_stride_B +
+          (x / layout->tile_width_el) * tile_size_B +
+          index * layout->blocksize_B;
+}
+
+struct image {
+   struct util_tiling_layout layout;
+   unsigned width_el, height_el;
+   std::vector<uint8_t> data;
+};
+
+static struct image
+make_image(enum util_tiling_mode mode, unsigned blocksize_B,
+           unsigned tile_w, unsigned tile_h, unsigned width_el,
+           unsigned height_el)
+{
+   struct image img;
+   unsigned tiles_x = DIV_ROUND_UP(width_el, tile_w);
+   unsigned tiles_y = DIV_ROUND_UP(height_el, tile_h);
+
+   img.layout.mode = mode;
+   img.layout.blocksize_B = blocksize_B;
+   img.layout.tile_width_el = tile_w;
+   img.layout.tile_height_el = tile_h;
+   img.layout.tile_row_stride_B = tiles_x * tile_w * tile_h * blocksize_B;
+   img.width_el = width_el;
+   img.height_el = height_el;
+   img.data.resize((size_t)tiles_y * img.layout.tile_row_stride_B);
+
+   for (size_t i = 0; i < img.data.size(); ++i)
+      img.data[i] = rand();
+
+   return img;
+}
+
+static void
+test_region(enum util_tiling_mode mode, unsigned bs, unsigned tile_w,
+            unsigned tile_h, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+   struct image img = make_image(mode, bs, tile_w, tile_h, x + w + 3, y + h + 5);
+   uint32_t pitch = (w + 1) * bs;
+   std::vector<uint8_t> linear((size_t)pitch * h, 0);
+
+   /* Load */
+   util_tiling_load(&img.layout, linear.data(), pitch, img.data.data(),
+                    x, y, w, h);
+
+   for (unsigned j = 0; j < h; ++j) {
+      for (unsigned i = 0; i < w; ++i) {
+         ASSERT_EQ(memcmp(&linear[j * pitch + i * bs],
+                          &img.data[ref_offset_B(&img.layout, x + i, y + j)],
+                          bs), 0)
+            << "load mode " << mode << " bs " << bs << " tile " << tile_w
+            << "x" << tile_h << " at (" << x + i << ", " << y + j << ")";
+      }
+   }
+
+   /* Store, which must only touch the region */
+   for (size_t i = 0; i < linear.size(); ++i)
+      linear[i] = rand();
+
+   std::vector<uint8_t> expected = img.data;
+   for (unsigned j = 0; j < h; ++j) {
+      for (unsigned i = 0; i < w; ++i) {
+         memcpy(&expected[ref_offset_B(&img.layout, x + i, y + j)],
+                &linear[j * pitch + i * bs], bs);
+      }
+   }
+
+   util_tiling_store(&img.layout, img.data.data(), linear.data(), pitch,
+                     x, y, w, h);
+
+   ASSERT_TRUE(expected == img.data)
+      << "store mode " << mode << " bs " << bs << " tile " << tile_w << "x"
+      << tile_h << " region " << x << "," << y << " " << w << "x" << h;
+}
+
+static const unsigned tile_sizes[][2] = {
+   { 16, 16 }, { 8, 8 }, { 4, 4 }, { 32, 16 }, { 8, 4 }, { 2, 2 }, { 2, 1 },
+};
+
+static const unsigned regions[][4] = {
+   { 0, 0, 64, 64 },
+   { 0, 0, 1, 1 },
+   { 3, 5, 1, 7 },
+   { 1, 2, 61, 35 },
+   { 4, 4, 8, 4 },
+   { 17, 3, 30, 30 },
+   { 6, 7, 3, 2 },
+};
+
+TEST(u_tiling_test, offset)
+{
+   for (unsigned mode = 0; mode < 2; ++mode) {
+      for (unsigned t = 0; t < ARRAY_SIZE(tile_sizes); ++t) {
+         struct image img = make_image((enum util_tiling_mode)mode, 4,
+                                       tile_sizes[t][0], tile_sizes[t][1],
+                                       37, 23);
+
+         for (unsigned y = 0; y < img.height_el; ++y) {
+            for (unsigned x = 0; x < img.width_el; ++x) {
+               ASSERT_EQ(util_tiling_offset_B(&img.layout, x, y),
+                         ref_offset_B(&img.layout, x, y));
+            }
+         }
+      }
+   }
+}
+
+TEST(u_tiling_test, load_store)
+{
+   srand(0);
+
+   for (unsigned mode = 0; mode < 2; ++mode) {
+      for (unsigned bs = 1; bs <= 16; bs *= 2) {
+         for (unsigned t = 0; t < ARRAY_SIZE(tile_sizes); ++t) {
+            for (unsigned r = 0; r < ARRAY_SIZE(regions); ++r) {
+               test_region((enum util_tiling_mode)mode, bs,
+                           tile_sizes[t][0], tile_sizes[t][1],
+                           regions[r][0], regions[r][1],
+                           regions[r][2], regions[r][3]);
+            }
+         }
+      }
+   }
+}
+
+/* Throughput of full-image tiling and detiling, run with
+ * --gtest_also_run_disabled_tests --gtest_filter=*benchmark*
+ */
+TEST(u_tiling_test, DISABLED_benchmark)
+{
+   const unsigned size = 2048, iterations = 20;
+
+   for (unsigned mode = 0; mode < 2; ++mode) {
+      for (unsigned bs = 1; bs <= 16; bs *= 2) {
+         struct image img = make_image((enum util_tiling_mode)mode, bs, 16, 16,
+                                       size, size);
+         std::vector<uint8_t> linear(img.data.size());
+         uint32_t pitch = size * bs;
+
+         int64_t start = os_time_get_nano();
+         for (unsigned i = 0; i < iterations; ++i) {
+            util_tiling_load(&img.layout, linear.data(), pitch,
+                             img.data.data(), 0, 0, size, size);
+         }
+         int64_t load_ns = os_time_get_nano() - start;
+
+         start = os_time_get_nano();
+         for (unsigned i = 0; i < iterations; ++i) {
+            util_tiling_store(&img.layout, img.data.data(), linear.data(),
+                              pitch, 0, 0, size, size);
+         }
+         int64_t store_ns = os_time_get_nano() - start;
+
+         double mb = (double)img.data.size() * iterations / (1024 * 1024);
+         printf("%s %2u B/el: load %8.1f MB/s, store %8.1f MB/s\n",
+                mode == UTIL_TILING_MORTON ? "morton       " : "u-interleaved",
+                bs, mb / (load_ns / 1e9), mb / (store_ns / 1e9));
+      }
+   }
+}
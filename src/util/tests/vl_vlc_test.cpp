@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "util/vl_vlc.h"
+
+/* 64 bytes, so that the search goes past the bit buffer into memchr */
+struct vlc_test_input {
+   alignas(4) uint8_t data[64];
+
+   vlc_test_input()
+   {
+      memset(data, 0xff, sizeof(data));
+   }
+};
+
+static void
+init_vlc(struct vl_vlc *vlc, const vlc_test_input &input)
+{
+   static const void *inputs[1];
+   static unsigned sizes[1];
+
+   inputs[0] = input.data;
+   sizes[0] = sizeof(input.data);
+   vl_vlc_init(vlc, 1, inputs, sizes);
+}
+
+TEST(VLC, SearchByte)
+{
+   vlc_test_input input;
+   struct vl_vlc vlc;
+
+   input.data[40] = 0x00;
+
+   init_vlc(&vlc, input);
+   EXPECT_FALSE(vl_vlc_search_byte(&vlc, 40 * 8, 0x00));
+
+   init_vlc(&vlc, input);
+   ASSERT_TRUE(vl_vlc_search_byte(&vlc, 41 * 8, 0x00));
+   EXPECT_EQ(vl_vlc_bits_left(&vlc), (64 - 40) * 8);
+   EXPECT_EQ(vl_vlc_peekbits(&vlc, 16), 0x00ffu);
+
+   init_vlc(&vlc, input);
+   ASSERT_TRUE(vl_vlc_search_byte(&vlc, ~0u, 0x00));
+   EXPECT_EQ(vl_vlc_bits_left(&vlc), (64 - 40) * 8);
+}
+
+/* The omx decoders pass vl_vlc_bits_left() minus the size of the start code,
+ * which leaves a limit that isn't a multiple of 8.
+ */
+TEST(VLC, SearchBytePartialLimit)
+{
+   vlc_test_input input;
+   struct vl_vlc vlc;
+
+   input.data[40] = 0x00;
+
+   for (unsigned num_bits = 1; num_bits < 8; ++num_bits) {
+      init_vlc(&vlc, input);
+      EXPECT_FALSE(vl_vlc_search_byte(&vlc, num_bits, 0x00));
+   }
+
+   /* The byte starting at bit 320 doesn't fit in 325 bits */
+   init_vlc(&vlc, input);
+   EXPECT_FALSE(vl_vlc_search_byte(&vlc, 40 * 8 + 5, 0x00));
+
+   init_vlc(&vlc, input);
+   EXPECT_TRUE(vl_vlc_search_byte(&vlc, 41 * 8 + 5, 0x00));
+
+   /* No match until the end of the data */
+   input.data[40] = 0xff;
+   init_vlc(&vlc, input);
+   vl_vlc_eatbits(&vlc, 8);
+   EXPECT_FALSE(vl_vlc_search_byte(&vlc, vl_vlc_bits_left(&vlc) - 4, 0x00));
+}
@@ -109,8 +109,18 @@ struct random_test {
       uint64_t size_pages = 1ULL << size_order;
       uint64_t size = size_pages * MEM_PAGE_SIZE;
 
+      /* Mix both allocation directions, like heaps that put small and large
+       * allocations at opposite ends do.
+       */
+      heap.alloc_high = std::bernoulli_distribution{0.75}(rand);
+
       uint64_t addr = util_vma_heap_alloc(&heap, size, align);
 
+      /* The heap must pick the first hole that fits going from the top down
+       * (or from the bottom up), as it always has.
+       */
+      assert(addr == expected_page(size_pages, align_pages) * MEM_PAGE_SIZE);
+
       if (addr == 0) {
          /* assert no gaps are present in the tracker that could satisfy this
           * allocation.
@@ -147,6 +157,30 @@ struct random_test {
       }
    }
 
+   uint64_t expected_page(uint64_t size_pages, uint64_t align_pages)
+   {
+      if (heap.alloc_high) {
+         for (auto i = heap_holes.rbegin(); i != heap_holes.rend(); i++) {
+            if (i->num_pages < size_pages)
+               continue;
+
+            uint64_t page = (allocation_end_page(*i) - size_pages) /
+                            align_pages * align_pages;
+            if (page >= i->start_page)
+               return page;
+         }
+      } else {
+         for (const auto& hole : heap_holes) {
+            uint64_t page = (hole.start_page + align_pages - 1) /
+                            align_pages * align_pages;
+            if (page + size_pages <= allocation_end_page(hole))
+               return page;
+         }
+      }
+
+      return 0;
+   }
+
    void dealloc()
    {
       if (allocations.size() == 0)
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Fragments a heap into a growing number of small holes that are too small
+ * for the allocations that follow, and prints how long allocating and
+ * freeing takes for each size.  With the holes in a tree, the time per
+ * operation should only grow with the logarithm of the number of holes.
+ */
+
+/* it is a test after all */
+#undef NDEBUG
+
+#include <cassert>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "util/vma.h"
+
+namespace {
+
+static const uint64_t PAGE_SIZE = 4096;
+static const uint64_t HEAP_START = PAGE_SIZE;
+static const uint64_t HEAP_SIZE = 1ull << 40;
+static const unsigned OPS = 20000;
+
+double
+ns_per_op(unsigned holes, bool alloc_high)
+{
+   struct util_vma_heap heap;
+   std::vector<uint64_t> addrs;
+
+   util_vma_heap_init(&heap, HEAP_START, HEAP_SIZE);
+
+   /* Pack single pages at the end of the heap we allocate from, then free
+    * every other one, so that the heap has to skip all those holes to
+    * satisfy anything bigger.
+    */
+   heap.alloc_high = alloc_high;
+   for (unsigned i = 0; i < holes * 2; i++) {
+      uint64_t addr = util_vma_heap_alloc(&heap, PAGE_SIZE, PAGE_SIZE);
+      assert(addr);
+      addrs.push_back(addr);
+   }
+   for (unsigned i = 0; i < holes * 2; i += 2)
+      util_vma_heap_free(&heap, addrs[i], PAGE_SIZE);
+
+   addrs.resize(OPS);
+
+   auto start = std::chrono::steady_clock::now();
+   for (unsigned i = 0; i < OPS; i++) {
+      addrs[i] = util_vma_heap_alloc(&heap, 2 * PAGE_SIZE, PAGE_SIZE);
+      assert(addrs[i]);
+   }
+   for (unsigned i = 0; i < OPS; i++)
+      util_vma_heap_free(&heap, addrs[i], 2 * PAGE_SIZE);
+
+   /* Holes at a given address, e.g. replaying captured buffer addresses */
+   for (unsigned i = 0; i < OPS; i++) {
+      uint64_t addr = HEAP_START + HEAP_SIZE / 2 + i * 2 * PAGE_SIZE;
+      bool ok = util_vma_heap_alloc_addr(&heap, addr, PAGE_SIZE);
+      assert(ok);
+      (void)ok;
+   }
+   auto end = std::chrono::steady_clock::now();
+
+   util_vma_heap_finish(&heap);
+
+   return std::chrono::duration<double, std::nano>(end - start).count() /
+          (3 * OPS);
+}
+
+}
+
+int main()
+{
+   for (unsigned holes = 1024; holes <= 128 * 1024; holes *= 8) {
+      printf("%7u holes: %8.1f ns/op allocating high, %8.1f ns/op low\n",
+             holes, ns_per_op(holes, true), ns_per_op(holes, false));
+   }
+
+   return 0;
+}
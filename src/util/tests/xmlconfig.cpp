@@ -22,8 +22,11 @@
  */
 
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 #include <driconf.h>
 #include <xmlconfig.h>
+#include "util/os_time.h"
 
 class xmlconfig_test : public ::testing::Test {
 protected:
@@ -53,6 +56,9 @@ xmlconfig_test::xmlconfig_test()
    unsetenv("mest_test_unknown_option");
    unsetenv("mest_drirc_option");
 
+   /* Keep the binary config cache out of $HOME, the cache tests enable it */
+   setenv("MESA_DRICONF_CACHE_DISABLE", "true", 1);
+
    options = {};
 }
 
@@ -299,4 +305,182 @@ TEST_F(xmlconfig_test, drirc_exec_override)
    EXPECT_EQ(driQueryOptioni(&cache, "mesa_drirc_option"), 1);
    driDestroyOptionCache(&cache);
 }
+
+class xmlconfig_cache_test : public xmlconfig_test {
+protected:
+   xmlconfig_cache_test();
+   ~xmlconfig_cache_test();
+
+   int query(const char *exec_name, const char *app, int appver,
+             const char *engine, int enginever);
+
+   std::filesystem::path dir;
+   std::filesystem::path cache_file;
+};
+
+xmlconfig_cache_test::xmlconfig_cache_test()
+{
+   char tmpl[] = "/tmp/mesa_driconf_test_XXXXXX";
+   dir = mkdtemp(tmpl);
+   cache_file = dir / "mesa_driconf.bin";
+
+   setenv("MESA_DRICONF_CACHE_DIR", dir.c_str(), 1);
+   unsetenv("MESA_DRICONF_CACHE_DISABLE");
+}
+
+xmlconfig_cache_test::~xmlconfig_cache_test()
+{
+   unsetenv("MESA_DRICONF_CACHE_DIR");
+   std::filesystem::remove_all(dir);
+}
+
+int
+xmlconfig_cache_test::query(const char *exec_name, const char *app,
+                            int appver, const char *engine, int enginever)
+{
+   driOptionCache cache = drirc_init("driver", "drm", exec_name, app, appver,
+                                     engine, enginever);
+   int value = driQueryOptioni(&cache, "mesa_drirc_option");
+   driDestroyOptionCache(&cache);
+   driDestroyOptionInfo(&options);
+   options = {};
+   return value;
+}
+
+TEST_F(xmlconfig_cache_test, replay)
+{
+   /* The first lookup writes the cache, all others replay it */
+   EXPECT_EQ(query("app1", NULL, 0, NULL, 0), 1);
+   ASSERT_TRUE(std::filesystem::exists(cache_file));
+   auto written = std::filesystem::last_write_time(cache_file);
+
+   EXPECT_EQ(query("app1", NULL, 0, NULL, 0), 1);
+   EXPECT_EQ(query("app3", NULL, 0, NULL, 0), 10);
+   EXPECT_EQ(query("app2v4", NULL, 0, NULL, 0), 7);
+   EXPECT_EQ(query("app2v7", NULL, 0, NULL, 0), 8);
+   EXPECT_EQ(query("other", "Versioned App Name", 1, NULL, 0), 3);
+   EXPECT_EQ(query("other", "Versioned App Name", 3, NULL, 0), 4);
+   EXPECT_EQ(query("other", "unknownapp", 0, "Versioned Engine Name", 1), 5);
+   EXPECT_EQ(query("other", NULL, 0, NULL, 0), 0);
+
+   EXPECT_TRUE(std::filesystem::last_write_time(cache_file) == written);
+}
+
+TEST_F(xmlconfig_cache_test, invalidate)
+{
+   std::filesystem::path configdir = dir / "drirc.d";
+   std::filesystem::create_directory(configdir);
+   std::filesystem::copy_file(
+      std::filesystem::path(getenv("DRIRC_CONFIGDIR")) / "00-test.conf",
+      configdir / "00-test.conf");
+
+   std::string old_configdir = getenv("DRIRC_CONFIGDIR");
+   setenv("DRIRC_CONFIGDIR", configdir.c_str(), 1);
+
+   EXPECT_EQ(query("app1", NULL, 0, NULL, 0), 1);
+   EXPECT_EQ(query("app4", NULL, 0, NULL, 0), 0);
+
+   /* A new file in the directory */
+   std::ofstream(configdir / "01-new.conf")
+      << "<driconf><device><application name=\"4\" executable=\"app4\">"
+         "<option name=\"mesa_drirc_option\" value=\"40\" />"
+         "</application></device></driconf>";
+   EXPECT_EQ(query("app4", NULL, 0, NULL, 0), 40);
+
+   /* A changed file */
+   std::ofstream(configdir / "01-new.conf")
+      << "<driconf><device><application name=\"4\" executable=\"app4\">"
+         "<option name=\"mesa_drirc_option\" value=\"41\" />"
+         "</application></device></driconf>";
+   EXPECT_EQ(query("app4", NULL, 0, NULL, 0), 41);
+
+   /* A removed file */
+   std::filesystem::remove(configdir / "01-new.conf");
+   EXPECT_EQ(query("app4", NULL, 0, NULL, 0), 0);
+   EXPECT_EQ(query("app1", NULL, 0, NULL, 0), 1);
+
+   setenv("DRIRC_CONFIGDIR", old_configdir.c_str(), 1);
+}
+
+/* A damaged cache is ignored and rewritten from the XML files */
+TEST_F(xmlconfig_cache_test, corrupt)
+{
+   EXPECT_EQ(query("app1", NULL, 0, NULL, 0), 1);
+
+   std::ifstream in(cache_file, std::ios::binary);
+   std::vector<char> good((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+   in.close();
+
+   /* magic[2], version, key, num_sources, num_words, strings_size, pad */
+   uint32_t header[8];
+   ASSERT_GE(good.size(), sizeof(header));
+   memcpy(header, good.data(), sizeof(header));
+   const uint32_t num_words = header[5], strings_size = header[6];
+   const size_t words_offset = sizeof(header) + header[4] * 32;
+
+   /* The events start with the first file, then its <driconf> element:
+    * START | name | end | exec hash | num attrs
+    */
+   const struct {
+      uint32_t word, value;
+   } corruptions[] = {
+      { 0, 0xff },                /* unknown event */
+      { 1, strings_size },        /* file name past the strings */
+      { 3, strings_size },        /* element name past the strings */
+      { 4, num_words + 1 },       /* end past the events */
+      { 4, 2 },                   /* end jumping backwards */
+      { 4, 3 },                   /* end in the middle of an event */
+      { 6, 1u << 30 },            /* attributes past the events */
+   };
+
+   for (const auto &c : corruptions) {
+      std::vector<char> bad = good;
+      ASSERT_LE(words_offset + (c.word + 1) * 4, bad.size());
+      memcpy(&bad[words_offset + c.word * 4], &c.value, 4);
+      std::ofstream(cache_file, std::ios::binary).write(bad.data(), bad.size());
+
+      EXPECT_EQ(query("app1", NULL, 0, NULL, 0), 1) << "word " << c.word;
+      EXPECT_EQ(query("app3", NULL, 0, NULL, 0), 10) << "word " << c.word;
+
+      std::ifstream reread(cache_file, std::ios::binary);
+      std::vector<char> rewritten((std::istreambuf_iterator<char>(reread)),
+                                  std::istreambuf_iterator<char>());
+      EXPECT_TRUE(rewritten == good) << "word " << c.word;
+   }
+}
+
+/* Startup cost of the Mesa defaults with and without the cache, run with
+ * --gtest_also_run_disabled_tests --gtest_filter=*benchmark*
+ */
+TEST_F(xmlconfig_cache_test, DISABLED_benchmark)
+{
+   const unsigned iterations = 200;
+   std::filesystem::path configdir = dir / "drirc.d";
+   std::filesystem::create_directory(configdir);
+   std::filesystem::copy_file(getenv("DRIRC_DEFAULTS"),
+                              configdir / "00-mesa-defaults.conf");
+
+   std::string old_configdir = getenv("DRIRC_CONFIGDIR");
+   setenv("DRIRC_CONFIGDIR", configdir.c_str(), 1);
+
+   for (unsigned cached = 0; cached < 2; cached++) {
+      if (cached)
+         unsetenv("MESA_DRICONF_CACHE_DISABLE");
+      else
+         setenv("MESA_DRICONF_CACHE_DISABLE", "true", 1);
+
+      query("glxgears", NULL, 0, NULL, 0);
+
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < iterations; i++)
+         query("glxgears", NULL, 0, NULL, 0);
+      int64_t ns = os_time_get_nano() - start;
+
+      printf("%s: %8.1f us per driParseConfigFiles\n",
+             cached ? "cache" : "xml  ", ns / 1000.0 / iterations);
+   }
+
+   setenv("DRIRC_CONFIGDIR", old_configdir.c_str(), 1);
+}
 #endif
@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "util/u_bands.h"
+
+#include <assert.h>
+
+#include "util/u_call_once.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
+
+struct band_job {
+   struct util_queue_fence fence;
+   util_band_func func;
+   void *data;
+   unsigned band;
+};
+
+static struct util_queue bands_queue;
+static unsigned bands_threads;
+static util_once_flag bands_once = UTIL_ONCE_FLAG_INIT;
+
+static void
+bands_init(void)
+{
+   /* The caller works on a band too */
+   unsigned num_threads =
+      MIN2(MAX2(util_get_cpu_caps()->nr_cpus, 1), UTIL_BANDS_MAX) - 1;
+
+   if (num_threads &&
+       util_queue_init(&bands_queue, "bands", 2 * UTIL_BANDS_MAX, num_threads,
+                       UTIL_QUEUE_INIT_RESIZE_IF_FULL, NULL))
+      bands_threads = num_threads;
+}
+
+unsigned
+util_bands_max(void)
+{
+   util_call_once(&bands_once, bands_init);
+
+   return bands_threads + 1;
+}
+
+static void
+band_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct band_job *job = data;
+
+   job->func(job->data, job->band);
+}
+
+void
+util_run_bands(unsigned num_bands, util_band_func func, void *data)
+{
+   struct band_job jobs[UTIL_BANDS_MAX];
+
+   assert(num_bands <= UTIL_BANDS_MAX);
+
+   if (util_bands_max() == 1) {
+      for (unsigned b = 0; b < num_bands; b++)
+         func(data, b);
+      return;
+   }
+
+   for (unsigned b = 1; b < num_bands; b++) {
+      jobs[b].func = func;
+      jobs[b].data = data;
+      jobs[b].band = b;
+      util_queue_fence_init(&jobs[b].fence);
+      util_queue_add_job(&bands_queue, &jobs[b], &jobs[b].fence,
+                         band_job_execute, NULL, 0);
+   }
+
+   if (num_bands)
+      func(data, 0);
+
+   for (unsigned b = 1; b < num_bands; b++) {
+      util_queue_fence_wait(&jobs[b].fence);
+      util_queue_fence_destroy(&jobs[b].fence);
+   }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * A process-wide pool of threads to split CPU work on an image or a
+ * bitstream into bands that run concurrently, with the calling thread
+ * taking the first band.
+ */
+
+#ifndef _UTIL_BANDS_H
+#define _UTIL_BANDS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of bands of a util_run_bands() call. */
+#define UTIL_BANDS_MAX 8
+
+typedef void (*util_band_func)(void *data, unsigned band);
+
+/**
+ * Number of bands that run at the same time: the threads of the pool, one
+ * less than the number of CPUs and at most UTIL_BANDS_MAX - 1, plus the
+ * calling thread.
+ */
+unsigned
+util_bands_max(void);
+
+/**
+ * Runs 'func' for each band in [0, num_bands), band 0 on the calling thread
+ * and the others on the pool, and returns once they are all done.
+ * 'num_bands' must not be larger than UTIL_BANDS_MAX.
+ */
+void
+util_run_bands(unsigned num_bands, util_band_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_BANDS_H */
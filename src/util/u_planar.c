@@ -0,0 +1,337 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "util/u_bands.h"
+#include "util/u_call_once.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+#include "util/u_planar_priv.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Copies smaller than this many elements are not worth splitting */
+#define UTIL_PLANAR_BAND_MIN_SIZE (1 << 19)
+#define UTIL_PLANAR_BAND_MIN_ROWS 32
+
+static void
+deinterleave_8_c(uint8_t *const *dst, const uint8_t *const *src,
+                 unsigned x, unsigned width)
+{
+   for (; x < width; x++) {
+      dst[0][x] = src[0][2 * x];
+      dst[1][x] = src[0][2 * x + 1];
+   }
+}
+
+static void
+interleave_8_c(uint8_t *const *dst, const uint8_t *const *src,
+               unsigned x, unsigned width)
+{
+   for (; x < width; x++) {
+      dst[0][2 * x] = src[0][x];
+      dst[0][2 * x + 1] = src[1][x];
+   }
+}
+
+static void
+insert_8_even_c(uint8_t *const *dst, const uint8_t *const *src,
+                unsigned x, unsigned width)
+{
+   for (; x < width; x++)
+      dst[0][2 * x] = src[0][x];
+}
+
+static void
+insert_8_odd_c(uint8_t *const *dst, const uint8_t *const *src,
+               unsigned x, unsigned width)
+{
+   for (; x < width; x++)
+      dst[0][2 * x + 1] = src[0][x];
+}
+
+static void
+swap_16_c(uint8_t *const *dst, const uint8_t *const *src,
+          unsigned x, unsigned width)
+{
+   for (; x < width; x++) {
+      uint8_t lo = src[0][2 * x], hi = src[0][2 * x + 1];
+      dst[0][2 * x] = hi;
+      dst[0][2 * x + 1] = lo;
+   }
+}
+
+/* The samples are little-endian, so the 8 MSBs are in the second byte */
+static void
+narrow_16_c(uint8_t *const *dst, const uint8_t *const *src,
+            unsigned x, unsigned width)
+{
+   for (; x < width; x++)
+      dst[0][x] = src[0][2 * x + 1];
+}
+
+static void
+deinterleave_narrow_16_c(uint8_t *const *dst, const uint8_t *const *src,
+                         unsigned x, unsigned width)
+{
+   for (; x < width; x++) {
+      dst[0][x] = src[0][4 * x + 1];
+      dst[1][x] = src[0][4 * x + 3];
+   }
+}
+
+const util_planar_row_func util_planar_row_c[UTIL_PLANAR_NUM_OPS] = {
+   [UTIL_PLANAR_DEINTERLEAVE_8] = deinterleave_8_c,
+   [UTIL_PLANAR_INTERLEAVE_8] = interleave_8_c,
+   [UTIL_PLANAR_INSERT_8_EVEN] = insert_8_even_c,
+   [UTIL_PLANAR_INSERT_8_ODD] = insert_8_odd_c,
+   [UTIL_PLANAR_SWAP_16] = swap_16_c,
+   [UTIL_PLANAR_NARROW_16] = narrow_16_c,
+   [UTIL_PLANAR_DEINTERLEAVE_NARROW_16] = deinterleave_narrow_16_c,
+};
+
+#if defined(__SSE2__)
+
+/* 16 UV pairs per iteration */
+static void
+deinterleave_8_sse2(uint8_t *const *dst, const uint8_t *const *src,
+                    unsigned x, unsigned width)
+{
+   const __m128i lo_mask = _mm_set1_epi16(0xff);
+
+   for (; x + 16 <= width; x += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(src[0] + 2 * x));
+      __m128i b = _mm_loadu_si128((const __m128i *)(src[0] + 2 * x + 16));
+      __m128i u = _mm_packus_epi16(_mm_and_si128(a, lo_mask),
+                                   _mm_and_si128(b, lo_mask));
+      __m128i v = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+
+      _mm_storeu_si128((__m128i *)(dst[0] + x), u);
+      _mm_storeu_si128((__m128i *)(dst[1] + x), v);
+   }
+
+   deinterleave_8_c(dst, src, x, width);
+}
+
+static void
+interleave_8_sse2(uint8_t *const *dst, const uint8_t *const *src,
+                  unsigned x, unsigned width)
+{
+   for (; x + 16 <= width; x += 16) {
+      __m128i u = _mm_loadu_si128((const __m128i *)(src[0] + x));
+      __m128i v = _mm_loadu_si128((const __m128i *)(src[1] + x));
+
+      _mm_storeu_si128((__m128i *)(dst[0] + 2 * x), _mm_unpacklo_epi8(u, v));
+      _mm_storeu_si128((__m128i *)(dst[0] + 2 * x + 16),
+                       _mm_unpackhi_epi8(u, v));
+   }
+
+   interleave_8_c(dst, src, x, width);
+}
+
+static ALWAYS_INLINE void
+insert_8_sse2(uint8_t *const *dst, const uint8_t *const *src,
+              unsigned *x, unsigned width, bool odd)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i keep = _mm_set1_epi16(odd ? 0x00ff : 0xff00);
+
+   for (; *x + 16 <= width; *x += 16) {
+      uint8_t *d = dst[0] + 2 * *x;
+      __m128i s = _mm_loadu_si128((const __m128i *)(src[0] + *x));
+      __m128i lo = odd ? _mm_unpacklo_epi8(zero, s) : _mm_unpacklo_epi8(s, zero);
+      __m128i hi = odd ? _mm_unpackhi_epi8(zero, s) : _mm_unpackhi_epi8(s, zero);
+      __m128i d0 = _mm_loadu_si128((const __m128i *)d);
+      __m128i d1 = _mm_loadu_si128((const __m128i *)(d + 16));
+
+      _mm_storeu_si128((__m128i *)d, _mm_or_si128(_mm_and_si128(d0, keep), lo));
+      _mm_storeu_si128((__m128i *)(d + 16),
+                       _mm_or_si128(_mm_and_si128(d1, keep), hi));
+   }
+}
+
+static void
+insert_8_even_sse2(uint8_t *const *dst, const uint8_t *const *src,
+                   unsigned x, unsigned width)
+{
+   insert_8_sse2(dst, src, &x, width, false);
+   insert_8_even_c(dst, src, x, width);
+}
+
+static void
+insert_8_odd_sse2(uint8_t *const *dst, const uint8_t *const *src,
+                  unsigned x, unsigned width)
+{
+   insert_8_sse2(dst, src, &x, width, true);
+   insert_8_odd_c(dst, src, x, width);
+}
+
+static void
+swap_16_sse2(uint8_t *const *dst, const uint8_t *const *src,
+             unsigned x, unsigned width)
+{
+   for (; x + 8 <= width; x += 8) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(src[0] + 2 * x));
+
+      _mm_storeu_si128((__m128i *)(dst[0] + 2 * x),
+                       _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8)));
+   }
+
+   swap_16_c(dst, src, x, width);
+}
+
+static void
+narrow_16_sse2(uint8_t *const *dst, const uint8_t *const *src,
+               unsigned x, unsigned width)
+{
+   for (; x + 16 <= width; x += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(src[0] + 2 * x));
+      __m128i b = _mm_loadu_si128((const __m128i *)(src[0] + 2 * x + 16));
+
+      _mm_storeu_si128((__m128i *)(dst[0] + x),
+                       _mm_packus_epi16(_mm_srli_epi16(a, 8),
+                                        _mm_srli_epi16(b, 8)));
+   }
+
+   narrow_16_c(dst, src, x, width);
+}
+
+/* Narrow to 8-bit UVUV..., then deinterleave as above */
+static void
+deinterleave_narrow_16_sse2(uint8_t *const *dst, const uint8_t *const *src,
+                            unsigned x, unsigned width)
+{
+   const __m128i lo_mask = _mm_set1_epi16(0xff);
+
+   for (; x + 16 <= width; x += 16) {
+      const __m128i *s = (const __m128i *)(src[0] + 4 * x);
+      __m128i a = _mm_packus_epi16(_mm_srli_epi16(_mm_loadu_si128(s + 0), 8),
+                                   _mm_srli_epi16(_mm_loadu_si128(s + 1), 8));
+      __m128i b = _mm_packus_epi16(_mm_srli_epi16(_mm_loadu_si128(s + 2), 8),
+                                   _mm_srli_epi16(_mm_loadu_si128(s + 3), 8));
+      __m128i u = _mm_packus_epi16(_mm_and_si128(a, lo_mask),
+                                   _mm_and_si128(b, lo_mask));
+      __m128i v = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+
+      _mm_storeu_si128((__m128i *)(dst[0] + x), u);
+      _mm_storeu_si128((__m128i *)(dst[1] + x), v);
+   }
+
+   deinterleave_narrow_16_c(dst, src, x, width);
+}
+
+#endif /* __SSE2__ */
+
+static util_planar_row_func planar_funcs[UTIL_PLANAR_NUM_OPS];
+static util_once_flag planar_once = UTIL_ONCE_FLAG_INIT;
+
+static void
+planar_init(void)
+{
+   memcpy(planar_funcs, util_planar_row_c, sizeof(planar_funcs));
+
+#if defined(__SSE2__)
+   planar_funcs[UTIL_PLANAR_DEINTERLEAVE_8] = deinterleave_8_sse2;
+   planar_funcs[UTIL_PLANAR_INTERLEAVE_8] = interleave_8_sse2;
+   planar_funcs[UTIL_PLANAR_INSERT_8_EVEN] = insert_8_even_sse2;
+   planar_funcs[UTIL_PLANAR_INSERT_8_ODD] = insert_8_odd_sse2;
+   planar_funcs[UTIL_PLANAR_SWAP_16] = swap_16_sse2;
+   planar_funcs[UTIL_PLANAR_NARROW_16] = narrow_16_sse2;
+   planar_funcs[UTIL_PLANAR_DEINTERLEAVE_NARROW_16] = deinterleave_narrow_16_sse2;
+#endif
+
+#if DETECT_ARCH_X86 || DETECT_ARCH_X86_64
+   if (util_get_cpu_caps()->has_avx2)
+      util_planar_init_avx2(planar_funcs);
+#endif
+
+#if DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM
+   util_planar_init_neon(planar_funcs);
+#endif
+}
+
+static void
+copy_rows(const struct util_planar_copy *copy)
+{
+   util_planar_row_func func = planar_funcs[copy->op];
+   uint8_t *dst[2] = { copy->dst[0], copy->dst[1] };
+   const uint8_t *src[2] = { copy->src[0], copy->src[1] };
+
+   for (unsigned y = 0; y < copy->height; y++) {
+      func(dst, src, 0, copy->width);
+
+      for (unsigned i = 0; i < 2; i++) {
+         if (dst[i])
+            dst[i] += copy->dst_stride[i];
+         if (src[i])
+            src[i] += copy->src_stride[i];
+      }
+   }
+}
+
+static void
+planar_band_execute(void *data, unsigned band)
+{
+   const struct util_planar_copy *bands = data;
+
+   copy_rows(&bands[band]);
+}
+
+void
+util_planar_copy(const struct util_planar_copy *copy)
+{
+   util_call_once(&planar_once, planar_init);
+
+   unsigned num_bands = 1;
+   if ((uint64_t)copy->width * copy->height >= UTIL_PLANAR_BAND_MIN_SIZE) {
+      num_bands = MIN2(util_bands_max(),
+                       copy->height / UTIL_PLANAR_BAND_MIN_ROWS);
+   }
+
+   if (num_bands <= 1) {
+      copy_rows(copy);
+      return;
+   }
+
+   struct util_planar_copy bands[UTIL_BANDS_MAX];
+
+   for (unsigned b = 0; b < num_bands; b++) {
+      unsigned y0 = (uint64_t)copy->height * b / num_bands;
+      unsigned y1 = (uint64_t)copy->height * (b + 1) / num_bands;
+      struct util_planar_copy *band = &bands[b];
+
+      *band = *copy;
+      band->height = y1 - y0;
+      for (unsigned i = 0; i < 2; i++) {
+         if (band->dst[i])
+            band->dst[i] += y0 * copy->dst_stride[i];
+         if (band->src[i])
+            band->src[i] += y0 * copy->src_stride[i];
+      }
+   }
+
+   util_run_bands(num_bands, planar_band_execute, bands);
+}
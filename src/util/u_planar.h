@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Row-by-row conversions between the planar, semi-planar and packed YUV
+ * layouts used by the video frontends when copying images in and out of
+ * video buffers.
+ *
+ * The per-row kernels are picked at runtime for the CPU (SSE2, AVX2 or
+ * NEON), and large copies are split into bands of rows processed in
+ * parallel.
+ */
+
+#ifndef _UTIL_PLANAR_H
+#define _UTIL_PLANAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum util_planar_op {
+   /** UVUV... in src[0] to U in dst[0] and V in dst[1] */
+   UTIL_PLANAR_DEINTERLEAVE_8,
+
+   /** U in src[0] and V in src[1] to UVUV... in dst[0] */
+   UTIL_PLANAR_INTERLEAVE_8,
+
+   /** src[0] to the even (resp. odd) bytes of dst[0], the others are kept */
+   UTIL_PLANAR_INSERT_8_EVEN,
+   UTIL_PLANAR_INSERT_8_ODD,
+
+   /** Swap the bytes of each 16-bit word, e.g. UYVY <-> YUYV */
+   UTIL_PLANAR_SWAP_16,
+
+   /** MSB-aligned 16-bit samples (P010, P016) to 8-bit */
+   UTIL_PLANAR_NARROW_16,
+
+   /** 16-bit UVUV... in src[0] to 8-bit U in dst[0] and V in dst[1] */
+   UTIL_PLANAR_DEINTERLEAVE_NARROW_16,
+
+   UTIL_PLANAR_NUM_OPS,
+};
+
+struct util_planar_copy {
+   enum util_planar_op op;
+
+   /** Only the planes used by the operation need to be set */
+   uint8_t *dst[2];
+   ptrdiff_t dst_stride[2];
+   const uint8_t *src[2];
+   ptrdiff_t src_stride[2];
+
+   /**
+    * Number of elements per row: for the (de)interleaving operations it is
+    * the number of UV pairs, for the other ones the number of samples of the
+    * source.
+    */
+   unsigned width;
+   unsigned height;
+};
+
+void
+util_planar_copy(const struct util_planar_copy *copy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_PLANAR_H */
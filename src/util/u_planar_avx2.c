@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* AVX2 row kernels for u_planar, built with -mavx2 and only called when the
+ * CPU supports it.
+ */
+
+#include "util/u_planar_priv.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+/* Packs within each 128-bit lane, so the 64-bit halves need reordering */
+static ALWAYS_INLINE __m256i
+packus_epi16_ordered(__m256i a, __m256i b)
+{
+   return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b),
+                                   _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+/* 32 UV pairs per iteration */
+static void
+deinterleave_8_avx2(uint8_t *const *dst, const uint8_t *const *src,
+                    unsigned x, unsigned width)
+{
+   const __m256i lo_mask = _mm256_set1_epi16(0xff);
+
+   for (; x + 32 <= width; x += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(src[0] + 2 * x));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(src[0] + 2 * x + 32));
+      __m256i u = packus_epi16_ordered(_mm256_and_si256(a, lo_mask),
+                                       _mm256_and_si256(b, lo_mask));
+      __m256i v = packus_epi16_ordered(_mm256_srli_epi16(a, 8),
+                                       _mm256_srli_epi16(b, 8));
+
+      _mm256_storeu_si256((__m256i *)(dst[0] + x), u);
+      _mm256_storeu_si256((__m256i *)(dst[1] + x), v);
+   }
+
+   util_planar_row_c[UTIL_PLANAR_DEINTERLEAVE_8](dst, src, x, width);
+}
+
+static void
+interleave_8_avx2(uint8_t *const *dst, const uint8_t *const *src,
+                  unsigned x, unsigned width)
+{
+   for (; x + 32 <= width; x += 32) {
+      __m256i u = _mm256_loadu_si256((const __m256i *)(src[0] + x));
+      __m256i v = _mm256_loadu_si256((const __m256i *)(src[1] + x));
+      __m256i lo = _mm256_unpacklo_epi8(u, v);
+      __m256i hi = _mm256_unpackhi_epi8(u, v);
+
+      _mm256_storeu_si256((__m256i *)(dst[0] + 2 * x),
+                          _mm256_permute2x128_si256(lo, hi, 0x20));
+      _mm256_storeu_si256((__m256i *)(dst[0] + 2 * x + 32),
+                          _mm256_permute2x128_si256(lo, hi, 0x31));
+   }
+
+   util_planar_row_c[UTIL_PLANAR_INTERLEAVE_8](dst, src, x, width);
+}
+
+static void
+swap_16_avx2(uint8_t *const *dst, const uint8_t *const *src,
+             unsigned x, unsigned width)
+{
+   const __m256i swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+                                         9, 8, 11, 10, 13, 12, 15, 14,
+                                         1, 0, 3, 2, 5, 4, 7, 6,
+                                         9, 8, 11, 10, 13, 12, 15, 14);
+
+   for (; x + 16 <= width; x += 16) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(src[0] + 2 * x));
+
+      _mm256_storeu_si256((__m256i *)(dst[0] + 2 * x),
+                          _mm256_shuffle_epi8(a, swap));
+   }
+
+   util_planar_row_c[UTIL_PLANAR_SWAP_16](dst, src, x, width);
+}
+
+static void
+narrow_16_avx2(uint8_t *const *dst, const uint8_t *const *src,
+               unsigned x, unsigned width)
+{
+   for (; x + 32 <= width; x += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(src[0] + 2 * x));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(src[0] + 2 * x + 32));
+
+      _mm256_storeu_si256((__m256i *)(dst[0] + x),
+                          packus_epi16_ordered(_mm256_srli_epi16(a, 8),
+                                               _mm256_srli_epi16(b, 8)));
+   }
+
+   util_planar_row_c[UTIL_PLANAR_NARROW_16](dst, src, x, width);
+}
+
+static void
+deinterleave_narrow_16_avx2(uint8_t *const *dst, const uint8_t *const *src,
+                            unsigned x, unsigned width)
+{
+   const __m256i lo_mask = _mm256_set1_epi16(0xff);
+
+   for (; x + 32 <= width; x += 32) {
+      const __m256i *s = (const __m256i *)(src[0] + 4 * x);
+      __m256i a =
+         packus_epi16_ordered(_mm256_srli_epi16(_mm256_loadu_si256(s + 0), 8),
+                              _mm256_srli_epi16(_mm256_loadu_si256(s + 1), 8));
+      __m256i b =
+         packus_epi16_ordered(_mm256_srli_epi16(_mm256_loadu_si256(s + 2), 8),
+                              _mm256_srli_epi16(_mm256_loadu_si256(s + 3), 8));
+      __m256i u = packus_epi16_ordered(_mm256_and_si256(a, lo_mask),
+                                       _mm256_and_si256(b, lo_mask));
+      __m256i v = packus_epi16_ordered(_mm256_srli_epi16(a, 8),
+                                       _mm256_srli_epi16(b, 8));
+
+      _mm256_storeu_si256((__m256i *)(dst[0] + x), u);
+      _mm256_storeu_si256((__m256i *)(dst[1] + x), v);
+   }
+
+   util_planar_row_c[UTIL_PLANAR_DEINTERLEAVE_NARROW_16](dst, src, x, width);
+}
+
+void
+util_planar_init_avx2(util_planar_row_func *funcs)
+{
+   funcs[UTIL_PLANAR_DEINTERLEAVE_8] = deinterleave_8_avx2;
+   funcs[UTIL_PLANAR_INTERLEAVE_8] = interleave_8_avx2;
+   funcs[UTIL_PLANAR_SWAP_16] = swap_16_avx2;
+   funcs[UTIL_PLANAR_NARROW_16] = narrow_16_avx2;
+   funcs[UTIL_PLANAR_DEINTERLEAVE_NARROW_16] = deinterleave_narrow_16_avx2;
+   /* The SSE2 insertion is bound by the read-modify-write of the destination */
+}
+
+#else
+
+void
+util_planar_init_avx2(util_planar_row_func *funcs)
+{
+}
+
+#endif /* __AVX2__ */
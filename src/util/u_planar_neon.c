@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "util/u_planar_priv.h"
+
+#if DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM
+
+#if !defined(__SOFTFP__)
+
+/* armhf builds default to vfp, not neon, and refuses to compile neon intrinsics
+ * unless you tell it "no really".
+ */
+#if DETECT_ARCH_ARM
+#pragma GCC target ("fpu=neon")
+#endif
+
+#include <arm_neon.h>
+#include "util/u_cpu_detect.h"
+
+/* The structured loads and stores do all the (de)interleaving for us */
+static void
+deinterleave_8_neon(uint8_t *const *dst, const uint8_t *const *src,
+                    unsigned x, unsigned width)
+{
+   for (; x + 16 <= width; x += 16) {
+      uint8x16x2_t uv = vld2q_u8(src[0] + 2 * x);
+
+      vst1q_u8(dst[0] + x, uv.val[0]);
+      vst1q_u8(dst[1] + x, uv.val[1]);
+   }
+
+   util_planar_row_c[UTIL_PLANAR_DEINTERLEAVE_8](dst, src, x, width);
+}
+
+static void
+interleave_8_neon(uint8_t *const *dst, const uint8_t *const *src,
+                  unsigned x, unsigned width)
+{
+   for (; x + 16 <= width; x += 16) {
+      uint8x16x2_t uv;
+
+      uv.val[0] = vld1q_u8(src[0] + x);
+      uv.val[1] = vld1q_u8(src[1] + x);
+      vst2q_u8(dst[0] + 2 * x, uv);
+   }
+
+   util_planar_row_c[UTIL_PLANAR_INTERLEAVE_8](dst, src, x, width);
+}
+
+static ALWAYS_INLINE void
+insert_8_neon(uint8_t *const *dst, const uint8_t *const *src,
+              unsigned *x, unsigned width, unsigned i)
+{
+   for (; *x + 16 <= width; *x += 16) {
+      uint8x16x2_t d = vld2q_u8(dst[0] + 2 * *x);
+
+      d.val[i] = vld1q_u8(src[0] + *x);
+      vst2q_u8(dst[0] + 2 * *x, d);
+   }
+}
+
+static void
+insert_8_even_neon(uint8_t *const *dst, const uint8_t *const *src,
+                   unsigned x, unsigned width)
+{
+   insert_8_neon(dst, src, &x, width, 0);
+   util_planar_row_c[UTIL_PLANAR_INSERT_8_EVEN](dst, src, x, width);
+}
+
+static void
+insert_8_odd_neon(uint8_t *const *dst, const uint8_t *const *src,
+                  unsigned x, unsigned width)
+{
+   insert_8_neon(dst, src, &x, width, 1);
+   util_planar_row_c[UTIL_PLANAR_INSERT_8_ODD](dst, src, x, width);
+}
+
+static void
+swap_16_neon(uint8_t *const *dst, const uint8_t *const *src,
+             unsigned x, unsigned width)
+{
+   for (; x + 8 <= width; x += 8)
+      vst1q_u8(dst[0] + 2 * x, vrev16q_u8(vld1q_u8(src[0] + 2 * x)));
+
+   util_planar_row_c[UTIL_PLANAR_SWAP_16](dst, src, x, width);
+}
+
+static void
+narrow_16_neon(uint8_t *const *dst, const uint8_t *const *src,
+               unsigned x, unsigned width)
+{
+   for (; x + 16 <= width; x += 16)
+      vst1q_u8(dst[0] + x, vld2q_u8(src[0] + 2 * x).val[1]);
+
+   util_planar_row_c[UTIL_PLANAR_NARROW_16](dst, src, x, width);
+}
+
+/* Bytes come as U lsb, U msb, V lsb, V msb */
+static void
+deinterleave_narrow_16_neon(uint8_t *const *dst, const uint8_t *const *src,
+                            unsigned x, unsigned width)
+{
+   for (; x + 16 <= width; x += 16) {
+      uint8x16x4_t uv = vld4q_u8(src[0] + 4 * x);
+
+      vst1q_u8(dst[0] + x, uv.val[1]);
+      vst1q_u8(dst[1] + x, uv.val[3]);
+   }
+
+   util_planar_row_c[UTIL_PLANAR_DEINTERLEAVE_NARROW_16](dst, src, x, width);
+}
+
+void
+util_planar_init_neon(util_planar_row_func *funcs)
+{
+   /* CPU detect for NEON support.  On arm64, it's implied. */
+#if DETECT_ARCH_ARM
+   if (!util_get_cpu_caps()->has_neon)
+      return;
+#endif
+
+   funcs[UTIL_PLANAR_DEINTERLEAVE_8] = deinterleave_8_neon;
+   funcs[UTIL_PLANAR_INTERLEAVE_8] = interleave_8_neon;
+   funcs[UTIL_PLANAR_INSERT_8_EVEN] = insert_8_even_neon;
+   funcs[UTIL_PLANAR_INSERT_8_ODD] = insert_8_odd_neon;
+   funcs[UTIL_PLANAR_SWAP_16] = swap_16_neon;
+   funcs[UTIL_PLANAR_NARROW_16] = narrow_16_neon;
+   funcs[UTIL_PLANAR_DEINTERLEAVE_NARROW_16] = deinterleave_narrow_16_neon;
+}
+
+#else
+
+void
+util_planar_init_neon(util_planar_row_func *funcs)
+{
+}
+
+#endif /* !__SOFTFP__ */
+
+#endif /* DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM */
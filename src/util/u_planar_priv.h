@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Helpers shared by the per-ISA implementations of u_planar. */
+
+#ifndef _UTIL_PLANAR_PRIV_H
+#define _UTIL_PLANAR_PRIV_H
+
+#include <stdint.h>
+
+#include "util/detect_arch.h"
+#include "util/macros.h"
+#include "util/u_planar.h"
+
+/**
+ * Converts the elements [x, width) of one row.  The SIMD kernels handle as
+ * many elements as they can and leave the rest to the C ones.
+ */
+typedef void (*util_planar_row_func)(uint8_t *const *dst,
+                                     const uint8_t *const *src,
+                                     unsigned x, unsigned width);
+
+extern const util_planar_row_func util_planar_row_c[UTIL_PLANAR_NUM_OPS];
+
+/* Each of these replaces the entries of 'funcs' it has a better kernel for */
+#if DETECT_ARCH_X86 || DETECT_ARCH_X86_64
+void util_planar_init_avx2(util_planar_row_func *funcs);
+#endif
+
+#if DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM
+void util_planar_init_neon(util_planar_row_func *funcs);
+#endif
+
+#endif /* _UTIL_PLANAR_PRIV_H */
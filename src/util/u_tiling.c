@@ -0,0 +1,463 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "util/u_cpu_detect.h"
+#include "util/u_tiling_priv.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Portable micro-block kernels.  The element size is a compile-time constant
+ * after inlining, so the copies turn into plain loads and stores.
+ */
+
+static ALWAYS_INLINE void
+micro_copy(uint8_t *linear, uint32_t linear_pitch_B, uint8_t *tiled,
+           enum util_tiling_mode mode, unsigned blocksize_B, bool is_store)
+{
+   const uint8_t *index = util_tiling_micro_index[mode];
+
+   for (unsigned y = 0; y < 4; ++y) {
+      for (unsigned x = 0; x < 4; ++x) {
+         uint8_t *l = linear + y * linear_pitch_B + x * blocksize_B;
+         uint8_t *t = tiled + index[y * 4 + x] * blocksize_B;
+
+         if (is_store)
+            memcpy(t, l, blocksize_B);
+         else
+            memcpy(l, t, blocksize_B);
+      }
+   }
+}
+
+#define MICRO_COPY_GENERIC(bs)                                                 \
+   static void micro_load_morton_##bs(uint8_t *l, uint32_t p, uint8_t *t)      \
+   {                                                                           \
+      micro_copy(l, p, t, UTIL_TILING_MORTON, bs, false);                      \
+   }                                                                           \
+   static void micro_store_morton_##bs(uint8_t *l, uint32_t p, uint8_t *t)     \
+   {                                                                           \
+      micro_copy(l, p, t, UTIL_TILING_MORTON, bs, true);                       \
+   }                                                                           \
+   static void micro_load_u_interleaved_##bs(uint8_t *l, uint32_t p,           \
+                                             uint8_t *t)                       \
+   {                                                                           \
+      micro_copy(l, p, t, UTIL_TILING_U_INTERLEAVED, bs, false);               \
+   }                                                                           \
+   static void micro_store_u_interleaved_##bs(uint8_t *l, uint32_t p,          \
+                                              uint8_t *t)                      \
+   {                                                                           \
+      micro_copy(l, p, t, UTIL_TILING_U_INTERLEAVED, bs, true);                \
+   }
+
+MICRO_COPY_GENERIC(1)
+MICRO_COPY_GENERIC(16)
+#if !defined(__SSE2__)
+MICRO_COPY_GENERIC(2)
+MICRO_COPY_GENERIC(4)
+MICRO_COPY_GENERIC(8)
+#endif
+
+#define COPY_ALIGNED(suffix, bs)                                               \
+   static void copy_aligned_##suffix(                                          \
+      const struct util_tiling_layout *layout, uint8_t *linear,                \
+      uint32_t linear_pitch_B, uint8_t *tiled, unsigned x_el, unsigned y_el,   \
+      unsigned w_el, unsigned h_el, bool is_store)                             \
+   {                                                                           \
+      util_tiling_micro_func kernel;                                           \
+      if (layout->mode == UTIL_TILING_MORTON)                                  \
+         kernel = is_store ? micro_store_morton_##suffix                       \
+                           : micro_load_morton_##suffix;                       \
+      else                                                                     \
+         kernel = is_store ? micro_store_u_interleaved_##suffix                \
+                           : micro_load_u_interleaved_##suffix;                \
+                                                                               \
+      util_tiling_copy_aligned(layout, linear, linear_pitch_B, tiled, x_el,    \
+                               y_el, w_el, h_el, bs, kernel);                  \
+   }
+
+#if defined(__SSE2__)
+
+/*
+ * SSE2 micro-block kernels.  For 4-byte elements, the micro-block is four
+ * 16-byte vectors holding elements [0..3], [4..7], [8..11] and [12..15], and
+ * each row of the micro-block takes one half from each of a pair of them.
+ * The u-interleaved order additionally swaps the elements of each pair in
+ * the odd rows, and swaps the halves of the bottom two rows.
+ */
+
+static ALWAYS_INLINE __m128i
+swap_pairs_32(__m128i v)
+{
+   return _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static ALWAYS_INLINE __m128i
+swap_pairs_64(__m128i v)
+{
+   return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+static ALWAYS_INLINE void
+micro_load_4_sse2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m128i v0 = _mm_loadu_si128((__m128i *)tiled + 0);
+   __m128i v1 = _mm_loadu_si128((__m128i *)tiled + 1);
+   __m128i v2 = _mm_loadu_si128((__m128i *)tiled + 2);
+   __m128i v3 = _mm_loadu_si128((__m128i *)tiled + 3);
+
+   __m128i r0 = _mm_unpacklo_epi64(v0, v1);
+   __m128i r1 = _mm_unpackhi_epi64(v0, v1);
+   __m128i r2 = u_il ? _mm_unpacklo_epi64(v3, v2) : _mm_unpacklo_epi64(v2, v3);
+   __m128i r3 = u_il ? _mm_unpackhi_epi64(v3, v2) : _mm_unpackhi_epi64(v2, v3);
+
+   if (u_il) {
+      r1 = swap_pairs_32(r1);
+      r3 = swap_pairs_32(r3);
+   }
+
+   _mm_storeu_si128((__m128i *)(linear + 0 * pitch), r0);
+   _mm_storeu_si128((__m128i *)(linear + 1 * pitch), r1);
+   _mm_storeu_si128((__m128i *)(linear + 2 * pitch), r2);
+   _mm_storeu_si128((__m128i *)(linear + 3 * pitch), r3);
+}
+
+static ALWAYS_INLINE void
+micro_store_4_sse2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m128i r0 = _mm_loadu_si128((__m128i *)(linear + 0 * pitch));
+   __m128i r1 = _mm_loadu_si128((__m128i *)(linear + 1 * pitch));
+   __m128i r2 = _mm_loadu_si128((__m128i *)(linear + 2 * pitch));
+   __m128i r3 = _mm_loadu_si128((__m128i *)(linear + 3 * pitch));
+
+   if (u_il) {
+      r1 = swap_pairs_32(r1);
+      r3 = swap_pairs_32(r3);
+   }
+
+   __m128i v0 = _mm_unpacklo_epi64(r0, r1);
+   __m128i v1 = _mm_unpackhi_epi64(r0, r1);
+   __m128i v2 = u_il ? _mm_unpackhi_epi64(r2, r3) : _mm_unpacklo_epi64(r2, r3);
+   __m128i v3 = u_il ? _mm_unpacklo_epi64(r2, r3) : _mm_unpackhi_epi64(r2, r3);
+
+   _mm_storeu_si128((__m128i *)tiled + 0, v0);
+   _mm_storeu_si128((__m128i *)tiled + 1, v1);
+   _mm_storeu_si128((__m128i *)tiled + 2, v2);
+   _mm_storeu_si128((__m128i *)tiled + 3, v3);
+}
+
+/* For 8-byte elements, each vector holds a pair of elements, and each row
+ * is made of two such pairs.
+ */
+static ALWAYS_INLINE void
+micro_load_8_sse2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   static const uint8_t order[2][8] = {
+      { 0, 2, 1, 3, 4, 6, 5, 7 },
+      { 0, 2, 1, 3, 6, 4, 7, 5 },
+   };
+
+   for (unsigned y = 0; y < 4; ++y) {
+      __m128i a = _mm_loadu_si128((__m128i *)tiled + order[u_il][y * 2 + 0]);
+      __m128i b = _mm_loadu_si128((__m128i *)tiled + order[u_il][y * 2 + 1]);
+
+      if (u_il && (y & 1)) {
+         a = swap_pairs_64(a);
+         b = swap_pairs_64(b);
+      }
+
+      _mm_storeu_si128((__m128i *)(linear + y * pitch) + 0, a);
+      _mm_storeu_si128((__m128i *)(linear + y * pitch) + 1, b);
+   }
+}
+
+static ALWAYS_INLINE void
+micro_store_8_sse2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   static const uint8_t order[2][8] = {
+      { 0, 2, 1, 3, 4, 6, 5, 7 },
+      { 0, 2, 1, 3, 6, 4, 7, 5 },
+   };
+
+   for (unsigned y = 0; y < 4; ++y) {
+      __m128i a = _mm_loadu_si128((__m128i *)(linear + y * pitch) + 0);
+      __m128i b = _mm_loadu_si128((__m128i *)(linear + y * pitch) + 1);
+
+      if (u_il && (y & 1)) {
+         a = swap_pairs_64(a);
+         b = swap_pairs_64(b);
+      }
+
+      _mm_storeu_si128((__m128i *)tiled + order[u_il][y * 2 + 0], a);
+      _mm_storeu_si128((__m128i *)tiled + order[u_il][y * 2 + 1], b);
+   }
+}
+
+/* For 2-byte elements, the micro-block is two vectors, and each row is two
+ * 32-bit pairs of elements picked from one of them.
+ */
+static ALWAYS_INLINE __m128i
+swap_pairs_16(__m128i v)
+{
+   v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+   return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static ALWAYS_INLINE void
+micro_load_2_sse2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m128i v0 = _mm_loadu_si128((__m128i *)tiled + 0);
+   __m128i v1 = _mm_loadu_si128((__m128i *)tiled + 1);
+
+   /* [r0 | r1] and [r2 | r3] */
+   __m128i r01 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(3, 1, 2, 0));
+   __m128i r23 = u_il ? _mm_shuffle_epi32(v1, _MM_SHUFFLE(1, 3, 0, 2))
+                      : _mm_shuffle_epi32(v1, _MM_SHUFFLE(3, 1, 2, 0));
+
+   if (u_il) {
+      r01 = _mm_shufflehi_epi16(r01, _MM_SHUFFLE(2, 3, 0, 1));
+      r23 = _mm_shufflehi_epi16(r23, _MM_SHUFFLE(2, 3, 0, 1));
+   }
+
+   _mm_storel_epi64((__m128i *)(linear + 0 * pitch), r01);
+   _mm_storel_epi64((__m128i *)(linear + 1 * pitch), swap_pairs_64(r01));
+   _mm_storel_epi64((__m128i *)(linear + 2 * pitch), r23);
+   _mm_storel_epi64((__m128i *)(linear + 3 * pitch), swap_pairs_64(r23));
+}
+
+static ALWAYS_INLINE void
+micro_store_2_sse2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m128i r01 = _mm_unpacklo_epi64(
+      _mm_loadl_epi64((__m128i *)(linear + 0 * pitch)),
+      _mm_loadl_epi64((__m128i *)(linear + 1 * pitch)));
+   __m128i r23 = _mm_unpacklo_epi64(
+      _mm_loadl_epi64((__m128i *)(linear + 2 * pitch)),
+      _mm_loadl_epi64((__m128i *)(linear + 3 * pitch)));
+
+   if (u_il) {
+      r01 = _mm_shufflehi_epi16(r01, _MM_SHUFFLE(2, 3, 0, 1));
+      r23 = _mm_shufflehi_epi16(r23, _MM_SHUFFLE(2, 3, 0, 1));
+   }
+
+   __m128i v0 = _mm_shuffle_epi32(r01, _MM_SHUFFLE(3, 1, 2, 0));
+   __m128i v1 = u_il ? _mm_shuffle_epi32(r23, _MM_SHUFFLE(2, 0, 3, 1))
+                     : _mm_shuffle_epi32(r23, _MM_SHUFFLE(3, 1, 2, 0));
+
+   _mm_storeu_si128((__m128i *)tiled + 0, v0);
+   _mm_storeu_si128((__m128i *)tiled + 1, v1);
+}
+
+#define MICRO_COPY_SSE2(bs)                                                    \
+   static void micro_load_morton_##bs##_sse2(uint8_t *l, uint32_t p,           \
+                                             uint8_t *t)                       \
+   {                                                                           \
+      micro_load_##bs##_sse2(l, p, t, false);                                  \
+   }                                                                           \
+   static void micro_store_morton_##bs##_sse2(uint8_t *l, uint32_t p,          \
+                                              uint8_t *t)                      \
+   {                                                                           \
+      micro_store_##bs##_sse2(l, p, t, false);                                 \
+   }                                                                           \
+   static void micro_load_u_interleaved_##bs##_sse2(uint8_t *l, uint32_t p,    \
+                                                    uint8_t *t)                \
+   {                                                                           \
+      micro_load_##bs##_sse2(l, p, t, true);                                   \
+   }                                                                           \
+   static void micro_store_u_interleaved_##bs##_sse2(uint8_t *l, uint32_t p,   \
+                                                     uint8_t *t)               \
+   {                                                                           \
+      micro_store_##bs##_sse2(l, p, t, true);                                  \
+   }
+
+MICRO_COPY_SSE2(2)
+MICRO_COPY_SSE2(4)
+MICRO_COPY_SSE2(8)
+
+COPY_ALIGNED(2_sse2, 2)
+COPY_ALIGNED(4_sse2, 4)
+COPY_ALIGNED(8_sse2, 8)
+
+#else
+
+COPY_ALIGNED(2, 2)
+COPY_ALIGNED(4, 4)
+COPY_ALIGNED(8, 8)
+
+#endif /* __SSE2__ */
+
+COPY_ALIGNED(1, 1)
+COPY_ALIGNED(16, 16)
+
+static util_tiling_aligned_func
+get_aligned_func(unsigned blocksize_B)
+{
+   util_tiling_aligned_func func = NULL;
+
+#if DETECT_ARCH_X86 || DETECT_ARCH_X86_64
+   if (util_get_cpu_caps()->has_avx2)
+      func = util_tiling_get_aligned_func_avx2(blocksize_B);
+#endif
+
+#if DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM
+   func = util_tiling_get_aligned_func_neon(blocksize_B);
+#endif
+
+   if (func)
+      return func;
+
+   switch (blocksize_B) {
+   case 1:
+      return copy_aligned_1;
+#if defined(__SSE2__)
+   case 2:
+      return copy_aligned_2_sse2;
+   case 4:
+      return copy_aligned_4_sse2;
+   case 8:
+      return copy_aligned_8_sse2;
+#else
+   case 2:
+      return copy_aligned_2;
+   case 4:
+      return copy_aligned_4;
+   case 8:
+      return copy_aligned_8;
+#endif
+   case 16:
+      return copy_aligned_16;
+   default:
+      unreachable("Invalid block size");
+   }
+}
+
+uint64_t
+util_tiling_offset_B(const struct util_tiling_layout *layout,
+                     unsigned x_el, unsigned y_el)
+{
+   unsigned tile_x = x_el / layout->tile_width_el;
+   unsigned tile_y = y_el / layout->tile_height_el;
+   unsigned x_in_tile = x_el & (layout->tile_width_el - 1);
+   unsigned y_in_tile = y_el & (layout->tile_height_el - 1);
+   unsigned tile_size_B =
+      layout->tile_width_el * layout->tile_height_el * layout->blocksize_B;
+
+   return (uint64_t)tile_y * layout->tile_row_stride_B +
+          (uint64_t)tile_x * tile_size_B +
+          util_tiling_index(layout->mode, x_in_tile, y_in_tile) *
+             layout->blocksize_B;
+}
+
+/* Element by element copy, for the edges of the region */
+static void
+copy_unaligned(const struct util_tiling_layout *layout,
+               uint8_t *linear, uint32_t linear_pitch_B, uint8_t *tiled,
+               unsigned x_el, unsigned y_el, unsigned w_el, unsigned h_el,
+               bool is_store)
+{
+   const unsigned bs = layout->blocksize_B;
+
+   for (unsigned y = 0; y < h_el; ++y) {
+      for (unsigned x = 0; x < w_el; ++x) {
+         uint8_t *l = linear + y * linear_pitch_B + x * bs;
+         uint8_t *t = tiled + util_tiling_offset_B(layout, x_el + x, y_el + y);
+
+         if (is_store)
+            memcpy(t, l, bs);
+         else
+            memcpy(l, t, bs);
+      }
+   }
+}
+
+static void
+util_tiling_copy(const struct util_tiling_layout *layout,
+                 uint8_t *linear, uint32_t linear_pitch_B, uint8_t *tiled,
+                 unsigned x_el, unsigned y_el, unsigned w_el, unsigned h_el,
+                 bool is_store)
+{
+   const unsigned bs = layout->blocksize_B;
+
+   assert(util_is_power_of_two_nonzero(bs) && bs <= 16);
+   assert(util_is_power_of_two_nonzero(layout->tile_width_el));
+   assert(util_is_power_of_two_nonzero(layout->tile_height_el));
+   assert(layout->tile_width_el == layout->tile_height_el ||
+          layout->tile_width_el == 2 * layout->tile_height_el);
+
+   unsigned x0 = ALIGN_POT(x_el, 4), x1 = ROUND_DOWN_TO(x_el + w_el, 4);
+   unsigned y0 = ALIGN_POT(y_el, 4), y1 = ROUND_DOWN_TO(y_el + h_el, 4);
+
+   /* Tiles smaller than the micro-blocks (the tail of some mip trees), or
+    * regions too small to contain a micro-block.
+    */
+   if (layout->tile_height_el < 4 || x0 >= x1 || y0 >= y1) {
+      copy_unaligned(layout, linear, linear_pitch_B, tiled,
+                     x_el, y_el, w_el, h_el, is_store);
+      return;
+   }
+
+#define LINEAR(x, y) (linear + ((y) - y_el) * linear_pitch_B + ((x) - x_el) * bs)
+
+   /* Top and bottom rows */
+   copy_unaligned(layout, LINEAR(x_el, y_el), linear_pitch_B, tiled,
+                  x_el, y_el, w_el, y0 - y_el, is_store);
+   copy_unaligned(layout, LINEAR(x_el, y1), linear_pitch_B, tiled,
+                  x_el, y1, w_el, y_el + h_el - y1, is_store);
+
+   /* Left and right columns */
+   copy_unaligned(layout, LINEAR(x_el, y0), linear_pitch_B, tiled,
+                  x_el, y0, x0 - x_el, y1 - y0, is_store);
+   copy_unaligned(layout, LINEAR(x1, y0), linear_pitch_B, tiled,
+                  x1, y0, x_el + w_el - x1, y1 - y0, is_store);
+
+   get_aligned_func(bs)(layout, LINEAR(x0, y0), linear_pitch_B, tiled,
+                        x0, y0, x1 - x0, y1 - y0, is_store);
+
+#undef LINEAR
+}
+
+void
+util_tiling_load(const struct util_tiling_layout *layout,
+                 void *linear, uint32_t linear_pitch_B,
+                 const void *tiled,
+                 unsigned x_el, unsigned y_el,
+                 unsigned w_el, unsigned h_el)
+{
+   util_tiling_copy(layout, linear, linear_pitch_B, (uint8_t *)tiled,
+                    x_el, y_el, w_el, h_el, false);
+}
+
+void
+util_tiling_store(const struct util_tiling_layout *layout,
+                  void *tiled,
+                  const void *linear, uint32_t linear_pitch_B,
+                  unsigned x_el, unsigned y_el,
+                  unsigned w_el, unsigned h_el)
+{
+   util_tiling_copy(layout, (uint8_t *)linear, linear_pitch_B, tiled,
+                    x_el, y_el, w_el, h_el, true);
+}
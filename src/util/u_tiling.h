@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * CPU tiling and detiling of images laid out as rows of tiles, where the
+ * elements within each tile are ordered along a Z-order (Morton) curve.
+ *
+ * Aligned 4x4 groups of elements are always contiguous in such layouts,
+ * so the bulk of the work is done by copying whole 4x4 micro-blocks with
+ * SIMD kernels selected at runtime, only the edges of the region are
+ * copied element by element.
+ *
+ * Only Z-ordered layouts are handled.  Block-linear layouts (tiles made of
+ * linear rows of 16-byte sectors, as in isl or nouveau) are not supported
+ * and still go through each driver's own tiling code.
+ */
+
+#ifndef _UTIL_TILING_H
+#define _UTIL_TILING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum util_tiling_mode {
+   /**
+    * Plain Z-order, with the X bits in the even positions of the index
+    * within the tile: ... y1 x1 y0 x0.
+    */
+   UTIL_TILING_MORTON,
+
+   /**
+    * Z-order of (X ^ Y, Y), aka. "u-interleaved" on Mali:
+    * ... y1 (x1 ^ y1) y0 (x0 ^ y0).
+    */
+   UTIL_TILING_U_INTERLEAVED,
+};
+
+struct util_tiling_layout {
+   enum util_tiling_mode mode;
+
+   /** Size of an element in bytes: 1, 2, 4, 8 or 16. */
+   unsigned blocksize_B;
+
+   /**
+    * Dimensions of a tile in elements.  Both must be powers of two, with
+    * the width either equal to the height or twice the height.
+    */
+   unsigned tile_width_el;
+   unsigned tile_height_el;
+
+   /** Number of bytes between adjacent rows of tiles. */
+   uint32_t tile_row_stride_B;
+};
+
+/**
+ * Load a region of a tiled image to a linear image.
+ *
+ * @linear Linear destination, pointing at the first element of the region
+ * @linear_pitch_B Stride in bytes of the linear destination
+ * @tiled Tiled source, pointing at the first tile of the image
+ * @x_el, @y_el, @w_el, @h_el Region of interest of the tiled image, in
+ * elements
+ */
+void util_tiling_load(const struct util_tiling_layout *layout,
+                      void *linear, uint32_t linear_pitch_B,
+                      const void *tiled,
+                      unsigned x_el, unsigned y_el,
+                      unsigned w_el, unsigned h_el);
+
+/**
+ * Store a linear image to a region of a tiled image, the counterpart of
+ * util_tiling_load().
+ */
+void util_tiling_store(const struct util_tiling_layout *layout,
+                       void *tiled,
+                       const void *linear, uint32_t linear_pitch_B,
+                       unsigned x_el, unsigned y_el,
+                       unsigned w_el, unsigned h_el);
+
+/**
+ * Byte offset of element (x_el, y_el) in a tiled image.
+ */
+uint64_t util_tiling_offset_B(const struct util_tiling_layout *layout,
+                              unsigned x_el, unsigned y_el);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_TILING_H */
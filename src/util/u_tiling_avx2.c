@@ -0,0 +1,259 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* AVX2 micro-block kernels for u_tiling, built with -mavx2 and only called
+ * when the CPU supports it.
+ */
+
+#include "util/u_tiling_priv.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+static ALWAYS_INLINE __m256i
+load_rows(uint8_t *linear, uint32_t pitch)
+{
+   __m128i lo = _mm_loadu_si128((__m128i *)linear);
+   __m128i hi = _mm_loadu_si128((__m128i *)(linear + pitch));
+   return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+static ALWAYS_INLINE void
+store_rows(uint8_t *linear, uint32_t pitch, __m256i v)
+{
+   _mm_storeu_si128((__m128i *)linear, _mm256_castsi256_si128(v));
+   _mm_storeu_si128((__m128i *)(linear + pitch), _mm256_extracti128_si256(v, 1));
+}
+
+/* Swap the 32-bit elements of each 64-bit pair, in the upper lane only */
+static ALWAYS_INLINE __m256i
+swap_pairs_32_hi(__m256i v)
+{
+   return _mm256_blend_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)),
+                             0xf0);
+}
+
+/*
+ * For 4-byte elements, each 256-bit load is half of the micro-block, and a
+ * cross-lane permute of its 64-bit pairs gives two rows: [r0 | r1] from the
+ * first half, [r2 | r3] from the second.
+ */
+static ALWAYS_INLINE void
+micro_load_4_avx2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m256i v0 = _mm256_loadu_si256((__m256i *)tiled + 0);
+   __m256i v1 = _mm256_loadu_si256((__m256i *)tiled + 1);
+
+   __m256i r01 = _mm256_permute4x64_epi64(v0, _MM_SHUFFLE(3, 1, 2, 0));
+   __m256i r23 = u_il ? _mm256_permute4x64_epi64(v1, _MM_SHUFFLE(1, 3, 0, 2))
+                      : _mm256_permute4x64_epi64(v1, _MM_SHUFFLE(3, 1, 2, 0));
+
+   if (u_il) {
+      r01 = swap_pairs_32_hi(r01);
+      r23 = swap_pairs_32_hi(r23);
+   }
+
+   store_rows(linear, pitch, r01);
+   store_rows(linear + 2 * pitch, pitch, r23);
+}
+
+static ALWAYS_INLINE void
+micro_store_4_avx2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m256i r01 = load_rows(linear, pitch);
+   __m256i r23 = load_rows(linear + 2 * pitch, pitch);
+
+   if (u_il) {
+      r01 = swap_pairs_32_hi(r01);
+      r23 = swap_pairs_32_hi(r23);
+   }
+
+   __m256i v0 = _mm256_permute4x64_epi64(r01, _MM_SHUFFLE(3, 1, 2, 0));
+   __m256i v1 = u_il ? _mm256_permute4x64_epi64(r23, _MM_SHUFFLE(2, 0, 3, 1))
+                     : _mm256_permute4x64_epi64(r23, _MM_SHUFFLE(3, 1, 2, 0));
+
+   _mm256_storeu_si256((__m256i *)tiled + 0, v0);
+   _mm256_storeu_si256((__m256i *)tiled + 1, v1);
+}
+
+/*
+ * For 8-byte elements, each 256-bit load holds a 2x2 quad, and each row is
+ * the top or bottom halves of two horizontally adjacent quads.
+ */
+static ALWAYS_INLINE void
+micro_load_8_avx2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m256i q0 = _mm256_loadu_si256((__m256i *)tiled + 0);
+   __m256i q1 = _mm256_loadu_si256((__m256i *)tiled + 1);
+   __m256i q2 = _mm256_loadu_si256((__m256i *)tiled + 2);
+   __m256i q3 = _mm256_loadu_si256((__m256i *)tiled + 3);
+
+   __m256i r0 = _mm256_permute2x128_si256(q0, q1, 0x20);
+   __m256i r1 = _mm256_permute2x128_si256(q0, q1, 0x31);
+   __m256i r2 = _mm256_permute2x128_si256(q2, q3, u_il ? 0x02 : 0x20);
+   __m256i r3 = _mm256_permute2x128_si256(q2, q3, u_il ? 0x13 : 0x31);
+
+   if (u_il) {
+      r1 = _mm256_permute4x64_epi64(r1, _MM_SHUFFLE(2, 3, 0, 1));
+      r3 = _mm256_permute4x64_epi64(r3, _MM_SHUFFLE(2, 3, 0, 1));
+   }
+
+   _mm256_storeu_si256((__m256i *)(linear + 0 * pitch), r0);
+   _mm256_storeu_si256((__m256i *)(linear + 1 * pitch), r1);
+   _mm256_storeu_si256((__m256i *)(linear + 2 * pitch), r2);
+   _mm256_storeu_si256((__m256i *)(linear + 3 * pitch), r3);
+}
+
+static ALWAYS_INLINE void
+micro_store_8_avx2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   __m256i r0 = _mm256_loadu_si256((__m256i *)(linear + 0 * pitch));
+   __m256i r1 = _mm256_loadu_si256((__m256i *)(linear + 1 * pitch));
+   __m256i r2 = _mm256_loadu_si256((__m256i *)(linear + 2 * pitch));
+   __m256i r3 = _mm256_loadu_si256((__m256i *)(linear + 3 * pitch));
+
+   if (u_il) {
+      r1 = _mm256_permute4x64_epi64(r1, _MM_SHUFFLE(2, 3, 0, 1));
+      r3 = _mm256_permute4x64_epi64(r3, _MM_SHUFFLE(2, 3, 0, 1));
+   }
+
+   __m256i q0 = _mm256_permute2x128_si256(r0, r1, 0x20);
+   __m256i q1 = _mm256_permute2x128_si256(r0, r1, 0x31);
+   __m256i q2 = _mm256_permute2x128_si256(r2, r3, u_il ? 0x31 : 0x20);
+   __m256i q3 = _mm256_permute2x128_si256(r2, r3, u_il ? 0x20 : 0x31);
+
+   _mm256_storeu_si256((__m256i *)tiled + 0, q0);
+   _mm256_storeu_si256((__m256i *)tiled + 1, q1);
+   _mm256_storeu_si256((__m256i *)tiled + 2, q2);
+   _mm256_storeu_si256((__m256i *)tiled + 3, q3);
+}
+
+/*
+ * For 16-byte elements, each 256-bit load is a horizontal pair of elements,
+ * so only whole pairs are moved around (and swapped in the odd rows of the
+ * u-interleaved order).
+ */
+static const uint8_t pair_order[2][8] = {
+   { 0, 2, 1, 3, 4, 6, 5, 7 },
+   { 0, 2, 1, 3, 6, 4, 7, 5 },
+};
+
+static ALWAYS_INLINE void
+micro_load_16_avx2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   for (unsigned y = 0; y < 4; ++y) {
+      __m256i a = _mm256_loadu_si256((__m256i *)tiled + pair_order[u_il][y * 2 + 0]);
+      __m256i b = _mm256_loadu_si256((__m256i *)tiled + pair_order[u_il][y * 2 + 1]);
+
+      if (u_il && (y & 1)) {
+         a = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(1, 0, 3, 2));
+         b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(1, 0, 3, 2));
+      }
+
+      _mm256_storeu_si256((__m256i *)(linear + y * pitch) + 0, a);
+      _mm256_storeu_si256((__m256i *)(linear + y * pitch) + 1, b);
+   }
+}
+
+static ALWAYS_INLINE void
+micro_store_16_avx2(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   for (unsigned y = 0; y < 4; ++y) {
+      __m256i a = _mm256_loadu_si256((__m256i *)(linear + y * pitch) + 0);
+      __m256i b = _mm256_loadu_si256((__m256i *)(linear + y * pitch) + 1);
+
+      if (u_il && (y & 1)) {
+         a = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(1, 0, 3, 2));
+         b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(1, 0, 3, 2));
+      }
+
+      _mm256_storeu_si256((__m256i *)tiled + pair_order[u_il][y * 2 + 0], a);
+      _mm256_storeu_si256((__m256i *)tiled + pair_order[u_il][y * 2 + 1], b);
+   }
+}
+
+#define COPY_ALIGNED_AVX2(bs)                                                  \
+   static void micro_load_morton_##bs(uint8_t *l, uint32_t p, uint8_t *t)      \
+   {                                                                           \
+      micro_load_##bs##_avx2(l, p, t, false);                                  \
+   }                                                                           \
+   static void micro_store_morton_##bs(uint8_t *l, uint32_t p, uint8_t *t)     \
+   {                                                                           \
+      micro_store_##bs##_avx2(l, p, t, false);                                 \
+   }                                                                           \
+   static void micro_load_u_interleaved_##bs(uint8_t *l, uint32_t p,           \
+                                             uint8_t *t)                       \
+   {                                                                           \
+      micro_load_##bs##_avx2(l, p, t, true);                                   \
+   }                                                                           \
+   static void micro_store_u_interleaved_##bs(uint8_t *l, uint32_t p,          \
+                                              uint8_t *t)                      \
+   {                                                                           \
+      micro_store_##bs##_avx2(l, p, t, true);                                  \
+   }                                                                           \
+   static void copy_aligned_##bs(                                              \
+      const struct util_tiling_layout *layout, uint8_t *linear,                \
+      uint32_t linear_pitch_B, uint8_t *tiled, unsigned x_el, unsigned y_el,   \
+      unsigned w_el, unsigned h_el, bool is_store)                             \
+   {                                                                           \
+      util_tiling_micro_func kernel;                                           \
+      if (layout->mode == UTIL_TILING_MORTON)                                  \
+         kernel = is_store ? micro_store_morton_##bs : micro_load_morton_##bs; \
+      else                                                                     \
+         kernel = is_store ? micro_store_u_interleaved_##bs                    \
+                           : micro_load_u_interleaved_##bs;                    \
+                                                                               \
+      util_tiling_copy_aligned(layout, linear, linear_pitch_B, tiled, x_el,    \
+                               y_el, w_el, h_el, bs, kernel);                  \
+   }
+
+COPY_ALIGNED_AVX2(4)
+COPY_ALIGNED_AVX2(8)
+COPY_ALIGNED_AVX2(16)
+
+util_tiling_aligned_func
+util_tiling_get_aligned_func_avx2(unsigned blocksize_B)
+{
+   switch (blocksize_B) {
+   case 4:
+      return copy_aligned_4;
+   case 8:
+      return copy_aligned_8;
+   case 16:
+      return copy_aligned_16;
+   default:
+      /* The SSE2 kernels are just as good for the smaller elements */
+      return NULL;
+   }
+}
+
+#else
+
+util_tiling_aligned_func
+util_tiling_get_aligned_func_avx2(unsigned blocksize_B)
+{
+   return NULL;
+}
+
+#endif /* __AVX2__ */
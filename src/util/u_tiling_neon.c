@@ -0,0 +1,205 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "util/u_tiling_priv.h"
+
+#if DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM
+
+#if !defined(__SOFTFP__)
+
+/* armhf builds default to vfp, not neon, and refuses to compile neon intrinsics
+ * unless you tell it "no really".
+ */
+#if DETECT_ARCH_ARM
+#pragma GCC target ("fpu=neon")
+#endif
+
+#include <arm_neon.h>
+#include "util/u_cpu_detect.h"
+
+/*
+ * Same decomposition as the SSE2 kernels: for 4-byte elements, each row of
+ * the micro-block is made of the halves of two of the four vectors.
+ */
+static ALWAYS_INLINE void
+micro_load_4_neon(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   uint32x4_t v0 = vld1q_u32((uint32_t *)tiled + 0);
+   uint32x4_t v1 = vld1q_u32((uint32_t *)tiled + 4);
+   uint32x4_t v2 = vld1q_u32((uint32_t *)tiled + 8);
+   uint32x4_t v3 = vld1q_u32((uint32_t *)tiled + 12);
+
+   if (u_il) {
+      uint32x4_t t = v2;
+      v2 = v3;
+      v3 = t;
+   }
+
+   uint32x4_t r0 = vcombine_u32(vget_low_u32(v0), vget_low_u32(v1));
+   uint32x4_t r1 = vcombine_u32(vget_high_u32(v0), vget_high_u32(v1));
+   uint32x4_t r2 = vcombine_u32(vget_low_u32(v2), vget_low_u32(v3));
+   uint32x4_t r3 = vcombine_u32(vget_high_u32(v2), vget_high_u32(v3));
+
+   if (u_il) {
+      r1 = vrev64q_u32(r1);
+      r3 = vrev64q_u32(r3);
+   }
+
+   vst1q_u32((uint32_t *)(linear + 0 * pitch), r0);
+   vst1q_u32((uint32_t *)(linear + 1 * pitch), r1);
+   vst1q_u32((uint32_t *)(linear + 2 * pitch), r2);
+   vst1q_u32((uint32_t *)(linear + 3 * pitch), r3);
+}
+
+static ALWAYS_INLINE void
+micro_store_4_neon(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   uint32x4_t r0 = vld1q_u32((uint32_t *)(linear + 0 * pitch));
+   uint32x4_t r1 = vld1q_u32((uint32_t *)(linear + 1 * pitch));
+   uint32x4_t r2 = vld1q_u32((uint32_t *)(linear + 2 * pitch));
+   uint32x4_t r3 = vld1q_u32((uint32_t *)(linear + 3 * pitch));
+
+   if (u_il) {
+      r1 = vrev64q_u32(r1);
+      r3 = vrev64q_u32(r3);
+   }
+
+   uint32x4_t v0 = vcombine_u32(vget_low_u32(r0), vget_low_u32(r1));
+   uint32x4_t v1 = vcombine_u32(vget_high_u32(r0), vget_high_u32(r1));
+   uint32x4_t v2 = vcombine_u32(vget_low_u32(r2), vget_low_u32(r3));
+   uint32x4_t v3 = vcombine_u32(vget_high_u32(r2), vget_high_u32(r3));
+
+   vst1q_u32((uint32_t *)tiled + 0, v0);
+   vst1q_u32((uint32_t *)tiled + 4, v1);
+   vst1q_u32((uint32_t *)tiled + (u_il ? 12 : 8), v2);
+   vst1q_u32((uint32_t *)tiled + (u_il ? 8 : 12), v3);
+}
+
+/* For 8-byte elements, each vector holds a pair of elements */
+static const uint8_t pair_order[2][8] = {
+   { 0, 2, 1, 3, 4, 6, 5, 7 },
+   { 0, 2, 1, 3, 6, 4, 7, 5 },
+};
+
+static ALWAYS_INLINE void
+micro_load_8_neon(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   for (unsigned y = 0; y < 4; ++y) {
+      uint64x2_t a = vld1q_u64((uint64_t *)tiled + 2 * pair_order[u_il][y * 2 + 0]);
+      uint64x2_t b = vld1q_u64((uint64_t *)tiled + 2 * pair_order[u_il][y * 2 + 1]);
+
+      if (u_il && (y & 1)) {
+         a = vextq_u64(a, a, 1);
+         b = vextq_u64(b, b, 1);
+      }
+
+      vst1q_u64((uint64_t *)(linear + y * pitch) + 0, a);
+      vst1q_u64((uint64_t *)(linear + y * pitch) + 2, b);
+   }
+}
+
+static ALWAYS_INLINE void
+micro_store_8_neon(uint8_t *linear, uint32_t pitch, uint8_t *tiled, bool u_il)
+{
+   for (unsigned y = 0; y < 4; ++y) {
+      uint64x2_t a = vld1q_u64((uint64_t *)(linear + y * pitch) + 0);
+      uint64x2_t b = vld1q_u64((uint64_t *)(linear + y * pitch) + 2);
+
+      if (u_il && (y & 1)) {
+         a = vextq_u64(a, a, 1);
+         b = vextq_u64(b, b, 1);
+      }
+
+      vst1q_u64((uint64_t *)tiled + 2 * pair_order[u_il][y * 2 + 0], a);
+      vst1q_u64((uint64_t *)tiled + 2 * pair_order[u_il][y * 2 + 1], b);
+   }
+}
+
+#define COPY_ALIGNED_NEON(bs)                                                  \
+   static void micro_load_morton_##bs(uint8_t *l, uint32_t p, uint8_t *t)      \
+   {                                                                           \
+      micro_load_##bs##_neon(l, p, t, false);                                  \
+   }                                                                           \
+   static void micro_store_morton_##bs(uint8_t *l, uint32_t p, uint8_t *t)     \
+   {                                                                           \
+      micro_store_##bs##_neon(l, p, t, false);                                 \
+   }                                                                           \
+   static void micro_load_u_interleaved_##bs(uint8_t *l, uint32_t p,           \
+                                             uint8_t *t)                       \
+   {                                                                           \
+      micro_load_##bs##_neon(l, p, t, true);                                   \
+   }                                                                           \
+   static void micro_store_u_interleaved_##bs(uint8_t *l, uint32_t p,          \
+                                              uint8_t *t)                      \
+   {                                                                           \
+      micro_store_##bs##_neon(l, p, t, true);                                  \
+   }                                                                           \
+   static void copy_aligned_##bs(                                              \
+      const struct util_tiling_layout *layout, uint8_t *linear,                \
+      uint32_t linear_pitch_B, uint8_t *tiled, unsigned x_el, unsigned y_el,   \
+      unsigned w_el, unsigned h_el, bool is_store)                             \
+   {                                                                           \
+      util_tiling_micro_func kernel;                                           \
+      if (layout->mode == UTIL_TILING_MORTON)                                  \
+         kernel = is_store ? micro_store_morton_##bs : micro_load_morton_##bs; \
+      else                                                                     \
+         kernel = is_store ? micro_store_u_interleaved_##bs                    \
+                           : micro_load_u_interleaved_##bs;                    \
+                                                                               \
+      util_tiling_copy_aligned(layout, linear, linear_pitch_B, tiled, x_el,    \
+                               y_el, w_el, h_el, bs, kernel);                  \
+   }
+
+COPY_ALIGNED_NEON(4)
+COPY_ALIGNED_NEON(8)
+
+util_tiling_aligned_func
+util_tiling_get_aligned_func_neon(unsigned blocksize_B)
+{
+   /* CPU detect for NEON support.  On arm64, it's implied. */
+#if DETECT_ARCH_ARM
+   if (!util_get_cpu_caps()->has_neon)
+      return NULL;
+#endif
+
+   switch (blocksize_B) {
+   case 4:
+      return copy_aligned_4;
+   case 8:
+      return copy_aligned_8;
+   default:
+      return NULL;
+   }
+}
+
+#else
+
+util_tiling_aligned_func
+util_tiling_get_aligned_func_neon(unsigned blocksize_B)
+{
+   return NULL;
+}
+
+#endif /* !__SOFTFP__ */
+
+#endif /* DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM */
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Helpers shared by the per-ISA implementations of u_tiling. */
+
+#ifndef _UTIL_TILING_PRIV_H
+#define _UTIL_TILING_PRIV_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/detect_arch.h"
+#include "util/macros.h"
+#include "util/u_math.h"
+#include "util/u_tiling.h"
+
+/**
+ * Copies the 4x4 micro-block at 'tiled' from/to the linear image at
+ * 'linear'.  The direction is up to the kernel.
+ */
+typedef void (*util_tiling_micro_func)(uint8_t *linear, uint32_t linear_pitch_B,
+                                       uint8_t *tiled);
+
+/**
+ * Copies a region whose position and size are multiples of 4 elements, in a
+ * layout whose tiles are at least 4x4 elements.
+ */
+typedef void (*util_tiling_aligned_func)(const struct util_tiling_layout *layout,
+                                         uint8_t *linear, uint32_t linear_pitch_B,
+                                         uint8_t *tiled,
+                                         unsigned x_el, unsigned y_el,
+                                         unsigned w_el, unsigned h_el,
+                                         bool is_store);
+
+/* Index of each element of a 4x4 micro-block, in linear order. */
+static const uint8_t util_tiling_micro_index[2][16] = {
+   [UTIL_TILING_MORTON] = {
+       0,  1,  4,  5,
+       2,  3,  6,  7,
+       8,  9, 12, 13,
+      10, 11, 14, 15,
+   },
+   [UTIL_TILING_U_INTERLEAVED] = {
+       0,  1,  4,  5,
+       3,  2,  7,  6,
+      12, 13,  8,  9,
+      15, 14, 11, 10,
+   },
+};
+
+/* Space out the bits of x, so they can be interleaved with another value */
+static inline uint32_t
+util_tiling_space_bits(uint32_t x)
+{
+   x &= 0xffff;
+   x = (x | (x << 8)) & 0x00ff00ff;
+   x = (x | (x << 4)) & 0x0f0f0f0f;
+   x = (x | (x << 2)) & 0x33333333;
+   x = (x | (x << 1)) & 0x55555555;
+   return x;
+}
+
+/* Index of element (x_el, y_el) within its tile */
+static inline uint32_t
+util_tiling_index(enum util_tiling_mode mode, unsigned x_el, unsigned y_el)
+{
+   if (mode == UTIL_TILING_U_INTERLEAVED)
+      x_el ^= y_el;
+
+   return util_tiling_space_bits(x_el) | (util_tiling_space_bits(y_el) << 1);
+}
+
+static ALWAYS_INLINE void
+util_tiling_copy_aligned(const struct util_tiling_layout *layout,
+                         uint8_t *linear, uint32_t linear_pitch_B,
+                         uint8_t *tiled,
+                         unsigned x_el, unsigned y_el,
+                         unsigned w_el, unsigned h_el,
+                         unsigned blocksize_B,
+                         util_tiling_micro_func kernel)
+{
+   const unsigned log2_tile_w = util_logbase2(layout->tile_width_el);
+   const unsigned log2_tile_h = util_logbase2(layout->tile_height_el);
+   const unsigned tile_size_B =
+      layout->tile_width_el * layout->tile_height_el * blocksize_B;
+
+   assert(x_el % 4 == 0 && y_el % 4 == 0);
+   assert(w_el % 4 == 0 && h_el % 4 == 0);
+
+   for (unsigned y = y_el; y < y_el + h_el; y += 4) {
+      uint8_t *tiled_row =
+         tiled + (size_t)(y >> log2_tile_h) * layout->tile_row_stride_B;
+      uint8_t *linear_row = linear;
+      unsigned y_in_tile = y & (layout->tile_height_el - 1);
+
+      for (unsigned x = x_el; x < x_el + w_el; x += 4) {
+         unsigned x_in_tile = x & (layout->tile_width_el - 1);
+         uint32_t index = util_tiling_index(layout->mode, x_in_tile, y_in_tile);
+
+         kernel(linear_row, linear_pitch_B,
+                tiled_row + (x >> log2_tile_w) * tile_size_B + index * blocksize_B);
+
+         linear_row += 4 * blocksize_B;
+      }
+
+      linear += 4 * linear_pitch_B;
+   }
+}
+
+#if DETECT_ARCH_AARCH64 || DETECT_ARCH_ARM
+util_tiling_aligned_func util_tiling_get_aligned_func_neon(unsigned blocksize_B);
+#endif
+
+#if DETECT_ARCH_X86 || DETECT_ARCH_X86_64
+util_tiling_aligned_func util_tiling_get_aligned_func_avx2(unsigned blocksize_B);
+#endif
+
+#endif /* _UTIL_TILING_PRIV_H */
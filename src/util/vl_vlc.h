@@ -32,6 +32,8 @@
 #ifndef vl_vlc_h
 #define vl_vlc_h
 
+#include <string.h>
+
 #include "util/u_math.h"
 
 struct vl_vlc
@@ -145,7 +147,11 @@ vl_vlc_fillbits(struct vl_vlc *vlc)
       } else if (bytes_left >= 4) {
 
          /* enough bytes in buffer, read in a whole dword */
-         uint64_t value = *(const uint32_t*)vlc->data;
+         uint32_t dword;
+         uint64_t value;
+
+         memcpy(&dword, vlc->data, sizeof(dword));
+         value = dword;
 
 #if !UTIL_ARCH_BIG_ENDIAN
          value = util_bswap32(value);
@@ -168,6 +174,40 @@ vl_vlc_fillbits(struct vl_vlc *vlc)
    }
 }
 
+/**
+ * fill the bit buffer like vl_vlc_fillbits, but with a single 64-bit read
+ * whenever the current input allows it, leaving at least 57 bits valid
+ *
+ * Only for callers that don't assume vl_vlc_valid_bits() to be at most 32
+ * afterwards.
+ */
+static inline void
+vl_vlc_refill(struct vl_vlc *vlc)
+{
+   assert(vlc);
+
+   if (vlc->invalid_bits <= 0)
+      return;
+
+   if (vlc->end - vlc->data >= 8) {
+      /* whole bytes that fit after the valid bits */
+      unsigned bytes = (32 + vlc->invalid_bits) / 8;
+      uint64_t value;
+
+      memcpy(&value, vlc->data, sizeof(value));
+
+#if !UTIL_ARCH_BIG_ENDIAN
+      value = util_bswap64(value);
+#endif
+
+      value &= ~0ull << (64 - 8 * bytes);
+      vlc->buffer |= value >> (32 - vlc->invalid_bits);
+      vlc->data += bytes;
+      vlc->invalid_bits -= 8 * bytes;
+   } else
+      vl_vlc_fillbits(vlc);
+}
+
 /**
  * initialize vlc structure and start reading from first input buffer
  */
@@ -291,7 +331,17 @@ vl_vlc_search_byte(struct vl_vlc *vlc, unsigned num_bits, uint8_t value)
 {
    /* make sure we are on a byte boundary */
    assert((vl_vlc_valid_bits(vlc) % 8) == 0);
-   assert(num_bits == ~0u || (num_bits % 8) == 0);
+
+   /* only whole bytes are searched, the limit callers pass is often derived
+    * from vl_vlc_bits_left() and doesn't need to be a multiple of 8
+    */
+   if (num_bits != ~0u) {
+      num_bits &= ~7u;
+      if (num_bits == 0) {
+         vl_vlc_align_data_ptr(vlc);
+         return false;
+      }
+   }
 
    /* deplete the bit buffer */
    while (vl_vlc_valid_bits(vlc) > 0) {
@@ -323,15 +373,22 @@ vl_vlc_search_byte(struct vl_vlc *vlc, unsigned num_bits, uint8_t value)
             return false;
       }
 
-      if (*vlc->data == value) {
+      /* let memchr scan the rest of this input, up to the limit */
+      unsigned len = vlc->end - vlc->data;
+      if (num_bits != ~0u)
+         len = MIN2(len, num_bits / 8);
+
+      const uint8_t *found = (const uint8_t *)memchr(vlc->data, value, len);
+      if (found) {
+         vlc->data = found;
          vl_vlc_align_data_ptr(vlc);
          vl_vlc_fillbits(vlc);
          return true;
       }
 
-      ++vlc->data;
+      vlc->data += len;
       if (num_bits != ~0u) {
-         num_bits -= 8;
+         num_bits -= len * 8;
          if (num_bits == 0) {
             vl_vlc_align_data_ptr(vlc);
             return false;
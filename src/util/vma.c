@@ -28,26 +28,188 @@
 #include "util/u_math.h"
 #include "util/vma.h"
 
+/* The holes are kept in a red-black tree ordered by address, where each hole
+ * also knows the size of the largest hole in its subtree.  That lets us find
+ * the highest (or lowest) hole big enough for an allocation, and the holes
+ * next to a freed range, without walking all of them.
+ */
 struct util_vma_hole {
-   struct list_head link;
+   struct rb_node node;
    uint64_t offset;
    uint64_t size;
+
+   /** Size of the largest hole in the subtree rooted at this hole */
+   uint64_t max_size;
 };
 
 #define util_vma_foreach_hole(_hole, _heap) \
-   list_for_each_entry(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   rb_tree_foreach(struct util_vma_hole, _hole, &(_heap)->holes, node)
+
+#define util_vma_foreach_hole_rev(_hole, _heap) \
+   rb_tree_foreach_rev(struct util_vma_hole, _hole, &(_heap)->holes, node)
+
+static inline struct util_vma_hole *
+util_vma_node_hole(const struct rb_node *node)
+{
+   return node ? rb_node_data(struct util_vma_hole, node, node) : NULL;
+}
+
+static inline uint64_t
+util_vma_subtree_max_size(const struct rb_node *node)
+{
+   return node ? util_vma_node_hole(node)->max_size : 0;
+}
+
+static void
+util_vma_hole_augment(struct rb_node *node)
+{
+   struct util_vma_hole *hole = util_vma_node_hole(node);
+
+   hole->max_size = MAX3(hole->size,
+                         util_vma_subtree_max_size(node->left),
+                         util_vma_subtree_max_size(node->right));
+}
+
+static int
+util_vma_hole_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+   const uint64_t a_offset = util_vma_node_hole(a)->offset;
+   const uint64_t b_offset = util_vma_node_hole(b)->offset;
 
-#define util_vma_foreach_hole_safe(_hole, _heap) \
-   list_for_each_entry_safe(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   return a_offset > b_offset ? -1 : a_offset < b_offset;
+}
+
+static void
+util_vma_hole_insert(struct util_vma_heap *heap, struct util_vma_hole *hole)
+{
+   rb_augmented_tree_insert(&heap->holes, &hole->node, util_vma_hole_cmp,
+                            util_vma_hole_augment);
+}
+
+static void
+util_vma_hole_remove(struct util_vma_heap *heap, struct util_vma_hole *hole)
+{
+   rb_augmented_tree_remove(&heap->holes, &hole->node, util_vma_hole_augment);
+   free(hole);
+}
+
+/* Must be called after changing the size of a hole in the tree */
+static void
+util_vma_hole_resized(struct util_vma_hole *hole)
+{
+   rb_augmented_tree_propagate(&hole->node, util_vma_hole_augment);
+}
 
-#define util_vma_foreach_hole_safe_rev(_hole, _heap) \
-   list_for_each_entry_safe_rev(struct util_vma_hole, _hole, &(_heap)->holes, link)
+/** Returns the highest hole of the subtree of at least size bytes */
+static struct util_vma_hole *
+util_vma_subtree_last_fit(struct rb_node *node, uint64_t size)
+{
+   while (util_vma_subtree_max_size(node) >= size) {
+      if (util_vma_subtree_max_size(node->right) >= size)
+         node = node->right;
+      else if (util_vma_node_hole(node)->size >= size)
+         return util_vma_node_hole(node);
+      else
+         node = node->left;
+   }
+
+   return NULL;
+}
+
+/** Returns the lowest hole of the subtree of at least size bytes */
+static struct util_vma_hole *
+util_vma_subtree_first_fit(struct rb_node *node, uint64_t size)
+{
+   while (util_vma_subtree_max_size(node) >= size) {
+      if (util_vma_subtree_max_size(node->left) >= size)
+         node = node->left;
+      else if (util_vma_node_hole(node)->size >= size)
+         return util_vma_node_hole(node);
+      else
+         node = node->right;
+   }
+
+   return NULL;
+}
+
+/** Returns the highest hole below this one of at least size bytes */
+static struct util_vma_hole *
+util_vma_hole_prev_fit(struct util_vma_hole *hole, uint64_t size)
+{
+   struct rb_node *node = &hole->node;
+   struct util_vma_hole *fit = util_vma_subtree_last_fit(node->left, size);
+   if (fit)
+      return fit;
+
+   /* Everything else below us is in the left subtrees of the ancestors we
+    * are the right descendant of, and in those ancestors themselves.
+    */
+   for (struct rb_node *parent = rb_node_parent(node); parent;
+        node = parent, parent = rb_node_parent(node)) {
+      if (node != parent->right)
+         continue;
+
+      if (util_vma_node_hole(parent)->size >= size)
+         return util_vma_node_hole(parent);
+
+      fit = util_vma_subtree_last_fit(parent->left, size);
+      if (fit)
+         return fit;
+   }
+
+   return NULL;
+}
+
+/** Returns the lowest hole above this one of at least size bytes */
+static struct util_vma_hole *
+util_vma_hole_next_fit(struct util_vma_hole *hole, uint64_t size)
+{
+   struct rb_node *node = &hole->node;
+   struct util_vma_hole *fit = util_vma_subtree_first_fit(node->right, size);
+   if (fit)
+      return fit;
+
+   for (struct rb_node *parent = rb_node_parent(node); parent;
+        node = parent, parent = rb_node_parent(node)) {
+      if (node != parent->left)
+         continue;
+
+      if (util_vma_node_hole(parent)->size >= size)
+         return util_vma_node_hole(parent);
+
+      fit = util_vma_subtree_first_fit(parent->right, size);
+      if (fit)
+         return fit;
+   }
+
+   return NULL;
+}
+
+/** Returns the highest hole starting at or below offset, if any */
+static struct util_vma_hole *
+util_vma_heap_find_hole(struct util_vma_heap *heap, uint64_t offset)
+{
+   struct util_vma_hole *found = NULL;
+   struct rb_node *node = heap->holes.root;
+
+   while (node) {
+      struct util_vma_hole *hole = util_vma_node_hole(node);
+      if (hole->offset <= offset) {
+         found = hole;
+         node = node->right;
+      } else {
+         node = node->left;
+      }
+   }
+
+   return found;
+}
 
 void
 util_vma_heap_init(struct util_vma_heap *heap,
                    uint64_t start, uint64_t size)
 {
-   list_inithead(&heap->holes);
+   rb_tree_init(&heap->holes);
    heap->free_size = 0;
    util_vma_heap_free(heap, start, size);
 
@@ -58,49 +220,96 @@ util_vma_heap_init(struct util_vma_heap *heap,
    heap->nospan_shift = 0;
 }
 
-void
-util_vma_heap_finish(struct util_vma_heap *heap)
+#ifndef NDEBUG
+static void
+util_vma_hole_validate(struct util_vma_hole *hole)
 {
-   util_vma_foreach_hole_safe(hole, heap)
-      free(hole);
+   assert(hole->offset > 0);
+   assert(hole->size > 0);
+   assert(hole->max_size ==
+          MAX3(hole->size, util_vma_subtree_max_size(hole->node.left),
+               util_vma_subtree_max_size(hole->node.right)));
+
+   struct util_vma_hole *next = util_vma_node_hole(rb_node_next(&hole->node));
+   if (next == NULL) {
+      /* This must be the top-most hole.  Assert that, if it overflows, it
+       * overflows to 0, i.e. 2^64.
+       */
+      assert(hole->size + hole->offset == 0 ||
+             hole->size + hole->offset > hole->offset);
+   } else {
+      /* This is not the top-most hole so it must not overflow and, in
+       * fact, must be strictly lower than the next hole.  If
+       * hole->size + hole->offset == next->offset, then we failed to join
+       * holes during a util_vma_heap_free.
+       */
+      assert(hole->size + hole->offset > hole->offset &&
+             hole->size + hole->offset < next->offset);
+   }
+}
+
+/* Checks the holes around offset, and the largest hole sizes from there to
+ * the root.  Walking all the holes on every call would make allocation
+ * linear in the number of holes again.
+ */
+static void
+util_vma_heap_validate_at(struct util_vma_heap *heap, uint64_t offset)
+{
+   struct util_vma_hole *hole = util_vma_heap_find_hole(heap, offset);
+   struct rb_node *node = hole ? &hole->node : rb_tree_first(&heap->holes);
+   if (node == NULL)
+      return;
+
+   struct rb_node *prev = rb_node_prev(node), *next = rb_node_next(node);
+   if (prev)
+      util_vma_hole_validate(util_vma_node_hole(prev));
+   util_vma_hole_validate(util_vma_node_hole(node));
+   if (next)
+      util_vma_hole_validate(util_vma_node_hole(next));
+
+   for (node = rb_node_parent(node); node; node = rb_node_parent(node))
+      util_vma_hole_validate(util_vma_node_hole(node));
 }
 
-#ifndef NDEBUG
 static void
 util_vma_heap_validate(struct util_vma_heap *heap)
 {
    uint64_t free_size = 0;
-   uint64_t prev_offset = 0;
-   util_vma_foreach_hole(hole, heap) {
-      assert(hole->offset > 0);
-      assert(hole->size > 0);
 
+   rb_tree_validate(&heap->holes);
+   util_vma_foreach_hole(hole, heap) {
+      util_vma_hole_validate(hole);
       free_size += hole->size;
-
-      if (&hole->link == heap->holes.next) {
-         /* This must be the top-most hole.  Assert that, if it overflows, it
-          * overflows to 0, i.e. 2^64.
-          */
-         assert(hole->size + hole->offset == 0 ||
-                hole->size + hole->offset > hole->offset);
-      } else {
-         /* This is not the top-most hole so it must not overflow and, in
-          * fact, must be strictly lower than the top-most hole.  If
-          * hole->size + hole->offset == prev_offset, then we failed to join
-          * holes during a util_vma_heap_free.
-          */
-         assert(hole->size + hole->offset > hole->offset &&
-                hole->size + hole->offset < prev_offset);
-      }
-      prev_offset = hole->offset;
    }
 
    assert(free_size == heap->free_size);
 }
 #else
+#define util_vma_heap_validate_at(heap, offset)
 #define util_vma_heap_validate(heap)
 #endif
 
+static void
+util_vma_subtree_free(struct rb_node *node)
+{
+   while (node) {
+      struct rb_node *left = node->left;
+
+      util_vma_subtree_free(node->right);
+      free(util_vma_node_hole(node));
+      node = left;
+   }
+}
+
+void
+util_vma_heap_finish(struct util_vma_heap *heap)
+{
+   util_vma_heap_validate(heap);
+
+   /* The tree is balanced, so this doesn't recurse deeply */
+   util_vma_subtree_free(heap->holes.root);
+}
+
 static void
 util_vma_hole_alloc(struct util_vma_heap *heap,
                     struct util_vma_hole *hole,
@@ -111,8 +320,7 @@ util_vma_hole_alloc(struct util_vma_heap *heap,
 
    if (offset == hole->offset && size == hole->size) {
       /* Just get rid of the hole. */
-      list_del(&hole->link);
-      free(hole);
+      util_vma_hole_remove(heap, hole);
       goto done;
    }
 
@@ -121,13 +329,17 @@ util_vma_hole_alloc(struct util_vma_heap *heap,
    if (waste == 0) {
       /* We allocated at the top.  Shrink the hole down. */
       hole->size -= size;
+      util_vma_hole_resized(hole);
       goto done;
    }
 
    if (offset == hole->offset) {
-      /* We allocated at the bottom. Shrink the hole up. */
+      /* We allocated at the bottom. Shrink the hole up.  It stays between
+       * the same neighbours, so its place in the tree doesn't change.
+       */
       hole->offset += size;
       hole->size -= size;
+      util_vma_hole_resized(hole);
       goto done;
    }
 
@@ -142,11 +354,9 @@ util_vma_hole_alloc(struct util_vma_heap *heap,
     * original hole.
     */
    hole->size = offset - hole->offset;
+   util_vma_hole_resized(hole);
 
-   /* Place the new hole before the old hole so that the list is in order
-    * from high to low.
-    */
-   list_addtail(&high_hole->link, &hole->link);
+   util_vma_hole_insert(heap, high_hole);
 
  done:
    heap->free_size -= size;
@@ -160,8 +370,6 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
    assert(size > 0);
    assert(alignment > 0);
 
-   util_vma_heap_validate(heap);
-
    /* The requested alignment should not be stronger than the block/nospan
     * alignment.
     */
@@ -171,10 +379,10 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
    }
 
    if (heap->alloc_high) {
-      util_vma_foreach_hole_safe(hole, heap) {
-         if (size > hole->size)
-            continue;
-
+      /* Try the holes big enough for the allocation from the top down */
+      for (struct util_vma_hole *hole =
+              util_vma_subtree_last_fit(heap->holes.root, size);
+           hole; hole = util_vma_hole_prev_fit(hole, size)) {
          /* Compute the offset as the highest address where a chunk of the
           * given size can be without going over the top of the hole.
           *
@@ -204,14 +412,14 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
             continue;
 
          util_vma_hole_alloc(heap, hole, offset, size);
-         util_vma_heap_validate(heap);
+         util_vma_heap_validate_at(heap, offset);
          return offset;
       }
    } else {
-      util_vma_foreach_hole_safe_rev(hole, heap) {
-         if (size > hole->size)
-            continue;
-
+      /* Try the holes big enough for the allocation from the bottom up */
+      for (struct util_vma_hole *hole =
+              util_vma_subtree_first_fit(heap->holes.root, size);
+           hole; hole = util_vma_hole_next_fit(hole, size)) {
          uint64_t offset = hole->offset;
 
          /* Align the offset */
@@ -235,7 +443,7 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
          }
 
          util_vma_hole_alloc(heap, hole, offset, size);
-         util_vma_heap_validate(heap);
+         util_vma_heap_validate_at(heap, offset);
          return offset;
       }
    }
@@ -261,25 +469,17 @@ util_vma_heap_alloc_addr(struct util_vma_heap *heap,
     */
    assert(offset + size == 0 || offset + size > offset);
 
-   /* Find the hole if one exists. */
-   util_vma_foreach_hole_safe(hole, heap) {
-      if (hole->offset > offset)
-         continue;
-
-      /* Holes are ordered high-to-low so the first hole we find with
-       * hole->offset <= is our hole.  If it's not big enough to contain the
-       * requested range, then the allocation fails.
-       */
-      assert(hole->offset <= offset);
-      if (hole->size < offset - hole->offset + size)
-         return false;
-
-      util_vma_hole_alloc(heap, hole, offset, size);
-      return true;
-   }
+   /* Find the hole if one exists.  The hole starting closest below the
+    * offset is our hole.  If it's not big enough to contain the requested
+    * range, then the allocation fails.
+    */
+   struct util_vma_hole *hole = util_vma_heap_find_hole(heap, offset);
+   if (hole == NULL || hole->size < offset - hole->offset + size)
+      return false;
 
-   /* We didn't find a suitable hole */
-   return false;
+   util_vma_hole_alloc(heap, hole, offset, size);
+   util_vma_heap_validate_at(heap, offset);
+   return true;
 }
 
 void
@@ -299,17 +499,11 @@ util_vma_heap_free(struct util_vma_heap *heap,
     */
    assert(offset + size == 0 || offset + size > offset);
 
-   util_vma_heap_validate(heap);
-
    /* Find immediately higher and lower holes if they exist. */
-   struct util_vma_hole *high_hole = NULL, *low_hole = NULL;
-   util_vma_foreach_hole(hole, heap) {
-      if (hole->offset <= offset) {
-         low_hole = hole;
-         break;
-      }
-      high_hole = hole;
-   }
+   struct util_vma_hole *low_hole = util_vma_heap_find_hole(heap, offset);
+   struct util_vma_hole *high_hole =
+      util_vma_node_hole(low_hole ? rb_node_next(&low_hole->node) :
+                                    rb_tree_first(&heap->holes));
 
    if (high_hole)
       assert(offset + size <= high_hole->offset);
@@ -324,31 +518,28 @@ util_vma_heap_free(struct util_vma_heap *heap,
    if (low_adjacent && high_adjacent) {
       /* Merge the two holes */
       low_hole->size += size + high_hole->size;
-      list_del(&high_hole->link);
-      free(high_hole);
+      util_vma_hole_remove(heap, high_hole);
+      util_vma_hole_resized(low_hole);
    } else if (low_adjacent) {
       /* Merge into the low hole */
       low_hole->size += size;
+      util_vma_hole_resized(low_hole);
    } else if (high_adjacent) {
       /* Merge into the high hole */
       high_hole->offset = offset;
       high_hole->size += size;
+      util_vma_hole_resized(high_hole);
    } else {
       /* Neither hole is adjacent; make a new one */
       struct util_vma_hole *hole = calloc(1, sizeof(*hole));
 
       hole->offset = offset;
       hole->size = size;
-
-      /* Add it after the high hole so we maintain high-to-low ordering */
-      if (high_hole)
-         list_add(&hole->link, &high_hole->link);
-      else
-         list_add(&hole->link, &heap->holes);
+      util_vma_hole_insert(heap, hole);
    }
 
    heap->free_size += size;
-   util_vma_heap_validate(heap);
+   util_vma_heap_validate_at(heap, offset);
 }
 
 void
@@ -358,7 +549,7 @@ util_vma_heap_print(struct util_vma_heap *heap, FILE *fp,
    fprintf(fp, "%sutil_vma_heap:\n", tab);
 
    uint64_t total_free = 0;
-   util_vma_foreach_hole(hole, heap) {
+   util_vma_foreach_hole_rev(hole, heap) {
       fprintf(fp, "%s    hole: offset = %"PRIu64" (0x%"PRIx64"), "
               "size = %"PRIu64" (0x%"PRIx64")\n",
               tab, hole->offset, hole->offset, hole->size, hole->size);
@@ -27,14 +27,15 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#include "list.h"
+#include "rb_tree.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct util_vma_heap {
-   struct list_head holes;
+   /** Holes ordered by address, see vma.c */
+   struct rb_tree holes;
 
    /** Total size of free memory. */
    uint64_t free_size;
@@ -41,7 +41,13 @@
 #include <unistd.h>
 #include <errno.h>
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include "bitset.h"
+#include "detect_os.h"
+#include "hash_table.h"
+#include "u_debug.h"
+#include "u_dynarray.h"
 #endif
 #ifdef NO_REGEX
 typedef int regex_t;
@@ -590,11 +596,27 @@ __driUtilMessage(const char *f, ...)
                         ##__VA_ARGS__);                                 \
    } while (0)
 
+#ifndef SYSCONFDIR
+#define SYSCONFDIR "/etc"
+#endif
+
+#ifndef DATADIR
+#define DATADIR "/usr/share"
+#endif
+
+static const char *datadir = DATADIR "/drirc.d";
+static const char *execname;
+
+#if WITH_XMLCONFIG
+struct driconf_recorder;
+#endif
+
 /** \brief Parser context for configuration files. */
 struct OptConfData {
    const char *name;
 #if WITH_XMLCONFIG
    XML_Parser parser;
+   struct driconf_recorder *recorder;
 #endif
    driOptionCache *cache;
    int screenNum;
@@ -859,6 +881,200 @@ bsearchStr(const char *name, const char *elems[], uint32_t count)
       return count;
 }
 
+/*
+ * Binary cache of the configuration files.
+ *
+ * Parsing the XML files doesn't depend on the driver, device or application
+ * being matched, only the handling of the elements does.  So the element
+ * events expat produces are recorded into a flat array of words and strings,
+ * stored in a cache file together with the stat() results of every source
+ * file, and replayed through the same handlers by later processes for as long
+ * as none of the sources changed.
+ *
+ * Events, as uint32_t words:
+ *   DRICONF_EV_FILE  | name
+ *   DRICONF_EV_START | name | end | exec hash | num attrs | attr/value names
+ *   DRICONF_EV_END   | name
+ *
+ * The first word also holds the OptConfElem in bits 8-15.  "end" is the index
+ * of the matching DRICONF_EV_END, so elements being ignored can be skipped as
+ * a whole, and applications with an executable attribute carry its hash so
+ * that a mismatch is found without looking at the attributes.
+ */
+#define DRICONF_CACHE_MAGIC "MESADRC"
+#define DRICONF_CACHE_VERSION 1
+#define DRICONF_CACHE_MAX_ATTRS 16
+
+enum driconf_event {
+   DRICONF_EV_FILE,
+   DRICONF_EV_START,
+   DRICONF_EV_END,
+};
+
+#define DRICONF_EV_HAS_EXEC (1u << 16)
+
+struct driconf_cache_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t key;           /* string offset of the source paths */
+   uint32_t num_sources;
+   uint32_t num_words;
+   uint32_t strings_size;
+   uint32_t pad;
+};
+
+struct driconf_cache_source {
+   uint32_t path;          /* string offset */
+   uint32_t exists;
+   int64_t size;
+   int64_t mtime_ns;
+   uint64_t ino;
+};
+
+struct driconf_recorder {
+   void *mem_ctx;
+   struct hash_table *string_offsets;
+   struct util_dynarray strings;
+   struct util_dynarray words;
+   struct util_dynarray sources;
+   struct util_dynarray open_elems;
+   bool failed;
+};
+
+static int64_t
+statMtimeNs(const struct stat *st)
+{
+#if DETECT_OS_APPLE
+   return st->st_mtimespec.tv_sec * 1000000000ll + st->st_mtimespec.tv_nsec;
+#else
+   return st->st_mtim.tv_sec * 1000000000ll + st->st_mtim.tv_nsec;
+#endif
+}
+
+static uint32_t
+recordString(struct driconf_recorder *rec, const char *str)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(rec->string_offsets, str);
+   if (entry)
+      return (uint32_t)(uintptr_t)entry->data;
+
+   uint32_t offset = rec->strings.size;
+   size_t len = strlen(str) + 1;
+   void *dst = util_dynarray_grow_bytes(&rec->strings, 1, len);
+   if (!dst) {
+      rec->failed = true;
+      return 0;
+   }
+   memcpy(dst, str, len);
+   _mesa_hash_table_insert(rec->string_offsets, ralloc_strdup(rec->mem_ctx, str),
+                           (void *)(uintptr_t)offset);
+   return offset;
+}
+
+static void
+recordWord(struct driconf_recorder *rec, uint32_t word)
+{
+   uint32_t *dst = util_dynarray_grow(&rec->words, uint32_t, 1);
+   if (dst)
+      *dst = word;
+   else
+      rec->failed = true;
+}
+
+static void
+recordSource(struct driconf_recorder *rec, const char *path)
+{
+   struct driconf_cache_source *src =
+      util_dynarray_grow(&rec->sources, struct driconf_cache_source, 1);
+   struct stat st;
+
+   if (!src) {
+      rec->failed = true;
+      return;
+   }
+
+   memset(src, 0, sizeof(*src));
+   src->path = recordString(rec, path);
+   if (stat(path, &st) == 0) {
+      src->exists = 1;
+      src->size = st.st_size;
+      src->mtime_ns = statMtimeNs(&st);
+      src->ino = st.st_ino;
+   }
+}
+
+/* Points elements left open by a parse error past the end of their file */
+static void
+recordCloseAll(struct driconf_recorder *rec)
+{
+   uint32_t *words = rec->words.data;
+
+   util_dynarray_foreach(&rec->open_elems, uint32_t, start)
+      words[*start + 2] = util_dynarray_num_elements(&rec->words, uint32_t);
+   util_dynarray_clear(&rec->open_elems);
+}
+
+static void
+recordFile(struct driconf_recorder *rec, const char *filename)
+{
+   recordCloseAll(rec);
+   recordSource(rec, filename);
+   recordWord(rec, DRICONF_EV_FILE);
+   recordWord(rec, recordString(rec, filename));
+}
+
+static void
+recordStartElem(struct driconf_recorder *rec, const char *name,
+                enum OptConfElem elem, const char **attr)
+{
+   uint32_t start = util_dynarray_num_elements(&rec->words, uint32_t);
+   uint32_t flags = 0, exec_hash = 0, num_attrs = 0;
+
+   while (attr[num_attrs * 2])
+      num_attrs++;
+   if (num_attrs > DRICONF_CACHE_MAX_ATTRS) {
+      rec->failed = true;
+      return;
+   }
+
+   if (elem == OC_APPLICATION) {
+      for (uint32_t i = 0; attr[i]; i += 2) {
+         if (!strcmp(attr[i], "executable")) {
+            flags |= DRICONF_EV_HAS_EXEC;
+            exec_hash = _mesa_hash_string(attr[i + 1]);
+         }
+      }
+   }
+
+   recordWord(rec, DRICONF_EV_START | elem << 8 | flags);
+   recordWord(rec, recordString(rec, name));
+   recordWord(rec, 0);
+   recordWord(rec, exec_hash);
+   recordWord(rec, num_attrs);
+   for (uint32_t i = 0; i < num_attrs * 2; i++)
+      recordWord(rec, recordString(rec, attr[i]));
+
+   util_dynarray_append(&rec->open_elems, uint32_t, start);
+}
+
+static void
+recordEndElem(struct driconf_recorder *rec, const char *name,
+              enum OptConfElem elem)
+{
+   uint32_t end = util_dynarray_num_elements(&rec->words, uint32_t);
+
+   if (rec->failed)
+      return;
+
+   if (util_dynarray_num_elements(&rec->open_elems, uint32_t)) {
+      uint32_t start = util_dynarray_pop(&rec->open_elems, uint32_t);
+      ((uint32_t *)rec->words.data)[start + 2] = end;
+   }
+
+   recordWord(rec, DRICONF_EV_END | elem << 8);
+   recordWord(rec, recordString(rec, name));
+}
+
 /** \brief Handler for start element events. */
 static void
 optConfStartElem(void *userData, const char *name,
@@ -866,6 +1082,8 @@ optConfStartElem(void *userData, const char *name,
 {
    struct OptConfData *data = (struct OptConfData *)userData;
    enum OptConfElem elem = bsearchStr(name, OptConfElems, OC_COUNT);
+   if (data->recorder)
+      recordStartElem(data->recorder, name, elem, attr);
    switch (elem) {
    case OC_DRICONF:
       if (data->inDriConf)
@@ -921,6 +1139,8 @@ optConfEndElem(void *userData, const char *name)
 {
    struct OptConfData *data = (struct OptConfData *)userData;
    enum OptConfElem elem = bsearchStr(name, OptConfElems, OC_COUNT);
+   if (data->recorder)
+      recordEndElem(data->recorder, name, elem);
    switch (elem) {
    case OC_DRICONF:
       data->inDriConf--;
@@ -988,6 +1208,9 @@ parseOneConfigFile(struct OptConfData *data, const char *filename)
 {
    XML_Parser p;
 
+   if (data->recorder)
+      recordFile(data->recorder, filename);
+
    p = XML_ParserCreate(NULL); /* use encoding specified by file */
    XML_SetElementHandler(p, optConfStartElem, optConfEndElem);
    XML_SetUserData(p, data);
@@ -1035,6 +1258,10 @@ parseConfigDir(struct OptConfData *data, const char *dirname)
    int i, count;
    struct dirent **entries = NULL;
 
+   /* Adding or removing files changes the mtime of the directory */
+   if (data->recorder)
+      recordSource(data->recorder, dirname);
+
    count = scandir(dirname, &entries, scandir_filter, alphasort);
    if (count < 0)
       return;
@@ -1066,6 +1293,349 @@ parseConfigDir(struct OptConfData *data, const char *dirname)
 
    free(entries);
 }
+
+/** \brief Path of the configuration cache, NULL if disabled */
+static char *
+driconfCachePath(void)
+{
+   const char *dir = os_get_option("MESA_DRICONF_CACHE_DIR");
+   char *path = NULL;
+
+   /* Don't let a setuid process read or write a file the user controls */
+   if (__check_suid() ||
+       debug_get_bool_option("MESA_DRICONF_CACHE_DISABLE", false))
+      return NULL;
+
+   if (dir) {
+      if (asprintf(&path, "%s/mesa_driconf.bin", dir) < 0)
+         return NULL;
+   } else if ((dir = getenv("XDG_CACHE_HOME"))) {
+      if (asprintf(&path, "%s/mesa_driconf.bin", dir) < 0)
+         return NULL;
+   } else if ((dir = getenv("HOME"))) {
+      if (asprintf(&path, "%s/.cache/mesa_driconf.bin", dir) < 0)
+         return NULL;
+   }
+
+   return path;
+}
+
+static bool
+checkCacheSource(const struct driconf_cache_source *src, const char *strings)
+{
+   struct stat st;
+
+   if (stat(strings + src->path, &st) != 0)
+      return !src->exists;
+
+   return src->exists && src->size == st.st_size &&
+          src->mtime_ns == statMtimeNs(&st) && src->ino == st.st_ino;
+}
+
+/* Length in words of the event at words[i], 0 if it's malformed */
+static uint32_t
+cacheEventLength(const uint32_t *words, uint32_t num_words, uint32_t i)
+{
+   uint32_t len;
+
+   switch (words[i] & 0xff) {
+   case DRICONF_EV_FILE:
+   case DRICONF_EV_END:
+      len = 2;
+      break;
+   case DRICONF_EV_START:
+      if (num_words - i < 5 || words[i + 4] > DRICONF_CACHE_MAX_ATTRS)
+         return 0;
+      len = 5 + words[i + 4] * 2;
+      break;
+   default:
+      return 0;
+   }
+
+   return num_words - i < len ? 0 : len;
+}
+
+/**
+ * \brief Check the events of a cache before anything is replayed
+ *
+ * The cache is a file in the user's home, so every string offset and every
+ * jump past an ignored element is checked.  Jumps have to go forward and land
+ * on the start of an event or on the end of the stream.
+ */
+static bool
+validateConfigEvents(const uint32_t *words, uint32_t num_words,
+                     uint32_t strings_size)
+{
+   BITSET_WORD *starts;
+   bool valid = false;
+   uint32_t i, len;
+
+   starts = calloc(BITSET_WORDS(num_words + 1), sizeof(BITSET_WORD));
+   if (!starts)
+      return false;
+
+   for (i = 0; i < num_words; i += len) {
+      len = cacheEventLength(words, num_words, i);
+      if (!len || ((words[i] >> 8) & 0xff) > OC_COUNT)
+         goto out;
+
+      /* name and, for elements, the attribute names and values */
+      for (uint32_t j = 1; j < len; j++) {
+         if ((j == 1 || j >= 5) && words[i + j] >= strings_size)
+            goto out;
+      }
+
+      BITSET_SET(starts, i);
+   }
+   BITSET_SET(starts, num_words);
+
+   for (i = 0; i < num_words; i += len) {
+      len = cacheEventLength(words, num_words, i);
+      if ((words[i] & 0xff) == DRICONF_EV_START &&
+          (words[i + 2] <= i || words[i + 2] > num_words ||
+           !BITSET_TEST(starts, words[i + 2])))
+         goto out;
+   }
+
+   valid = true;
+
+out:
+   free(starts);
+   return valid;
+}
+
+/** \brief Replay recorded element events through the parser handlers */
+static void
+replayConfigEvents(struct OptConfData *data, const uint32_t *words,
+                   uint32_t num_words, const char *strings)
+{
+   uint32_t exec_hash = _mesa_hash_string(data->execName);
+   const char *attr[DRICONF_CACHE_MAX_ATTRS * 2 + 1];
+   uint32_t i = 0;
+
+   while (i < num_words) {
+      const uint32_t *ev = &words[i];
+      enum OptConfElem elem = (ev[0] >> 8) & 0xff;
+
+      switch (ev[0] & 0xff) {
+      case DRICONF_EV_FILE:
+         data->name = strings + ev[1];
+         data->ignoringDevice = 0;
+         data->ignoringApp = 0;
+         data->inDriConf = 0;
+         data->inDevice = 0;
+         data->inApp = 0;
+         data->inOption = 0;
+         i += 2;
+         break;
+      case DRICONF_EV_START: {
+         uint32_t num_attrs = ev[4];
+
+         /* An application for another executable, it can't match */
+         if (elem == OC_APPLICATION && (ev[0] & DRICONF_EV_HAS_EXEC) &&
+             ev[3] != exec_hash && !data->ignoringDevice &&
+             !data->ignoringApp) {
+            data->inApp++;
+            data->ignoringApp = data->inApp;
+            i = ev[2];
+            break;
+         }
+
+         for (uint32_t j = 0; j < num_attrs * 2; j++)
+            attr[j] = strings + ev[5 + j];
+         attr[num_attrs * 2] = NULL;
+
+         optConfStartElem(data, strings + ev[1], attr);
+
+         /* Nothing inside an ignored element has any effect */
+         if (data->ignoringDevice || data->ignoringApp)
+            i = ev[2];
+         else
+            i += 5 + num_attrs * 2;
+         break;
+      }
+      case DRICONF_EV_END:
+         optConfEndElem(data, strings + ev[1]);
+         i += 2;
+         break;
+      default:
+         unreachable("bad driconf cache event");
+      }
+   }
+}
+
+/** \brief Apply the configuration cache if it is up to date */
+static bool
+loadConfigCache(struct OptConfData *data, const char *path, const char *key)
+{
+   const struct driconf_cache_header *header;
+   const struct driconf_cache_source *sources;
+   const uint32_t *words;
+   const char *strings;
+   struct stat st;
+   bool valid = false;
+   void *map;
+   int fd;
+
+   fd = open(path, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      return false;
+
+   if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(*header)) {
+      close(fd);
+      return false;
+   }
+
+   map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED)
+      return false;
+
+   header = map;
+   sources = (const void *)(header + 1);
+   words = (const void *)(sources + header->num_sources);
+   strings = (const void *)(words + header->num_words);
+
+   if (memcmp(header->magic, DRICONF_CACHE_MAGIC, sizeof(header->magic)) ||
+       header->version != DRICONF_CACHE_VERSION ||
+       st.st_size != (off_t)(sizeof(*header) +
+                             (uint64_t)header->num_sources * sizeof(*sources) +
+                             (uint64_t)header->num_words * sizeof(*words) +
+                             header->strings_size) ||
+       !header->strings_size || strings[header->strings_size - 1] != '\0' ||
+       header->key >= header->strings_size || strcmp(strings + header->key, key))
+      goto out;
+
+   for (uint32_t i = 0; i < header->num_sources; i++) {
+      if (sources[i].path >= header->strings_size ||
+          !checkCacheSource(&sources[i], strings))
+         goto out;
+   }
+
+   /* A corrupt cache is rewritten from the XML files by the caller */
+   if (!validateConfigEvents(words, header->num_words, header->strings_size))
+      goto out;
+
+   replayConfigEvents(data, words, header->num_words, strings);
+   valid = true;
+
+out:
+   munmap(map, st.st_size);
+   return valid;
+}
+
+/** \brief Write the recorded events, replacing the cache atomically */
+static void
+writeConfigCache(struct driconf_recorder *rec, const char *path,
+                 const char *key)
+{
+   struct driconf_cache_header header = {
+      .magic = DRICONF_CACHE_MAGIC,
+      .version = DRICONF_CACHE_VERSION,
+   };
+   char *tmp, *slash;
+   bool ok;
+   FILE *f;
+   int fd;
+
+   recordCloseAll(rec);
+   header.key = recordString(rec, key);
+   if (rec->failed)
+      return;
+
+   header.num_sources =
+      util_dynarray_num_elements(&rec->sources, struct driconf_cache_source);
+   header.num_words = util_dynarray_num_elements(&rec->words, uint32_t);
+   header.strings_size = rec->strings.size;
+
+   if (asprintf(&tmp, "%s.XXXXXX", path) < 0)
+      return;
+
+   /* $HOME/.cache may not exist yet */
+   slash = strrchr(tmp, '/');
+   if (slash) {
+      *slash = '\0';
+      mkdir(tmp, 0755);
+      *slash = '/';
+   }
+
+   fd = mkstemp(tmp);
+   if (fd == -1) {
+      free(tmp);
+      return;
+   }
+
+   f = fdopen(fd, "wb");
+   if (!f) {
+      close(fd);
+      unlink(tmp);
+      free(tmp);
+      return;
+   }
+
+   ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(rec->sources.data, 1, rec->sources.size, f) == rec->sources.size &&
+        fwrite(rec->words.data, 1, rec->words.size, f) == rec->words.size &&
+        fwrite(rec->strings.data, 1, rec->strings.size, f) == rec->strings.size;
+   ok = fclose(f) == 0 && ok;
+
+   if (!ok || rename(tmp, path) != 0)
+      unlink(tmp);
+   free(tmp);
+}
+
+static void
+parseAllConfigFiles(struct OptConfData *data, const char *home_drirc)
+{
+   parseConfigDir(data, datadir);
+   parseOneConfigFile(data, SYSCONFDIR "/drirc");
+   if (home_drirc)
+      parseOneConfigFile(data, home_drirc);
+}
+
+/** \brief Parse the configuration files, through the cache if possible */
+static void
+parseConfigFilesCached(struct OptConfData *data)
+{
+   char home_drirc[PATH_MAX], *key, *path;
+   const char *home = getenv("HOME");
+   struct driconf_recorder rec;
+
+   if (home)
+      snprintf(home_drirc, PATH_MAX, "%s/.drirc", home);
+
+   path = driconfCachePath();
+   if (!path ||
+       asprintf(&key, "%s\n%s\n%s", datadir, SYSCONFDIR "/drirc",
+                home ? home_drirc : "") < 0) {
+      free(path);
+      parseAllConfigFiles(data, home ? home_drirc : NULL);
+      return;
+   }
+
+   if (loadConfigCache(data, path, key))
+      goto out;
+
+   memset(&rec, 0, sizeof(rec));
+   rec.mem_ctx = ralloc_context(NULL);
+   rec.string_offsets = _mesa_hash_table_create(rec.mem_ctx, _mesa_hash_string,
+                                                _mesa_key_string_equal);
+   util_dynarray_init(&rec.strings, rec.mem_ctx);
+   util_dynarray_init(&rec.words, rec.mem_ctx);
+   util_dynarray_init(&rec.sources, rec.mem_ctx);
+   util_dynarray_init(&rec.open_elems, rec.mem_ctx);
+
+   data->recorder = &rec;
+   parseAllConfigFiles(data, home ? home_drirc : NULL);
+   data->recorder = NULL;
+
+   writeConfigCache(&rec, path, key);
+   ralloc_free(rec.mem_ctx);
+
+out:
+   free(key);
+   free(path);
+}
 #else
 #  include "driconf_static.h"
 
@@ -1165,17 +1735,6 @@ initOptionCache(driOptionCache *cache, const driOptionCache *info)
    }
 }
 
-#ifndef SYSCONFDIR
-#define SYSCONFDIR "/etc"
-#endif
-
-#ifndef DATADIR
-#define DATADIR "/usr/share"
-#endif
-
-static const char *datadir = DATADIR "/drirc.d";
-static const char *execname;
-
 void
 driInjectDataDir(const char *dir)
 {
@@ -1216,17 +1775,7 @@ driParseConfigFiles(driOptionCache *cache, const driOptionCache *info,
    userData.execName = execname;
 
 #if WITH_XMLCONFIG
-   char *home;
-
-   parseConfigDir(&userData, datadir);
-   parseOneConfigFile(&userData, SYSCONFDIR "/drirc");
-
-   if ((home = getenv("HOME"))) {
-      char filename[PATH_MAX];
-
-      snprintf(filename, PATH_MAX, "%s/.drirc", home);
-      parseOneConfigFile(&userData, filename);
-   }
+   parseConfigFilesCached(&userData);
 #else
    parseStaticConfig(&userData);
 #endif /* WITH_XMLCONFIG */
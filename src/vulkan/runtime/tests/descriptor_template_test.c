@@ -0,0 +1,351 @@
+/*
+ * Copyright © 2023 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Compiles an update template shaped like the ones engines use, with one
+ * entry per descriptor, and checks that executing the compiled ops, both
+ * from the user data and from the data packed for push descriptors, writes
+ * the same descriptors as walking the entries one descriptor at a time.
+ * Prints how long both take per update.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vk_alloc.h"
+#include "vk_descriptor_update_template.h"
+#include "vk_device.h"
+
+#include "util/macros.h"
+#include "util/os_time.h"
+
+#define UPDATES 200000
+
+/* What a driver might keep for every descriptor */
+struct fake_descriptor {
+   uint64_t handle;
+   uint64_t offset;
+   uint64_t range;
+};
+
+struct fake_binding {
+   VkDescriptorType type;
+   uint32_t count;
+};
+
+static const struct fake_binding layout[] = {
+   { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+   { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+   { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+   { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 16 },
+   { VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK, 64 },
+   { VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK, 32 },
+   { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 2 },
+};
+
+struct frame_data {
+   VkDescriptorBufferInfo ubos[2];
+   VkDescriptorBufferInfo ssbos[4];
+   VkDescriptorImageInfo images[16];
+   uint8_t uniforms[96];
+   VkBufferView views[2];
+};
+
+struct fake_set {
+   struct fake_descriptor descriptors[32];
+   uint8_t uniforms[96];
+};
+
+static struct vk_descriptor_template_binding bindings[ARRAY_SIZE(layout)];
+
+static void
+init_bindings(void)
+{
+   uint32_t descriptor = 0, uniform = offsetof(struct fake_set, uniforms);
+
+   for (uint32_t i = 0; i < ARRAY_SIZE(layout); i++) {
+      if (layout[i].type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK) {
+         bindings[i] = (struct vk_descriptor_template_binding) {
+            .array_size = layout[i].count,
+            .offset = uniform,
+         };
+         uniform += layout[i].count;
+      } else {
+         bindings[i] = (struct vk_descriptor_template_binding) {
+            .array_size = layout[i].count,
+            .offset = descriptor * sizeof(struct fake_descriptor),
+            .stride = sizeof(struct fake_descriptor),
+         };
+         descriptor += layout[i].count;
+      }
+   }
+}
+
+static uint32_t
+init_entries(VkDescriptorUpdateTemplateEntry *entries)
+{
+   uint32_t n = 0;
+
+   /* Rolls over into binding 1 */
+   entries[n++] = (VkDescriptorUpdateTemplateEntry) {
+      .dstBinding = 0,
+      .descriptorCount = 2,
+      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      .offset = offsetof(struct frame_data, ubos),
+      .stride = sizeof(VkDescriptorBufferInfo),
+   };
+   for (uint32_t i = 0; i < 4; i++) {
+      entries[n++] = (VkDescriptorUpdateTemplateEntry) {
+         .dstBinding = 2,
+         .dstArrayElement = i,
+         .descriptorCount = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+         .offset = offsetof(struct frame_data, ssbos[i]),
+      };
+   }
+   for (uint32_t i = 0; i < 16; i++) {
+      entries[n++] = (VkDescriptorUpdateTemplateEntry) {
+         .dstBinding = 3,
+         .dstArrayElement = i,
+         .descriptorCount = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+         .offset = offsetof(struct frame_data, images[i]),
+      };
+   }
+   /* Both inline uniform blocks in one go */
+   entries[n++] = (VkDescriptorUpdateTemplateEntry) {
+      .dstBinding = 4,
+      .descriptorCount = 96,
+      .descriptorType = VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK,
+      .offset = offsetof(struct frame_data, uniforms),
+   };
+   /* Written backwards, so these can't be merged */
+   for (uint32_t i = 0; i < 2; i++) {
+      entries[n++] = (VkDescriptorUpdateTemplateEntry) {
+         .dstBinding = 6,
+         .dstArrayElement = 1 - i,
+         .descriptorCount = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+         .offset = offsetof(struct frame_data, views[i]),
+      };
+   }
+
+   return n;
+}
+
+static void
+init_frame_data(struct frame_data *data, uint32_t frame)
+{
+   for (uint32_t i = 0; i < ARRAY_SIZE(data->ubos); i++) {
+      data->ubos[i] = (VkDescriptorBufferInfo) {
+         .buffer = (VkBuffer)(uintptr_t)(0x1000 + i),
+         .offset = frame * 256,
+         .range = 256,
+      };
+   }
+   for (uint32_t i = 0; i < ARRAY_SIZE(data->ssbos); i++) {
+      data->ssbos[i] = (VkDescriptorBufferInfo) {
+         .buffer = (VkBuffer)(uintptr_t)(0x2000 + i),
+         .offset = frame * 64,
+         .range = VK_WHOLE_SIZE,
+      };
+   }
+   for (uint32_t i = 0; i < ARRAY_SIZE(data->images); i++) {
+      data->images[i] = (VkDescriptorImageInfo) {
+         .imageView = (VkImageView)(uintptr_t)(0x3000 + i + frame),
+         .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      };
+   }
+   for (uint32_t i = 0; i < ARRAY_SIZE(data->uniforms); i++)
+      data->uniforms[i] = i + frame;
+   for (uint32_t i = 0; i < ARRAY_SIZE(data->views); i++)
+      data->views[i] = (VkBufferView)(uintptr_t)(0x4000 + i);
+}
+
+static void
+write_descriptor(struct fake_descriptor *desc, VkDescriptorType type,
+                 const void *src)
+{
+   switch (type) {
+   case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+   case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: {
+      const VkDescriptorBufferInfo *info = src;
+      desc->handle = (uintptr_t)info->buffer;
+      desc->offset = info->offset;
+      desc->range = info->range;
+      break;
+   }
+   case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: {
+      const VkDescriptorImageInfo *info = src;
+      desc->handle = (uintptr_t)info->imageView;
+      desc->offset = info->imageLayout;
+      break;
+   }
+   case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+      desc->handle = (uintptr_t)*(const VkBufferView *)src;
+      break;
+   default:
+      unreachable("Unexpected descriptor type");
+   }
+}
+
+/* What drivers did before: walk every element of every entry */
+static void
+update_entries(struct fake_set *set,
+               const VkDescriptorUpdateTemplateEntry *entries,
+               uint32_t entry_count, const void *data)
+{
+   for (uint32_t i = 0; i < entry_count; i++) {
+      const VkDescriptorUpdateTemplateEntry *entry = &entries[i];
+      uint32_t binding = entry->dstBinding;
+      uint32_t element = entry->dstArrayElement;
+
+      if (entry->descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK) {
+         memcpy((uint8_t *)set + bindings[binding].offset + element,
+                (const uint8_t *)data + entry->offset, entry->descriptorCount);
+         continue;
+      }
+
+      for (uint32_t j = 0; j < entry->descriptorCount; j++, element++) {
+         if (element >= layout[binding].count) {
+            binding++;
+            element = 0;
+         }
+
+         struct fake_descriptor *desc = (void *)((uint8_t *)set +
+            bindings[binding].offset + element * bindings[binding].stride);
+         write_descriptor(desc, entry->descriptorType,
+                          (const uint8_t *)data + entry->offset +
+                          j * entry->stride);
+      }
+   }
+}
+
+static void
+update_program(struct fake_set *set,
+               const struct vk_descriptor_template_program *program,
+               const void *data, bool packed)
+{
+   for (uint32_t i = 0; i < program->op_count; i++) {
+      const struct vk_descriptor_template_op *op = &program->ops[i];
+      size_t src_stride;
+      const uint8_t *src = vk_descriptor_template_op_src(op, data, packed,
+                                                         &src_stride);
+      uint8_t *dst = (uint8_t *)set + op->dst_offset;
+
+      if (op->type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK) {
+         memcpy(dst, src, op->count);
+         continue;
+      }
+
+      for (uint32_t j = 0; j < op->count; j++) {
+         write_descriptor((struct fake_descriptor *)dst, op->type, src);
+         dst += op->dst_stride;
+         src += src_stride;
+      }
+   }
+}
+
+int
+main(void)
+{
+   struct vk_device device = { .alloc = *vk_default_allocator() };
+   VkDescriptorUpdateTemplateEntry entries[32];
+   struct vk_descriptor_template_program *program;
+   struct frame_data data;
+   bool pass = true;
+
+   init_bindings();
+
+   const VkDescriptorUpdateTemplateCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+      .descriptorUpdateEntryCount = init_entries(entries),
+      .pDescriptorUpdateEntries = entries,
+      .templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+   };
+
+   VkResult result =
+      vk_descriptor_template_program_create(&device, NULL, &info,
+                                            bindings, ARRAY_SIZE(bindings),
+                                            &program);
+   if (result != VK_SUCCESS) {
+      printf("FAILED: vk_descriptor_template_program_create\n");
+      return EXIT_FAILURE;
+   }
+
+   /* Ubos, ssbos, images, uniforms and the two texel buffers */
+   printf("%u entries compiled to %u ops, %u bytes packed\n",
+          info.descriptorUpdateEntryCount, program->op_count,
+          program->packed_size);
+   if (program->op_count != 6) {
+      printf("FAILED: expected 6 ops\n");
+      pass = false;
+   }
+
+   uint8_t *packed = malloc(program->packed_size);
+   struct fake_set *expected = calloc(1, sizeof(*expected));
+   struct fake_set *set = calloc(1, sizeof(*set));
+
+   for (uint32_t frame = 0; frame < 4; frame++) {
+      init_frame_data(&data, frame);
+      update_entries(expected, entries, info.descriptorUpdateEntryCount, &data);
+
+      update_program(set, program, &data, false);
+      if (memcmp(set, expected, sizeof(*set))) {
+         printf("FAILED: frame %u: compiled update differs\n", frame);
+         pass = false;
+      }
+
+      memset(set, 0, sizeof(*set));
+      vk_descriptor_template_pack(program, packed, &data);
+      memset(&data, 0xff, sizeof(data));
+      update_program(set, program, packed, true);
+      if (memcmp(set, expected, sizeof(*set))) {
+         printf("FAILED: frame %u: packed update differs\n", frame);
+         pass = false;
+      }
+   }
+
+   init_frame_data(&data, 0);
+
+   int64_t start = os_time_get_nano();
+   for (uint32_t i = 0; i < UPDATES; i++)
+      update_entries(set, entries, info.descriptorUpdateEntryCount, &data);
+   const int64_t entries_time = os_time_get_nano() - start;
+
+   start = os_time_get_nano();
+   for (uint32_t i = 0; i < UPDATES; i++)
+      update_program(set, program, &data, false);
+   const int64_t program_time = os_time_get_nano() - start;
+
+   printf("per update: %7.1f ns walking entries, %7.1f ns compiled\n",
+          (double)entries_time / UPDATES, (double)program_time / UPDATES);
+
+   free(set);
+   free(expected);
+   free(packed);
+   vk_descriptor_template_program_destroy(&device, NULL, program);
+
+   return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
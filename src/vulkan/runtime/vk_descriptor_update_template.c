@@ -24,10 +24,13 @@
 
 #include "vk_descriptor_update_template.h"
 
+#include "vk_alloc.h"
 #include "vk_common_entrypoints.h"
 #include "vk_device.h"
 #include "vk_log.h"
 
+#include "util/u_math.h"
+
 VKAPI_ATTR VkResult VKAPI_CALL
 vk_common_CreateDescriptorUpdateTemplate(VkDevice _device,
    const VkDescriptorUpdateTemplateCreateInfo *pCreateInfo,
@@ -51,6 +54,7 @@ vk_common_CreateDescriptorUpdateTemplate(VkDevice _device,
 
    template->type = pCreateInfo->templateType;
    template->bind_point = pCreateInfo->pipelineBindPoint;
+   template->program = NULL;
 
    if (template->type == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET)
       template->set = pCreateInfo->set;
@@ -93,5 +97,203 @@ vk_common_DestroyDescriptorUpdateTemplate(VkDevice _device,
    if (!template)
       return;
 
+   vk_descriptor_template_program_destroy(device, pAllocator,
+                                          template->program);
    vk_object_free(device, pAllocator, template);
 }
+
+uint32_t
+vk_descriptor_template_element_size(VkDescriptorType type)
+{
+   switch (type) {
+   case VK_DESCRIPTOR_TYPE_SAMPLER:
+   case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+   case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+   case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+   case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+      return sizeof(VkDescriptorImageInfo);
+   case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+   case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+      return sizeof(VkBufferView);
+   case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+   case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+   case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+   case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+      return sizeof(VkDescriptorBufferInfo);
+   case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK:
+      return 1;
+   case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+      return sizeof(VkAccelerationStructureKHR);
+   default:
+      unreachable("Invalid descriptor type in update template");
+   }
+}
+
+static bool
+descriptor_template_ops_merge(struct vk_descriptor_template_op *prev,
+                              const struct vk_descriptor_template_op *op)
+{
+   if (prev->type != op->type || prev->flags != op->flags ||
+       prev->dst_stride != op->dst_stride ||
+       prev->dst_offset + prev->count * prev->dst_stride != op->dst_offset)
+      return false;
+
+   /* A run of a single descriptor can take any stride in the user data */
+   size_t src_stride;
+   if (prev->count > 1)
+      src_stride = prev->src_stride;
+   else if (op->count > 1)
+      src_stride = op->src_stride;
+   else if (op->src_offset > prev->src_offset)
+      src_stride = op->src_offset - prev->src_offset;
+   else
+      return false;
+
+   if ((op->count > 1 && op->src_stride != src_stride) ||
+       prev->src_offset + prev->count * src_stride != op->src_offset)
+      return false;
+
+   prev->src_stride = src_stride;
+   prev->count += op->count;
+   return true;
+}
+
+/* Splits an entry at binding boundaries and appends the pieces to the
+ * program, merging them with the previous op where possible.  With a NULL
+ * program, only counts the pieces.
+ */
+static uint32_t
+descriptor_template_emit_entry(struct vk_descriptor_template_program *program,
+                               const VkDescriptorUpdateTemplateEntry *entry,
+                               const struct vk_descriptor_template_binding *bindings,
+                               uint32_t binding_count)
+{
+   const bool is_inline =
+      entry->descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK;
+   const uint32_t packed_stride =
+      vk_descriptor_template_element_size(entry->descriptorType);
+   const size_t src_stride = is_inline ? 1 : entry->stride;
+
+   uint32_t binding = entry->dstBinding;
+   uint32_t element = entry->dstArrayElement;
+   uint32_t remaining = entry->descriptorCount;
+   size_t src_offset = entry->offset;
+   uint32_t pieces = 0;
+
+   while (remaining > 0) {
+      assert(binding < binding_count);
+      const struct vk_descriptor_template_binding *b = &bindings[binding];
+
+      /* Descriptor counts roll over into the next binding, skipping empty
+       * ones.
+       */
+      if (element >= b->array_size) {
+         element -= b->array_size;
+         binding++;
+         continue;
+      }
+
+      const uint32_t count = MIN2(remaining, b->array_size - element);
+      pieces++;
+
+      if (program != NULL) {
+         const uint32_t dst_stride = is_inline ? 1 : b->stride;
+         const struct vk_descriptor_template_op op = {
+            .type = entry->descriptorType,
+            .flags = b->flags,
+            .binding = binding,
+            .array_element = element,
+            .count = count,
+            .dst_offset = b->offset + element * dst_stride,
+            .dst_stride = dst_stride,
+            .packed_offset = program->packed_size,
+            .packed_stride = packed_stride,
+            .src_offset = src_offset,
+            .src_stride = src_stride,
+         };
+
+         /* Packed data is laid out in op order, so it stays contiguous
+          * whenever the op merges.
+          */
+         if (program->op_count == 0 ||
+             !descriptor_template_ops_merge(&program->ops[program->op_count - 1],
+                                            &op))
+            program->ops[program->op_count++] = op;
+
+         program->packed_size += count * packed_stride;
+      }
+
+      src_offset += count * src_stride;
+      remaining -= count;
+      binding++;
+      element = 0;
+   }
+
+   return pieces;
+}
+
+VkResult
+vk_descriptor_template_program_create(struct vk_device *device,
+                                      const VkAllocationCallbacks *alloc,
+                                      const VkDescriptorUpdateTemplateCreateInfo *info,
+                                      const struct vk_descriptor_template_binding *bindings,
+                                      uint32_t binding_count,
+                                      struct vk_descriptor_template_program **program_out)
+{
+   struct vk_descriptor_template_program *program;
+
+   uint32_t max_op_count = 0;
+   for (uint32_t i = 0; i < info->descriptorUpdateEntryCount; i++) {
+      max_op_count +=
+         descriptor_template_emit_entry(NULL, &info->pDescriptorUpdateEntries[i],
+                                        bindings, binding_count);
+   }
+
+   size_t size = sizeof(*program) + max_op_count * sizeof(program->ops[0]);
+   program = vk_alloc2(&device->alloc, alloc, size, 8,
+                       VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   if (program == NULL)
+      return vk_error(device, VK_ERROR_OUT_OF_HOST_MEMORY);
+
+   program->op_count = 0;
+   program->packed_size = 0;
+   for (uint32_t i = 0; i < info->descriptorUpdateEntryCount; i++) {
+      descriptor_template_emit_entry(program, &info->pDescriptorUpdateEntries[i],
+                                     bindings, binding_count);
+   }
+   assert(program->op_count <= max_op_count);
+
+   *program_out = program;
+
+   return VK_SUCCESS;
+}
+
+void
+vk_descriptor_template_program_destroy(struct vk_device *device,
+                                       const VkAllocationCallbacks *alloc,
+                                       struct vk_descriptor_template_program *program)
+{
+   vk_free2(&device->alloc, alloc, program);
+}
+
+void
+vk_descriptor_template_pack(const struct vk_descriptor_template_program *program,
+                            void *dst, const void *data)
+{
+   for (uint32_t i = 0; i < program->op_count; i++) {
+      const struct vk_descriptor_template_op *op = &program->ops[i];
+      const uint8_t *src = (const uint8_t *)data + op->src_offset;
+      uint8_t *packed = (uint8_t *)dst + op->packed_offset;
+
+      if (op->src_stride == op->packed_stride) {
+         memcpy(packed, src, op->count * op->packed_stride);
+         continue;
+      }
+
+      for (uint32_t j = 0; j < op->count; j++) {
+         memcpy(packed, src, op->packed_stride);
+         packed += op->packed_stride;
+         src += op->src_stride;
+      }
+   }
+}
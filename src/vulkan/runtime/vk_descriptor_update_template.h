@@ -55,6 +55,87 @@ struct vk_descriptor_template_entry {
    size_t stride;
 };
 
+/** Driver description of a descriptor set layout binding
+ *
+ * This tells vk_descriptor_template_program_create() where the elements of
+ * a binding live in the driver's descriptor set storage, so that contiguous
+ * runs can be merged into a single op.  Offsets and strides are in whatever
+ * unit the driver likes, as long as it is the same for all bindings.
+ */
+struct vk_descriptor_template_binding {
+   /** Number of array elements in the binding, or its size in bytes for
+    * inline uniform blocks
+    */
+   uint32_t array_size;
+
+   /** Offset of array element 0 in the driver's storage */
+   uint32_t offset;
+
+   /** Stride between array elements in the driver's storage
+    *
+    * Ignored for inline uniform blocks, which are always addressed in bytes.
+    */
+   uint32_t stride;
+
+   /** Driver-defined flags, copied into every op of this binding
+    *
+    * Elements of two different bindings only end up in the same op if their
+    * flags are equal, so a driver which needs the binding of every element
+    * can make the flags unique per binding.
+    */
+   uint32_t flags;
+};
+
+/** A run of descriptors of a single type, as copied by a template update
+ *
+ * The i-th descriptor of the op is read from
+ * `data + src_offset + i * src_stride` and written to
+ * `dst_offset + i * dst_stride` in the driver's storage.  For inline uniform
+ * blocks, count, array_element and both strides are in bytes, and the whole
+ * op is a single memcpy().
+ */
+struct vk_descriptor_template_op {
+   VkDescriptorType type;
+
+   /** vk_descriptor_template_binding::flags of the first binding */
+   uint32_t flags;
+
+   /** Binding and array element of the first descriptor */
+   uint32_t binding;
+   uint32_t array_element;
+
+   /** Number of descriptors */
+   uint32_t count;
+
+   uint32_t dst_offset;
+   uint32_t dst_stride;
+
+   /** Offset and stride of the descriptors in the data packed by
+    * vk_descriptor_template_pack()
+    */
+   uint32_t packed_offset;
+   uint32_t packed_stride;
+
+   size_t src_offset;
+   size_t src_stride;
+};
+
+/** A template compiled against a descriptor set layout
+ *
+ * Entries rolling over into consecutive bindings are split per binding, and
+ * runs of descriptors of the same type which are contiguous both in the user
+ * data and in the driver's storage are merged, so that drivers can execute
+ * an update with one switch per op rather than per descriptor.
+ */
+struct vk_descriptor_template_program {
+   uint32_t op_count;
+
+   /** Size of the data written by vk_descriptor_template_pack() */
+   uint32_t packed_size;
+
+   struct vk_descriptor_template_op ops[0];
+};
+
 struct vk_descriptor_update_template {
    struct vk_object_base base;
 
@@ -75,6 +156,12 @@ struct vk_descriptor_update_template {
    /** VkDescriptorUpdateTemplateCreateInfo::descriptorUpdateEntryCount */
    uint32_t entry_count;
 
+   /** Compiled template, or NULL if the driver doesn't compile templates
+    *
+    * Freed by vk_common_DestroyDescriptorUpdateTemplate().
+    */
+   struct vk_descriptor_template_program *program;
+
    /** Entries of the template */
    struct vk_descriptor_template_entry entries[0];
 };
@@ -83,6 +170,47 @@ VK_DEFINE_NONDISP_HANDLE_CASTS(vk_descriptor_update_template, base,
                                VkDescriptorUpdateTemplate,
                                VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE)
 
+/** Size of one descriptor of the given type in template data
+ *
+ * Returns 1 for inline uniform blocks, whose template entries count bytes.
+ */
+uint32_t
+vk_descriptor_template_element_size(VkDescriptorType type);
+
+VkResult
+vk_descriptor_template_program_create(struct vk_device *device,
+                                      const VkAllocationCallbacks *alloc,
+                                      const VkDescriptorUpdateTemplateCreateInfo *info,
+                                      const struct vk_descriptor_template_binding *bindings,
+                                      uint32_t binding_count,
+                                      struct vk_descriptor_template_program **program_out);
+
+void
+vk_descriptor_template_program_destroy(struct vk_device *device,
+                                       const VkAllocationCallbacks *alloc,
+                                       struct vk_descriptor_template_program *program);
+
+/** Copy the descriptors read by a program into program->packed_size bytes
+ *
+ * This is for drivers which defer push descriptor updates and have to keep
+ * a copy of the data, which is usually much smaller than the whole range
+ * spanned by the template.
+ */
+void
+vk_descriptor_template_pack(const struct vk_descriptor_template_program *program,
+                            void *dst, const void *data);
+
+/** Returns the first descriptor of an op in the user or packed data, and
+ * the stride to the following ones
+ */
+static inline const uint8_t *
+vk_descriptor_template_op_src(const struct vk_descriptor_template_op *op,
+                              const void *data, bool packed, size_t *stride)
+{
+   *stride = packed ? op->packed_stride : op->src_stride;
+   return (const uint8_t *)data + (packed ? op->packed_offset : op->src_offset);
+}
+
 #ifdef __cplusplus
 }
 #endif
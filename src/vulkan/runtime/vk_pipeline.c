@@ -31,7 +31,7 @@
 
 #include "nir_serialize.h"
 
-#include "util/mesa-sha1.h"
+#include "util/mesa-cache-key.h"
 #include "util/mesa-blake3.h"
 
 bool
@@ -157,7 +157,7 @@ vk_pipeline_hash_shader_stage(const VkPipelineShaderStageCreateInfo *info,
       blob_init(&blob);
       nir_serialize(&blob, module->nir, false);
       assert(!blob.out_of_memory);
-      _mesa_sha1_compute(blob.data, blob.size, stage_sha1);
+      _mesa_cache_key_compute(blob.data, blob.size, stage_sha1);
       blob_finish(&blob);
       return;
    }
@@ -167,51 +167,51 @@ vk_pipeline_hash_shader_stage(const VkPipelineShaderStageCreateInfo *info,
    const VkPipelineShaderStageModuleIdentifierCreateInfoEXT *iinfo =
       vk_find_struct_const(info->pNext, PIPELINE_SHADER_STAGE_MODULE_IDENTIFIER_CREATE_INFO_EXT);
 
-   struct mesa_sha1 ctx;
+   struct mesa_cache_key_ctx ctx;
 
-   _mesa_sha1_init(&ctx);
+   _mesa_cache_key_init(&ctx);
 
-   _mesa_sha1_update(&ctx, &info->flags, sizeof(info->flags));
+   _mesa_cache_key_update(&ctx, &info->flags, sizeof(info->flags));
 
    assert(util_bitcount(info->stage) == 1);
-   _mesa_sha1_update(&ctx, &info->stage, sizeof(info->stage));
+   _mesa_cache_key_update(&ctx, &info->stage, sizeof(info->stage));
 
    if (module) {
-      _mesa_sha1_update(&ctx, module->hash, sizeof(module->hash));
+      _mesa_cache_key_update(&ctx, module->hash, sizeof(module->hash));
    } else if (minfo) {
       blake3_hash spirv_hash;
 
       _mesa_blake3_compute(minfo->pCode, minfo->codeSize, spirv_hash);
-      _mesa_sha1_update(&ctx, spirv_hash, sizeof(spirv_hash));
+      _mesa_cache_key_update(&ctx, spirv_hash, sizeof(spirv_hash));
    } else {
       /* It is legal to pass in arbitrary identifiers as long as they don't exceed
        * the limit. Shaders with bogus identifiers are more or less guaranteed to fail. */
       assert(iinfo);
       assert(iinfo->identifierSize <= VK_MAX_SHADER_MODULE_IDENTIFIER_SIZE_EXT);
-      _mesa_sha1_update(&ctx, iinfo->pIdentifier, iinfo->identifierSize);
+      _mesa_cache_key_update(&ctx, iinfo->pIdentifier, iinfo->identifierSize);
    }
 
    if (rstate) {
-      _mesa_sha1_update(&ctx, &rstate->storage_buffers, sizeof(rstate->storage_buffers));
-      _mesa_sha1_update(&ctx, &rstate->uniform_buffers, sizeof(rstate->uniform_buffers));
-      _mesa_sha1_update(&ctx, &rstate->vertex_inputs, sizeof(rstate->vertex_inputs));
-      _mesa_sha1_update(&ctx, &rstate->images, sizeof(rstate->images));
+      _mesa_cache_key_update(&ctx, &rstate->storage_buffers, sizeof(rstate->storage_buffers));
+      _mesa_cache_key_update(&ctx, &rstate->uniform_buffers, sizeof(rstate->uniform_buffers));
+      _mesa_cache_key_update(&ctx, &rstate->vertex_inputs, sizeof(rstate->vertex_inputs));
+      _mesa_cache_key_update(&ctx, &rstate->images, sizeof(rstate->images));
    }
 
-   _mesa_sha1_update(&ctx, info->pName, strlen(info->pName));
+   _mesa_cache_key_update(&ctx, info->pName, strlen(info->pName));
 
    if (info->pSpecializationInfo) {
-      _mesa_sha1_update(&ctx, info->pSpecializationInfo->pMapEntries,
-                        info->pSpecializationInfo->mapEntryCount *
-                        sizeof(*info->pSpecializationInfo->pMapEntries));
-      _mesa_sha1_update(&ctx, info->pSpecializationInfo->pData,
-                        info->pSpecializationInfo->dataSize);
+      _mesa_cache_key_update(&ctx, info->pSpecializationInfo->pMapEntries,
+                             info->pSpecializationInfo->mapEntryCount *
+                             sizeof(*info->pSpecializationInfo->pMapEntries));
+      _mesa_cache_key_update(&ctx, info->pSpecializationInfo->pData,
+                             info->pSpecializationInfo->dataSize);
    }
 
    uint32_t req_subgroup_size = get_required_subgroup_size(info);
-   _mesa_sha1_update(&ctx, &req_subgroup_size, sizeof(req_subgroup_size));
+   _mesa_cache_key_update(&ctx, &req_subgroup_size, sizeof(req_subgroup_size));
 
-   _mesa_sha1_final(&ctx, stage_sha1);
+   _mesa_cache_key_final(&ctx, stage_sha1);
 }
 
 static VkPipelineRobustnessBufferBehaviorEXT
@@ -57,7 +57,7 @@ struct vk_pipeline_robustness_state {
 /** Hash VkPipelineShaderStageCreateInfo info
  *
  * Returns the hash of a VkPipelineShaderStageCreateInfo:
- *    SHA1(info->module->sha1,
+ *    HASH(info->module->sha1,
  *         info->pName,
  *         vk_stage_to_mesa_stage(info->stage),
  *         info->pSpecializationInfo)
@@ -453,6 +453,139 @@ done:
    return result;
 }
 
+DEBUG_GET_ONCE_BOOL_OPTION(submit_merge, "MESA_VK_SUBMIT_MERGE", true)
+
+/* Upper bound on how many vk_queue_submits go into one driver submit, so a
+ * long backlog still trickles out to the kernel.
+ */
+#define VK_QUEUE_MAX_MERGED_SUBMITS 32
+
+static bool
+vk_queue_submit_can_merge(struct vk_queue *queue,
+                          const struct vk_queue_submit *first,
+                          const struct vk_queue_submit *submit)
+{
+   if (submit->buffer_bind_count || submit->image_opaque_bind_count ||
+       submit->image_bind_count)
+      return false;
+
+   if (submit->perf_pass_index != first->perf_pass_index)
+      return false;
+
+   /* There is only room for one in the merged submit */
+   if (submit->_mem_signal_temp != NULL)
+      return false;
+
+   /* The waits get checked from the CPU */
+   for (uint32_t i = 0; i < submit->wait_count; i++) {
+      if (!(submit->waits[i].sync->type->features & VK_SYNC_FEATURE_CPU_WAIT))
+         return false;
+   }
+
+   return true;
+}
+
+/* Collects the submits following the first one in the queue that can go to
+ * the driver along with it.  Must be called from the submit thread, without
+ * the submit mutex held.
+ */
+static uint32_t
+vk_queue_collect_merge(struct vk_queue *queue,
+                       struct vk_queue_submit **submits)
+{
+   struct vk_queue_submit *first = submits[0];
+   uint32_t count = 1, ready;
+
+   if (!debug_get_option_submit_merge() ||
+       first->buffer_bind_count || first->image_opaque_bind_count ||
+       first->image_bind_count)
+      return 1;
+
+   mtx_lock(&queue->submit.mutex);
+   list_for_each_entry(struct vk_queue_submit, submit,
+                       &queue->submit.submits, link) {
+      if (submit == first)
+         continue;
+
+      if (count == VK_QUEUE_MAX_MERGED_SUBMITS ||
+          !vk_queue_submit_can_merge(queue, first, submit))
+         break;
+
+      submits[count++] = submit;
+   }
+   mtx_unlock(&queue->submit.mutex);
+
+   /* Only merge submits whose waits have already completed.  Waits that are
+    * merely pending could depend on something the merged submit signals,
+    * since those signals now happen only once the whole batch is done.
+    *
+    * Checking may go to the kernel, so it's done without the lock.  Only
+    * this thread takes submits off the list, so they stay around.
+    */
+   for (ready = 1; ready < count; ready++) {
+      if (vk_sync_wait_many(queue->base.device,
+                            submits[ready]->wait_count, submits[ready]->waits,
+                            VK_SYNC_WAIT_COMPLETE, 0) != VK_SUCCESS)
+         break;
+   }
+
+   return ready;
+}
+
+/* Builds one vk_queue_submit out of several, in order.  The merged submit
+ * takes over the temporaries of the originals, which must only be freed,
+ * not cleaned up, afterwards.
+ */
+static struct vk_queue_submit *
+vk_queue_merge_submits(struct vk_queue *queue,
+                       struct vk_queue_submit **submits,
+                       uint32_t count)
+{
+   uint32_t wait_count = 0, command_buffer_count = 0, signal_count = 0;
+   for (uint32_t i = 0; i < count; i++) {
+      wait_count += submits[i]->wait_count;
+      command_buffer_count += submits[i]->command_buffer_count;
+      signal_count += submits[i]->signal_count;
+   }
+
+   struct vk_queue_submit *merged =
+      vk_queue_submit_alloc(queue, wait_count, command_buffer_count,
+                            0, 0, 0, 0, 0, signal_count, NULL, NULL);
+   if (merged == NULL)
+      return NULL;
+
+   merged->perf_pass_index = submits[0]->perf_pass_index;
+   merged->_mem_signal_temp = submits[0]->_mem_signal_temp;
+   submits[0]->_mem_signal_temp = NULL;
+
+   uint32_t w = 0, c = 0, s = 0;
+   for (uint32_t i = 0; i < count; i++) {
+      struct vk_queue_submit *submit = submits[i];
+
+      typed_memcpy(&merged->waits[w], submit->waits, submit->wait_count);
+      typed_memcpy(&merged->_wait_temps[w], submit->_wait_temps,
+                   submit->wait_count);
+      if (merged->_wait_points != NULL) {
+         typed_memcpy(&merged->_wait_points[w], submit->_wait_points,
+                      submit->wait_count);
+      }
+      w += submit->wait_count;
+
+      typed_memcpy(&merged->command_buffers[c], submit->command_buffers,
+                   submit->command_buffer_count);
+      c += submit->command_buffer_count;
+
+      typed_memcpy(&merged->signals[s], submit->signals, submit->signal_count);
+      if (merged->_signal_points != NULL) {
+         typed_memcpy(&merged->_signal_points[s], submit->_signal_points,
+                      submit->signal_count);
+      }
+      s += submit->signal_count;
+   }
+
+   return merged;
+}
+
 static int
 vk_queue_submit_thread_func(void *_data)
 {
@@ -487,6 +620,23 @@ vk_queue_submit_thread_func(void *_data)
          return 1;
       }
 
+      /* Anything queued up behind it that is ready too goes to the driver
+       * in the same submit.
+       */
+      struct vk_queue_submit *submits[VK_QUEUE_MAX_MERGED_SUBMITS];
+      submits[0] = submit;
+
+      uint32_t submit_count = vk_queue_collect_merge(queue, submits);
+
+      if (submit_count > 1) {
+         struct vk_queue_submit *merged =
+            vk_queue_merge_submits(queue, submits, submit_count);
+         if (merged != NULL)
+            submit = merged;
+         else
+            submit_count = 1;
+      }
+
       result = vk_queue_submit_final(queue, submit);
       if (unlikely(result != VK_SUCCESS)) {
          vk_queue_set_lost(queue, "queue::driver_submit failed");
@@ -498,15 +648,24 @@ vk_queue_submit_thread_func(void *_data)
        * that under the lock.
        */
       vk_queue_submit_cleanup(queue, submit);
+      if (submit_count > 1)
+         vk_queue_submit_free(queue, submit);
 
       mtx_lock(&queue->submit.mutex);
 
-      /* Only remove the submit from from the list and free it after
+      /* Only remove the submits from from the list and free them after
        * queue->submit() has completed.  This ensures that, when
        * vk_queue_drain() completes, there are no more pending jobs.
        */
-      list_del(&submit->link);
-      vk_queue_submit_free(queue, submit);
+      for (uint32_t i = 0; i < submit_count; i++) {
+         list_del(&submits[i]->link);
+         vk_queue_submit_free(queue, submits[i]);
+      }
+
+      queue->submit.stats.submits += submit_count;
+      queue->submit.stats.driver_submits++;
+      if (submit_count > 1)
+         queue->submit.stats.merged_submits += submit_count - 1;
 
       cnd_broadcast(&queue->submit.pop);
    }
@@ -61,7 +61,10 @@ struct vk_queue {
     *
     * When using the common implementation of vkQueueSubmit(), this function
     * is called to do the final submit to the kernel driver after all
-    * semaphore dependencies have been resolved.  Depending on the timeline
+    * semaphore dependencies have been resolved.  The submit thread may pass
+    * several consecutive vkQueueSubmit2() batches merged into one
+    * `vk_queue_submit`, with their waits, command buffers and signals
+    * concatenated in order.  Depending on the timeline
     * mode and application usage, this function may be called directly from
     * the client thread on which vkQueueSubmit was called or from a runtime-
     * managed submit thread.  We do, however, guarantee that as long as the
@@ -96,6 +99,21 @@ struct vk_queue {
 
       bool thread_run;
       thrd_t thread;
+
+      /** Submit thread statistics
+       *
+       * The submit thread hands consecutive submits whose waits have
+       * already completed to `vk_queue::driver_submit` together, as one
+       * `vk_queue_submit`.  These count how much that happens.
+       */
+      struct {
+         /* vk_queue_submits processed */
+         uint64_t submits;
+         /* Calls to vk_queue::driver_submit */
+         uint64_t driver_submits;
+         /* vk_queue_submits that went to the driver with an earlier one */
+         uint64_t merged_submits;
+      } stats;
    } submit;
 
    struct {
@@ -55,6 +55,7 @@ static const struct debug_control debug_control[] = {
    { "noshm",        WSI_DEBUG_NOSHM },
    { "linear",       WSI_DEBUG_LINEAR },
    { "dxgi",         WSI_DEBUG_DXGI },
+   { "shmput",       WSI_DEBUG_SHMPUT },
    { NULL, },
 };
 
@@ -75,6 +75,8 @@ struct wsi_x11_connection {
    bool is_proprietary_x11;
    bool is_xwayland;
    bool has_mit_shm;
+   /* MIT-SHM can be used for ShmPutImage, but not for Present pixmaps */
+   bool has_mit_shm_put;
    bool has_xfixes;
 };
 
@@ -331,28 +333,42 @@ wsi_x11_connection_create(struct wsi_device *wsi_dev,
       wsi_conn->is_proprietary_x11 = true;
 
    wsi_conn->has_mit_shm = false;
-   if (wsi_conn->has_dri3 && wsi_conn->has_present && wants_shm) {
-      bool has_mit_shm = shm_reply->present != 0;
-
+   wsi_conn->has_mit_shm_put = false;
+   if (wants_shm && shm_reply->present &&
+       ((wsi_conn->has_dri3 && wsi_conn->has_present) ||
+        (WSI_DEBUG & WSI_DEBUG_SHMPUT))) {
       xcb_shm_query_version_cookie_t ver_cookie;
       xcb_shm_query_version_reply_t *ver_reply;
 
       ver_cookie = xcb_shm_query_version(conn);
       ver_reply = xcb_shm_query_version_reply(conn, ver_cookie, NULL);
 
-      has_mit_shm = ver_reply->shared_pixmaps;
+      bool shared_pixmaps = ver_reply && ver_reply->shared_pixmaps;
       free(ver_reply);
       xcb_void_cookie_t cookie;
       xcb_generic_error_t *error;
 
-      if (has_mit_shm) {
-         cookie = xcb_shm_detach_checked(conn, 0);
-         if ((error = xcb_request_check(conn, cookie))) {
-            if (error->error_code != BadRequest)
-               wsi_conn->has_mit_shm = true;
-            free(error);
-         }
+      /* Detaching segment 0 fails with BadValue if we can use MIT-SHM, and
+       * with BadRequest if the server won't let us, e.g. when remote.
+       */
+      bool can_use_shm = false;
+      cookie = xcb_shm_detach_checked(conn, 0);
+      if ((error = xcb_request_check(conn, cookie))) {
+         if (error->error_code != BadRequest)
+            can_use_shm = true;
+         free(error);
       }
+
+      /* Presenting SHM pixmaps needs DRI3 for the fences.  Without it, e.g.
+       * on Xvfb, we can still put the images from SHM rather than sending
+       * them over the socket.  That path is opt-in with
+       * MESA_VK_WSI_DEBUG=shmput until it has seen more testing.
+       */
+      if (can_use_shm && shared_pixmaps &&
+          wsi_conn->has_dri3 && wsi_conn->has_present)
+         wsi_conn->has_mit_shm = true;
+      else if (WSI_DEBUG & WSI_DEBUG_SHMPUT)
+         wsi_conn->has_mit_shm_put = can_use_shm;
    }
 
    free(dri3_reply);
@@ -1041,6 +1057,8 @@ struct x11_image {
    xcb_shm_seg_t                             shmseg;
    int                                       shmid;
    uint8_t *                                 shmaddr;
+   xcb_void_cookie_t                         shm_put_cookie;
+   bool                                      shm_put_pending;
    uint64_t                                  present_id;
    uint64_t                                  signal_present_id;
 };
@@ -1050,6 +1068,8 @@ struct x11_swapchain {
 
    bool                                         has_dri3_modifiers;
    bool                                         has_mit_shm;
+   bool                                         has_mit_shm_put;
+   uint32_t                                     last_sw_image;
 
    xcb_connection_t *                           conn;
    xcb_connection_t *                           capture_conn;
@@ -1646,14 +1666,11 @@ x11_present_to_x11_dri3(struct x11_swapchain *chain, uint32_t image_index,
 }
 
 /**
- * Send image to X server unaccelerated (software drivers).
+ * Send the image contents over the socket with PutImage requests.
  */
-static VkResult
-x11_present_to_x11_sw(struct x11_swapchain *chain, uint32_t image_index,
-                      uint64_t target_msc)
+static void
+x11_put_image_sw(struct x11_swapchain *chain, struct x11_image *image)
 {
-   struct x11_image *image = &chain->images[image_index];
-
    xcb_void_cookie_t cookie;
    void *myptr = image->base.cpu_map;
    size_t hdr_len = sizeof(xcb_put_image_request_t);
@@ -1690,6 +1707,42 @@ x11_present_to_x11_sw(struct x11_swapchain *chain, uint32_t image_index,
          y_todo -= this_lines;
       }
    }
+}
+
+/**
+ * Send image to X server unaccelerated (software drivers).
+ */
+static VkResult
+x11_present_to_x11_sw(struct x11_swapchain *chain, uint32_t image_index,
+                      uint64_t target_msc)
+{
+   struct x11_image *image = &chain->images[image_index];
+
+   chain->last_sw_image = image_index;
+
+   /* The image lives in a SHM segment the server has attached, so it only
+    * needs the request.  The server is done with the segment once the
+    * request is processed, which x11_acquire_next_image() checks before
+    * handing the image out again.
+    */
+   if (chain->has_mit_shm_put && image->shmseg) {
+      image->shm_put_cookie =
+         xcb_shm_put_image_checked(chain->conn, chain->window, chain->gc,
+                                   image->base.row_pitches[0] / 4,
+                                   chain->extent.height,
+                                   0, 0,
+                                   chain->extent.width, chain->extent.height,
+                                   0, 0, chain->depth,
+                                   XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                   0 /* send_event */,
+                                   image->shmseg, 0);
+      image->shm_put_pending = true;
+      image->busy = false;
+      xcb_flush(chain->conn);
+      return x11_swapchain_result(chain, VK_SUCCESS);
+   }
+
+   x11_put_image_sw(chain, image);
 
    chain->images[image_index].busy = false;
    xcb_flush(chain->conn);
@@ -1808,6 +1861,33 @@ x11_acquire_next_image(struct wsi_swapchain *anv_chain,
             }
             free(err);
             free(geom);
+
+            /* The geometry reply came after the last ShmPutImage from this
+             * image was processed, so this doesn't add a round trip.
+             */
+            if (chain->images[i].shm_put_pending) {
+               err = xcb_request_check(chain->conn,
+                                       chain->images[i].shm_put_cookie);
+               chain->images[i].shm_put_pending = false;
+               if (err) {
+                  /* Send the images over the socket from now on, starting
+                   * with the newest frame so the window doesn't keep
+                   * showing a stale one.  Its contents are intact unless
+                   * the application has already acquired it again.
+                   */
+                  struct x11_image *last =
+                     &chain->images[chain->last_sw_image];
+
+                  chain->has_mit_shm_put = false;
+                  free(err);
+
+                  if (chain->last_sw_image == i || !last->busy) {
+                     x11_put_image_sw(chain, last);
+                     xcb_flush(chain->conn);
+                  }
+               }
+            }
+
             return result;
          }
       }
@@ -2115,6 +2195,13 @@ x11_image_init(VkDevice device_h, struct x11_swapchain *chain,
 
    if (chain->base.wsi->sw) {
       if (!chain->has_mit_shm) {
+         /* alloc_shm() may have failed, in which case this image is sent
+          * over the socket.
+          */
+         if (chain->has_mit_shm_put && image->shmaddr) {
+            image->shmseg = xcb_generate_id(chain->conn);
+            xcb_shm_attach(chain->conn, image->shmseg, image->shmid, 0);
+         }
          image->busy = false;
          return VK_SUCCESS;
       }
@@ -2252,6 +2339,9 @@ x11_image_finish(struct x11_swapchain *chain,
 
       cookie = xcb_xfixes_destroy_region(chain->conn, image->update_region);
       xcb_discard_reply(chain->conn, cookie.sequence);
+   } else if (image->shmseg) {
+      cookie = xcb_shm_detach(chain->conn, image->shmseg);
+      xcb_discard_reply(chain->conn, cookie.sequence);
    }
 
    wsi_destroy_image(&chain->base, &image->base);
@@ -2697,7 +2787,8 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    if (wsi_device->sw) {
       cpu_image_params = (struct wsi_cpu_image_params) {
          .base.image_type = WSI_IMAGE_TYPE_CPU,
-         .alloc_shm = wsi_conn->has_mit_shm ? &alloc_shm : NULL,
+         .alloc_shm = wsi_conn->has_mit_shm || wsi_conn->has_mit_shm_put ?
+                      &alloc_shm : NULL,
       };
       image_params = &cpu_image_params.base;
    } else {
@@ -2746,6 +2837,8 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->status = VK_SUCCESS;
    chain->has_dri3_modifiers = wsi_conn->has_dri3_modifiers;
    chain->has_mit_shm = wsi_conn->has_mit_shm;
+   chain->has_mit_shm_put = wsi_conn->has_mit_shm_put;
+   chain->last_sw_image = 0;
    chain->surface = (struct wsi_x11_vk_surface*)icd_surface;
    chain->surface->extent = pCreateInfo->imageExtent;
 